@@ -0,0 +1,939 @@
+/*
+    focagg.cpp
+    ----------
+    GROUP BY for the FocFile C++ library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "focagg.h"
+#include "focsketch.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+// Aggregate functions
+#define AGG_COUNT	0
+#define AGG_SUM		1
+#define AGG_MIN		2
+#define AGG_MAX		3
+#define AGG_AVG		4
+#define AGG_DISTINCT	5
+#define AGG_PERCENTILE	6
+
+struct FOCAGG_FIELD {
+	int	seg;
+	int	offset;
+	char	type;
+	int	length;
+	int	key_offset;	// BY fields: where it lies in the group key
+	int	function;	// measures
+	double	percent;	// AGG_PERCENTILE
+};
+
+// One measure of one group
+struct FOCAGG_ACC {
+	long	count;
+	double	sum;
+	double	min;
+	double	max;
+	FOCHLL		*distinct;	// sketches, made at the first record
+	FOCQUANTILES	*quantiles;
+};
+
+// The instances of one level of a FOCROLLUP
+struct FOCROLLUP_LEVEL {
+	int	seg;
+	long	count;
+	long	allocated;
+	long	*parent;
+	long	*children;
+	long	*subtotal;
+	int	*page;
+	int	*word;
+	int	*type;
+	double	*totals;	// Num_measures per instance
+};
+
+static unsigned int hash_key(UCHAR *key, int length);
+
+// =============================================================
+// CLASS: FOCAGG
+// -------------------------------------------------------------
+// Hash aggregation over the records of one segment.
+// =============================================================
+FOCAGG::FOCAGG(FOCFILE* foc, int seg) {
+
+	Foc		= foc;
+	Seg		= seg;
+	Scan		= new FOCSCAN(foc, seg);
+	Prepared	= 0;
+
+	By		= NULL;
+	Num_by		= 0;
+	Key_length	= 0;
+	Key		= NULL;
+
+	Measure		= NULL;
+	Num_measures	= 0;
+
+	Data		= NULL;
+	Data_chain	= -1;
+
+	Stream_level	= -1;
+	Last_chain	= -1;
+	Pending		= 0;
+
+	Group_keys	= NULL;
+	Acc		= NULL;
+	Num_groups	= 0;
+	Allocated_groups = 0;
+
+	Table		= NULL;
+	Table_size	= 0;
+
+	Ready		= 0;
+	Current		= -1;
+	Done		= 0;
+	Groups_out	= 0;
+}
+
+FOCAGG::~FOCAGG() {
+
+	Clear_groups();
+	delete Scan;
+	free(By);
+	free(Key);
+	free(Measure);
+	free(Data);
+	free(Group_keys);
+	free(Acc);
+	free(Table);
+}
+
+void FOCAGG::where(FOCEXPR& expr) {
+
+	if (Prepared) {
+		die("AGG::where called after next()\n");
+	}
+
+	Scan->where(expr);
+}
+
+void FOCAGG::group_by(int seg, int offset, char type, int length) {
+
+	if (Prepared) {
+		die("AGG::group_by called after next()\n");
+	}
+
+	if (!On_path(seg)) {
+		die("AGG::group_by field in segment %d, which is not segment "
+			"%d or one of its parents\n", seg, Seg);
+	}
+
+	By = (FOCAGG_FIELD*) xrealloc("AGG BY fields", By,
+			sizeof(FOCAGG_FIELD) * (Num_by + 1));
+
+	FOCAGG_FIELD *by = &By[Num_by++];
+	by->seg		= seg;
+	by->offset	= offset;
+	by->type	= type;
+	by->length	= length;
+	by->key_offset	= Key_length;
+	by->function	= 0;
+
+	Key_length += length;
+}
+
+int FOCAGG::count(void) {
+	return Add_measure(AGG_COUNT, 0, 0, '?', 0);
+}
+
+int FOCAGG::sum(int seg, int offset, char type, int length) {
+	return Add_measure(AGG_SUM, seg, offset, type, length);
+}
+
+int FOCAGG::min(int seg, int offset, char type, int length) {
+	return Add_measure(AGG_MIN, seg, offset, type, length);
+}
+
+int FOCAGG::max(int seg, int offset, char type, int length) {
+	return Add_measure(AGG_MAX, seg, offset, type, length);
+}
+
+int FOCAGG::avg(int seg, int offset, char type, int length) {
+	return Add_measure(AGG_AVG, seg, offset, type, length);
+}
+
+int FOCAGG::distinct(int seg, int offset, char type, int length) {
+	return Add_measure(AGG_DISTINCT, seg, offset, type, length);
+}
+
+int FOCAGG::percentile(int seg, int offset, char type, int length,
+			double percent) {
+
+	if (percent < 0 || percent > 100) {
+		die("AGG percentile %g is not from 0 to 100\n", percent);
+	}
+
+	int measure = Add_measure(AGG_PERCENTILE, seg, offset, type, length);
+	Measure[measure].percent = percent;
+	return measure;
+}
+
+int FOCAGG::Add_measure(int function, int seg, int offset, char type,
+			int length) {
+
+	if (Prepared) {
+		die("AGG measure added after next()\n");
+	}
+
+	if (function != AGG_COUNT) {
+		if (function != AGG_DISTINCT &&
+				type != FIELDTYPE_INTEGER &&
+				type != FIELDTYPE_DOUBLE &&
+				type != FIELDTYPE_FLOAT &&
+				type != FIELDTYPE_SMDATE) {
+			die("AGG can't aggregate a field of type %c\n", type);
+		}
+		if (!On_path(seg)) {
+			die("AGG field in segment %d, which is not segment "
+				"%d or one of its parents\n", seg, Seg);
+		}
+	}
+
+	Measure = (FOCAGG_FIELD*) xrealloc("AGG measures", Measure,
+			sizeof(FOCAGG_FIELD) * (Num_measures + 1));
+
+	FOCAGG_FIELD *m = &Measure[Num_measures];
+	m->seg		= seg;
+	m->offset	= offset;
+	m->type		= type;
+	m->length	= length;
+	m->key_offset	= 0;
+	m->function	= function;
+	m->percent	= 0;
+
+	return Num_measures++;
+}
+
+// The level of a segment in the hierarchy; the root is 0
+int FOCAGG::Level(int seg) {
+
+	int level = 0;
+
+	while ((seg = Foc->parent(seg)) != 0) {
+		level++;
+	}
+
+	return level;
+}
+
+int FOCAGG::On_path(int seg) {
+
+	for (int s = Seg; s != 0; s = Foc->parent(s)) {
+		if (s == seg) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+Decide whether we can stream. Say the deepest BY field lies at level L.
+If every segment on the path from the root down to level L is S1 or SH1,
+and its key (the field at offset 0) is a BY field, then the BY values
+pick out exactly one instance at level L. All the records of a group
+then sit under that one instance, and the group is complete as soon as
+the scan moves to another one.
+*/
+void FOCAGG::Prepare(void) {
+
+	int	i, s, deepest = -1;
+
+	if (Prepared) {
+		return;
+	}
+
+	Key = (UCHAR*) xrealloc("AGG key", NULL, Key_length + 1);
+	Data = (UCHAR**) xrealloc("AGG data", NULL,
+			sizeof(UCHAR*) * (Foc->number_seg() + 1));
+
+	for (i = 0; i < Num_by; i++) {
+		if (Level(By[i].seg) > deepest) {
+			deepest = Level(By[i].seg);
+			s = By[i].seg;
+		}
+	}
+
+	if (deepest >= 0) {
+		Stream_level = deepest;
+		for (; s != 0; s = Foc->parent(s)) {
+			int keyed = 0;
+			for (i = 0; i < Num_by; i++) {
+				if (By[i].seg == s && By[i].offset == 0) {
+					keyed = 1;
+				}
+			}
+			if (!keyed || Foc->key_fields(s) != 1) {
+				Stream_level = -1;
+				break;
+			}
+		}
+	}
+
+	debug("AGG::Prepare %d BY fields, %d measures, stream level %d\n",
+		Num_by, Num_measures, Stream_level);
+
+	Table_size = 64;
+	Table = (int*) xrealloc("AGG table", NULL, sizeof(int) * Table_size);
+	memset(Table, 0xff, sizeof(int) * Table_size);
+
+	Prepared = 1;
+}
+
+int FOCAGG::is_streaming(void) {
+
+	Prepare();
+	return Stream_level >= 0;
+}
+
+int FOCAGG::next(void) {
+
+	Prepare();
+
+	for (;;) {
+		if (Current + 1 < Ready) {
+			Current++;
+			Groups_out++;
+			return 1;
+		}
+
+		if (Done) {
+			return 0;
+		}
+
+		// Everything handed out so far is finished with
+		Clear_groups();
+
+		// Read until some groups are complete
+		for (;;) {
+			if (!Pending) {
+				if (!Scan->next()) {
+					Done = 1;
+					break;
+				}
+				Read_fields();
+
+				if (Stream_level >= 0 &&
+						Scan->chains() != Last_chain) {
+					Last_chain = Scan->chains();
+					if (Scan->chain_level() <= Stream_level &&
+							Num_groups > 0) {
+						Pending = 1;
+						break;
+					}
+				}
+			}
+			Pending = 0;
+			Add_record();
+		}
+
+		Ready = Num_groups;
+		Current = -1;
+	}
+}
+
+// Point Data[] at the current record of each segment we read from.
+// The ancestors only move when the scan starts a new chain.
+void FOCAGG::Read_fields(void) {
+
+	int	i;
+
+	Data[Seg] = Scan->record();
+
+	if (Scan->chains() == Data_chain) {
+		return;
+	}
+	Data_chain = Scan->chains();
+
+	for (i = 0; i < Num_by; i++) {
+		if (By[i].seg != Seg) {
+			Data[By[i].seg] = Foc->record_data(By[i].seg);
+		}
+	}
+	for (i = 0; i < Num_measures; i++) {
+		if (Measure[i].function != AGG_COUNT &&
+				Measure[i].seg != Seg) {
+			Data[Measure[i].seg] = Foc->record_data(Measure[i].seg);
+		}
+	}
+}
+
+// Find the record's group, creating it if need be, and add to it
+void FOCAGG::Add_record(void) {
+
+	int		i, group;
+	unsigned int	slot;
+	FOCAGG_ACC	*acc;
+
+	for (i = 0; i < Num_by; i++) {
+		memcpy(Key + By[i].key_offset, Data[By[i].seg] + By[i].offset,
+			By[i].length);
+	}
+
+	slot = hash_key(Key, Key_length) & (Table_size - 1);
+	while ((group = Table[slot]) >= 0) {
+		if (memcmp(Group_keys + group * Key_length, Key,
+					Key_length) == 0) {
+			break;
+		}
+		slot = (slot + 1) & (Table_size - 1);
+	}
+
+	// A new group
+	if (group < 0) {
+		if (Num_groups == Allocated_groups) {
+			Allocated_groups = Allocated_groups ?
+						Allocated_groups * 2 : 64;
+			Group_keys = (UCHAR*) xrealloc("AGG groups", Group_keys,
+					Allocated_groups * Key_length + 1);
+			Acc = (FOCAGG_ACC*) xrealloc("AGG measures", Acc,
+					sizeof(FOCAGG_ACC) * Allocated_groups *
+					(Num_measures + 1));
+		}
+
+		group = Num_groups++;
+		memcpy(Group_keys + group * Key_length, Key, Key_length);
+		memset(&Acc[group * Num_measures], 0,
+			sizeof(FOCAGG_ACC) * Num_measures);
+		Table[slot] = group;
+
+		if (Num_groups * 2 > Table_size) {
+			Grow_table();
+		}
+	}
+
+	acc = &Acc[group * Num_measures];
+	for (i = 0; i < Num_measures; i++, acc++) {
+		if (Measure[i].function == AGG_COUNT) {
+			acc->count++;
+			continue;
+		}
+
+		FOCAGG_FIELD *m = &Measure[i];
+		if (m->function == AGG_DISTINCT) {
+			if (!acc->distinct) {
+				acc->distinct = new FOCHLL(m->seg, m->offset,
+						m->type, m->length);
+			}
+			acc->distinct->add(Data[m->seg]);
+			acc->count++;
+			continue;
+		}
+		if (m->function == AGG_PERCENTILE) {
+			if (!acc->quantiles) {
+				acc->quantiles = new FOCQUANTILES(m->seg,
+						m->offset, m->type, m->length);
+			}
+			acc->quantiles->add(Data[m->seg]);
+			acc->count++;
+			continue;
+		}
+
+		double v = field_value(Measure[i].type,
+				Data[Measure[i].seg] + Measure[i].offset);
+
+		if (acc->count == 0 || v < acc->min) acc->min = v;
+		if (acc->count == 0 || v > acc->max) acc->max = v;
+		acc->sum += v;
+		acc->count++;
+	}
+}
+
+// Double the hash table and put the groups back in
+void FOCAGG::Grow_table(void) {
+
+	unsigned int	slot;
+
+	Table_size *= 2;
+	Table = (int*) xrealloc("AGG table", Table, sizeof(int) * Table_size);
+	memset(Table, 0xff, sizeof(int) * Table_size);
+
+	for (int group = 0; group < Num_groups; group++) {
+		slot = hash_key(Group_keys + group * Key_length, Key_length) &
+			(Table_size - 1);
+		while (Table[slot] >= 0) {
+			slot = (slot + 1) & (Table_size - 1);
+		}
+		Table[slot] = group;
+	}
+
+	debug("AGG::Grow_table to %d slots for %d groups\n",
+		Table_size, Num_groups);
+}
+
+void FOCAGG::Clear_groups(void) {
+
+	for (int i = 0; i < Num_groups * Num_measures; i++) {
+		delete Acc[i].distinct;
+		delete Acc[i].quantiles;
+	}
+
+	if (Num_groups > 0) {
+		memset(Table, 0xff, sizeof(int) * Table_size);
+	}
+	Num_groups	= 0;
+	Ready		= 0;
+	Current		= -1;
+}
+
+double FOCAGG::value(int measure) {
+
+	if (Current < 0 || Current >= Ready) {
+		die("AGG::value called with no current group\n");
+	}
+	if (measure < 0 || measure >= Num_measures) {
+		die("AGG::value bad measure %d\n", measure);
+	}
+
+	FOCAGG_ACC *acc = &Acc[Current * Num_measures + measure];
+
+	switch (Measure[measure].function) {
+		case AGG_SUM:
+			return acc->sum;
+		case AGG_MIN:
+			return acc->min;
+		case AGG_MAX:
+			return acc->max;
+		case AGG_AVG:
+			return acc->count ? acc->sum / acc->count : 0.0;
+		case AGG_DISTINCT:
+			return acc->distinct ? acc->distinct->estimate() : 0.0;
+		case AGG_PERCENTILE:
+			return acc->quantiles ? acc->quantiles->quantile(
+				Measure[measure].percent / 100) : 0.0;
+		default:
+			return (double) acc->count;
+	}
+}
+
+// Where a BY field of the current group is stored
+UCHAR* FOCAGG::Group_key(int seg, int offset, char type, int length) {
+
+	if (Current < 0 || Current >= Ready) {
+		die("AGG::hold called with no current group\n");
+	}
+
+	for (int i = 0; i < Num_by; i++) {
+		if (By[i].seg == seg && By[i].offset == offset) {
+			return Group_keys + Current * Key_length +
+				By[i].key_offset;
+		}
+	}
+
+	die("AGG::hold seg %d offset %d is not a BY field\n", seg, offset);
+}
+
+int FOCAGG::hold(char* s, int seg, int offset, char type, int length) {
+
+	if (type != FIELDTYPE_ALPHA) {
+		die("AGG::hold type not Alpha: %c\n", type);
+	}
+
+	memcpy(s, Group_key(seg, offset, type, length), length);
+	return 1;
+}
+
+int FOCAGG::hold(long& l, int seg, int offset, char type, int length) {
+
+	int32_t value;
+
+	if (hold(value, seg, offset, type, length)) {
+		l = value;
+		return 1;
+	}
+
+	return 0;
+}
+
+int FOCAGG::hold(int32_t& i, int seg, int offset, char type, int length) {
+
+	if (type != FIELDTYPE_INTEGER) {
+		die("AGG::hold type not Integer: %c\n", type);
+	}
+
+	memcpy(&i, Group_key(seg, offset, type, length), sizeof(int32_t));
+	return 1;
+}
+
+int FOCAGG::hold(double& d, int seg, int offset, char type, int length) {
+
+	if (type != FIELDTYPE_DOUBLE) {
+		die("AGG::hold type not Double: %c\n", type);
+	}
+
+	memcpy(&d, Group_key(seg, offset, type, length), sizeof(double));
+	return 1;
+}
+
+int FOCAGG::hold(float& f, int seg, int offset, char type, int length) {
+
+	if (type != FIELDTYPE_FLOAT) {
+		die("AGG::hold type not Float: %c\n", type);
+	}
+
+	memcpy(&f, Group_key(seg, offset, type, length), sizeof(float));
+	return 1;
+}
+
+int FOCAGG::hold(SMDATE& smd, int seg, int offset, char type, int length) {
+
+	int32_t value;
+
+	if (type != FIELDTYPE_SMDATE) {
+		die("AGG::hold type not SMDATE: %c\n", type);
+	}
+
+	memcpy(&value, Group_key(seg, offset, type, length), sizeof(int32_t));
+	smd.set_julian(value, SMDATE_FOCUS);
+	return 1;
+}
+
+// =============================================================
+// CLASS: FOCROLLUP
+// -------------------------------------------------------------
+// Counts and totals per instance at every level of a path.
+// =============================================================
+FOCROLLUP::FOCROLLUP(FOCFILE* foc, int seg) {
+
+	int	s;
+
+	if (seg <= 0 || seg > foc->number_seg()) {
+		die("ROLLUP called for non-existant segment %d\n", seg);
+	}
+
+	Foc	= foc;
+	Seg	= seg;
+
+	Depth = 0;
+	for (s = foc->parent(seg); s != 0; s = foc->parent(s)) {
+		Depth++;
+	}
+
+	Path = (int*) xrealloc("ROLLUP path", NULL, sizeof(int) * (Depth + 1));
+	s = seg;
+	for (int level = Depth; level >= 0; level--) {
+		Path[level] = s;
+		s = foc->parent(s);
+	}
+
+	Levels = (FOCROLLUP_LEVEL*) xrealloc("ROLLUP levels", NULL,
+			sizeof(FOCROLLUP_LEVEL) * (Depth + 1));
+	memset(Levels, 0, sizeof(FOCROLLUP_LEVEL) * (Depth + 1));
+	for (int level = 0; level < Depth; level++) {
+		Levels[level].seg = Path[level];
+	}
+
+	Where		= NULL;
+	Measure		= NULL;
+	Num_measures	= 0;
+	Records		= 0;
+	Totals		= NULL;
+}
+
+FOCROLLUP::~FOCROLLUP() {
+
+	for (int level = 0; level < Depth; level++) {
+		FOCROLLUP_LEVEL *lv = &Levels[level];
+		free(lv->parent);
+		free(lv->children);
+		free(lv->subtotal);
+		free(lv->page);
+		free(lv->word);
+		free(lv->type);
+		free(lv->totals);
+	}
+	free(Levels);
+	free(Path);
+	free(Measure);
+	free(Totals);
+}
+
+void FOCROLLUP::where(FOCEXPR& expr) {
+
+	expr.compile(Foc);
+
+	for (int s = 1; s <= Foc->number_seg(); s++) {
+		int on_path = 0;
+		for (int level = 0; level <= Depth; level++) {
+			if (Path[level] == s) on_path = 1;
+		}
+		if (expr.reads_segment(s) && !on_path) {
+			die("ROLLUP::where tests segment %d, which is not "
+				"segment %d or one of its parents\n", s, Seg);
+		}
+	}
+
+	Where = &expr;
+}
+
+int FOCROLLUP::measure(int seg, int offset, char type, int length) {
+
+	if (seg != Seg) {
+		die("ROLLUP::measure field in segment %d, not %d\n", seg, Seg);
+	}
+
+	if (type != FIELDTYPE_INTEGER && type != FIELDTYPE_DOUBLE &&
+			type != FIELDTYPE_FLOAT && type != FIELDTYPE_SMDATE) {
+		die("ROLLUP can't total a field of type %c\n", type);
+	}
+
+	Measure = (FOCAGG_FIELD*) xrealloc("ROLLUP measures", Measure,
+			sizeof(FOCAGG_FIELD) * (Num_measures + 1));
+
+	FOCAGG_FIELD *m = &Measure[Num_measures];
+	m->seg		= seg;
+	m->offset	= offset;
+	m->type		= type;
+	m->length	= length;
+	m->key_offset	= 0;
+	m->function	= AGG_SUM;
+
+	return Num_measures++;
+}
+
+void FOCROLLUP::run(void) {
+
+	for (int level = 0; level < Depth; level++) {
+		Levels[level].count = 0;
+	}
+
+	Records = 0;
+	Totals = (double*) xrealloc("ROLLUP totals", Totals,
+			sizeof(double) * (Num_measures + 1));
+	memset(Totals, 0, sizeof(double) * Num_measures);
+
+	Foc->reposition(Path[0]);
+
+	if (Depth == 0) {
+		Count_records(-1);
+	}
+	else {
+		Descend(0, -1);
+	}
+
+	debug("ROLLUP::run counted %ld records\n", Records);
+}
+
+// Walk the instances of one level under the current parent. Each
+// instance's counts are added to its parent's on the way back up.
+void FOCROLLUP::Descend(int level, long parent) {
+
+	long	i;
+	int	m;
+
+	while (Foc->next(Path[level])) {
+		i = Add_instance(level, parent);
+
+		if (level + 1 < Depth) {
+			Descend(level + 1, i);
+		}
+		else {
+			Count_records(i);
+		}
+
+		if (parent >= 0) {
+			FOCROLLUP_LEVEL *lv = &Levels[level];
+			FOCROLLUP_LEVEL *up = &Levels[level - 1];
+
+			up->children[parent]++;
+			up->subtotal[parent] += lv->subtotal[i];
+			for (m = 0; m < Num_measures; m++) {
+				up->totals[parent * Num_measures + m] +=
+					lv->totals[i * Num_measures + m];
+			}
+		}
+	}
+}
+
+long FOCROLLUP::Add_instance(int level, long parent) {
+
+	FOCROLLUP_LEVEL	*lv = &Levels[level];
+	FOCPTR		where;
+	long		i;
+
+	if (lv->count == lv->allocated) {
+		lv->allocated = lv->allocated ? lv->allocated * 2 : 64;
+		lv->parent = (long*) xrealloc("ROLLUP", lv->parent,
+				sizeof(long) * lv->allocated);
+		lv->children = (long*) xrealloc("ROLLUP", lv->children,
+				sizeof(long) * lv->allocated);
+		lv->subtotal = (long*) xrealloc("ROLLUP", lv->subtotal,
+				sizeof(long) * lv->allocated);
+		lv->page = (int*) xrealloc("ROLLUP", lv->page,
+				sizeof(int) * lv->allocated);
+		lv->word = (int*) xrealloc("ROLLUP", lv->word,
+				sizeof(int) * lv->allocated);
+		lv->type = (int*) xrealloc("ROLLUP", lv->type,
+				sizeof(int) * lv->allocated);
+		lv->totals = (double*) xrealloc("ROLLUP", lv->totals,
+				sizeof(double) * lv->allocated *
+				(Num_measures + 1));
+	}
+
+	i = lv->count++;
+	Foc->position(lv->seg, where);
+
+	lv->parent[i]	= parent;
+	lv->children[i]	= 0;
+	lv->subtotal[i]	= 0;
+	lv->page[i]	= where.page;
+	lv->word[i]	= where.word;
+	lv->type[i]	= where.type;
+	for (int m = 0; m < Num_measures; m++) {
+		lv->totals[i * Num_measures + m] = 0.0;
+	}
+
+	return i;
+}
+
+// Count the records of Seg under the current parent, a page at a time
+void FOCROLLUP::Count_records(long parent) {
+
+	long	count = 0;
+	int	n, r, m;
+
+	if (Where) {
+		Where->bind(Foc, Seg);
+	}
+
+	while ((n = Foc->next_batch(Seg, Batch, FOCSCAN_BATCH)) > 0) {
+		for (r = 0; r < n; r++) {
+			if (Where && !Where->eval_bound(Batch[r])) {
+				continue;
+			}
+			count++;
+
+			for (m = 0; m < Num_measures; m++) {
+				double v = field_value(Measure[m].type,
+					Batch[r] + Measure[m].offset);
+				Totals[m] += v;
+				if (parent >= 0) {
+					Levels[Depth - 1].totals[parent *
+						Num_measures + m] += v;
+				}
+			}
+		}
+	}
+
+	Records += count;
+	if (parent >= 0) {
+		Levels[Depth - 1].children[parent] += count;
+		Levels[Depth - 1].subtotal[parent] += count;
+	}
+}
+
+// The level of seg, checking that instance i exists (unless i < 0)
+FOCROLLUP_LEVEL* FOCROLLUP::Level(int seg, long i) {
+
+	for (int level = 0; level < Depth; level++) {
+		if (Path[level] == seg) {
+			if (i >= Levels[level].count) {
+				die("ROLLUP has no instance %ld of segment "
+					"%d\n", i, seg);
+			}
+			return &Levels[level];
+		}
+	}
+
+	die("ROLLUP segment %d is not above segment %d\n", seg, Seg);
+}
+
+long FOCROLLUP::instances(int seg) {
+	return Level(seg, -1)->count;
+}
+
+long FOCROLLUP::parent(int seg, long i) {
+	return Level(seg, i)->parent[i];
+}
+
+long FOCROLLUP::children(int seg, long i) {
+	return Level(seg, i)->children[i];
+}
+
+long FOCROLLUP::subtotal(int seg, long i) {
+	return Level(seg, i)->subtotal[i];
+}
+
+double FOCROLLUP::total(int measure, int seg, long i) {
+
+	if (measure < 0 || measure >= Num_measures) {
+		die("ROLLUP::total bad measure %d\n", measure);
+	}
+
+	return Level(seg, i)->totals[i * Num_measures + measure];
+}
+
+double FOCROLLUP::total(int measure) {
+
+	if (measure < 0 || measure >= Num_measures) {
+		die("ROLLUP::total bad measure %d\n", measure);
+	}
+
+	return Totals[measure];
+}
+
+void FOCROLLUP::position(int seg, long i, FOCPTR& where) {
+
+	FOCROLLUP_LEVEL *lv = Level(seg, i);
+
+	where.page = lv->page[i];
+	where.word = lv->word[i];
+	where.type = lv->type[i];
+}
+
+// =============================================================
+// Extra functions
+// =============================================================
+
+// FNV-1a
+unsigned int hash_key(UCHAR *key, int length) {
+
+	unsigned int h = 2166136261U;
+
+	for (int i = 0; i < length; i++) {
+		h = (h ^ key[i]) * 16777619U;
+	}
+
+	return h;
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
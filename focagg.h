@@ -0,0 +1,224 @@
+/*
+    focagg.h
+    --------
+    GROUP BY for the FocFile C++ library. A FOCAGG reads one segment
+    with a FOCSCAN and keeps SUM, COUNT, MIN, MAX, AVG, and sketches of
+    distinct counts and percentiles per group.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCAGG_H
+#define FOCAGG_H
+
+#ifndef FOCSCAN_H
+#include "focscan.h"
+#endif /* FOCSCAN_H */
+
+struct FOCAGG_FIELD;
+struct FOCAGG_ACC;
+struct FOCROLLUP_LEVEL;
+
+// This is "SUM DEALER_COST BY COUNTRY BY CAR":
+//
+//	FOCAGG agg(foc, FOCSEG_CAR_BODY);
+//	agg.group_by(FOCFLD_CAR_COUNTRY);
+//	agg.group_by(FOCFLD_CAR_CAR);
+//	int cost = agg.sum(FOCFLD_CAR_DEALER_COST);
+//
+//	while (agg.next()) {
+//		agg.hold(country, FOCFLD_CAR_COUNTRY);
+//		agg.hold(car, FOCFLD_CAR_CAR);
+//		printf("%s %s %.0lf\n", country, car, agg.value(cost));
+//	}
+//
+// The groups live in a hash table and the file is read once. When the
+// BY fields include the key of every segment from the root down to the
+// deepest BY field, and those segments are all S1 or SH1, each group
+// belongs to a single parent instance. Then the groups are handed out
+// as soon as that parent moves on, in file order, and the table starts
+// over empty. Otherwise they come out in order of first appearance,
+// after the whole segment has been read.
+class FOCAGG {
+
+public:
+	FOCAGG(FOCFILE* foc, int seg);
+	~FOCAGG();
+
+	// Only aggregate records that pass the filter
+	void	where(FOCEXPR& expr);
+
+	// BY field, in the segment or one of its ancestors
+	void	group_by(int seg, int offset, char type, int length);
+
+	// Measures. Each returns a handle for value().
+	int	count(void);
+	int	sum(int seg, int offset, char type, int length);
+	int	min(int seg, int offset, char type, int length);
+	int	max(int seg, int offset, char type, int length);
+	int	avg(int seg, int offset, char type, int length);
+
+	// Sketched measures (see focsketch.h), in constant memory a group:
+	// about how many distinct values a field has, of any type, and
+	// about the value percent of a numeric field's values lie below
+	int	distinct(int seg, int offset, char type, int length);
+	int	percentile(int seg, int offset, char type, int length,
+			double percent);
+
+	// Go to the next finished group. Returns 1, or 0 when done.
+	int	next(void);
+
+	// The BY fields of the current group
+	int	hold(char *s,	    int seg, int offset, char type, int length);
+	int	hold(long &l,	    int seg, int offset, char type, int length);
+	int	hold(int32_t &i,    int seg, int offset, char type, int length);
+	int	hold(double &d,	    int seg, int offset, char type, int length);
+	int	hold(float &f,	    int seg, int offset, char type, int length);
+	int	hold(SMDATE &smd,   int seg, int offset, char type, int length);
+
+	// A measure of the current group
+	double	value(int measure);
+
+	// Is the aggregation handing out groups as parents close?
+	int	is_streaming(void);
+
+	long	number_of_groups(void) { return Groups_out; };
+
+private:
+	int	Add_measure(int function, int seg, int offset, char type,
+			int length);
+	void	Prepare(void);
+	int	Level(int seg);
+	int	On_path(int seg);
+	void	Read_fields(void);
+	void	Add_record(void);
+	void	Grow_table(void);
+	void	Clear_groups(void);
+	UCHAR*	Group_key(int seg, int offset, char type, int length);
+
+private:
+	FOCFILE		*Foc;
+	FOCSCAN		*Scan;
+	int		Seg;
+	int		Prepared;
+
+	// BY fields; their values laid end to end make the group key
+	FOCAGG_FIELD	*By;
+	int		Num_by;
+	int		Key_length;
+	UCHAR		*Key;
+
+	FOCAGG_FIELD	*Measure;
+	int		Num_measures;
+
+	UCHAR		**Data;		// current record, by segment number
+	long		Data_chain;
+
+	// Streaming
+	int		Stream_level;	// -1 if not streaming
+	long		Last_chain;
+	int		Pending;	// a record read but not yet added
+
+	// The groups, in order of first appearance
+	UCHAR		*Group_keys;
+	FOCAGG_ACC	*Acc;
+	int		Num_groups;
+	int		Allocated_groups;
+
+	// Open-addressing hash table of group numbers
+	int		*Table;
+	int		Table_size;	// a power of 2
+
+	int		Ready;		// groups that may be handed out
+	int		Current;
+	int		Done;
+	long		Groups_out;
+};
+
+
+// Record counts at every level of a path, from one walk down the file.
+// For "number of BODY per CARREC per COMP":
+//
+//	FOCROLLUP roll(foc, FOCSEG_CAR_BODY);
+//	roll.run();
+//	for (long i = 0; i < roll.instances(FOCSEG_CAR_COMP); i++) {
+//		printf("%ld models, %ld body types\n",
+//			roll.children(FOCSEG_CAR_COMP, i),
+//			roll.subtotal(FOCSEG_CAR_COMP, i));
+//	}
+//
+// Every segment above the counted one gets flat arrays, indexed by the
+// instance's position in file order: its parent's index one level up,
+// its number of children one level down, its number of counted records,
+// and the totals of any measures. Counted records aren't stored one by
+// one; they're read a page at a time.
+class FOCROLLUP {
+
+public:
+	FOCROLLUP(FOCFILE* foc, int seg);
+	~FOCROLLUP();
+
+	// Only count records of seg that pass the filter
+	void	where(FOCEXPR& expr);
+
+	// Total a field of seg under each instance. Returns a handle.
+	int	measure(int seg, int offset, char type, int length);
+
+	// Walk the file. May be called again to start over.
+	void	run(void);
+
+	// For a segment above the counted one, and instance i of it
+	long	instances(int seg);
+	long	parent(int seg, long i);
+	long	children(int seg, long i);
+	long	subtotal(int seg, long i);
+	double	total(int measure, int seg, long i);
+	void	position(int seg, long i, FOCPTR& where);
+
+	// The whole file
+	long	subtotal(void) { return Records; };
+	double	total(int measure);
+
+private:
+	void	Descend(int level, long parent);
+	long	Add_instance(int level, long parent);
+	void	Count_records(long parent);
+	FOCROLLUP_LEVEL* Level(int seg, long i);
+
+private:
+	FOCFILE		*Foc;
+	int		Seg;
+	int		*Path;		// root ... Seg
+	int		Depth;		// Path[Depth] == Seg
+
+	FOCEXPR		*Where;
+	FOCAGG_FIELD	*Measure;
+	int		Num_measures;
+
+	FOCROLLUP_LEVEL	*Levels;	// one per level above Seg
+	long		Records;
+	double		*Totals;
+	UCHAR		*Batch[FOCSCAN_BATCH];
+};
+
+#endif /* FOCAGG_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
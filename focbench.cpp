@@ -0,0 +1,1176 @@
+/*
+    focbench
+    --------
+    Benchmarks for the FocFile library's hot paths: next(), hold(),
+    match(), find(), joins, and reccount(). Run it on a file made by
+    mkfoc from data/orders.mas; "make bench" does both.
+
+    *********************************************************
+    This library is in no way related to or supported by IBI.
+    IBI's FOCUS is a proprietary database whose format may
+    change at any time. If you have any problems, suggestions,
+    or comments about the FocFile C++ library, contact
+    the author, not Information Builders!
+    *********************************************************
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+/*
+   focbench [-r repeat] [-p probes] [-s seed] [-b name] [-t trace]
+            file.foc
+
+   -r	Times to repeat each whole-file benchmark (default 1)
+   -p	Number of index probes in the find benchmarks (default 100000)
+   -s	Seed for choosing the probe keys (default 1)
+   -b	Only run benchmarks whose name starts with this
+   -t	Write a page trace of the benchmarks, for focreplay
+
+   Each benchmark prints one line of name=value pairs:
+
+	bench=next_deep kind=macro ops=500000 records=500000
+	seconds=0.026 ns_per_op=52.4 records_per_s=19085169 pages_read=4658
+	buffer_hits=1009993 index_finds=0 index_cache_hits=0
+
+   "ops" are the operations being timed (records visited, fields held,
+   index probes); "records" are the records read, or for probes, the
+   keys found. The rest come from FOCFILE::stats(). If the library
+   was built with LATENCY_HISTOGRAMS, each benchmark is followed by a
+   "latency" line for each operation it timed. Every
+   benchmark starts with a fresh FOCFILE, so its buffers start cold.
+   The hold benchmarks include the next() that reaches each record.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "focfile.h"
+#include "focexpr.h"
+#include "focscan.h"
+#include "foczone.h"
+#include "focsidx.h"
+#include "focbitmap.h"
+#include "fockeys.h"
+#include "focintersect.h"
+#include "focsample.h"
+#include "focsketch.h"
+#include "foctop.h"
+#include "orders.h"
+
+#define die(format, args...) { \
+	fprintf(stderr, "focbench: " format, ## args); \
+	exit(-1); \
+	}
+
+static FILE	*Foc_fh;
+static int	Repeat = 1;
+static long	Probes = 100000;
+static unsigned long Seed = 1;
+static char	*Only = NULL;
+static char	*Trace_name = NULL;
+
+// Keys found in the file, for the probes
+static int32_t	*Qty_keys;
+static double	*Amount_keys;		// in the same order
+static char	*Name_keys;
+static long	Num_qty_keys;
+static long	Num_name_keys;
+static int32_t	Date_low, Date_high;	// ORDER_DATE, on disk
+
+// The FOCFILEs of the running benchmark, and its start time
+static FOCFILE	*Open[2];
+static int	Num_open;
+static double	Start_time;
+
+FOCFILE* bench_open(void);
+int bench_wanted(const char *name);
+void bench_start(void);
+void bench_report(const char *name, const char *kind, long ops, long records);
+void latency_report(const char *name);
+double now(void);
+unsigned long lcg(void);
+void collect_keys(void);
+
+void bench_next_root(void);
+void bench_next_deep(void);
+void bench_hold(void);
+void bench_match(void);
+void bench_reccount(void);
+void bench_find(void);
+void bench_join(void);
+void bench_scan(void);
+void bench_scan_preloaded(void);
+void bench_scan_zone(void);
+void bench_scan_sample(void);
+void bench_sketch(void);
+void bench_sidx(void);
+void bench_bitmap(void);
+void bench_keys(void);
+void bench_intersect(void);
+void bench_top(void);
+
+int main(int argc, char **argv) {
+
+	int	c;
+
+	FILE	*trace = NULL;
+
+	while ((c = getopt(argc, argv, "r:p:s:b:t:")) != EOF) {
+		switch (c) {
+			case 'r': Repeat = atoi(optarg);	break;
+			case 'p': Probes = atol(optarg);	break;
+			case 's': Seed = atol(optarg);		break;
+			case 'b': Only = optarg;		break;
+			case 't': Trace_name = optarg;		break;
+			default:
+				die("usage: focbench [-r repeat] [-p probes] "
+					"[-s seed] [-b name] [-t trace] "
+					"file.foc\n");
+		}
+	}
+
+	if (optind != argc - 1) {
+		die("Must supply the name of a FOCUS file.\n");
+	}
+
+	if (!(Foc_fh = fopen(argv[optind], "rb"))) {
+		die("Can't open %s\n", argv[optind]);
+	}
+
+	collect_keys();
+
+	if (Trace_name) {
+		if (!(trace = fopen(Trace_name, "wb"))) {
+			die("Can't open %s\n", Trace_name);
+		}
+		FOCFILE::record_pages(trace);
+	}
+
+	bench_next_root();
+	bench_next_deep();
+	bench_hold();
+	bench_match();
+	bench_reccount();
+	bench_find();
+	bench_join();
+	bench_scan();
+	bench_scan_preloaded();
+	bench_scan_zone();
+	bench_scan_sample();
+	bench_sketch();
+	bench_sidx();
+	bench_bitmap();
+	bench_keys();
+	bench_intersect();
+	bench_top();
+
+	if (trace) {
+		FOCFILE::record_pages(NULL);
+		fclose(trace);
+	}
+
+	fclose(Foc_fh);
+	return 0;
+}
+
+// -------------------------------------------------------------
+// Traversal
+// -------------------------------------------------------------
+void bench_next_root(void) {
+
+	long	n = 0;
+
+	if (!bench_wanted("next_root")) return;
+
+	FOCFILE *foc = bench_open();
+	bench_start();
+	for (int r = 0; r < Repeat; r++) {
+		foc->reposition(FOCSEG_ORDERS_REGION);
+		while (foc->next(FOCSEG_ORDERS_REGION)) {
+			n++;
+		}
+	}
+	bench_report("next_root", "macro", n, n);
+	delete foc;
+}
+
+void bench_next_deep(void) {
+
+	long	n = 0;
+
+	if (!bench_wanted("next_deep")) return;
+
+	FOCFILE *foc = bench_open();
+	bench_start();
+	for (int r = 0; r < Repeat; r++) {
+		foc->reposition(FOCSEG_ORDERS_REGION);
+		while (foc->next(FOCSEG_ORDERS_REGION))
+		while (foc->next(FOCSEG_ORDERS_CUST))
+		while (foc->next(FOCSEG_ORDERS_ORDERS)) {
+			n++;
+		}
+	}
+	bench_report("next_deep", "macro", n, n);
+	delete foc;
+}
+
+// -------------------------------------------------------------
+// hold(), one benchmark per type
+// -------------------------------------------------------------
+#define HOLD_LOOP(name, var, field) \
+	if (bench_wanted(name)) { \
+		long n = 0; \
+		FOCFILE *foc = bench_open(); \
+		bench_start(); \
+		for (int r = 0; r < Repeat; r++) { \
+			foc->reposition(FOCSEG_ORDERS_REGION); \
+			while (foc->next(FOCSEG_ORDERS_REGION)) \
+			while (foc->next(FOCSEG_ORDERS_CUST)) \
+			while (foc->next(FOCSEG_ORDERS_ORDERS)) { \
+				foc->hold(var, field); \
+				n++; \
+			} \
+		} \
+		bench_report(name, "micro", n, n); \
+		delete foc; \
+	}
+
+void bench_hold(void) {
+
+	char	channel[7];
+	long	l;
+	int32_t	i;
+	double	d;
+	float	f;
+	SMDATE	date;
+
+	HOLD_LOOP("hold_alpha",  channel, FOCFLD_ORDERS_CHANNEL);
+	HOLD_LOOP("hold_long",   l,       FOCFLD_ORDERS_QTY);
+	HOLD_LOOP("hold_int32",  i,       FOCFLD_ORDERS_QTY);
+	HOLD_LOOP("hold_double", d,       FOCFLD_ORDERS_AMOUNT);
+	HOLD_LOOP("hold_float",  f,       FOCFLD_ORDERS_PRICE);
+	HOLD_LOOP("hold_smdate", date,    FOCFLD_ORDERS_ORDER_DATE);
+}
+
+// -------------------------------------------------------------
+// match(), on a field and on an expression
+// -------------------------------------------------------------
+void bench_match(void) {
+
+	long	hits, records;
+	long	key = Num_qty_keys ? Qty_keys[0] : 0;
+
+	if (bench_wanted("match_field")) {
+		FOCFILE *foc = bench_open();
+		hits = records = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			foc->reposition(FOCSEG_ORDERS_REGION);
+			while (foc->next(FOCSEG_ORDERS_REGION))
+			while (foc->next(FOCSEG_ORDERS_CUST)) {
+				while (foc->match(FOCFLD_ORDERS_QTY, key)) {
+					hits++;
+				}
+			}
+		}
+		records = Num_qty_keys * Repeat;
+		bench_report("match_field", "macro", records, records);
+		delete foc;
+	}
+
+	if (bench_wanted("match_expr")) {
+		FOCFILE *foc = bench_open();
+		FOCEXPR where;
+		where.compare(FOCFLD_ORDERS_QTY, FOCEXPR_EQ, key);
+
+		hits = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			foc->reposition(FOCSEG_ORDERS_REGION);
+			while (foc->next(FOCSEG_ORDERS_REGION))
+			while (foc->next(FOCSEG_ORDERS_CUST)) {
+				while (foc->match(FOCSEG_ORDERS_ORDERS, where)) {
+					hits++;
+				}
+			}
+		}
+		records = Num_qty_keys * Repeat;
+		bench_report("match_expr", "macro", records, records);
+		delete foc;
+	}
+
+	// The same records, walked along the QTY index
+	if (bench_wanted("match_postings")) {
+		FOCFILE *foc = bench_open();
+		int32_t qty = (int32_t) key;
+
+		hits = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			while (foc->match_postings(FOCIDX_ORDERS_QTY, qty)) {
+				hits++;
+			}
+		}
+		bench_report("match_postings", "macro", hits, hits);
+		delete foc;
+	}
+}
+
+// -------------------------------------------------------------
+// reccount(), plain and with an expression
+// -------------------------------------------------------------
+int qty_filter(FOCFILE *foc) {
+
+	long qty;
+
+	foc->hold(qty, FOCFLD_ORDERS_QTY);
+	return qty < 1000;
+}
+
+void bench_reccount(void) {
+
+	long	n;
+
+	if (bench_wanted("reccount")) {
+		FOCFILE *foc = bench_open();
+		n = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			foc->reposition(FOCSEG_ORDERS_REGION);
+			while (foc->next(FOCSEG_ORDERS_REGION))
+			while (foc->next(FOCSEG_ORDERS_CUST)) {
+				n += foc->reccount(FOCSEG_ORDERS_ORDERS);
+			}
+		}
+		bench_report("reccount", "macro", n, n);
+		delete foc;
+	}
+
+	if (bench_wanted("reccount_filter")) {
+		FOCFILE *foc = bench_open();
+		n = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			foc->reposition(FOCSEG_ORDERS_REGION);
+			while (foc->next(FOCSEG_ORDERS_REGION))
+			while (foc->next(FOCSEG_ORDERS_CUST)) {
+				n += foc->reccount(FOCSEG_ORDERS_ORDERS,
+						qty_filter);
+			}
+		}
+		bench_report("reccount_filter", "macro", Num_qty_keys * Repeat,
+			Num_qty_keys * Repeat);
+		delete foc;
+	}
+
+	if (bench_wanted("reccount_expr")) {
+		FOCFILE *foc = bench_open();
+		FOCEXPR where;
+		where.compare(FOCFLD_ORDERS_QTY, FOCEXPR_LT, 1000L);
+
+		n = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			foc->reposition(FOCSEG_ORDERS_REGION);
+			while (foc->next(FOCSEG_ORDERS_REGION))
+			while (foc->next(FOCSEG_ORDERS_CUST)) {
+				n += foc->reccount(FOCSEG_ORDERS_ORDERS, where);
+			}
+		}
+		bench_report("reccount_expr", "macro", Num_qty_keys * Repeat,
+			Num_qty_keys * Repeat);
+		delete foc;
+	}
+
+	// The whole ORDERS segment, from page fill instead of a walk
+	if (bench_wanted("reccount_estimate")) {
+		FOCFILE *foc = bench_open();
+		long error;
+		n = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			n += foc->reccount_estimate(FOCSEG_ORDERS_ORDERS, error);
+		}
+		bench_report("reccount_estimate", "micro", Repeat, n);
+		delete foc;
+	}
+
+	if (bench_wanted("reccount_estimate_sample")) {
+		FOCFILE *foc = bench_open();
+		long error;
+		n = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			n += foc->reccount_estimate(FOCSEG_ORDERS_ORDERS, error,
+					64, Seed + r);
+		}
+		bench_report("reccount_estimate_sample", "micro", Repeat, n);
+		delete foc;
+	}
+}
+
+// -------------------------------------------------------------
+// find(). Cold probes hop around the index at random, so most of
+// them miss the node buffers; warm probes repeat one key, which the
+// index cache answers.
+// -------------------------------------------------------------
+void bench_find(void) {
+
+	long	i, found;
+
+	if (Num_qty_keys == 0 || Num_name_keys == 0) {
+		return;
+	}
+
+	if (bench_wanted("find_int_cold")) {
+		FOCFILE *foc = bench_open();
+		found = 0;
+		bench_start();
+		for (i = 0; i < Probes; i++) {
+			int32_t key = Qty_keys[lcg() % Num_qty_keys];
+			found += foc->find(FOCIDX_ORDERS_QTY, key);
+		}
+		bench_report("find_int_cold", "micro", Probes, found);
+		delete foc;
+	}
+
+	if (bench_wanted("find_int_warm")) {
+		FOCFILE *foc = bench_open();
+		int32_t key = Qty_keys[0];
+		found = 0;
+		bench_start();
+		for (i = 0; i < Probes; i++) {
+			found += foc->find(FOCIDX_ORDERS_QTY, key);
+		}
+		bench_report("find_int_warm", "micro", Probes, found);
+		delete foc;
+	}
+
+	if (bench_wanted("find_alpha_cold")) {
+		FOCFILE *foc = bench_open();
+		found = 0;
+		bench_start();
+		for (i = 0; i < Probes; i++) {
+			found += foc->find(FOCIDX_ORDERS_CUST_NAME,
+				&Name_keys[(lcg() % Num_name_keys) * 24]);
+		}
+		bench_report("find_alpha_cold", "micro", Probes, found);
+		delete foc;
+	}
+
+	// Type-ahead: every customer whose name starts like a random one's
+	if (bench_wanted("match_prefix")) {
+		FOCFILE *foc = bench_open();
+		long	probes = Probes / 100 + 1;
+		char	prefix[7];
+
+		found = 0;
+		bench_start();
+		for (i = 0; i < probes; i++) {
+			memcpy(prefix, &Name_keys[(lcg() % Num_name_keys) * 24],
+				6);
+			prefix[6] = 0;
+			while (foc->match_prefix(FOCIDX_ORDERS_CUST_NAME,
+					prefix)) {
+				found++;
+			}
+		}
+		bench_report("match_prefix", "micro", probes, found);
+		delete foc;
+	}
+
+	if (bench_wanted("match_index")) {
+		FOCFILE *foc = bench_open();
+		foc->initialize_index(FOCIDX_ORDERS_QTY);
+		found = 0;
+		bench_start();
+		for (i = 0; i < Probes; i++) {
+			int32_t key = Qty_keys[lcg() % Num_qty_keys];
+			found += foc->match_index(FOCIDX_ORDERS_QTY, &key);
+		}
+		bench_report("match_index", "micro", Probes, found);
+		delete foc;
+	}
+
+	if (bench_wanted("match_index_up")) {
+		FOCFILE *foc = bench_open();
+		char name[25];
+		foc->initialize_index(FOCIDX_ORDERS_QTY);
+		found = 0;
+		bench_start();
+		for (i = 0; i < Probes; i++) {
+			int32_t key = Qty_keys[lcg() % Num_qty_keys];
+			if (foc->match_index(FOCIDX_ORDERS_QTY, &key) &&
+				foc->position_ancestors(FOCSEG_ORDERS_ORDERS)) {
+				foc->hold(name, FOCFLD_ORDERS_CUST_NAME);
+				found++;
+			}
+		}
+		bench_report("match_index_up", "micro", Probes, found);
+		delete foc;
+	}
+}
+
+// -------------------------------------------------------------
+// Joins: every CUST in one FOCFILE probes the CUST_ID index of a
+// second FOCFILE on the same file.
+// -------------------------------------------------------------
+void bench_join(void) {
+
+	long	probes = 0, found = 0;
+
+	if (!bench_wanted("join_probe")) return;
+
+	FOCFILE *parent = bench_open();
+	FOCFILE *child = bench_open();
+
+	parent->join(FOCFLD_ORDERS_CUST_ID, child, FOCIDX_ORDERS_CUST_ID);
+
+	bench_start();
+	for (int r = 0; r < Repeat; r++) {
+		parent->reposition(FOCSEG_ORDERS_REGION);
+		while (parent->next(FOCSEG_ORDERS_REGION))
+		while (parent->next(FOCSEG_ORDERS_CUST)) {
+			found += child->next(FOCSEG_ORDERS_CUST);
+			probes++;
+		}
+	}
+	bench_report("join_probe", "macro", probes, found);
+
+	delete parent;
+	delete child;
+}
+
+// -------------------------------------------------------------
+// FOCSCAN, a filtered extract of two columns
+// -------------------------------------------------------------
+void bench_scan(void) {
+
+	long	n = 0;
+	long	qty;
+	double	amount;
+
+	if (!bench_wanted("scan_filtered")) return;
+
+	FOCFILE *foc = bench_open();
+	FOCEXPR where;
+	where.compare(FOCFLD_ORDERS_QTY, FOCEXPR_LT, 20L);
+
+	bench_start();
+	for (int r = 0; r < Repeat; r++) {
+		FOCSCAN scan(foc, FOCSEG_ORDERS_ORDERS);
+		scan.where(where);
+		scan.column(qty, FOCFLD_ORDERS_QTY);
+		scan.column(amount, FOCFLD_ORDERS_AMOUNT);
+		while (scan.next()) {
+			;
+		}
+		n += scan.records_read();
+	}
+	bench_report("scan_filtered", "macro", n, n);
+	delete foc;
+}
+
+// The same scan, after reading the segments' pages in one batch
+void bench_scan_preloaded(void) {
+
+	long	n = 0;
+	long	qty;
+	double	amount;
+
+	if (!bench_wanted("scan_preloaded")) return;
+
+	FOCFILE *foc = bench_open();
+	FOCEXPR where;
+	where.compare(FOCFLD_ORDERS_QTY, FOCEXPR_LT, 20L);
+
+	bench_start();
+	for (int r = 0; r < Repeat; r++) {
+		foc->preload_release();
+		foc->preload(FOCSEG_ORDERS_REGION);
+		foc->preload(FOCSEG_ORDERS_CUST);
+		foc->preload(FOCSEG_ORDERS_ORDERS);
+
+		FOCSCAN scan(foc, FOCSEG_ORDERS_ORDERS);
+		scan.where(where);
+		scan.column(qty, FOCFLD_ORDERS_QTY);
+		scan.column(amount, FOCFLD_ORDERS_AMOUNT);
+		while (scan.next()) {
+			;
+		}
+		n += scan.records_read();
+	}
+	bench_report("scan_preloaded", "macro", n, n);
+	delete foc;
+}
+
+// The last 5% of the order dates: through the parent chains, and in
+// page order through a zone map (built before the timing starts)
+void bench_scan_zone(void) {
+
+	long		n = 0;
+	int32_t		from = Date_high - (Date_high - Date_low) / 20;
+	FOCEXPR		where;
+	FOCZONEMAP	map;
+
+	where.range(FOCFLD_ORDERS_ORDER_DATE, (long) from, (long) Date_high);
+
+	if (bench_wanted("scan_dated")) {
+		FOCFILE *foc = bench_open();
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			FOCSCAN scan(foc, FOCSEG_ORDERS_ORDERS);
+			scan.where(where);
+			while (scan.next()) {
+				n++;
+			}
+		}
+		bench_report("scan_dated", "macro", n, n);
+		delete foc;
+	}
+
+	if (bench_wanted("scan_zone")) {
+		FOCFILE *foc = bench_open();
+		map.field(FOCFLD_ORDERS_ORDER_DATE);
+		map.build(foc);
+
+		n = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			FOCZONESCAN scan(foc, map, FOCSEG_ORDERS_ORDERS);
+			scan.where(where);
+			while (scan.next()) {
+				n++;
+			}
+		}
+		bench_report("scan_zone", "macro", n, n);
+		delete foc;
+	}
+}
+
+// -------------------------------------------------------------
+// SUM(QTY) over 1% of the ORDERS pages, scaled up, against the walk
+// of every record that scan_dated does
+// -------------------------------------------------------------
+void bench_scan_sample(void) {
+
+	long		n = 0;
+	int32_t		qty;
+	double		total;
+	UCHAR		*data;
+
+	if (bench_wanted("scan_sample")) {
+		FOCFILE *foc = bench_open();
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			FOCSAMPLESCAN scan(foc, FOCSEG_ORDERS_ORDERS, 0.01,
+					Seed + r);
+			total = 0;
+			while ((data = scan.next())) {
+				memcpy(&qty, data + 12, sizeof(int32_t));
+				total += qty;
+				n++;
+			}
+			total *= scan.scale();
+		}
+		bench_report("scan_sample", "macro", n, n);
+		delete foc;
+	}
+}
+
+// -------------------------------------------------------------
+// Distinct ORDER_DATEs and the 95th percentile of AMOUNT, from
+// sketches fed every record's data area
+// -------------------------------------------------------------
+void bench_sketch(void) {
+
+	long	n = 0;
+
+	if (bench_wanted("sketch_distinct")) {
+		FOCFILE *foc = bench_open();
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			FOCSCAN scan(foc, FOCSEG_ORDERS_ORDERS);
+			FOCHLL days(FOCFLD_ORDERS_ORDER_DATE);
+			while (scan.next()) {
+				days.add(scan.record());
+				n++;
+			}
+			days.estimate();
+		}
+		bench_report("sketch_distinct", "macro", n, n);
+		delete foc;
+	}
+
+	if (bench_wanted("sketch_quantile")) {
+		FOCFILE *foc = bench_open();
+		n = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			FOCSCAN scan(foc, FOCSEG_ORDERS_ORDERS);
+			FOCQUANTILES amounts(FOCFLD_ORDERS_AMOUNT);
+			while (scan.next()) {
+				amounts.add(scan.record());
+				n++;
+			}
+			amounts.quantile(0.95);
+		}
+		bench_report("sketch_quantile", "macro", n, n);
+		delete foc;
+	}
+}
+
+// -------------------------------------------------------------
+// Sidecar indexes on AMOUNT, which the master doesn't index: every
+// record with the probed amount, against one match() pass over the
+// whole file.
+// -------------------------------------------------------------
+void bench_sidx(void) {
+
+	long	i, found;
+	double	key = Num_qty_keys ? Amount_keys[0] : 0;
+
+	if (Num_qty_keys == 0) {
+		return;
+	}
+
+	if (bench_wanted("sidx_linear")) {
+		FOCFILE *foc = bench_open();
+		found = 0;
+		bench_start();
+		foc->reposition(FOCSEG_ORDERS_REGION);
+		while (foc->next(FOCSEG_ORDERS_REGION))
+		while (foc->next(FOCSEG_ORDERS_CUST)) {
+			while (foc->match(FOCFLD_ORDERS_AMOUNT, key)) {
+				found++;
+			}
+		}
+		bench_report("sidx_linear", "micro", 1, found);
+		delete foc;
+	}
+
+	const char	*name[2] = { "sidx_sorted", "sidx_hashed" };
+	int		kind[2] = { FOCSIDX_SORTED, FOCSIDX_HASHED };
+
+	for (int k = 0; k < 2; k++) {
+		if (!bench_wanted(name[k])) {
+			continue;
+		}
+
+		FOCFILE *foc = bench_open();
+		FOCSIDX sidx;
+		sidx.build(foc, FOCFLD_ORDERS_AMOUNT, kind[k]);
+
+		found = 0;
+		bench_start();
+		for (i = 0; i < Probes; i++) {
+			key = Amount_keys[lcg() % Num_qty_keys];
+			while (sidx.match(foc, key)) {
+				found++;
+			}
+		}
+		bench_report(name[k], "micro", Probes, found);
+		delete foc;
+	}
+}
+
+// -------------------------------------------------------------
+// Bitmap indexes: count the ORDERS with one CHANNEL and one QTY, and
+// visit them, against reccount() with the same expression.
+// -------------------------------------------------------------
+void bench_bitmap(void) {
+
+	long		n, records;
+	char		channel[7];
+	int32_t		qty;
+	FOCBITMAPINDEX	channels, qtys;
+
+	if (Num_qty_keys == 0 || !(bench_wanted("bitmap_") ||
+			bench_wanted("count_expr"))) {
+		return;
+	}
+
+	FOCFILE *foc = new FOCFILE(FOCFILE_ORDERS, Foc_fh);
+	channels.build(foc, FOCFLD_ORDERS_CHANNEL);
+	qtys.build(foc, FOCFLD_ORDERS_QTY);
+	memcpy(channel, channels.value(0), 6);
+	channel[6] = 0;
+	qty = Qty_keys[0];
+	delete foc;
+
+	if (bench_wanted("count_expr")) {
+		FOCFILE *foc = bench_open();
+		FOCEXPR where;
+		where.compare(FOCFLD_ORDERS_CHANNEL, FOCEXPR_EQ, channel);
+		where.compare(FOCFLD_ORDERS_QTY, FOCEXPR_EQ, (long) qty);
+		where.op_and();
+
+		n = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			foc->reposition(FOCSEG_ORDERS_REGION);
+			while (foc->next(FOCSEG_ORDERS_REGION))
+			while (foc->next(FOCSEG_ORDERS_CUST)) {
+				n += foc->reccount(FOCSEG_ORDERS_ORDERS, where);
+			}
+		}
+		bench_report("count_expr", "macro", Repeat, n);
+		delete foc;
+	}
+
+	if (bench_wanted("bitmap_count")) {
+		FOCFILE *foc = bench_open();
+		n = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			FOCBITMAP both(channels.bitmap(channel));
+			both.intersect(qtys.bitmap(qty));
+			n += both.count();
+		}
+		bench_report("bitmap_count", "macro", Repeat, n);
+		delete foc;
+	}
+
+	if (bench_wanted("bitmap_visit")) {
+		FOCFILE *foc = bench_open();
+		n = records = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			FOCBITMAP both(channels.bitmap(channel));
+			both.intersect(qtys.bitmap(qty));
+			for (long i = both.next(0); i >= 0; i = both.next(i + 1)) {
+				channels.move(foc, i);
+				n += foc->record_data(FOCSEG_ORDERS_ORDERS) != NULL;
+			}
+		}
+		bench_report("bitmap_visit", "macro", Repeat, n);
+		delete foc;
+	}
+}
+
+// -------------------------------------------------------------
+// Index-only queries: the distinct QTYs, and the CUST_NAMEs between
+// two random ones, from the index pages alone. next_deep is the walk
+// over the data they save.
+// -------------------------------------------------------------
+void bench_keys(void) {
+
+	long	n, records;
+
+	if (Num_name_keys == 0) {
+		return;
+	}
+
+	if (bench_wanted("keys_distinct")) {
+		FOCFILE *foc = bench_open();
+		FOCKEYS qtys(foc, FOCIDX_ORDERS_QTY);
+
+		n = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			n += qtys.distinct(&records);
+		}
+		bench_report("keys_distinct", "macro", Repeat * records, n);
+		delete foc;
+	}
+
+	if (bench_wanted("keys_range")) {
+		FOCFILE *foc = bench_open();
+		FOCKEYS names(foc, FOCIDX_ORDERS_CUST_NAME);
+		long	probes = Probes / 100 + 1;
+		char	low[25], high[25];
+
+		n = 0;
+		bench_start();
+		for (long i = 0; i < probes; i++) {
+			memcpy(low, &Name_keys[(lcg() % Num_name_keys) * 24], 24);
+			memcpy(high, low, 24);
+			low[24] = high[24] = 0;
+			high[5]++;	// CUSTnn... to CUSTnm...
+			names.from(low);
+			names.to(high);
+			n += names.distinct();
+		}
+		bench_report("keys_range", "micro", probes, n);
+		delete foc;
+	}
+}
+
+// -------------------------------------------------------------
+// Two indexed fields at once: the ORDERS with a QTY and an ORDER_DATE,
+// by walking the QTY index and testing each date, and by intersecting
+// the two indexes' records before visiting any.
+// -------------------------------------------------------------
+void bench_intersect(void) {
+
+	long	i, found, probes = Probes / 100 + 1;
+	int32_t	qty, date, on_disk;
+
+	if (Num_qty_keys == 0) {
+		return;
+	}
+
+	if (bench_wanted("postings_filter")) {
+		FOCFILE *foc = bench_open();
+		found = 0;
+		bench_start();
+		for (i = 0; i < probes; i++) {
+			qty = Qty_keys[lcg() % Num_qty_keys];
+			date = Date_low + lcg() % (Date_high - Date_low + 1);
+			while (foc->match_postings(FOCIDX_ORDERS_QTY, qty)) {
+				foc->read_bytes((UCHAR*) &on_disk,
+					FOCFLD_ORDERS_ORDER_DATE);
+				found += on_disk == date;
+			}
+		}
+		bench_report("postings_filter", "micro", probes, found);
+		delete foc;
+	}
+
+	if (bench_wanted("intersect")) {
+		FOCFILE *foc = bench_open();
+		found = 0;
+		bench_start();
+		for (i = 0; i < probes; i++) {
+			FOCINTERSECT both(foc, FOCSEG_ORDERS_ORDERS);
+			qty = Qty_keys[lcg() % Num_qty_keys];
+			date = Date_low + lcg() % (Date_high - Date_low + 1);
+			both.key(FOCIDX_ORDERS_QTY, qty);
+			both.key(FOCIDX_ORDERS_ORDER_DATE, date);
+			while (both.next()) {
+				found++;
+			}
+		}
+		bench_report("intersect", "micro", probes, found);
+		delete foc;
+	}
+}
+
+// -------------------------------------------------------------
+// Report previews: the first 100 orders with QTY under 20, and the 10
+// largest QTYs, by a heap over the whole segment and down the index
+// -------------------------------------------------------------
+void bench_top(void) {
+
+	long	n = 0, records = 0;
+	long	qty;
+	double	amount;
+	long	queries = Probes / 100 > 0 ? Probes / 100 : 1;
+	FOCEXPR	where;
+
+	where.compare(FOCFLD_ORDERS_QTY, FOCEXPR_LT, 20L);
+
+	if (bench_wanted("scan_limit")) {
+		FOCFILE *foc = bench_open();
+		bench_start();
+		for (long q = 0; q < queries; q++) {
+			FOCSCAN scan(foc, FOCSEG_ORDERS_ORDERS);
+			scan.where(where);
+			scan.limit(100);
+			scan.column(qty, FOCFLD_ORDERS_QTY);
+			scan.column(amount, FOCFLD_ORDERS_AMOUNT);
+			while (scan.next()) {
+				n++;
+			}
+			records += scan.records_read();
+		}
+		bench_report("scan_limit", "micro", queries, records);
+		delete foc;
+	}
+
+	if (bench_wanted("top_scan")) {
+		FOCFILE *foc = bench_open();
+		records = 0;
+		bench_start();
+		for (int r = 0; r < Repeat; r++) {
+			FOCTOPN top(foc, FOCSEG_ORDERS_ORDERS, 10,
+					FOCFLD_ORDERS_QTY);
+			while (top.next()) {
+				n++;
+			}
+			records += top.records_read();
+		}
+		bench_report("top_scan", "macro", records, records);
+		delete foc;
+	}
+
+	if (bench_wanted("top_index")) {
+		FOCFILE *foc = bench_open();
+		records = 0;
+		bench_start();
+		for (long q = 0; q < queries; q++) {
+			FOCTOPN top(foc, FOCSEG_ORDERS_ORDERS, 10,
+					FOCFLD_ORDERS_QTY);
+			top.index(FOCIDX_ORDERS_QTY);
+			while (top.next()) {
+				n++;
+			}
+			records += top.records_read();
+		}
+		bench_report("top_index", "micro", queries, records);
+		delete foc;
+	}
+}
+
+// -------------------------------------------------------------
+// Helpers
+// -------------------------------------------------------------
+
+// Gather the QTY and CUST_NAME values in the file, for the probes
+void collect_keys(void) {
+
+	long	allocated = 1024;
+	long	qty;
+	int32_t	date;
+
+	FOCFILE *foc = new FOCFILE(FOCFILE_ORDERS, Foc_fh);
+
+	Qty_keys = (int32_t*) malloc(sizeof(int32_t) * allocated);
+	Amount_keys = (double*) malloc(sizeof(double) * allocated);
+	Num_qty_keys = 0;
+	while (foc->next(FOCSEG_ORDERS_REGION))
+	while (foc->next(FOCSEG_ORDERS_CUST))
+	while (foc->next(FOCSEG_ORDERS_ORDERS)) {
+		if (Num_qty_keys == allocated) {
+			allocated *= 2;
+			Qty_keys = (int32_t*) realloc(Qty_keys,
+					sizeof(int32_t) * allocated);
+			Amount_keys = (double*) realloc(Amount_keys,
+					sizeof(double) * allocated);
+		}
+		foc->hold(Amount_keys[Num_qty_keys], FOCFLD_ORDERS_AMOUNT);
+		foc->hold(qty, FOCFLD_ORDERS_QTY);
+		Qty_keys[Num_qty_keys++] = qty;
+
+		foc->read_bytes((UCHAR*) &date, FOCFLD_ORDERS_ORDER_DATE);
+		if (Num_qty_keys == 1 || date < Date_low) Date_low = date;
+		if (Num_qty_keys == 1 || date > Date_high) Date_high = date;
+	}
+
+	allocated = 1024;
+	Name_keys = (char*) malloc(24 * allocated);
+	Num_name_keys = 0;
+	foc->reposition(FOCSEG_ORDERS_REGION);
+	while (foc->next(FOCSEG_ORDERS_REGION))
+	while (foc->next(FOCSEG_ORDERS_CUST)) {
+		if (Num_name_keys == allocated) {
+			allocated *= 2;
+			Name_keys = (char*) realloc(Name_keys, 24 * allocated);
+		}
+		foc->hold(&Name_keys[Num_name_keys++ * 24],
+			FOCFLD_ORDERS_CUST_NAME);
+	}
+
+	if (!Qty_keys || !Amount_keys || !Name_keys) {
+		die("Can't allocate memory for the probe keys\n");
+	}
+
+	delete foc;
+}
+
+FOCFILE* bench_open(void) {
+
+	FOCFILE *foc = new FOCFILE(FOCFILE_ORDERS, Foc_fh);
+
+	Open[Num_open++] = foc;
+	return foc;
+}
+
+int bench_wanted(const char *name) {
+
+	return Only == NULL || strncmp(name, Only, strlen(Only)) == 0;
+}
+
+void bench_start(void) {
+
+	for (int i = 0; i < Num_open; i++) {
+		Open[i]->stats_reset();
+	}
+	FOCFILE::latency_reset();
+	Start_time = now();
+}
+
+void bench_report(const char *name, const char *kind, long ops, long records) {
+
+	double		seconds = now() - Start_time;
+	FOCSTATS	total, s;
+
+	memset(&total, 0, sizeof(FOCSTATS));
+	for (int i = 0; i < Num_open; i++) {
+		Open[i]->stats(s);
+		total.pages_read	+= s.pages_read;
+		total.buffer_hits	+= s.buffer_hits;
+		total.index_finds	+= s.index_finds;
+		total.index_cache_hits	+= s.index_cache_hits;
+	}
+	Num_open = 0;
+
+	printf("bench=%s kind=%s ops=%ld records=%ld seconds=%.6f "
+		"ns_per_op=%.1f records_per_s=%.0f pages_read=%ld "
+		"buffer_hits=%ld index_finds=%ld index_cache_hits=%ld\n",
+		name, kind, ops, records, seconds,
+		ops ? seconds * 1e9 / ops : 0.0,
+		seconds > 0 ? records / seconds : 0.0,
+		total.pages_read, total.buffer_hits, total.index_finds,
+		total.index_cache_hits);
+	latency_report(name);
+	fflush(stdout);
+}
+
+// The latency histograms, if the library keeps them
+void latency_report(const char *name) {
+
+	static const char *op_name[FOCOP_COUNT] = { "find", "match_index",
+					"next", "read_page" };
+	FOCHIST	h;
+
+	for (int op = 0; op < FOCOP_COUNT; op++) {
+		if (!FOCFILE::latency((FOCOP) op, h) || h.count == 0) {
+			continue;
+		}
+		printf("latency bench=%s op=%s count=%ld mean_ns=%.0f "
+			"p50_ns=%ld p99_ns=%ld p999_ns=%ld max_ns=%ld\n",
+			name, op_name[op], h.count, h.total_ns / h.count,
+			FOCFILE::latency_percentile(h, 50.0),
+			FOCFILE::latency_percentile(h, 99.0),
+			FOCFILE::latency_percentile(h, 99.9),
+			h.max_ns);
+	}
+}
+
+double now(void) {
+
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// The probe keys come from a fixed generator, so runs are comparable
+unsigned long lcg(void) {
+
+	Seed = Seed * 6364136223846793005UL + 1442695040888963407UL;
+	return Seed >> 33;
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
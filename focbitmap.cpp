@@ -0,0 +1,868 @@
+/*
+    focbitmap.cpp
+    -------------
+    Bitmap indexes for the FocFile C++ library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "focbitmap.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+
+#define CHUNK_BITS	65536
+#define CHUNK_WORDS	(CHUNK_BITS / 64)
+#define LIST_MAX	4096	// past this, a list is bigger than the bits
+
+// For Combine()
+#define OP_AND		1
+#define OP_OR		2
+#define OP_ANDNOT	3
+
+// One chunk's members: a sorted list, or bits, never both
+struct FOCBITMAP_CHUNK {
+	int		key;		// the members' high 16 bits
+	int		members;
+	unsigned short	*list;
+	int		allocated;	// of list
+	uint64_t	*bits;		// CHUNK_WORDS of them
+};
+
+// The file is these structures, in this order and in the machine's
+// byte order: the header, the values, the postings, the page stamps,
+// and each value's bitmap.
+struct FOCBITMAP_HEADER {
+	char	magic[8];
+	int32_t	seg;
+	int32_t	offset;
+	int32_t	length;
+	int32_t	values;
+	int32_t	records;
+	char	type;
+	UCHAR	unused[3];
+};
+
+struct FOCBITMAP_POSTING {
+	int32_t	page;
+	int32_t	word;
+};
+
+static void chunk_free(FOCBITMAP_CHUNK *c);
+static void chunk_copy(FOCBITMAP_CHUNK *to, const FOCBITMAP_CHUNK *from);
+static void chunk_expand(const FOCBITMAP_CHUNK *c, uint64_t *words);
+static void chunk_pack(FOCBITMAP_CHUNK *c, int key, uint64_t *words);
+
+// =============================================================
+// CLASS: FOCBITMAP
+// -------------------------------------------------------------
+// A compressed set of record numbers.
+// =============================================================
+FOCBITMAP::FOCBITMAP() {
+
+	Chunk			= NULL;
+	Num_chunks		= 0;
+	Allocated_chunks	= 0;
+}
+
+FOCBITMAP::FOCBITMAP(const FOCBITMAP& other) {
+
+	Chunk			= NULL;
+	Num_chunks		= 0;
+	Allocated_chunks	= 0;
+	*this = other;
+}
+
+FOCBITMAP& FOCBITMAP::operator=(const FOCBITMAP& other) {
+
+	if (this == &other) {
+		return *this;
+	}
+
+	clear();
+	for (int i = 0; i < other.Num_chunks; i++) {
+		FOCBITMAP_CHUNK *c = Insert_chunk(i, other.Chunk[i].key);
+		chunk_copy(c, &other.Chunk[i]);
+	}
+	return *this;
+}
+
+FOCBITMAP::~FOCBITMAP() {
+
+	clear();
+	free(Chunk);
+}
+
+void FOCBITMAP::clear(void) {
+
+	for (int i = 0; i < Num_chunks; i++) {
+		chunk_free(&Chunk[i]);
+	}
+	Num_chunks = 0;
+}
+
+// The chunk with the key, or where it would go, as -1 - place
+int FOCBITMAP::Find_chunk(int key) const {
+
+	int	low = 0, high = Num_chunks;
+
+	// Most sets are built in order
+	if (Num_chunks > 0 && Chunk[Num_chunks - 1].key == key) {
+		return Num_chunks - 1;
+	}
+
+	while (low < high) {
+		int middle = (low + high) / 2;
+		if (Chunk[middle].key < key) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	if (low < Num_chunks && Chunk[low].key == key) {
+		return low;
+	}
+	return -1 - low;
+}
+
+FOCBITMAP_CHUNK* FOCBITMAP::Insert_chunk(int at, int key) {
+
+	if (Num_chunks == Allocated_chunks) {
+		Allocated_chunks = Allocated_chunks ? Allocated_chunks * 2 : 4;
+		Chunk = (FOCBITMAP_CHUNK*) xrealloc("BITMAP chunks", Chunk,
+				sizeof(FOCBITMAP_CHUNK) * Allocated_chunks);
+	}
+
+	memmove(&Chunk[at + 1], &Chunk[at],
+			sizeof(FOCBITMAP_CHUNK) * (Num_chunks - at));
+	Num_chunks++;
+
+	FOCBITMAP_CHUNK *c = &Chunk[at];
+	memset(c, 0, sizeof(FOCBITMAP_CHUNK));
+	c->key = key;
+	return c;
+}
+
+void FOCBITMAP::set(long n) {
+
+	int		key = n >> 16;
+	unsigned short	low = n & 0xffff;
+	int		at = Find_chunk(key);
+	FOCBITMAP_CHUNK	*c;
+
+	if (n < 0) {
+		die("BITMAP can't hold %ld\n", n);
+	}
+
+	c = at >= 0 ? &Chunk[at] : Insert_chunk(-1 - at, key);
+
+	if (c->bits) {
+		if (!(c->bits[low >> 6] & ((uint64_t) 1 << (low & 63)))) {
+			c->bits[low >> 6] |= (uint64_t) 1 << (low & 63);
+			c->members++;
+		}
+		return;
+	}
+
+	// Where it goes in the list; at the end, usually
+	int i = c->members;
+	if (i > 0 && c->list[i - 1] >= low) {
+		int lo = 0, hi = c->members;
+		while (lo < hi) {
+			int middle = (lo + hi) / 2;
+			if (c->list[middle] < low) lo = middle + 1;
+			else hi = middle;
+		}
+		if (c->list[lo] == low) {
+			return;
+		}
+		i = lo;
+	}
+
+	if (c->members == LIST_MAX) {
+		uint64_t words[CHUNK_WORDS];
+		chunk_expand(c, words);
+		words[low >> 6] |= (uint64_t) 1 << (low & 63);
+		chunk_pack(c, key, words);
+		return;
+	}
+
+	if (c->members == c->allocated) {
+		c->allocated = c->allocated ? c->allocated * 2 : 16;
+		c->list = (unsigned short*) xrealloc("BITMAP list", c->list,
+				sizeof(unsigned short) * c->allocated);
+	}
+	memmove(&c->list[i + 1], &c->list[i],
+			sizeof(unsigned short) * (c->members - i));
+	c->list[i] = low;
+	c->members++;
+}
+
+int FOCBITMAP::test(long n) const {
+
+	int		at = Find_chunk(n >> 16);
+	unsigned short	low = n & 0xffff;
+
+	if (n < 0 || at < 0) {
+		return 0;
+	}
+
+	const FOCBITMAP_CHUNK *c = &Chunk[at];
+	if (c->bits) {
+		return (c->bits[low >> 6] >> (low & 63)) & 1;
+	}
+
+	int lo = 0, hi = c->members;
+	while (lo < hi) {
+		int middle = (lo + hi) / 2;
+		if (c->list[middle] < low) lo = middle + 1;
+		else hi = middle;
+	}
+	return lo < c->members && c->list[lo] == low;
+}
+
+long FOCBITMAP::count(void) const {
+
+	long	n = 0;
+
+	for (int i = 0; i < Num_chunks; i++) {
+		n += Chunk[i].members;
+	}
+	return n;
+}
+
+long FOCBITMAP::next(long n) const {
+
+	int	at;
+
+	if (n < 0) {
+		n = 0;
+	}
+	at = Find_chunk(n >> 16);
+	if (at < 0) {
+		at = -1 - at;
+		n = 0;		// from the start of that chunk
+	}
+
+	for (; at < Num_chunks; at++, n = 0) {
+		const FOCBITMAP_CHUNK *c = &Chunk[at];
+		int		low = (Chunk[at].key == (n >> 16)) ?
+					(n & 0xffff) : 0;
+		long		base = (long) c->key << 16;
+
+		if (c->bits) {
+			int		w = low >> 6;
+			uint64_t	word = c->bits[w] & (~(uint64_t) 0 << (low & 63));
+
+			for (;;) {
+				if (word) {
+					return base + w * 64 +
+						__builtin_ctzll(word);
+				}
+				if (++w == CHUNK_WORDS) {
+					break;
+				}
+				word = c->bits[w];
+			}
+		}
+		else {
+			int lo = 0, hi = c->members;
+			while (lo < hi) {
+				int middle = (lo + hi) / 2;
+				if (c->list[middle] < low) lo = middle + 1;
+				else hi = middle;
+			}
+			if (lo < c->members) {
+				return base + c->list[lo];
+			}
+		}
+	}
+
+	return -1;
+}
+
+void FOCBITMAP::intersect(const FOCBITMAP& other) {
+	Combine(other, OP_AND);
+}
+
+void FOCBITMAP::unite(const FOCBITMAP& other) {
+	Combine(other, OP_OR);
+}
+
+void FOCBITMAP::subtract(const FOCBITMAP& other) {
+	Combine(other, OP_ANDNOT);
+}
+
+// Everything in 0 .. records - 1 that isn't in the set
+void FOCBITMAP::invert(long records) {
+
+	FOCBITMAP	all;
+	uint64_t	words[CHUNK_WORDS];
+
+	for (long first = 0; first < records; first += CHUNK_BITS) {
+		long in_chunk = records - first;
+		if (in_chunk > CHUNK_BITS) {
+			in_chunk = CHUNK_BITS;
+		}
+
+		memset(words, 0, sizeof(words));
+		memset(words, 0xff, sizeof(uint64_t) * (in_chunk / 64));
+		if (in_chunk % 64) {
+			words[in_chunk / 64] = ((uint64_t) 1 << (in_chunk % 64)) - 1;
+		}
+
+		FOCBITMAP_CHUNK *c = all.Insert_chunk(all.Num_chunks,
+				first >> 16);
+		chunk_pack(c, first >> 16, words);
+	}
+
+	all.subtract(*this);
+	*this = all;
+}
+
+// Chunk by chunk, in key order. Two chunks are combined word by word,
+// and the result kept as a list or bits, whichever is smaller.
+void FOCBITMAP::Combine(const FOCBITMAP& other, int op) {
+
+	FOCBITMAP_CHUNK	*result;
+	int		results = 0, allocated;
+	int		i = 0, j = 0, w;
+	uint64_t	a[CHUNK_WORDS], b[CHUNK_WORDS];
+
+	allocated = Num_chunks + other.Num_chunks + 1;
+	result = (FOCBITMAP_CHUNK*) xrealloc("BITMAP chunks", NULL,
+			sizeof(FOCBITMAP_CHUNK) * allocated);
+
+	while (i < Num_chunks || j < other.Num_chunks) {
+		int mine = i < Num_chunks ? Chunk[i].key : 0x7fffffff;
+		int theirs = j < other.Num_chunks ?
+				other.Chunk[j].key : 0x7fffffff;
+		FOCBITMAP_CHUNK *r = &result[results];
+
+		memset(r, 0, sizeof(FOCBITMAP_CHUNK));
+		if (mine < theirs) {
+			// Only in this one
+			if (op != OP_AND) {
+				*r = Chunk[i];
+				memset(&Chunk[i], 0, sizeof(FOCBITMAP_CHUNK));
+				results++;
+			}
+			else {
+				chunk_free(&Chunk[i]);
+			}
+			i++;
+		}
+		else if (theirs < mine) {
+			// Only in the other
+			if (op == OP_OR) {
+				chunk_copy(r, &other.Chunk[j]);
+				results++;
+			}
+			j++;
+		}
+		else {
+			chunk_expand(&Chunk[i], a);
+			chunk_expand(&other.Chunk[j], b);
+			for (w = 0; w < CHUNK_WORDS; w++) {
+				switch (op) {
+					case OP_AND:	a[w] &= b[w];	break;
+					case OP_OR:	a[w] |= b[w];	break;
+					default:	a[w] &= ~b[w];	break;
+				}
+			}
+			chunk_free(&Chunk[i]);
+			chunk_pack(r, mine, a);
+			if (r->members > 0) {
+				results++;
+			}
+			else {
+				chunk_free(r);
+			}
+			i++;
+			j++;
+		}
+	}
+
+	free(Chunk);
+	Chunk			= result;
+	Num_chunks		= results;
+	Allocated_chunks	= allocated;
+}
+
+void FOCBITMAP::write(FILE* fh) const {
+
+	int32_t	header[2];
+
+	if (fwrite(&Num_chunks, sizeof(int32_t), 1, fh) != 1) {
+		die("BITMAP: can't write the bitmap\n");
+	}
+
+	for (int i = 0; i < Num_chunks; i++) {
+		const FOCBITMAP_CHUNK *c = &Chunk[i];
+
+		header[0] = c->key;
+		header[1] = c->members;
+		if (fwrite(header, sizeof(int32_t), 2, fh) != 2 ||
+			(c->bits && fwrite(c->bits, sizeof(uint64_t),
+				CHUNK_WORDS, fh) != CHUNK_WORDS) ||
+			(!c->bits && fwrite(c->list, sizeof(unsigned short),
+				c->members, fh) != (size_t) c->members)) {
+			die("BITMAP: can't write the bitmap\n");
+		}
+	}
+}
+
+void FOCBITMAP::read(FILE* fh) {
+
+	int32_t	chunks, header[2];
+
+	clear();
+	if (fread(&chunks, sizeof(int32_t), 1, fh) != 1) {
+		die("BITMAP: bitmap is cut short\n");
+	}
+
+	for (int i = 0; i < chunks; i++) {
+		if (fread(header, sizeof(int32_t), 2, fh) != 2) {
+			die("BITMAP: bitmap is cut short\n");
+		}
+
+		FOCBITMAP_CHUNK *c = Insert_chunk(i, header[0]);
+		c->members = header[1];
+		if (c->members > LIST_MAX) {
+			c->bits = (uint64_t*) xrealloc("BITMAP bits", NULL,
+					sizeof(uint64_t) * CHUNK_WORDS);
+			if (fread(c->bits, sizeof(uint64_t), CHUNK_WORDS, fh) !=
+					CHUNK_WORDS) {
+				die("BITMAP: bitmap is cut short\n");
+			}
+		}
+		else {
+			c->allocated = c->members;
+			c->list = (unsigned short*) xrealloc("BITMAP list",
+					NULL, sizeof(unsigned short) *
+					(c->members + 1));
+			if (fread(c->list, sizeof(unsigned short), c->members,
+					fh) != (size_t) c->members) {
+				die("BITMAP: bitmap is cut short\n");
+			}
+		}
+	}
+}
+
+// =============================================================
+// CLASS: FOCBITMAPINDEX
+// -------------------------------------------------------------
+// A bitmap of a segment's records for each value of a field.
+// =============================================================
+FOCBITMAPINDEX::FOCBITMAPINDEX() {
+
+	Seg		= 0;
+	Offset		= 0;
+	Type		= FIELDTYPE_ALPHA;
+	Length		= 0;
+
+	Value		= NULL;
+	Bitmap		= NULL;
+	Num_values	= 0;
+	Allocated_values = 0;
+	Slot		= NULL;
+	Num_slots	= 0;
+	Posting		= NULL;
+	Clear();
+}
+
+FOCBITMAPINDEX::~FOCBITMAPINDEX() {
+
+	Clear();
+}
+
+void FOCBITMAPINDEX::Clear(void) {
+
+	for (int i = 0; i < Num_values; i++) {
+		delete Bitmap[i];
+	}
+	free(Value);
+	free(Bitmap);
+	free(Slot);
+	free(Posting);
+	Stamps.clear();
+
+	Value		= NULL;
+	Bitmap		= NULL;
+	Num_values	= 0;
+	Allocated_values = 0;
+	Slot		= NULL;
+	Num_slots	= 0;
+	Posting		= NULL;
+	Num_records	= 0;
+	Allocated_records = 0;
+}
+
+// Walk every record of seg
+void FOCBITMAPINDEX::build(FOCFILE* foc, int seg, int offset, char type,
+			int length) {
+
+	if (seg < 1 || seg > foc->number_seg()) {
+		die("BITMAP on non-existant segment %d\n", seg);
+	}
+	if (type == FIELDTYPE_INTEGER || type == FIELDTYPE_SMDATE ||
+			type == FIELDTYPE_FLOAT) {
+		length = 4;
+	}
+	else if (type == FIELDTYPE_DOUBLE) {
+		length = 8;
+	}
+	else if (type != FIELDTYPE_ALPHA) {
+		die("BITMAP field has unknown type %c\n", type);
+	}
+
+	Clear();
+	Seg		= seg;
+	Offset		= offset;
+	Type		= type;
+	Length		= length;
+	Rehash();
+
+	Stamps.start(foc);
+	foc->walk(Seg, Walked, this);
+	Stamps.end();
+
+	debug("BITMAP::build %d values, %ld records, %d pages\n",
+		Num_values, Num_records, Stamps.pages());
+}
+
+void FOCBITMAPINDEX::Walked(FOCFILE* foc, int seg, void* arg) {
+
+	((FOCBITMAPINDEX*) arg)->Add_record(foc);
+}
+
+void FOCBITMAPINDEX::Add_record(FOCFILE* foc) {
+
+	FOCPTR		where;
+	UCHAR		*key;
+	int		s;
+
+	foc->position(Seg, where);
+	Stamps.add(foc, Seg, where.page);
+
+	if (Num_records == Allocated_records) {
+		Allocated_records = Allocated_records ?
+				Allocated_records * 2 : 4096;
+		Posting = (FOCBITMAP_POSTING*) xrealloc("BITMAP postings",
+				Posting, sizeof(FOCBITMAP_POSTING) *
+				Allocated_records);
+	}
+	Posting[Num_records].page = where.page;
+	Posting[Num_records].word = where.word;
+
+	// A value not seen before gets a bitmap
+	key = foc->record_data(Seg) + Offset;
+	s = Value_slot(key);
+	if (Slot[s] == 0) {
+		if (Num_values == Allocated_values) {
+			Allocated_values = Allocated_values ?
+					Allocated_values * 2 : 16;
+			Value = (UCHAR*) xrealloc("BITMAP values", Value,
+					(long) Length * Allocated_values);
+			Bitmap = (FOCBITMAP**) xrealloc("BITMAP values",
+					Bitmap, sizeof(FOCBITMAP*) *
+					Allocated_values);
+		}
+		memcpy(Value + Length * Num_values, key, Length);
+		Bitmap[Num_values] = new FOCBITMAP;
+		Slot[s] = ++Num_values;
+
+		if (Num_values * 2 > Num_slots) {
+			Rehash();
+			s = Value_slot(key);
+		}
+	}
+
+	Bitmap[Slot[s] - 1]->set(Num_records);
+	Num_records++;
+}
+
+// The slot that holds the value, or the empty one it would go in.
+// Hashed on the raw bytes, the way FOCFILE::match() compares them.
+int FOCBITMAPINDEX::Value_slot(UCHAR* key) {
+
+	uint32_t	hash = 2166136261u;
+	int		s;
+
+	for (int i = 0; i < Length; i++) {
+		hash = (hash ^ key[i]) * 16777619u;
+	}
+
+	for (s = hash & (Num_slots - 1); Slot[s] != 0;
+			s = (s + 1) & (Num_slots - 1)) {
+		if (memcmp(Value + Length * (Slot[s] - 1), key, Length) == 0) {
+			break;
+		}
+	}
+
+	return s;
+}
+
+// Size the slots for the values there are, and fill them in again
+void FOCBITMAPINDEX::Rehash(void) {
+
+	for (Num_slots = 64; Num_slots < 4 * Num_values; Num_slots *= 2)
+		;
+	Slot = (int*) xrealloc("BITMAP slots", Slot, sizeof(int) * Num_slots);
+	memset(Slot, 0, sizeof(int) * Num_slots);
+
+	for (int v = 0; v < Num_values; v++) {
+		Slot[Value_slot(Value + Length * v)] = v + 1;
+	}
+}
+
+void FOCBITMAPINDEX::write(FILE* fh) {
+
+	FOCBITMAP_HEADER	h;
+
+	memset(&h, 0, sizeof(FOCBITMAP_HEADER));
+	memcpy(h.magic, FOCBITMAP_MAGIC, 8);
+	h.seg		= Seg;
+	h.offset	= Offset;
+	h.type		= Type;
+	h.length	= Length;
+	h.values	= Num_values;
+	h.records	= Num_records;
+
+	if (fwrite(&h, sizeof(FOCBITMAP_HEADER), 1, fh) != 1 ||
+		fwrite(Value, Length, Num_values, fh) != (size_t) Num_values ||
+		fwrite(Posting, sizeof(FOCBITMAP_POSTING), Num_records, fh) !=
+			(size_t) Num_records ||
+		!Stamps.write(fh)) {
+		die("BITMAP: can't write the index\n");
+	}
+
+	for (int v = 0; v < Num_values; v++) {
+		Bitmap[v]->write(fh);
+	}
+}
+
+// Returns 1, or 0 if the FOCUS file has changed since it was built
+int FOCBITMAPINDEX::read(FILE* fh, FOCFILE* foc) {
+
+	FOCBITMAP_HEADER	h;
+
+	if (fread(&h, sizeof(FOCBITMAP_HEADER), 1, fh) != 1 ||
+			memcmp(h.magic, FOCBITMAP_MAGIC, 8) != 0) {
+		die("BITMAP: not a bitmap index\n");
+	}
+
+	Clear();
+	Seg		= h.seg;
+	Offset		= h.offset;
+	Type		= h.type;
+	Length		= h.length;
+	Num_values	= Allocated_values = h.values;
+	Num_records	= Allocated_records = h.records;
+
+	Value = (UCHAR*) xrealloc("BITMAP values", NULL,
+			(long) Length * Num_values + 1);
+	Bitmap = (FOCBITMAP**) xrealloc("BITMAP values", NULL,
+			sizeof(FOCBITMAP*) * (Num_values + 1));
+	Posting = (FOCBITMAP_POSTING*) xrealloc("BITMAP postings", NULL,
+			sizeof(FOCBITMAP_POSTING) * (Num_records + 1));
+
+	if (fread(Value, Length, Num_values, fh) != (size_t) Num_values ||
+		fread(Posting, sizeof(FOCBITMAP_POSTING), Num_records, fh) !=
+			(size_t) Num_records ||
+		!Stamps.read(fh)) {
+		die("BITMAP: index is cut short\n");
+	}
+
+	for (int v = 0; v < Num_values; v++) {
+		Bitmap[v] = new FOCBITMAP;
+		Bitmap[v]->read(fh);
+	}
+	Rehash();
+
+	return Stamps.current(foc);
+}
+
+// Read every page with a record on it, and count those that have changed
+int FOCBITMAPINDEX::stale(FOCFILE* foc) {
+
+	return Stamps.stale(foc);
+}
+
+const FOCBITMAP& FOCBITMAPINDEX::bitmap(char* key) {
+	return bitmap((void*) key);
+}
+const FOCBITMAP& FOCBITMAPINDEX::bitmap(long& key) {
+	int32_t value = (int32_t) key;
+	return bitmap((void*) &value);
+}
+const FOCBITMAP& FOCBITMAPINDEX::bitmap(int32_t& key) {
+	return bitmap((void*) &key);
+}
+const FOCBITMAP& FOCBITMAPINDEX::bitmap(SMDATE& key) {
+	int32_t date = (int32_t) key.julian();
+	return bitmap((void*) &date);
+}
+
+const FOCBITMAP& FOCBITMAPINDEX::bitmap(void* key) {
+
+	int s = Num_slots ? Value_slot((UCHAR*) key) : 0;
+
+	if (Num_slots == 0 || Slot[s] == 0) {
+		return Empty;
+	}
+	return *Bitmap[Slot[s] - 1];
+}
+
+UCHAR* FOCBITMAPINDEX::value(int n) {
+
+	if (n < 0 || n >= Num_values) {
+		die("BITMAP has no value %d\n", n);
+	}
+	return Value + Length * n;
+}
+
+const FOCBITMAP& FOCBITMAPINDEX::value_bitmap(int n) {
+
+	if (n < 0 || n >= Num_values) {
+		die("BITMAP has no value %d\n", n);
+	}
+	return *Bitmap[n];
+}
+
+void FOCBITMAPINDEX::move(FOCFILE* foc, long n) {
+
+	FOCPTR		where;
+
+	if (n < 0 || n >= Num_records) {
+		die("BITMAP has no record %ld\n", n);
+	}
+
+	// Is the page as it was?
+	if (!Stamps.read_page(foc, Seg, Posting[n].page)) {
+		die("BITMAP page %d has changed since the index was built\n",
+			Posting[n].page);
+	}
+
+	where.type = 0;
+	where.page = Posting[n].page;
+	where.word = Posting[n].word;
+	foc->set_position(Seg, where);
+}
+
+// =============================================================
+// Extra functions
+// =============================================================
+
+void chunk_free(FOCBITMAP_CHUNK *c) {
+
+	free(c->list);
+	free(c->bits);
+	c->list		= NULL;
+	c->bits		= NULL;
+	c->members	= 0;
+	c->allocated	= 0;
+}
+
+void chunk_copy(FOCBITMAP_CHUNK *to, const FOCBITMAP_CHUNK *from) {
+
+	to->key		= from->key;
+	to->members	= from->members;
+	to->list	= NULL;
+	to->bits	= NULL;
+	to->allocated	= 0;
+
+	if (from->bits) {
+		to->bits = (uint64_t*) xrealloc("BITMAP bits", NULL,
+				sizeof(uint64_t) * CHUNK_WORDS);
+		memcpy(to->bits, from->bits, sizeof(uint64_t) * CHUNK_WORDS);
+	}
+	else {
+		to->allocated = from->members;
+		to->list = (unsigned short*) xrealloc("BITMAP list", NULL,
+				sizeof(unsigned short) * (from->members + 1));
+		memcpy(to->list, from->list,
+				sizeof(unsigned short) * from->members);
+	}
+}
+
+void chunk_expand(const FOCBITMAP_CHUNK *c, uint64_t *words) {
+
+	if (c->bits) {
+		memcpy(words, c->bits, sizeof(uint64_t) * CHUNK_WORDS);
+		return;
+	}
+
+	memset(words, 0, sizeof(uint64_t) * CHUNK_WORDS);
+	for (int i = 0; i < c->members; i++) {
+		words[c->list[i] >> 6] |= (uint64_t) 1 << (c->list[i] & 63);
+	}
+}
+
+// Store the words in c, whose old members must already be freed
+void chunk_pack(FOCBITMAP_CHUNK *c, int key, uint64_t *words) {
+
+	int	members = 0, w;
+
+	for (w = 0; w < CHUNK_WORDS; w++) {
+		members += __builtin_popcountll(words[w]);
+	}
+
+	free(c->list);
+	free(c->bits);
+	c->key		= key;
+	c->members	= members;
+	c->list		= NULL;
+	c->bits		= NULL;
+	c->allocated	= 0;
+
+	if (members > LIST_MAX) {
+		c->bits = (uint64_t*) xrealloc("BITMAP bits", NULL,
+				sizeof(uint64_t) * CHUNK_WORDS);
+		memcpy(c->bits, words, sizeof(uint64_t) * CHUNK_WORDS);
+		return;
+	}
+
+	c->allocated = members;
+	c->list = (unsigned short*) xrealloc("BITMAP list", NULL,
+			sizeof(unsigned short) * (members + 1));
+	members = 0;
+	for (w = 0; w < CHUNK_WORDS; w++) {
+		uint64_t word = words[w];
+		while (word) {
+			c->list[members++] = w * 64 + __builtin_ctzll(word);
+			word &= word - 1;
+		}
+	}
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
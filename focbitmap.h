@@ -0,0 +1,170 @@
+/*
+    focbitmap.h
+    -----------
+    Bitmap indexes for the FocFile C++ library. A FOCBITMAPINDEX keeps,
+    for each value of a field with few distinct values, the set of a
+    segment's records that have it, as a compressed FOCBITMAP. Bitmaps
+    are combined with AND, OR and NOT, counted without reading the FOCUS
+    file, and walked to visit only the records they hold.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCBITMAP_H
+#define FOCBITMAP_H
+
+#ifndef FOCSTAMP_H
+#include "focstamp.h"
+#endif /* FOCSTAMP_H */
+
+#define FOCBITMAP_MAGIC	"FOCBMAP2"
+
+struct FOCBITMAP_CHUNK;
+struct FOCBITMAP_POSTING;
+
+// A set of record numbers. The numbers are split into chunks of 65536
+// by their high 16 bits; a chunk with few members keeps them as a
+// sorted list of their low 16 bits, a full one as 65536 bits. Chunks
+// with no members aren't kept at all.
+//
+//	FOCBITMAP picked(body.bitmap(sedan));
+//	picked.intersect(country.bitmap(england));
+//	for (n = picked.next(0); n >= 0; n = picked.next(n + 1)) {
+//		...
+//	}
+class FOCBITMAP {
+
+public:
+	FOCBITMAP();
+	FOCBITMAP(const FOCBITMAP& other);
+	FOCBITMAP& operator=(const FOCBITMAP& other);
+	~FOCBITMAP();
+
+	void	set(long n);
+	int	test(long n) const;
+	long	count(void) const;
+	void	clear(void);
+
+	// The first member >= n, or -1
+	long	next(long n) const;
+
+	// AND, OR, AND NOT; invert() is NOT within 0 .. records - 1
+	void	intersect(const FOCBITMAP& other);
+	void	unite(const FOCBITMAP& other);
+	void	subtract(const FOCBITMAP& other);
+	void	invert(long records);
+
+	void	write(FILE* fh) const;
+	void	read(FILE* fh);
+
+private:
+	int	Find_chunk(int key) const;
+	FOCBITMAP_CHUNK* Insert_chunk(int at, int key);
+	void	Combine(const FOCBITMAP& other, int op);
+
+private:
+	FOCBITMAP_CHUNK	*Chunk;		// by key
+	int		Num_chunks;
+	int		Allocated_chunks;
+};
+
+// The index is built once by walking every record of the segment, and
+// kept in a file next to the FOCUS file:
+//
+//	FOCBITMAPINDEX body;
+//	body.build(foc, FOCFLD_CAR_BODYTYPE);
+//	body.write(fh);
+//
+// Records are numbered in the order a walk from the root reaches them,
+// so the bitmaps of two indexes on the same segment, built from the same
+// file, can be combined. The stamp of each page with a record on it is
+// kept, and the FDT's: read() returns 0 if the FDT has changed since,
+// stale() counts the pages that have, and move() dies if the page it
+// moves to has.
+class FOCBITMAPINDEX {
+
+public:
+	FOCBITMAPINDEX();
+	~FOCBITMAPINDEX();
+
+	void	build(FOCFILE* foc, int seg, int offset, char type,
+			int length);
+	void	write(FILE* fh);
+	int	read(FILE* fh, FOCFILE* foc);
+	int	stale(FOCFILE* foc);
+
+	// The records with a value; an empty bitmap if there are none.
+	// They belong to the index: copy one to combine it with others.
+private:
+	const FOCBITMAP& bitmap(void* key);
+public:
+	const FOCBITMAP& bitmap(char* key);
+	const FOCBITMAP& bitmap(long& key);
+	const FOCBITMAP& bitmap(int32_t& key);
+	const FOCBITMAP& bitmap(SMDATE& key);
+
+	// The n'th distinct value and its records
+	int	values(void) { return Num_values; };
+	UCHAR*	value(int n);
+	const FOCBITMAP& value_bitmap(int n);
+
+	// Move the segment's cursor to record n, as FOCSIDX::match() does
+	void	move(FOCFILE* foc, long n);
+
+	int	segment(void) { return Seg; };
+	long	records(void) { return Num_records; };
+
+private:
+	void	Clear(void);
+	static void Walked(FOCFILE* foc, int seg, void* arg);
+	void	Add_record(FOCFILE* foc);
+	int	Value_slot(UCHAR* key);
+	void	Rehash(void);
+
+private:
+	int		Seg;
+	int		Offset;
+	char		Type;
+	int		Length;
+
+	// The values, in the order they were first seen, and their records
+	UCHAR		*Value;
+	FOCBITMAP	**Bitmap;
+	int		Num_values;
+	int		Allocated_values;
+	FOCBITMAP	Empty;
+
+	// Value number + 1 by hash, or 0 for an empty slot
+	int		*Slot;
+	int		Num_slots;
+
+	// Where each record is, by number
+	FOCBITMAP_POSTING *Posting;
+	long		Num_records;
+	long		Allocated_records;
+
+	// The FDT and the pages the records are on
+	FOCSTAMPTABLE	Stamps;
+};
+
+#endif /* FOCBITMAP_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
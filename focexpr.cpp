@@ -0,0 +1,787 @@
+/*
+    focexpr.cpp
+    -----------
+    Filter expressions for the FocFile C++ library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "focexpr.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+// Node kinds
+#define NODE_TEST	0
+#define NODE_AND	1
+#define NODE_OR		2
+#define NODE_NOT	3
+
+// Tests beyond the FOCEXPR_OP comparisons
+#define OP_RANGE	100
+#define OP_IN		101
+
+// What a test may come to over a range of values
+#define MAY_TRUE	1
+#define MAY_FALSE	2
+
+// Opcodes of the compiled program
+#define I_TEST		0
+#define I_JUMP_FALSE	1
+#define I_JUMP_TRUE	2
+#define I_NOT		3
+#define I_END		4
+
+// One pushed test or operator
+struct FOCEXPR_NODE {
+	int	kind;
+	int	op;
+	int	seg;
+	int	offset;
+	char	type;
+	int	length;
+	int	constant;	// offset of the first constant in Constants
+	int	count;		// number of constants
+
+	// Set by compile()
+	int	left;
+	int	right;
+};
+
+// One instruction. Tests leave their result in the accumulator;
+// the jumps look at it.
+struct FOCEXPR_INSTR {
+	UCHAR	opcode;
+	UCHAR	slot;
+	char	type;
+	int	op;
+	int	offset;
+	int	length;
+	int	count;
+	UCHAR	*constant;
+	int	target;
+};
+
+static int test_field(FOCEXPR_INSTR *instr, UCHAR *field);
+static int test_bounds(FOCEXPR_NODE *n, UCHAR *constant, UCHAR *low,
+		UCHAR *high);
+
+// =============================================================
+// CLASS: FOCEXPR
+// -------------------------------------------------------------
+// A WHERE clause, built in postfix order and compiled into a
+// small program.
+// =============================================================
+FOCEXPR::FOCEXPR() {
+
+	Node			= NULL;
+	Num_nodes		= 0;
+	Allocated_nodes		= 0;
+	Depth			= 0;
+
+	Constants		= NULL;
+	Constants_length	= 0;
+	Allocated_constants	= 0;
+
+	Code			= NULL;
+	Code_length		= 0;
+	Compiled		= 0;
+
+	Slot			= NULL;
+	Num_slots		= 0;
+	Slot_data		= NULL;
+	Bound_slot		= -1;
+}
+
+FOCEXPR::~FOCEXPR() {
+
+	free(Node);
+	free(Constants);
+	free(Code);
+	free(Slot);
+	free(Slot_data);
+}
+
+// Comparisons
+void FOCEXPR::compare(int seg, int offset, char type, int length,
+			FOCEXPR_OP op, const char* value) {
+	Add_test(seg, offset, type, length, op, 1);
+	Add_alpha(length, value);
+}
+
+void FOCEXPR::compare(int seg, int offset, char type, int length,
+			FOCEXPR_OP op, long value) {
+	Add_test(seg, offset, type, length, op, 1);
+	Add_long(type, value);
+}
+
+void FOCEXPR::compare(int seg, int offset, char type, int length,
+			FOCEXPR_OP op, double value) {
+	Add_test(seg, offset, type, length, op, 1);
+	Add_double(type, value);
+}
+
+void FOCEXPR::compare(int seg, int offset, char type, int length,
+			FOCEXPR_OP op, const SMDATE& value) {
+
+	if (type != FIELDTYPE_SMDATE) {
+		die("EXPR::compare SMDATE against type %c\n", type);
+	}
+	Add_test(seg, offset, type, length, op, 1);
+	Add_long(type, value.internal() - SMDATE_FOCUS);
+}
+
+// Ranges
+void FOCEXPR::range(int seg, int offset, char type, int length,
+			const char* low, const char* high) {
+	Add_test(seg, offset, type, length, OP_RANGE, 2);
+	Add_alpha(length, low);
+	Add_alpha(length, high);
+}
+
+void FOCEXPR::range(int seg, int offset, char type, int length,
+			long low, long high) {
+	Add_test(seg, offset, type, length, OP_RANGE, 2);
+	Add_long(type, low);
+	Add_long(type, high);
+}
+
+void FOCEXPR::range(int seg, int offset, char type, int length,
+			double low, double high) {
+	Add_test(seg, offset, type, length, OP_RANGE, 2);
+	Add_double(type, low);
+	Add_double(type, high);
+}
+
+void FOCEXPR::range(int seg, int offset, char type, int length,
+			const SMDATE& low, const SMDATE& high) {
+
+	if (type != FIELDTYPE_SMDATE) {
+		die("EXPR::range SMDATE against type %c\n", type);
+	}
+	Add_test(seg, offset, type, length, OP_RANGE, 2);
+	Add_long(type, low.internal() - SMDATE_FOCUS);
+	Add_long(type, high.internal() - SMDATE_FOCUS);
+}
+
+// IN-lists
+void FOCEXPR::in_list(int seg, int offset, char type, int length,
+			int count, const char** values) {
+	Add_test(seg, offset, type, length, OP_IN, count);
+	for (int i = 0; i < count; i++) {
+		Add_alpha(length, values[i]);
+	}
+}
+
+void FOCEXPR::in_list(int seg, int offset, char type, int length,
+			int count, long* values) {
+	Add_test(seg, offset, type, length, OP_IN, count);
+	for (int i = 0; i < count; i++) {
+		Add_long(type, values[i]);
+	}
+}
+
+void FOCEXPR::in_list(int seg, int offset, char type, int length,
+			int count, double* values) {
+	Add_test(seg, offset, type, length, OP_IN, count);
+	for (int i = 0; i < count; i++) {
+		Add_double(type, values[i]);
+	}
+}
+
+// Operators
+void FOCEXPR::op_and(void) {
+	if (Depth < 2) {
+		die("EXPR::op_and needs two results, has %d\n", Depth);
+	}
+	Add_node(NODE_AND);
+	Depth--;
+}
+
+void FOCEXPR::op_or(void) {
+	if (Depth < 2) {
+		die("EXPR::op_or needs two results, has %d\n", Depth);
+	}
+	Add_node(NODE_OR);
+	Depth--;
+}
+
+void FOCEXPR::op_not(void) {
+	if (Depth < 1) {
+		die("EXPR::op_not needs a result\n");
+	}
+	Add_node(NODE_NOT);
+}
+
+// Returns the segment of the fields, or 0 if they lie in several
+int FOCEXPR::segment(void) {
+
+	if (!Compiled) {
+		die("EXPR::segment called before compile()\n");
+	}
+
+	return Num_slots == 1 ? Slot[0] : 0;
+}
+
+int FOCEXPR::reads_segment(int seg) {
+
+	if (!Compiled) {
+		die("EXPR::reads_segment called before compile()\n");
+	}
+
+	for (int i = 0; i < Num_slots; i++) {
+		if (Slot[i] == seg) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void FOCEXPR::Add_node(int kind) {
+
+	if (Num_nodes == Allocated_nodes) {
+		Allocated_nodes = Allocated_nodes ? Allocated_nodes * 2 : 8;
+		Node = (FOCEXPR_NODE*) xrealloc("EXPR nodes", Node,
+				sizeof(FOCEXPR_NODE) * Allocated_nodes);
+	}
+
+	FOCEXPR_NODE *n = &Node[Num_nodes++];
+	memset(n, 0, sizeof(FOCEXPR_NODE));
+	n->kind = kind;
+	n->left = n->right = -1;
+
+	// Anything added after compile() needs a new program
+	Compiled = 0;
+}
+
+void FOCEXPR::Add_test(int seg, int offset, char type, int length,
+			int op, int count) {
+
+	if (count < 1) {
+		die("EXPR test on seg %d offset %d has no values\n",
+			seg, offset);
+	}
+
+	if (type == FIELDTYPE_INTEGER || type == FIELDTYPE_SMDATE ||
+			type == FIELDTYPE_FLOAT) {
+		length = 4;
+	}
+	else if (type == FIELDTYPE_DOUBLE) {
+		length = 8;
+	}
+	else if (type != FIELDTYPE_ALPHA) {
+		die("EXPR test has unknown type %c\n", type);
+	}
+
+	Add_node(NODE_TEST);
+
+	FOCEXPR_NODE *n = &Node[Num_nodes - 1];
+	n->op		= op;
+	n->seg		= seg;
+	n->offset	= offset;
+	n->type		= type;
+	n->length	= length;
+	n->constant	= Constants_length;
+	n->count	= count;
+
+	Depth++;
+}
+
+// Constants are stored in the field's own format, so the tests can
+// compare them against the page buffer as they are.
+void FOCEXPR::Add_constant(char type, int length, UCHAR* bytes) {
+
+	FOCEXPR_NODE *n = &Node[Num_nodes - 1];
+
+	if (n->type != type) {
+		die("EXPR constant of type %c for field of type %c\n",
+			type, n->type);
+	}
+
+	if (Constants_length + length > Allocated_constants) {
+		Allocated_constants = (Constants_length + length) * 2;
+		Constants = (UCHAR*) xrealloc("EXPR constants", Constants,
+				Allocated_constants);
+	}
+
+	memcpy(Constants + Constants_length, bytes, length);
+	Constants_length += length;
+}
+
+// Alpha fields are blank-padded on disk
+void FOCEXPR::Add_alpha(int length, const char* value) {
+
+	UCHAR	*padded = (UCHAR*) xrealloc("EXPR alpha", NULL, length);
+	int	value_length = strlen(value);
+
+	if (value_length > length) {
+		die("EXPR value '%s' longer than its field (%d)\n",
+			value, length);
+	}
+
+	memset(padded, ' ', length);
+	memcpy(padded, value, value_length);
+	Add_constant(FIELDTYPE_ALPHA, length, padded);
+	free(padded);
+}
+
+// Integer constants go with integer, smartdate, and floating fields
+void FOCEXPR::Add_long(char type, long value) {
+
+	if (type == FIELDTYPE_INTEGER || type == FIELDTYPE_SMDATE) {
+		int32_t i = (int32_t) value;
+		Add_constant(type, 4, (UCHAR*) &i);
+	}
+	else {
+		Add_double(type, (double) value);
+	}
+}
+
+void FOCEXPR::Add_double(char type, double value) {
+
+	if (type == FIELDTYPE_DOUBLE) {
+		Add_constant(type, 8, (UCHAR*) &value);
+	}
+	else if (type == FIELDTYPE_FLOAT) {
+		float f = (float) value;
+		Add_constant(type, 4, (UCHAR*) &f);
+	}
+	else {
+		die("EXPR floating point constant for type %c\n", type);
+	}
+}
+
+/*
+Compiling works in three steps:
+
+1.  Collect the segments that the tests read from. Each gets a slot;
+	eval() fetches the current record of every slot once per call.
+
+2.  Turn the postfix list into a tree, by replaying the pushes on a
+	stack of node numbers.
+
+3.  Walk the tree and emit the program. AND and OR become jumps around
+	their right operand, so we stop evaluating as soon as the answer
+	is known.
+*/
+void FOCEXPR::compile(FOCFILE* foc) {
+
+	int	i, j;
+
+	if (Compiled) {
+		return;
+	}
+
+	if (Num_nodes > 0 && Depth != 1) {
+		die("EXPR::compile has %d results left; missing op_and() "
+			"or op_or()?\n", Depth);
+	}
+
+	// 1. Slots
+	free(Slot);
+	Slot = (int*) xrealloc("EXPR slots", NULL,
+			sizeof(int) * (Num_nodes + 1));
+	Num_slots = 0;
+
+	for (i = 0; i < Num_nodes; i++) {
+
+		if (Node[i].kind != NODE_TEST) {
+			continue;
+		}
+
+		if (Node[i].seg < 1 ||
+				(foc && Node[i].seg > foc->number_seg())) {
+			die("EXPR::compile field in non-existant segment %d\n",
+				Node[i].seg);
+		}
+
+		for (j = 0; j < Num_slots; j++) {
+			if (Slot[j] == Node[i].seg) break;
+		}
+		if (j == Num_slots) {
+			Slot[Num_slots++] = Node[i].seg;
+		}
+	}
+
+	if (Num_slots > 255) {
+		die("EXPR::compile reads too many segments\n");
+	}
+
+	free(Slot_data);
+	Slot_data = (UCHAR**) xrealloc("EXPR slot data", NULL,
+			sizeof(UCHAR*) * (Num_slots + 1));
+
+	// 2. Tree
+	int	*stack = (int*) xrealloc("EXPR stack", NULL,
+				sizeof(int) * (Num_nodes + 1));
+	int	depth = 0;
+
+	for (i = 0; i < Num_nodes; i++) {
+		switch (Node[i].kind) {
+			case NODE_TEST:
+				break;
+			case NODE_NOT:
+				Node[i].left = stack[--depth];
+				break;
+			default:
+				Node[i].right = stack[--depth];
+				Node[i].left = stack[--depth];
+				break;
+		}
+		stack[depth++] = i;
+	}
+	free(stack);
+
+	// 3. Program
+	free(Code);
+	Code = (FOCEXPR_INSTR*) xrealloc("EXPR code", NULL,
+			sizeof(FOCEXPR_INSTR) * (2 * Num_nodes + 1));
+
+	Code_length = Num_nodes > 0 ? Emit(Num_nodes - 1, 0) : 0;
+	Code[Code_length].opcode = I_END;
+	Code_length++;
+
+	debug("EXPR::compile %d nodes, %d instructions, %d segments\n",
+		Num_nodes, Code_length, Num_slots);
+
+	Compiled = 1;
+}
+
+// Emit the code for a node at position pc. Returns the position after it.
+int FOCEXPR::Emit(int node, int pc) {
+
+	FOCEXPR_NODE	*n = &Node[node];
+	int		jump;
+
+	switch (n->kind) {
+
+		case NODE_TEST: {
+			FOCEXPR_INSTR *instr = &Code[pc];
+			instr->opcode	= I_TEST;
+			instr->type	= n->type;
+			instr->op	= n->op;
+			instr->offset	= n->offset;
+			instr->length	= n->length;
+			instr->count	= n->count;
+			instr->constant	= Constants + n->constant;
+			for (int i = 0; i < Num_slots; i++) {
+				if (Slot[i] == n->seg) instr->slot = i;
+			}
+			return pc + 1;
+		}
+
+		case NODE_NOT:
+			pc = Emit(n->left, pc);
+			Code[pc].opcode = I_NOT;
+			return pc + 1;
+
+		default:
+			pc = Emit(n->left, pc);
+			jump = pc++;
+			Code[jump].opcode = (n->kind == NODE_AND) ?
+						I_JUMP_FALSE : I_JUMP_TRUE;
+			pc = Emit(n->right, pc);
+			Code[jump].target = pc;
+			return pc;
+	}
+}
+
+// Evaluate against the current record of every segment involved
+int FOCEXPR::eval(FOCFILE* foc) {
+
+	compile(foc);
+
+	for (int i = 0; i < Num_slots; i++) {
+		if (!(Slot_data[i] = foc->record_data(Slot[i]))) {
+			return 0;
+		}
+	}
+
+	return Run(Slot_data);
+}
+
+// Evaluate against one record's data area
+int FOCEXPR::eval_record(UCHAR* data) {
+
+	if (!Compiled) {
+		die("EXPR::eval_record called before compile()\n");
+	}
+
+	if (Num_slots > 1) {
+		die("EXPR::eval_record on an expression over %d segments\n",
+			Num_slots);
+	}
+
+	Slot_data[0] = data;
+	return Run(Slot_data);
+}
+
+// Fetch the records of every segment but seg
+int FOCEXPR::bind(FOCFILE* foc, int seg) {
+
+	compile(foc);
+
+	Bound_slot = -1;
+	for (int i = 0; i < Num_slots; i++) {
+		if (Slot[i] == seg) {
+			Bound_slot = i;
+		}
+		else if (!(Slot_data[i] = foc->record_data(Slot[i]))) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+// Evaluate against one record of the bound segment
+int FOCEXPR::eval_bound(UCHAR* data) {
+
+	if (Bound_slot >= 0) {
+		Slot_data[Bound_slot] = data;
+	}
+
+	return Run(Slot_data);
+}
+
+// The interpreter. An empty expression is true.
+int FOCEXPR::Run(UCHAR** data) {
+
+	FOCEXPR_INSTR	*pc = Code;
+	int		acc = 1;
+
+	for (;;) {
+		switch (pc->opcode) {
+			case I_TEST:
+				acc = test_field(pc, data[pc->slot] +
+						pc->offset);
+				pc++;
+				break;
+			case I_JUMP_FALSE:
+				pc = acc ? pc + 1 : Code + pc->target;
+				break;
+			case I_JUMP_TRUE:
+				pc = acc ? Code + pc->target : pc + 1;
+				break;
+			case I_NOT:
+				acc = !acc;
+				pc++;
+				break;
+			default:
+				return acc;
+		}
+	}
+}
+
+// Could anything within the bounds pass? The tree is walked with two
+// answers per node, whether it may be true and whether it may be false,
+// since NOT swaps them.
+int FOCEXPR::may_pass(FOCEXPR_BOUNDS bounds, void* arg) {
+
+	if (!Compiled) {
+		die("EXPR::may_pass called before compile()\n");
+	}
+
+	if (Num_nodes == 0) {
+		return 1;
+	}
+
+	return (Bounds_test(Num_nodes - 1, bounds, arg) & MAY_TRUE) != 0;
+}
+
+int FOCEXPR::Bounds_test(int node, FOCEXPR_BOUNDS bounds, void* arg) {
+
+	FOCEXPR_NODE	*n = &Node[node];
+	UCHAR		*low, *high;
+	int		l, r;
+
+	switch (n->kind) {
+		case NODE_TEST:
+			if (!bounds(n->seg, n->offset, n->type, n->length,
+					&low, &high, arg)) {
+				return MAY_TRUE | MAY_FALSE;
+			}
+			return test_bounds(n, Constants + n->constant,
+					low, high);
+
+		case NODE_NOT:
+			l = Bounds_test(n->left, bounds, arg);
+			return ((l & MAY_TRUE) ? MAY_FALSE : 0) |
+				((l & MAY_FALSE) ? MAY_TRUE : 0);
+
+		case NODE_AND:
+			l = Bounds_test(n->left, bounds, arg);
+			r = Bounds_test(n->right, bounds, arg);
+			return (l & r & MAY_TRUE) | ((l | r) & MAY_FALSE);
+
+		default:
+			l = Bounds_test(n->left, bounds, arg);
+			r = Bounds_test(n->right, bounds, arg);
+			return ((l | r) & MAY_TRUE) | (l & r & MAY_FALSE);
+	}
+}
+
+// =============================================================
+// Extra functions
+// =============================================================
+
+// Test one field against the instruction's constants
+int test_field(FOCEXPR_INSTR *instr, UCHAR *field) {
+
+	int	c;
+	int	i;
+
+	// The common case, integers and dates, without the general compare
+	if (instr->type == FIELDTYPE_INTEGER ||
+			instr->type == FIELDTYPE_SMDATE) {
+
+		int32_t	value = mkint32(field);
+
+		switch (instr->op) {
+			case FOCEXPR_EQ:
+				return value == mkint32(instr->constant);
+			case FOCEXPR_NE:
+				return value != mkint32(instr->constant);
+			case FOCEXPR_LT:
+				return value < mkint32(instr->constant);
+			case FOCEXPR_LE:
+				return value <= mkint32(instr->constant);
+			case FOCEXPR_GT:
+				return value > mkint32(instr->constant);
+			case FOCEXPR_GE:
+				return value >= mkint32(instr->constant);
+			case OP_RANGE:
+				return value >= mkint32(instr->constant) &&
+					value <= mkint32(instr->constant + 4);
+			default:
+				for (i = 0; i < instr->count; i++) {
+					if (value == mkint32(instr->constant +
+								i * 4)) {
+						return 1;
+					}
+				}
+				return 0;
+		}
+	}
+
+	switch (instr->op) {
+		case OP_RANGE:
+			return field_compare(instr->type, instr->length,
+					field, instr->constant) >= 0 &&
+				field_compare(instr->type, instr->length,
+					field, instr->constant +
+					instr->length) <= 0;
+		case OP_IN:
+			for (i = 0; i < instr->count; i++) {
+				if (field_compare(instr->type, instr->length,
+					field, instr->constant +
+					i * instr->length) == 0) {
+					return 1;
+				}
+			}
+			return 0;
+	}
+
+	c = field_compare(instr->type, instr->length, field, instr->constant);
+
+	switch (instr->op) {
+		case FOCEXPR_EQ:	return c == 0;
+		case FOCEXPR_NE:	return c != 0;
+		case FOCEXPR_LT:	return c < 0;
+		case FOCEXPR_LE:	return c <= 0;
+		case FOCEXPR_GT:	return c > 0;
+		default:		return c >= 0;
+	}
+}
+
+// What a test may come to for values from low to high
+int test_bounds(FOCEXPR_NODE *n, UCHAR *constant, UCHAR *low, UCHAR *high) {
+
+	int	lo = field_compare(n->type, n->length, low, constant);
+	int	hi = field_compare(n->type, n->length, high, constant);
+	int	may_true, may_false;
+	int	i;
+
+	switch (n->op) {
+		case FOCEXPR_EQ:
+		case FOCEXPR_NE:
+			may_true = lo <= 0 && hi >= 0;
+			may_false = !(lo == 0 && hi == 0);
+			if (n->op == FOCEXPR_NE) {
+				i = may_true;
+				may_true = may_false;
+				may_false = i;
+			}
+			break;
+		case FOCEXPR_LT:
+			may_true = lo < 0;
+			may_false = hi >= 0;
+			break;
+		case FOCEXPR_LE:
+			may_true = lo <= 0;
+			may_false = hi > 0;
+			break;
+		case FOCEXPR_GT:
+			may_true = hi > 0;
+			may_false = lo <= 0;
+			break;
+		case FOCEXPR_GE:
+			may_true = hi >= 0;
+			may_false = lo < 0;
+			break;
+		case OP_RANGE: {
+			UCHAR *top = constant + n->length;
+			may_true = hi >= 0 &&
+				field_compare(n->type, n->length, low, top) <= 0;
+			may_false = lo < 0 ||
+				field_compare(n->type, n->length, high, top) > 0;
+			break;
+		}
+		default:
+			may_true = 0;
+			may_false = 1;
+			for (i = 0; i < n->count; i++) {
+				UCHAR *c = constant + i * n->length;
+				lo = field_compare(n->type, n->length, low, c);
+				hi = field_compare(n->type, n->length, high, c);
+				if (lo <= 0 && hi >= 0) {
+					may_true = 1;
+				}
+				if (lo == 0 && hi == 0) {
+					may_false = 0;
+				}
+			}
+			break;
+	}
+
+	return (may_true ? MAY_TRUE : 0) | (may_false ? MAY_FALSE : 0);
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
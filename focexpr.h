@@ -0,0 +1,171 @@
+/*
+    focexpr.h
+    ---------
+    Filter expressions for the FocFile C++ library. An expression is
+    built once, compiled against the segment layout, and then evaluated
+    directly on the record bytes in the page buffers.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCEXPR_H
+#define FOCEXPR_H
+
+#ifndef FOCFILE_H
+#include "focfile.h"
+#endif /* FOCFILE_H */
+
+// Comparison operators, as in a FOCUS WHERE or IF test
+enum FOCEXPR_OP { FOCEXPR_EQ, FOCEXPR_NE, FOCEXPR_LT, FOCEXPR_LE,
+		FOCEXPR_GT, FOCEXPR_GE };
+
+struct FOCEXPR_NODE;
+struct FOCEXPR_INSTR;
+
+// Supplies the lowest and highest value of a field over some set of
+// records, in the field's own format; returns 0 if it doesn't know them.
+typedef int (*FOCEXPR_BOUNDS)(int seg, int offset, char type, int length,
+		UCHAR** low, UCHAR** high, void* arg);
+
+// A FOCEXPR is a WHERE clause. You push tests and combine them in
+// postfix order, the way an RPN calculator works. This is
+//	COUNTRY EQ 'ENGLAND' AND (SEATS GE 4 OR DEALER_COST FROM 1000 TO 5000)
+//
+//	FOCEXPR where;
+//	where.compare(FOCFLD_CAR_COUNTRY, FOCEXPR_EQ, "ENGLAND");
+//	where.compare(FOCFLD_CAR_SEATS, FOCEXPR_GE, 4L);
+//	where.range(FOCFLD_CAR_DEALER_COST, 1000.0, 5000.0);
+//	where.op_or();
+//	where.op_and();
+//
+// The fields may lie in the segment being scanned or in any of its
+// ancestors. Constants are converted to the field's on-disk format when
+// they are pushed, and compile() turns the whole thing into a short
+// program with the AND/OR short-circuits as jumps, so evaluating it
+// never copies a field out of the page buffer.
+class FOCEXPR {
+
+public:
+	FOCEXPR();
+	~FOCEXPR();
+
+	// Tests
+	void	compare(int seg, int offset, char type, int length,
+			FOCEXPR_OP op, const char* value);
+	void	compare(int seg, int offset, char type, int length,
+			FOCEXPR_OP op, long value);
+	void	compare(int seg, int offset, char type, int length,
+			FOCEXPR_OP op, double value);
+	void	compare(int seg, int offset, char type, int length,
+			FOCEXPR_OP op, const SMDATE& value);
+
+	// FROM low TO high, inclusive
+	void	range(int seg, int offset, char type, int length,
+			const char* low, const char* high);
+	void	range(int seg, int offset, char type, int length,
+			long low, long high);
+	void	range(int seg, int offset, char type, int length,
+			double low, double high);
+	void	range(int seg, int offset, char type, int length,
+			const SMDATE& low, const SMDATE& high);
+
+	// IN (value, value, ...)
+	void	in_list(int seg, int offset, char type, int length,
+			int count, const char** values);
+	void	in_list(int seg, int offset, char type, int length,
+			int count, long* values);
+	void	in_list(int seg, int offset, char type, int length,
+			int count, double* values);
+
+	// Combine the last two results, or negate the last one
+	void	op_and(void);
+	void	op_or(void);
+	void	op_not(void);
+
+	// Check the expression against the FOCUS file and build the
+	// program. eval() compiles automatically the first time.
+	void	compile(FOCFILE* foc);
+
+	// Evaluate against the current records. Returns 1 or 0. A segment
+	// whose cursor isn't on a record makes the expression false.
+	int	eval(FOCFILE* foc);
+
+	// Evaluate against one record's data area. Only for expressions
+	// whose fields all lie in one segment.
+	int	eval_record(UCHAR* data);
+
+	// For scanning one segment. bind() fetches the current records of
+	// the ancestors once, and returns 0 if one isn't on a record. Then
+	// eval_bound() evaluates each record of seg in turn.
+	int	bind(FOCFILE* foc, int seg);
+	int	eval_bound(UCHAR* data);
+
+	// For skipping a whole set of records, such as a page, by the
+	// bounds of their fields. Returns 0 only if no record within the
+	// bounds can pass; fields without bounds may hold anything.
+	int	may_pass(FOCEXPR_BOUNDS bounds, void* arg);
+
+	// The segment of the fields, or 0 if they lie in several.
+	int	segment(void);
+
+	int	number_of_segments(void) { return Num_slots; };
+
+	// Does the expression test a field in seg?
+	int	reads_segment(int seg);
+
+private:
+	void	Add_test(int seg, int offset, char type, int length,
+			int op, int count);
+	void	Add_constant(char type, int length, UCHAR* bytes);
+	void	Add_alpha(int length, const char* value);
+	void	Add_long(char type, long value);
+	void	Add_double(char type, double value);
+	void	Add_node(int kind);
+	int	Emit(int node, int code_size);
+	int	Run(UCHAR** data);
+	int	Bounds_test(int node, FOCEXPR_BOUNDS bounds, void* arg);
+
+private:
+	// The expression as pushed
+	FOCEXPR_NODE	*Node;
+	int		Num_nodes;
+	int		Allocated_nodes;
+	int		Depth;		// results on the stack
+
+	UCHAR		*Constants;
+	int		Constants_length;
+	int		Allocated_constants;
+
+	// The compiled program
+	FOCEXPR_INSTR	*Code;
+	int		Code_length;
+	int		Compiled;
+
+	// Segments the program reads from. Slot i holds segment Slot[i].
+	int		*Slot;
+	int		Num_slots;
+	UCHAR		**Slot_data;
+	int		Bound_slot;	// slot of the bound segment, or -1
+};
+
+#endif /* FOCEXPR_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
@@ -34,7 +34,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
 #include "focfile.h"
+#include "focexpr.h"
+#include "focread.h"
 
 // Flags
 // ---------------------------------
@@ -42,31 +46,24 @@
 #define HAS_STRDUP
 //#define IBM_MAINFRAME
 #define FAST_CMP
+#define HAS_FADVISE		// posix_fadvise() for readahead
+#define READAHEAD_PAGES	8	// default readahead on segment chains
+//#define LATENCY_HISTOGRAMS
+//#define TRACE_HOOKS
 // ---------------------------------
 
 #define DEBUG_PROGRAM_NAME	"FocFile"
 #include "debug.h"
 
+#ifdef HAS_FADVISE
+#include <fcntl.h>
+#endif /* HAS_FADVISE */
+
 // Offsets and other constants
 // 4000	= 0xfa0
 #define CTRLOFF		4000 - 28	/* 0xf84 */
 #define FDTOFF		4000 - 30	/* 0xf86 */
 
-// FOCUS Pointer types
-#define PTR_KU		1		/* Keyed Unique */
-#define PTR_KM		2		/* Keyed Multiple */
-#define	PTR_CHILD	3		/* Descendant or Child instance */
-#define PTR_NEXT	4		/* Next instance of same segment */
-#define PTR_PARENT	5		/* Parent */
-#define PTR_PRIOR	6		/* (Unused at this time: 6/20/87) */
-#define PTR_EOFILE	7		/* End of File */
-#define PTR_DELETED	8		/* Deleted data */
-#define PTR_IGNORED	9		/* ??? */
-#define PTR_DKU		10		/* Dynamic keyed unique */
-#define PTR_DKM		11		/* Dynamic keyed multiple */
-#define PTR_EOCHAIN	0x010000000	/* End of chain */
-#define PTR_NORECORD	(short)0xdddd	/* No child exists ???*/ /* -8739 */
-
 #ifdef IBM_MAINFRAME
  #define INDEXTYPE_HASH			0
  #define INDEXTYPE_BTREE		128
@@ -75,16 +72,12 @@
  #define INDEXTYPE_HASH			-1	/* n/a */
 #endif /* IBM_MAINFRAME */
 
-#define FIELDTYPE_ALPHA		'A'
-#define FIELDTYPE_INTEGER	'I'
-#define FIELDTYPE_DOUBLE	'D'
-#define FIELDTYPE_FLOAT		'F'
-#define FIELDTYPE_SMDATE	'S'
-
 static inline int mkshort(UCHAR* ptr);
-static void* xmalloc(char *label, int bytes);
+static void stats_add(FOCSTATS *total, FOCSTATS *s);
 
-static int intcmp(long *a, long *b);
+static void int32_bounds(UCHAR *b, int count, int stride, int32_t key,
+		int *less, int *less_or_equal);
+static int int32_find_first(UCHAR *b, int count, int stride, int32_t key);
 static int doublecmp(double *a, double *b);
 static int floatcmp(float *a, float *b);
 
@@ -92,6 +85,38 @@ static int floatcmp(float *a, float *b);
 static char* strdup(const char *s);
 #endif /* ! HAS_STRDUP */
 
+// Timing of operations, for the latency histograms and the trace hook.
+// Without either, OP_BEGIN and OP_END disappear.
+#if defined(LATENCY_HISTOGRAMS) || defined(TRACE_HOOKS)
+ #define OP_TIMING
+ #define OP_BEGIN(op, owner, id, page) \
+	long op_start = op_begin(op, owner, id, page)
+ #define OP_END(op, owner, id, page, result) \
+	op_end(op, owner, id, page, result, op_start)
+static long op_begin(FOCOP op, char owner, int id, int page);
+static void op_end(FOCOP op, char owner, int id, int page, int result,
+		long start);
+#else /* not OP_TIMING */
+ #define OP_BEGIN(op, owner, id, page)
+ #define OP_END(op, owner, id, page, result)
+#endif /* OP_TIMING */
+
+#ifdef LATENCY_HISTOGRAMS
+static FOCHIST Latency[FOCOP_COUNT];
+static int hist_bucket(long ns);
+static long hist_bucket_top(int bucket);
+#endif /* LATENCY_HISTOGRAMS */
+
+#ifdef TRACE_HOOKS
+static FOCTRACE_HOOK Trace_hook = NULL;
+static void *Trace_arg = NULL;
+#endif /* TRACE_HOOKS */
+
+// Where FOCPAGE writes the page trace, if anywhere
+static FILE *Page_trace = NULL;
+static void page_trace_record(FILE *fh, int page, char owner, int owner_id,
+		int level, int flags);
+
 #ifdef DEBUG
 static int total_memory_allocated = 0;
 void debug_cursor_pos(char *s, CURSOR_POS position_type);
@@ -107,6 +132,9 @@ void debug_cursor_pos(char *s, CURSOR_POS position_type);
 // =============================================================
 FOCFILE::FOCFILE(char *mfd_string, FILE *fh) {
 
+	foc_fh = fh;
+	memset(&Stats, 0, sizeof(FOCSTATS));
+	memset(&Pool, 0, sizeof(FOCPOOL));
 	Parse_fdt(fh);
 	Parse_mfd(mfd_string);
 
@@ -116,6 +144,9 @@ FOCFILE::FOCFILE(char *mfd_string, FILE *fh) {
 };
 
 FOCFILE::FOCFILE(FILE *fh) {
+	foc_fh = fh;
+	memset(&Stats, 0, sizeof(FOCSTATS));
+	memset(&Pool, 0, sizeof(FOCPOOL));
 	Parse_fdt(fh);
 };
 
@@ -136,6 +167,8 @@ FOCFILE::~FOCFILE() {
 
 	// The joins
 	free(Join_list);
+
+	preload_release();
 };
 
 void FOCFILE::Parse_fdt(FILE *fh) {
@@ -144,7 +177,7 @@ void FOCFILE::Parse_fdt(FILE *fh) {
 	UCHAR	*buffer;
 	int	entries_in_fdt;
 
-	first_page = new FOCPAGE(fh);
+	first_page = new FOCPAGE(fh, &Stats, FOCPAGE_FDT, 0);
 
 	// How many segments does FOC contain?
 	if (!(buffer = first_page->Return_byte_offset(1, 0))) {
@@ -172,6 +205,14 @@ void FOCFILE::Parse_fdt(FILE *fh) {
 	Parse_fdt_seg(fh, buffer);
 	Parse_fdt_idx(fh, buffer);
 	delete first_page;
+
+	// Everyone reads through the preloaded pages, if there are any
+	for (int i = 1; i <= Num_segments; i++) {
+		Segment[i]->set_pool(&Pool);
+	}
+	for (int i = 1; i <= Num_indices; i++) {
+		Index[i]->set_pool(&Pool);
+	}
 }
 
 /*
@@ -391,6 +432,32 @@ int FOCFILE::read_bytes(UCHAR* u, int seg, int offset, char type, int length) {
 	return Segment[seg]->read_bytes(u, offset, length);
 }
 
+// Pointer to the data area of the current record, or NULL
+UCHAR* FOCFILE::record_data(int seg) {
+
+	return Segment[seg]->record_data();
+}
+
+// Where the current record of a segment is. Returns 0 if the cursor
+// isn't on a record.
+int FOCFILE::position(int seg, FOCPTR& where) {
+
+	return Segment[seg]->position(where);
+}
+
+// Move a segment's cursor to a record that position() gave, the way
+// match_index() does. The children start at the beginning of its
+// chains; the ancestors don't move.
+void FOCFILE::set_position(int seg, FOCPTR& where) {
+
+	if (seg <= 0 || seg > Num_segments) {
+		die("set_position called for non-existant segment %i\n", seg);
+	}
+
+	Segment[seg]->cursor_set(where, record);
+	Segment[seg]->set_children_cursor_pos(beginning);
+}
+
 
 // These next 5 functions read a field from the current record
 // Character fields
@@ -403,17 +470,32 @@ int FOCFILE::hold(char* s, int seg, int offset, char type, int length) {
 	return Segment[seg]->read_bytes((UCHAR*)s, offset, length);
 }
 
-// Integer fields
+// Integer fields. FOCUS integers are always 4 bytes, no matter how
+// big a long is on this machine, so we read an int32_t and widen it.
 int FOCFILE::hold(long& l, int seg, int offset, char type, int length) {
 
-	long value;
+	int32_t value;
+
+	if (hold(value, seg, offset, type, length)) {
+		l = value;
+		return 1;
+	}
+	else {
+		return 0;
+	}
+
+}
+
+int FOCFILE::hold(int32_t& i, int seg, int offset, char type, int length) {
+
+	int32_t value;
 
 	if (type != FIELDTYPE_INTEGER) {
 		die("hold type not Integer: %c\n", type);
 	}
 
-	if(Segment[seg]->read_bytes((UCHAR*)&value, offset, sizeof(long))) {
-		l = value;
+	if(Segment[seg]->read_bytes((UCHAR*)&value, offset, sizeof(int32_t))) {
+		i = value;
 		return 1;
 	}
 	else {
@@ -463,13 +545,13 @@ int FOCFILE::hold(float& f, int seg, int offset, char type, int length) {
 // SMDATE fields
 int FOCFILE::hold(SMDATE &smd, int seg, int offset, char type, int length) {
 
-	long value;
+	int32_t value;
 
 	if (type != FIELDTYPE_SMDATE) {
 		die("hold type not SMDATE: %c\n", type);
 	}
 
-	if(Segment[seg]->read_bytes((UCHAR*)&value, offset, sizeof(long))) {
+	if(Segment[seg]->read_bytes((UCHAR*)&value, offset, sizeof(int32_t))) {
 		smd.set_julian(value, SMDATE_FOCUS);
 		return 1;
 	}
@@ -556,6 +638,22 @@ int FOCFILE::next(int seg, int offset, char type, int length) {
 	}
 }
 
+// Moves the cursor forward over as many records as lie on the current
+// page, up to max, and stores a pointer to the data area of each in
+// data[]. The pointers stay good until the segment is moved again.
+// The cursor is left on the last record of the batch.
+//
+// Returns the number of records, 0 at the end of the chain
+int FOCFILE::next_batch(int seg, UCHAR** data, int max) {
+
+	if (seg > 0 && seg <= Num_segments) {
+		return Segment[seg]->next_batch(data, max);
+	}
+	else {
+		die("next_batch called for non-existant segment %i\n", seg);
+	}
+}
+
 // Does a next(), and then next()'s any unique children automatically.
 // This makes it appear as if the unique children segments are merely
 // extensions of the parent segment.
@@ -590,6 +688,10 @@ int FOCFILE::find(int idx, char type, int seg, char* key) {
 	return find(idx, type, seg, (void*) key);
 }
 int FOCFILE::find(int idx, char type, int seg, long& key) {
+	int32_t value = (int32_t) key;
+	return find(idx, type, seg, (void*) &value);
+}
+int FOCFILE::find(int idx, char type, int seg, int32_t& key) {
 	return find(idx, type, seg, (void*) &key);
 }
 int FOCFILE::find(int idx, char type, int seg, double& key) {
@@ -599,20 +701,26 @@ int FOCFILE::find(int idx, char type, int seg, float& key) {
 	return find(idx, type, seg, (void*) &key);
 }
 int FOCFILE::find(int idx, char type, int seg, SMDATE& key) {
-	long date = key.julian();
+	int32_t date = (int32_t) key.julian();
 	return find(idx, type, seg, (void*) &date);
 }
 
 int FOCFILE::find(int idx, char type, int seg, void* key) {
 
 	FOCPTR junk;
+	int found;
+
+	OP_BEGIN(FOCOP_FIND, FOCPAGE_INDEX, idx, 0);
 
 	// Make sure the index is initialized
 	if ( ! index_in_use(idx)) {
 		initialize_index(idx, type, seg);
 	}
 
-	return Index[idx]->find(key, &junk);
+	found = Index[idx]->find(key, &junk);
+
+	OP_END(FOCOP_FIND, FOCPAGE_INDEX, idx, found ? junk.page : 0, found);
+	return found;
 }
 
 // Same as find(), but moves the cursor (pointer to current record)
@@ -630,17 +738,216 @@ int FOCFILE::match_index(int idx, char type, int seg, void* key) {
 
 	FOCPTR position;
 
+	OP_BEGIN(FOCOP_MATCH_INDEX, FOCPAGE_INDEX, idx, 0);
+
 	if (Index[idx]->find(key, &position)) {
 		debug("FILE::match_index moving seg %d to page %d word %d\n",
 			seg, position.page, position.word);
 		//Segment[seg]->cursor_set(position, beginning);
 		Segment[seg]->cursor_set(position, record);
 		Segment[seg]->set_children_cursor_pos(beginning);
+		OP_END(FOCOP_MATCH_INDEX, FOCPAGE_INDEX, idx, position.page, 1);
 		return 1;
 	}
 	else {
+		OP_END(FOCOP_MATCH_INDEX, FOCPAGE_INDEX, idx, 0, 0);
+		return 0;
+	}
+}
+
+// Like match_index(), but walks every record with the key rather than
+// finding one of them. Each call after the first goes on from the last
+// record found, if the cursor is still on it; otherwise it starts over.
+//
+// returns 1 if it moved the cursor, 0 after the last record
+int FOCFILE::match_postings(int idx, char type, int seg, char* key) {
+	return match_postings(idx, type, seg, (void*) key);
+}
+int FOCFILE::match_postings(int idx, char type, int seg, long& key) {
+	int32_t value = (int32_t) key;
+	return match_postings(idx, type, seg, (void*) &value);
+}
+int FOCFILE::match_postings(int idx, char type, int seg, int32_t& key) {
+	return match_postings(idx, type, seg, (void*) &key);
+}
+int FOCFILE::match_postings(int idx, char type, int seg, double& key) {
+	return match_postings(idx, type, seg, (void*) &key);
+}
+int FOCFILE::match_postings(int idx, char type, int seg, float& key) {
+	return match_postings(idx, type, seg, (void*) &key);
+}
+int FOCFILE::match_postings(int idx, char type, int seg, SMDATE& key) {
+	int32_t date = (int32_t) key.julian();
+	return match_postings(idx, type, seg, (void*) &date);
+}
+
+// Walks the records whose key starts with prefix, as match_postings()
+// walks those with a key. The walk starts at the first key not less than
+// the prefix and stops at the first that doesn't start with it, so it
+// reads only the index pages the prefix is on.
+//
+// returns 1 if it moved the cursor, 0 after the last record
+int FOCFILE::match_prefix(int idx, char type, int seg, char* prefix) {
+
+	if (type != FIELDTYPE_ALPHA) {
+		die("match_prefix called for index %d, of type %c, not %c\n",
+			idx, type, FIELDTYPE_ALPHA);
+	}
+
+	if ( ! index_in_use(idx)) {
+		initialize_index(idx, type, seg);
+	}
+
+	// A prefix longer than the key can't match it; an empty one
+	// matches every key.
+	int length = strlen(prefix);
+	if (length > Index[idx]->key_size()) {
+		return 0;
+	}
+
+	return match_postings(idx, type, seg, (void*) prefix, length);
+}
+
+int FOCFILE::match_postings(int idx, char type, int seg, void* key,
+		int length) {
+
+	FOCPTR	position, where;
+	int	found;
+
+	OP_BEGIN(FOCOP_MATCH_INDEX, FOCPAGE_INDEX, idx, 0);
+
+	if ( ! index_in_use(idx)) {
+		initialize_index(idx, type, seg);
+	}
+
+	if (Segment[seg]->position(where) &&
+			Index[idx]->walking(key, where, length)) {
+		found = Index[idx]->next(&position);
+	}
+	else {
+		found = Index[idx]->first(key, &position, length);
+	}
+
+	if (found) {
+		debug("FILE::match_postings moving seg %d to page %d word %d\n",
+			seg, position.page, position.word);
+		Segment[seg]->cursor_set(position, record);
+		Segment[seg]->set_children_cursor_pos(beginning);
+	}
+
+	OP_END(FOCOP_MATCH_INDEX, FOCPAGE_INDEX, idx,
+		found ? position.page : 0, found);
+	return found;
+}
+
+// The records match_postings() would move to, without moving there
+int FOCFILE::index_first(int idx, char type, int seg, void* key,
+		FOCPTR& where) {
+
+	if ( ! index_in_use(idx)) {
+		initialize_index(idx, type, seg);
+	}
+
+	return Index[idx]->first(key, &where);
+}
+
+int FOCFILE::index_next(int idx, FOCPTR& where) {
+
+	return Index[idx]->next(&where);
+}
+
+// Index-only walks, for FOCKEYS: index_seek() goes to the first key not
+// less than key, or the first of all for NULL, and each index_next_key()
+// copies a key from there on and counts the records that have it. They
+// read index pages only, and move no cursor.
+int FOCFILE::index_seek(int idx, char type, int seg, void* key) {
+
+	if ( ! index_in_use(idx)) {
+		initialize_index(idx, type, seg);
+	}
+
+	return Index[idx]->seek(key);
+}
+
+int FOCFILE::index_next_key(int idx, UCHAR* key, long& records) {
+
+	return Index[idx]->next_key(key, &records);
+}
+
+int FOCFILE::index_key_size(int idx, char type, int seg) {
+
+	if ( ! index_in_use(idx)) {
+		initialize_index(idx, type, seg);
+	}
+
+	return Index[idx]->key_size();
+}
+
+// Whole-index walks, for FOCTOPN: index_ends() goes to the first record
+// of all, or the last if backward, and each index_step() copies a
+// record's key and says where its data is, moving on towards the other
+// end. They share the walk with index_seek() and match_postings().
+int FOCFILE::index_ends(int idx, char type, int seg, int backward) {
+
+	if ( ! index_in_use(idx)) {
+		initialize_index(idx, type, seg);
+	}
+
+	return Index[idx]->ends(backward);
+}
+
+int FOCFILE::index_step(int idx, UCHAR* key, FOCPTR& where) {
+
+	return Index[idx]->step(key, &where);
+}
+
+// An index (or set_position()) moves only the segment it was asked
+// about. This follows each record's parent pointer up to the root, one
+// page read a level at most, then sets the cursors from the top down,
+// as next() would have left them: each ancestor on its record, and the
+// other children of each at the beginning of their chains. next(seg)
+// then goes on along the chain it is in.
+//
+// Returns 1, or 0 if seg's cursor isn't on a record
+int FOCFILE::position_ancestors(int seg) {
+
+	FOCPTR	*path;
+	int	*segs, levels, s, i;
+
+	if (seg <= 0 || seg > Num_segments) {
+		die("position_ancestors called for non-existant segment %i\n",
+			seg);
+	}
+
+	path = new FOCPTR[Num_segments + 1];
+	segs = new int[Num_segments + 1];
+
+	if (!Segment[seg]->position(path[0])) {
+		delete [] path;
+		delete [] segs;
 		return 0;
 	}
+
+	segs[0] = seg;
+	levels = 1;
+	for (s = seg; Segment[s]->Get_parent() > 0;
+			s = Segment[s]->Get_parent()) {
+		if (!Segment[s]->parent_of(path[levels - 1], path[levels])) {
+			die("position_ancestors: record at page %d word %d of "
+				"segment %d has no parent pointer\n",
+				path[levels - 1].page, path[levels - 1].word, s);
+		}
+		segs[levels++] = Segment[s]->Get_parent();
+	}
+
+	for (i = levels - 1; i >= 0; i--) {
+		Segment[segs[i]]->cursor_set(path[i], record);
+		Segment[segs[i]]->set_children_cursor_pos(beginning);
+	}
+
+	delete [] path;
+	delete [] segs;
+	return 1;
 }
 
 // Looks for the next record that matches a field. Does not use the index,
@@ -656,6 +963,10 @@ int FOCFILE::match(int seg, int offset, char type, int length, char* key) {
 	return match(seg, offset, type, length, (void*) key);
 }
 int FOCFILE::match(int seg, int offset, char type, int length, long& key) {
+	int32_t value = (int32_t) key;
+	return match(seg, offset, type, length, (void*) &value);
+}
+int FOCFILE::match(int seg, int offset, char type, int length, int32_t& key) {
 	return match(seg, offset, type, length, (void*) &key);
 }
 int FOCFILE::match(int seg, int offset, char type, int length, double& key) {
@@ -665,41 +976,53 @@ int FOCFILE::match(int seg, int offset, char type, int length, float& key) {
 	return match(seg, offset, type, length, (void*) &key);
 }
 int FOCFILE::match(int seg, int offset, char type, int length, SMDATE& key) {
-	long date = key.julian();
+	int32_t date = (int32_t) key.julian();
 	return match(seg, offset, type, length, (void*) &date);
 }
 
 
+// The field is compared where it lies in the page buffer; nothing
+// is copied out of the record.
 int FOCFILE::match(int seg, int offset, char type, int length, void* key) {
 
-	int	ret_val;
 	int	found = 0;
-	UCHAR	*field_value;
+	UCHAR	*record;
+
+	// Integers and smartdates are compared as 4-byte integers.
+	if (type == FIELDTYPE_INTEGER || type == FIELDTYPE_SMDATE) {
 
-	debug("FILE::match allocating \n");
+		int32_t	value = mkint32((UCHAR*) key);
+
+		while (!found && next(seg, offset, type, length)) {
+			debug("FILE::match looping\n");
+			record = Segment[seg]->record_data();
+			if (record && mkint32(record + offset) == value) {
+				found = 1;
+			}
+		}
 
-	// Allocate memory to retrieve the value of the comparison-field.
-	field_value = (UCHAR*) xmalloc("match", sizeof(UCHAR) * length);
+		debug("FILE::match out of loop with find = %d\n", found);
+		return found;
+	}
 
 	// Loop until we either find a matching record, or run out of data
 	while (!found) {	
 		debug("FILE::match looping\n");
 		// Advance the record position.
-		if (!(ret_val = next(seg, offset, type, length))) {
+		if (!next(seg, offset, type, length)) {
 			debug("FILE::match no next inside loop\n");
 			break;
 		}
 
-		read_bytes(field_value, seg, offset, type, length);
+		record = Segment[seg]->record_data();
 
-		if (memcmp(key, (void*) field_value, length) == 0) {
+		if (record && memcmp(key, record + offset, length) == 0) {
 			found = 1;
 		}
 
 	}
 
 	debug("FILE::match out of loop with find = %d\n", found);
-	free(field_value);
 	return found;
 }
 
@@ -717,6 +1040,23 @@ int FOCFILE::match_with_uniques(int seg, int offset, char type, int length,
 }
 
 
+// Looks for the next record for which the filter expression is true.
+// Like match(), it starts from the current record. The expression may
+// test fields in seg and in any of its ancestors.
+int FOCFILE::match(int seg, FOCEXPR& where) {
+
+	where.compile(this);
+
+	while (next(seg)) {
+		if (where.eval(this)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
 // Build a JOIN between parent (p_*) and child (c_*)
 // Returns an integer which is a unique JOIN ID. That ID can be used
 // later to clear the JOIN.
@@ -809,6 +1149,169 @@ int FOCFILE::reccount(int seg, int offset, char type, int length,
 	return reccount(seg, filter);
 }
 
+// Count the records in a segment for which the expression is true
+int FOCFILE::reccount(int seg, FOCEXPR& where) {
+
+	where.compile(this);
+
+	if (seg == 0 ) {
+		return Root_segment->reccount(where, this);
+	}
+	else if (seg > 0 && seg <= Num_segments) {
+		return Segment[seg]->reccount(where, this);
+	}
+	else {
+		die("reccount called for non-existant segment %i\n", seg);
+	}
+}
+
+int FOCFILE::reccount(int seg, int offset, char type, int length,
+			FOCEXPR& where) {
+
+	return reccount(seg, where);
+}
+
+// Estimate the instances of a segment from how full its pages are.
+// FOCUS adds instances at the end of a segment's last page and starts a
+// new page when that one is full, so every page but the last holds
+// about as many as fit. The last page is counted exactly and says how
+// many fit; with a sample, the pages picked say how many the others
+// hold instead. Deleted instances still take up their words, and are
+// counted.
+long FOCFILE::reccount_estimate(int seg, long& error, int sample,
+		unsigned long seed) {
+
+	FOCSEG		*s;
+	FOCPAGE		*p;
+	int		length, others, span, page, i, j, k, n;
+	int		used, last_word, next_page;
+	int		*order;
+	long		last, estimate;
+	double		sum, sum2, mean, var;
+	uint64_t	state;
+
+	if (seg <= 0 || seg > Num_segments) {
+		die("reccount_estimate called for non-existant segment %i\n",
+			seg);
+	}
+	if (sample < 0) {
+		die("reccount_estimate called with a sample of %i pages\n",
+			sample);
+	}
+
+	s	= Segment[seg];
+	length	= s->Get_length();
+	others	= s->Get_pages() - 1;
+	error	= 0;
+
+	if (others < 0 || length <= 0) {
+		return 0;
+	}
+
+	// A page of our own, so the segment's cursor keeps its page
+	p = new FOCPAGE(foc_fh, s->Get_stats(), FOCPAGE_SEGMENT, seg);
+	p->Set_pool(&Pool);
+
+	p->Get_fill(s->Get_last_page(), &used, &last_word, &next_page);
+	last = used / length;
+
+	// The pages a sample is picked from, and about how many of them
+	// have to be read to find that many of the segment's
+	span = s->Get_last_page() - s->Get_first_page();
+
+	// One page says nothing about how much the others differ
+	if (sample == 1) {
+		sample = 2;
+	}
+
+	if (others == 0) {
+		estimate = last;
+	}
+	else if (sample == 0) {
+		// Each page before the last holds from 1 to a full page
+		n = last_word / length;
+		estimate = last + (long) others * n;
+		error = (long) others * (n - 1);
+	}
+	else if (sample >= others ||
+			(double) sample * span / others >= others) {
+		// Reading the whole chain is no more work
+		estimate = 0;
+		page = s->Get_first_page();
+		for (i = 0; page > 0 && i <= span; i++) {
+			p->Get_fill(page, &used, &last_word, &next_page);
+			estimate += used / length;
+			page = next_page;
+		}
+	}
+	else {
+		p->Set_readahead(0);
+
+		order = (int*) xmalloc("reccount_estimate", sizeof(int) * span);
+		for (i = 0; i < span; i++) {
+			order[i] = s->Get_first_page() + i;
+		}
+
+		// Pick pages without repeats until enough are the segment's
+		state = seed;
+		sum = sum2 = 0;
+		for (i = k = 0; i < span && k < sample; i++) {
+			j = i + sample_random(&state) % (span - i);
+			page = order[j];
+			order[j] = order[i];
+			order[i] = page;
+
+			if (p->Get_fill(page, &used, &last_word, &next_page)
+					!= seg) {
+				continue;
+			}
+			n = used / length;
+			sum += n;
+			sum2 += (double) n * n;
+			k++;
+		}
+		free(order);
+
+		if (k < sample) {
+			// Every page was read
+			estimate = last + (long) sum;
+		}
+		else {
+			mean = sum / k;
+			var = (sum2 - sum * mean) / (k - 1);
+			if (var < 0) {
+				var = 0;
+			}
+			estimate = last + (long) (others * mean + 0.5);
+			error = (long) ceil(1.96 * others *
+				sqrt(var / k * (1 - (double) k / others)));
+		}
+	}
+
+	delete p;
+	return estimate;
+}
+
+// Returns the number of key fields of an Sn or SHn segment, else 0
+int FOCFILE::key_fields(int seg) {
+
+	if (seg <= 0 || seg > Num_segments) {
+		die("key_fields called for non-existant segment %i\n", seg);
+	}
+
+	return Segment[seg]->Get_keys();
+}
+
+// Returns the parent segment number, or 0 for the root segment
+int FOCFILE::parent(int seg) {
+
+	if (seg <= 0 || seg > Num_segments) {
+		die("parent called for non-existant segment %i\n", seg);
+	}
+
+	return Segment[seg]->Get_parent();
+}
+
 void FOCFILE::segment_name(char* answer, int seg) {
 	if (seg == 0 ) {
 		strcpy(answer, Root_segment->Segment_name());
@@ -830,53 +1333,364 @@ void FOCFILE::index_name(char* answer, int idx) {
 	}
 }
 
+void FOCFILE::readahead(int pages) {
 
-// =============================================================
-// CLASS: FOCSEG
-// -------------------------------------------------------------
-// Class to handle FOCUS segments
-// =============================================================
-
-FOCSEG::FOCSEG(int seg_num, FILE* fh, UCHAR* fdt_entry) {
-
-	// Terminate the string in NUL. 
-	segment_name[8] = 0;
+	for (int i = 1; i <= Num_segments; i++) {
+		Segment[i]->set_readahead(pages);
+	}
+}
 
-	// Store my ID # in case I need it.
-	my_id = seg_num;
+UCHAR* FOCFILE::read_page(int seg, int page, FOCPAGE_STAMP& stamp) {
+	if (seg > 0 && seg <= Num_segments) {
+		return Segment[seg]->read_page(page, &stamp);
+	}
+	else {
+		die("read_page called for non-existant segment %i\n", seg);
+	}
+}
 
-	// Create my page-buffer object
-	Page = new FOCPAGE(fh);
+void FOCFILE::page_stamp(int page, FOCPAGE_STAMP& stamp) {
 
-	first_page	= mkshort(&fdt_entry[0]);
-	last_page 	= mkshort(&fdt_entry[2]);
+	FOCPAGE	*p = new FOCPAGE(foc_fh, &Stats, FOCPAGE_FDT, 0);
 
-	memcpy(segment_name, &fdt_entry[4], 8);
-	debug("SEG::Constructed %s\n", segment_name);
+	p->Set_pool(&Pool);
+	p->Get_stamp(page, &stamp);
+	delete p;
+}
 
-	segment_length	= mkshort(&fdt_entry[12]);
-	parent_number	= mkshort(&fdt_entry[14]);
-	number_of_pages	= mkshort(&fdt_entry[16]);
-	number_of_pointers = mkshort(&fdt_entry[18]);
+// From the root down to seg, then every record of each level in turn
+void FOCFILE::walk(int seg, FOCWALK_FUNC func, void* arg) {
 
-	// The number of children can be determined from
-	// the number of pointers and whether or not we
-	// have a parent.
-	number_of_children = number_of_pointers - 1;
+	int	*path, depth = 0, level, s;
 
-	if (parent_number > 0) {
-		number_of_children--;
+	if (seg <= 0 || seg > Num_segments) {
+		die("walk called for non-existant segment %i\n", seg);
 	}
-	//debug("SEG::SEG %s has %d children\n", segment_name,
-	//	number_of_children);
 
-	// Allocate space for the pointers to my children
-	if (number_of_children > 0) {
-		Child = (FOCSEG**) xmalloc("SEG Constructor",
-				number_of_children * sizeof(FOCSEG*));
+	for (s = seg; s > 0; s = parent(s)) {
+		depth++;
 	}
-	else {
-		Child = NULL;
+	path = (int*) xmalloc("walk path", sizeof(int) * depth);
+	level = depth;
+	for (s = seg; s > 0; s = parent(s)) {
+		path[--level] = s;
+	}
+
+	reposition(path[0]);
+	Walk_path(path, 0, depth, func, arg);
+	free(path);
+}
+
+void FOCFILE::Walk_path(int* path, int level, int depth, FOCWALK_FUNC func,
+		void* arg) {
+
+	while (next(path[level])) {
+		if (level == depth - 1) {
+			func(this, path[level], arg);
+		}
+		else {
+			Walk_path(path, level + 1, depth, func, arg);
+		}
+	}
+}
+
+int FOCFILE::pointers(int seg) {
+
+	if (seg <= 0 || seg > Num_segments) {
+		die("pointers called for non-existant segment %i\n", seg);
+	}
+
+	return Segment[seg]->Get_pointers();
+}
+
+int FOCFILE::page_range(int seg, int& first, int& last) {
+
+	if (seg <= 0 || seg > Num_segments) {
+		die("page_range called for non-existant segment %i\n", seg);
+	}
+
+	first	= Segment[seg]->Get_first_page();
+	last	= Segment[seg]->Get_last_page();
+	return Segment[seg]->Get_pages();
+}
+
+int FOCFILE::instance_length(int seg) {
+
+	if (seg <= 0 || seg > Num_segments) {
+		die("instance_length called for non-existant segment %i\n",
+			seg);
+	}
+
+	return Segment[seg]->Get_length();
+}
+
+int FOCFILE::page_used(int seg, int page) {
+
+	if (seg <= 0 || seg > Num_segments) {
+		die("page_used called for non-existant segment %i\n", seg);
+	}
+
+	return Segment[seg]->page_used(page);
+}
+
+int FOCFILE::preload(int seg) {
+	if (seg > 0 && seg <= Num_segments) {
+		return Preload_pages(Segment[seg]->Get_first_page(),
+				Segment[seg]->Get_last_page());
+	}
+	else {
+		die("preload called for non-existant segment %i\n", seg);
+	}
+}
+
+int FOCFILE::preload_index(int idx) {
+	if (idx > 0 && idx <= Num_indices) {
+		return Preload_pages(Index[idx]->Get_first_page(),
+				Index[idx]->Get_last_page());
+	}
+	else {
+		die("preload_index called for non-existant index %i\n", idx);
+	}
+}
+
+// The pages of a segment or index lie between its first and last page,
+// mixed in with those of others, so the whole range is read. Pages
+// already in the pool are not read again.
+int FOCFILE::Preload_pages(int first, int last) {
+
+	FOCREADER	reader(foc_fh);
+	UCHAR		*block;
+	int		page, count = 0;
+
+	if (first <= 0 || last < first) {
+		return 0;
+	}
+
+	// Grow the frame table to reach the last page
+	if (last >= Pool.pages) {
+		Pool.frame = (UCHAR**) realloc(Pool.frame,
+				sizeof(UCHAR*) * (last + 1));
+		if (!Pool.frame) {
+			die("Can't allocate the preload table for %d pages\n",
+				last + 1);
+		}
+		memset(&Pool.frame[Pool.pages], 0,
+			sizeof(UCHAR*) * (last + 1 - Pool.pages));
+		Pool.pages = last + 1;
+	}
+
+	for (page = first; page <= last; page++) {
+		if (!Pool.frame[page]) {
+			count++;
+		}
+	}
+	if (count == 0) {
+		return 0;
+	}
+
+	block = (UCHAR*) xmalloc("preload", count * 4000);
+	Pool.block = (UCHAR**) realloc(Pool.block,
+			sizeof(UCHAR*) * (Pool.blocks + 1));
+	if (!Pool.block) {
+		die("Can't allocate the preload block list\n");
+	}
+	Pool.block[Pool.blocks++] = block;
+
+	for (page = first; page <= last; page++) {
+		if (!Pool.frame[page]) {
+			Pool.frame[page] = block;
+			reader.add(page, block);
+			block += 4000;
+		}
+	}
+	reader.flush();
+
+	debug("FILE::Preload_pages %d pages, %ld calls, %s\n", count,
+		reader.read_calls(),
+		reader.uses_io_uring() ? "io_uring" : "pread");
+
+	Stats.pages_read += count;
+	Stats.pages_preloaded += count;
+	return count;
+}
+
+void FOCFILE::preload_release(void) {
+
+	for (int i = 0; i < Pool.blocks; i++) {
+		free(Pool.block[i]);
+	}
+	free(Pool.block);
+	free(Pool.frame);
+	memset(&Pool, 0, sizeof(FOCPOOL));
+}
+
+// The counters for the whole file: the FDT read, every segment, and
+// every index
+void FOCFILE::stats(FOCSTATS& total) {
+
+	int i;
+
+	total = Stats;
+	for (i = 1; i <= Num_segments; i++) {
+		stats_add(&total, Segment[i]->Get_stats());
+	}
+	for (i = 1; i <= Num_indices; i++) {
+		stats_add(&total, Index[i]->Get_stats());
+	}
+}
+
+void FOCFILE::segment_stats(int seg, FOCSTATS& s) {
+	if (seg > 0 && seg <= Num_segments) {
+		s = *Segment[seg]->Get_stats();
+	}
+	else {
+		die("segment_stats called for non-existant segment %i\n", seg);
+	}
+}
+
+void FOCFILE::index_stats(int idx, FOCSTATS& s) {
+	if (idx > 0 && idx <= Num_indices) {
+		s = *Index[idx]->Get_stats();
+	}
+	else {
+		die("index_stats called for non-existant index %i\n", idx);
+	}
+}
+
+void FOCFILE::stats_reset(void) {
+
+	int i;
+
+	memset(&Stats, 0, sizeof(FOCSTATS));
+	for (i = 1; i <= Num_segments; i++) {
+		memset(Segment[i]->Get_stats(), 0, sizeof(FOCSTATS));
+	}
+	for (i = 1; i <= Num_indices; i++) {
+		memset(Index[i]->Get_stats(), 0, sizeof(FOCSTATS));
+	}
+}
+
+// Copies out one latency histogram. Returns 0 if focfile.cpp was built
+// without LATENCY_HISTOGRAMS.
+int FOCFILE::latency(FOCOP op, FOCHIST& h) {
+#ifdef LATENCY_HISTOGRAMS
+	h = Latency[op];
+	return 1;
+#else /* not LATENCY_HISTOGRAMS */
+	memset(&h, 0, sizeof(FOCHIST));
+	return 0;
+#endif /* LATENCY_HISTOGRAMS */
+}
+
+// The value below which percent of the timings lie, in ns
+long FOCFILE::latency_percentile(FOCHIST& h, double percent) {
+#ifdef LATENCY_HISTOGRAMS
+	long	wanted, seen = 0;
+
+	if (h.count == 0) {
+		return 0;
+	}
+
+	wanted = (long) (h.count * percent / 100.0 + 0.5);
+	if (wanted < 1) {
+		wanted = 1;
+	}
+
+	for (int i = 0; i < FOCHIST_BUCKETS; i++) {
+		seen += h.bucket[i];
+		if (seen >= wanted) {
+			long top = hist_bucket_top(i);
+			return top < h.max_ns ? top : h.max_ns;
+		}
+	}
+	return h.max_ns;
+#else /* not LATENCY_HISTOGRAMS */
+	return 0;
+#endif /* LATENCY_HISTOGRAMS */
+}
+
+void FOCFILE::latency_reset(void) {
+#ifdef LATENCY_HISTOGRAMS
+	memset(Latency, 0, sizeof(Latency));
+#endif /* LATENCY_HISTOGRAMS */
+}
+
+// Start or stop the page trace. Each FOCPAGE writes a record when
+// asked for a page; see FOCPAGE_TRACE_RECORD.
+void FOCFILE::record_pages(FILE* trace) {
+
+	if (Page_trace) {
+		fflush(Page_trace);
+	}
+
+	Page_trace = trace;
+
+	if (Page_trace) {
+		if (fwrite(FOCPAGE_TRACE_MAGIC, 1, 8, Page_trace) != 8) {
+			die("Can't write the page trace\n");
+		}
+	}
+}
+
+// Returns 0 if focfile.cpp was built without TRACE_HOOKS
+int FOCFILE::trace(FOCTRACE_HOOK hook, void* arg) {
+#ifdef TRACE_HOOKS
+	Trace_hook = hook;
+	Trace_arg = arg;
+	return 1;
+#else /* not TRACE_HOOKS */
+	return 0;
+#endif /* TRACE_HOOKS */
+}
+
+
+// =============================================================
+// CLASS: FOCSEG
+// -------------------------------------------------------------
+// Class to handle FOCUS segments
+// =============================================================
+
+FOCSEG::FOCSEG(int seg_num, FILE* fh, UCHAR* fdt_entry) {
+
+	// Terminate the string in NUL. 
+	segment_name[8] = 0;
+
+	// Store my ID # in case I need it.
+	my_id = seg_num;
+
+	// Create my page-buffer object
+	memset(&Stats, 0, sizeof(FOCSTATS));
+	Page = new FOCPAGE(fh, &Stats, FOCPAGE_SEGMENT, seg_num);
+
+	first_page	= mkshort(&fdt_entry[0]);
+	last_page 	= mkshort(&fdt_entry[2]);
+
+	memcpy(segment_name, &fdt_entry[4], 8);
+	debug("SEG::Constructed %s\n", segment_name);
+
+	segment_length	= mkshort(&fdt_entry[12]);
+	parent_number	= mkshort(&fdt_entry[14]);
+	number_of_pages	= mkshort(&fdt_entry[16]);
+	number_of_pointers = mkshort(&fdt_entry[18]);
+
+	// The number of children can be determined from
+	// the number of pointers and whether or not we
+	// have a parent.
+	number_of_children = number_of_pointers - 1;
+
+	if (parent_number > 0) {
+		number_of_children--;
+	}
+	//debug("SEG::SEG %s has %d children\n", segment_name,
+	//	number_of_children);
+
+	// Allocate space for the pointers to my children
+	if (number_of_children > 0) {
+		Child = (FOCSEG**) xmalloc("SEG Constructor",
+				number_of_children * sizeof(FOCSEG*));
+	}
+	else {
+		Child = NULL;
 	}
 
 	// Initialize the child pointers to NULL. ***IMPORTANT***
@@ -895,6 +1709,7 @@ FOCSEG::FOCSEG(int seg_num, FILE* fh, UCHAR* fdt_entry) {
 	chain_beginning = new FOCPTR();
 	cursor_pos	= inaccessible;
 	segtype		= unknown;
+	number_of_keys	= 0;
 };
 
 FOCSEG::~FOCSEG() {
@@ -956,7 +1771,11 @@ void FOCSEG::set_segtype(char *segment_type) {
 					debug("FOCSEG::set_segtype to Sn\n");
 					break;
 			}
-			/* get number of key fields here */
+			// Number of key fields: S1, SH2, ...
+			if (segtype != S0) {
+				number_of_keys = atoi(&segment_type[
+						segtype == SHn ? 2 : 1]);
+			}
 			break;
 
 		case 'b':
@@ -1179,11 +1998,15 @@ int FOCSEG::next(void) {
 			" has not been accessed yet.\n", segment_name);
 	}
 
+	OP_BEGIN(FOCOP_NEXT, FOCPAGE_SEGMENT, my_id, cursor->page);
+
 	// Do an alternate next() if we are the child segment in a join
 	if (Parent_join) {
 		debug("SEG::next Running SEG::Parent_join\n");
 		debug("SEG::next leaving with seg = %d\n", my_id);
-		return Parent_join->next();
+		int found = Parent_join->next();
+		OP_END(FOCOP_NEXT, FOCPAGE_SEGMENT, my_id, cursor->page, found);
+		return found;
 	}
 
 	// Maybe we're at the beginning
@@ -1207,6 +2030,7 @@ int FOCSEG::next(void) {
 		debug("SEG::next I'm already at the end\n");
 		set_children_cursor_pos(end);
 		debug("SEG::next leaving with seg = %d\n", my_id);
+		OP_END(FOCOP_NEXT, FOCPAGE_SEGMENT, my_id, 0, 0);
 		return 0;
 	}
 	else {
@@ -1228,10 +2052,70 @@ int FOCSEG::next(void) {
 		}
 	}
 	debug("SEG::next leaving with seg = %d\n", my_id);
+	OP_END(FOCOP_NEXT, FOCPAGE_SEGMENT, my_id, cursor->page, 1);
 	return 1;
 }
 
 
+// Like next(), but keeps going while the next instance is on the page
+// already in the buffer. The children are positioned only once, for the
+// last record, and unique children aren't touched. Joined segments go
+// through next() one record at a time.
+int FOCSEG::next_batch(UCHAR **data, int max) {
+
+	FOCPTR	next_record;
+	int	n = 0;
+
+	if (Parent_join || Join_list || max <= 1) {
+		if (max > 0 && next()) {
+			data[0] = record_data();
+			return 1;
+		}
+		return 0;
+	}
+
+	if (cursor_pos == inaccessible) {
+		die("SEG::next_batch(%s) is not accessible yet. The parent "
+			"segment has not been accessed yet.\n", segment_name);
+	}
+
+	if (cursor_pos == beginning) {
+		cursor_set_pos(record);
+	}
+	else if (cursor_pos == record) {
+		Page->Parse_pointer_at_word(cursor->page,
+			cursor->word + number_of_children, &next_record);
+		cursor_set(next_record, record);
+	}
+
+	while (cursor_pos == record) {
+		data[n++] = Page->Return_word_offset(cursor->page,
+				cursor->word + number_of_pointers);
+
+		if (n == max) {
+			break;
+		}
+
+		// Stop at the end of the chain, or at the end of this page,
+		// so that the data pointers stay in the buffer.
+		Page->Parse_pointer_at_word(cursor->page,
+			cursor->word + number_of_children, &next_record);
+		if (next_record.page != cursor->page ||
+				next_record.type == PTR_EOCHAIN ||
+				next_record.type == PTR_NORECORD ||
+				next_record.word <= 0) {
+			break;
+		}
+		*cursor = next_record;
+	}
+
+	debug("SEG::next_batch seg %s = %d read %d records\n",
+		segment_name, my_id, n);
+
+	set_children_cursor_pos(n ? beginning : end);
+	return n;
+}
+
 void FOCSEG::next_unique_children(void) {
 
 	debug("SEG::next_unique_children seg %s = %d\n",
@@ -1299,6 +2183,21 @@ int FOCSEG::read_bytes(UCHAR *target, int offset, int length) {
 	debug("SEG::read_bytes reading page %d word %d offset %d length %d\n",
 		cursor->page, cursor->word, offset, length);
 
+	if (!(byte_ptr = record_data())) {
+		return 0;
+	}
+
+	memcpy(target, byte_ptr + offset, length);
+	Stats.read_bytes_calls++;
+	Stats.bytes_copied += length;
+	return 1;
+}
+
+// Returns a pointer to the data area of the current record, inside the
+// page buffer, or NULL if the cursor isn't on a record. The pointer is
+// only good until the segment's page buffer is re-used.
+UCHAR* FOCSEG::record_data(void) {
+
 	if (cursor_pos == inaccessible) {
 		die("SEG::read_bytes(%s) is not accessible yet."
 			"The parent segment has not been accessed yet.\n",
@@ -1306,16 +2205,69 @@ int FOCSEG::read_bytes(UCHAR *target, int offset, int length) {
 	}
 
 	if (cursor_pos != record) {
-		return 0;
+		return NULL;
 	}
 
-	byte_ptr = Page->Return_word_offset(cursor->page,
+	return Page->Return_word_offset(cursor->page,
 			cursor->word + number_of_pointers);
+}
 
-	memcpy(target, byte_ptr + offset, length);
+int FOCSEG::position(FOCPTR& where) {
+
+	if (cursor_pos != record) {
+		return 0;
+	}
+
+	where = *cursor;
 	return 1;
 }
 
+// The parent of a record of this segment, from the PTR_PARENT pointer
+// that follows its child and next pointers. Returns 0 for the root
+// segment, or if the pointer isn't there.
+int FOCSEG::parent_of(FOCPTR& where, FOCPTR& parent) {
+
+	if (parent_number == 0) {
+		return 0;
+	}
+
+	Page->Parse_pointer_at_word(where.page,
+		where.word + number_of_children + 1, &parent);
+
+	debug("SEG::parent_of %s page %d word %d -> page %d word %d "
+		"type %d\n", segment_name, where.page, where.word,
+		parent.page, parent.word, parent.type);
+
+	return parent.type == PTR_PARENT && parent.page > 0 &&
+		parent.word > 0;
+}
+
+void FOCSEG::set_readahead(int pages) {
+
+	Page->Set_readahead(pages);
+}
+
+void FOCSEG::set_pool(FOCPOOL *pool) {
+
+	Page->Set_pool(pool);
+}
+
+// Reads any page into the page buffer. The cursor doesn't move; the
+// next record_data() reads its own page back.
+UCHAR* FOCSEG::read_page(int page, FOCPAGE_STAMP *stamp) {
+
+	Page->Get_stamp(page, stamp);
+	return Page->Return_byte_offset(page, 0);
+}
+
+int FOCSEG::page_used(int page) {
+
+	int	used, last_word, next_page;
+
+	Page->Get_fill(page, &used, &last_word, &next_page);
+	return used;
+}
+
 
 void FOCSEG::join_segment_as_head(FOCJOIN* new_join) {
 
@@ -1366,6 +2318,27 @@ int FOCSEG::reccount(int (*filter)(FOCFILE*), FOCFILE *foc) {
 	return records;
 }
 
+// Same, with a filter expression. When all the fields lie in this
+// segment, the expression runs straight on the page buffer.
+int FOCSEG::reccount(FOCEXPR& where, FOCFILE *foc) {
+
+	int records = 0;
+
+	reposition();
+	if (where.segment() == my_id) {
+		while (next()) {
+			records += where.eval_record(record_data());
+		}
+	}
+	else {
+		while (next()) {
+			records += where.eval(foc);
+		}
+	}
+
+	return records;
+}
+
 
 
 // =============================================================
@@ -1397,66 +2370,357 @@ FOCINDEX::FOCINDEX(int idx_num, FILE* fh, UCHAR* fdt_entry) {
 	Cache		= NULL;
 	size_of_key	= 0;
 
-	debug("INDEX::INDEX Index %s has type %i first_page %d "
-		"last_page %d # pages %d\n",
-		field_name, index_type, first_page, last_page,
-		number_of_pages);
+	memset(&Stats, 0, sizeof(FOCSTATS));
+	Pool		= NULL;
+
+	debug("INDEX::INDEX Index %s has type %i first_page %d "
+		"last_page %d # pages %d\n",
+		field_name, index_type, first_page, last_page,
+		number_of_pages);
+
+};
+
+FOCINDEX::~FOCINDEX() {
+	delete Cache;
+};
+
+
+int FOCINDEX::index_in_use(void) {
+
+	return (int) in_use;
+}
+
+
+// =============================================================
+// CLASS: FOCINDEX_BTREE
+// -------------------------------------------------------------
+// Class to handle Balanced-Tree indices.
+// =============================================================
+FOCINDEX_BTREE::FOCINDEX_BTREE(int idx_num, FILE* fh, UCHAR* fdt_entry) 
+	: FOCINDEX(idx_num, fh, fdt_entry) {
+	debug("BTREE::Constructor for index %d\n", idx_num);
+	Root_node = NULL;
+
+	Level		= NULL;
+	Levels		= 0;
+	Walk_page	= NULL;
+	Walk_record	= NULL;
+	Walk_top	= -1;
+	Walk_key	= NULL;
+	Walk_length	= -1;
+	Walk_backward	= 0;
+	Walk_last	= new FOCPTR();
+};
+
+FOCINDEX_BTREE::~FOCINDEX_BTREE() {
+
+	debug("BTREE::Destructor for index %d\n", my_id);
+	delete Root_node;
+	delete [] Level;
+	delete [] Walk_page;
+	delete [] Walk_record;
+	free(Walk_key);
+	delete Walk_last;
+};
+
+void FOCINDEX_BTREE::initialize(char type, int seg) {
+	debug("BTREE::initialize called: type %c seg %d\n", type, seg);
+	in_use = 1;
+	Root_node = new FOCINDEX_BTREE_NODE(type, first_page, foc_fh, &Stats,
+			Pool, my_id, 0);
+	Cache = new FOCINDEXCACHE(Root_node->key_size());
+	size_of_key = Root_node->key_size();
+
+	FOCINDEX_BTREE_NODE	*node;
+	int			l;
+
+	for (node = Root_node; node; node = node->children()) {
+		Levels++;
+	}
+	Level		= new FOCINDEX_BTREE_NODE*[Levels];
+	Walk_page	= new int[Levels];
+	Walk_record	= new int[Levels];
+	for (node = Root_node, l = 0; node; node = node->children(), l++) {
+		Level[l] = node;
+	}
+	Walk_key = (UCHAR*) xmalloc("FOCINDEX_BTREE::initialize",
+			Root_node->key_size());
+}
+
+int FOCINDEX_BTREE::find(void *key, FOCPTR *result) {
+	debug("BTREE::find called\n");
+	Stats.index_finds++;
+
+	// we might get lucky and know the answer alredy
+	if (Cache->lookup(key, result)) {
+		Stats.index_cache_hits++;
+		return 1;
+	}
+
+	// search successful
+	if (Root_node->find(key, result)) {
+		debug("BTREE::find found!\n");
+		Cache->insert(key, result);
+		return 1;
+	}
+	// search unsuccessful
+	else {
+		debug("BTREE::find not found!\n");
+		return 0;
+	}
+}
+
+/* Since the non-leaf records point to data too, the records with a key
+   aren't all in the leaves: in key order, a non-leaf record comes after
+   everything in the child of the record before it, and before everything
+   in its own child. So first() goes down the tree to the first key not
+   less than ours, the way find() does, but remembering the record it
+   took on each level; next() goes down the child of a non-leaf record,
+   or along a leaf and back up to the record after the child it was in.
+   Equal keys are together in that order, so the walk stops at the first
+   different one. */
+int FOCINDEX_BTREE::first(void *key, FOCPTR *result, int length) {
+
+	debug("BTREE::first called\n");
+	Stats.index_finds++;
+	Walk_length = length;
+	memcpy(Walk_key, key, length < 0 ? size_of_key : length);
+
+	if (!Walk_down(key, length)) {
+		return 0;
+	}
+	return Walk_result(result);
+}
+
+int FOCINDEX_BTREE::next(FOCPTR *result) {
+
+	debug("BTREE::next called\n");
+	if (Walk_top < 0 || !Walk_step()) {
+		return 0;
+	}
+	return Walk_result(result);
+}
+
+// The keys alone: seek() puts the walk at the first key not less than
+// key, or at the first of all if key is NULL, and next_key() gives each
+// key from there on, and how many records have it.
+int FOCINDEX_BTREE::seek(void *key) {
+
+	debug("BTREE::seek called\n");
+	Stats.index_finds++;
+
+	// match_postings() can't go on from here
+	Walk_last->page = 0;
+	Walk_last->word = 0;
+
+	return Walk_down(key, -1);
+}
+
+int FOCINDEX_BTREE::next_key(UCHAR *key, long *records) {
+
+	FOCINDEX_BTREE_NODE	*node;
+
+	if (Walk_top < 0) {
+		return 0;
+	}
+
+	node = Level[Walk_top];
+	memcpy(key, node->record(Walk_page[Walk_top], Walk_record[Walk_top]),
+		size_of_key);
+
+	*records = 0;
+	do {
+		(*records)++;
+		if (!Walk_step()) {
+			break;
+		}
+		node = Level[Walk_top];
+	} while (node->compare(key, node->record(Walk_page[Walk_top],
+			Walk_record[Walk_top])) == 0);
+
+	return 1;
+}
+
+// Every record, with its key, in key order from ends(0) or backwards
+// from ends(1)
+int FOCINDEX_BTREE::ends(int backward) {
+
+	debug("BTREE::ends called, backward %d\n", backward);
+	Stats.index_finds++;
+
+	// match_postings() can't go on from here
+	Walk_last->page = 0;
+	Walk_last->word = 0;
+
+	Walk_backward = backward;
+	return backward ? Walk_down_last() : Walk_down(NULL, -1);
+}
+
+int FOCINDEX_BTREE::step(UCHAR *key, FOCPTR *result) {
+
+	UCHAR	*b;
+
+	if (Walk_top < 0) {
+		return 0;
+	}
+
+	b = Level[Walk_top]->record(Walk_page[Walk_top],
+			Walk_record[Walk_top]);
+	memcpy(key, b, size_of_key);
+	result->set_location(b + size_of_key);
+
+	if (Walk_backward) {
+		Walk_back();
+	}
+	else {
+		Walk_step();
+	}
+	return 1;
+}
+
+// Down from the root, on each non-leaf page along the child of the last
+// record less than the key; the first record is less than every key.
+int FOCINDEX_BTREE::Walk_down(void *key, int length) {
+
+	int	l, page = first_page;
+
+	for (l = 0; l < Levels; l++) {
+		Walk_page[l] = page;
+		if (Level[l]->leaf(page)) {
+			Walk_record[l] = key ? Level[l]->count_less(page, 0,
+						key, length) : 0;
+			break;
+		}
+		Walk_record[l] = key ? Level[l]->count_less(page, 1,
+					key, length) : 0;
+		page = Level[l]->child(page, Walk_record[l]);
+	}
+	Walk_top = l < Levels ? l : Levels - 1;
+
+	return Walk_settle();
+}
+
+// To the next record in key order
+int FOCINDEX_BTREE::Walk_step(void) {
+
+	int	l = Walk_top, page = Walk_page[Walk_top];
+
+	// A leaf record: the next one along
+	if (Level[l]->leaf(page)) {
+		Walk_record[l]++;
+	}
+	// A non-leaf record: the first one in its child
+	else {
+		page = Level[l]->child(page, Walk_record[l]);
+		for (l++; l < Levels; l++) {
+			Walk_page[l] = page;
+			Walk_record[l] = 0;
+			if (Level[l]->leaf(page)) {
+				break;
+			}
+			page = Level[l]->child(page, 0);
+		}
+		Walk_top = l < Levels ? l : Levels - 1;
+	}
+
+	return Walk_settle();
+}
+
+int FOCINDEX_BTREE::walking(void *key, FOCPTR& where, int length) {
 
-};
+	return Walk_top >= 0 && length == Walk_length &&
+		memcmp(key, Walk_key, length < 0 ? size_of_key : length) == 0 &&
+		where.page == Walk_last->page && where.word == Walk_last->word;
+}
 
-FOCINDEX::~FOCINDEX() {
-	delete Cache;
-};
+// Past the last record of a node, the walk goes on at the record after
+// the child it came down. Returns 0 at the end of the index.
+int FOCINDEX_BTREE::Walk_settle(void) {
+
+	while (Walk_top >= 0 && Walk_record[Walk_top] >=
+			Level[Walk_top]->records(Walk_page[Walk_top])) {
+		Walk_top--;
+		if (Walk_top >= 0) {
+			Walk_record[Walk_top]++;
+		}
+	}
+	return Walk_top >= 0;
+}
 
+/* Backwards, the order is the other way round: a non-leaf record comes
+   after everything in the child of the record before it, so from there
+   the walk goes down that child to its last record, and from the first
+   record of a leaf back up to the record whose child it is in. The first
+   record of a non-leaf page is less than every key, and is passed over
+   the way the forward walk passes over it. */
+int FOCINDEX_BTREE::Walk_down_last(void) {
 
-int FOCINDEX::index_in_use(void) {
+	int	l, page = first_page;
 
-	return (int) in_use;
+	for (l = 0; l < Levels; l++) {
+		Walk_page[l] = page;
+		Walk_record[l] = Level[l]->records(page) - 1;
+		if (Level[l]->leaf(page)) {
+			break;
+		}
+		page = Level[l]->child(page, Walk_record[l]);
+	}
+	Walk_top = l < Levels ? l : Levels - 1;
+
+	return Walk_settle_back();
 }
 
+// To the record before in key order
+int FOCINDEX_BTREE::Walk_back(void) {
 
-// =============================================================
-// CLASS: FOCINDEX_BTREE
-// -------------------------------------------------------------
-// Class to handle Balanced-Tree indices.
-// =============================================================
-FOCINDEX_BTREE::FOCINDEX_BTREE(int idx_num, FILE* fh, UCHAR* fdt_entry) 
-	: FOCINDEX(idx_num, fh, fdt_entry) {
-	debug("BTREE::Constructor for index %d\n", idx_num);
-	Root_node = NULL;
-};
+	int	l = Walk_top, page = Walk_page[Walk_top];
 
-FOCINDEX_BTREE::~FOCINDEX_BTREE() {
+	Walk_record[l]--;
 
-	debug("BTREE::Destructor for index %d\n", my_id);
-	delete Root_node;
-};
+	// A non-leaf record: the last one in the child of the record before
+	if (!Level[l]->leaf(page)) {
+		page = Level[l]->child(page, Walk_record[l]);
+		for (l++; l < Levels; l++) {
+			Walk_page[l] = page;
+			Walk_record[l] = Level[l]->records(page) - 1;
+			if (Level[l]->leaf(page)) {
+				break;
+			}
+			page = Level[l]->child(page, Walk_record[l]);
+		}
+		Walk_top = l < Levels ? l : Levels - 1;
+	}
 
-void FOCINDEX_BTREE::initialize(char type, int seg) {
-	debug("BTREE::initialize called: type %c seg %d\n", type, seg);
-	in_use = 1;
-	Root_node = new FOCINDEX_BTREE_NODE(type, first_page, foc_fh);
-	Cache = new FOCINDEXCACHE(Root_node->key_size());
+	return Walk_settle_back();
 }
 
-int FOCINDEX_BTREE::find(void *key, FOCPTR *result) {
-	debug("BTREE::find called\n");
-	// we might get lucky and know the answer alredy
-	if (Cache->lookup(key, result)) {
-		return 1;
-	}
+// Before the first record of a leaf, the walk goes on at the record
+// whose child it came down, unless that is the first of its page too.
+// Returns 0 at the start of the index.
+int FOCINDEX_BTREE::Walk_settle_back(void) {
 
-	// search successful
-	if (Root_node->find(key, result)) {
-		debug("BTREE::find found!\n");
-		Cache->insert(key, result);
-		return 1;
+	while (Walk_top >= 0 && Walk_record[Walk_top] <
+			(Level[Walk_top]->leaf(Walk_page[Walk_top]) ? 0 : 1)) {
+		Walk_top--;
 	}
-	// search unsuccessful
-	else {
-		debug("BTREE::find not found!\n");
+	return Walk_top >= 0;
+}
+
+// If the record the walk is at has the key, return where its data is
+int FOCINDEX_BTREE::Walk_result(FOCPTR *result) {
+
+	FOCINDEX_BTREE_NODE	*node = Level[Walk_top];
+	UCHAR			*b;
+
+	b = node->record(Walk_page[Walk_top], Walk_record[Walk_top]);
+	if (node->compare(Walk_key, b, Walk_length) != 0) {
+		Walk_top = -1;
 		return 0;
 	}
+
+	result->set_location(b + node->key_size());
+	*Walk_last = *result;
+	return 1;
 }
 
 // =============================================================
@@ -1465,18 +2729,22 @@ int FOCINDEX_BTREE::find(void *key, FOCPTR *result) {
 // Class for the nodes in a Btree
 // =============================================================
 FOCINDEX_BTREE_NODE::FOCINDEX_BTREE_NODE(char key_type, int node_page,
-			FILE *fh) {
+			FILE *fh, FOCSTATS *stats, FOCPOOL *pool, int idx_num,
+			int level) {
 
 	debug("BTREE_NODE::Constructor key %c node_page %d\n",
 			key_type, node_page);
 	type_of_key = key_type;
-	Page = new FOCPAGE(fh);
+	Page = new FOCPAGE(fh, stats, FOCPAGE_INDEX, idx_num, level);
+	Page->Set_pool(pool);
+	node_page_in_memory = 0;
 	read_node_page(node_page);
 
 	if (!is_leaf) {
 		debug("BTREE_NODE::This node not leaf. Making new node\n");
 		Children_node_level =
-			new FOCINDEX_BTREE_NODE(key_type, left_child(), fh);
+			new FOCINDEX_BTREE_NODE(key_type, left_child(), fh,
+					stats, pool, idx_num, level + 1);
 	}
 	else {
 		debug("BTREE_NODE::This node is the leaf.\n");
@@ -1582,6 +2850,36 @@ int FOCINDEX_BTREE_NODE::find_in_non_leaf(void *key, FOCPTR *result) {
 	UCHAR *end_b	= start_b + first_free_byte - size_of_record;
 
 	debug("BTREE_NODE::find_in_non_leaf type_of_key %c\n", type_of_key);
+
+	// Integer and smartdate keys. The keys in a node are sorted, so
+	// counting the keys below ours tells us where to go, and the count
+	// doesn't need any branches.
+	if (type_of_key == FIELDTYPE_INTEGER ||
+			type_of_key == FIELDTYPE_SMDATE) {
+
+		int	less, less_or_equal;
+		int	count = first_free_byte / size_of_record;
+
+		int32_bounds(start_b, count, size_of_record,
+			mkint32((UCHAR*) key), &less, &less_or_equal);
+
+		// Hit the nail on the head! (the last equal key, as
+		// the backwards search below would find it)
+		if (less_or_equal > less) {
+			b = start_b + (less_or_equal - 1) * size_of_record;
+			result->set_location(b + size_of_key);
+			return 1;
+		}
+		// The key lies in the child of the last lesser key
+		else if (less > 0) {
+			b = start_b + (less - 1) * size_of_record;
+			return Children_node_level->find(key,
+				result, mkshort(b + size_of_key + 4));
+		}
+
+		die("INDEX_BTREE_NODE couldn't compare value correctly.\n");
+	}
+
 	for(b = end_b; b >= start_b; b -= size_of_record) {
 
 		// compare correctly
@@ -1596,10 +2894,6 @@ int FOCINDEX_BTREE_NODE::find_in_non_leaf(void *key, FOCPTR *result) {
 
 			comparison = memcmp(key, b, size_of_key);
 		}
-		else if (type_of_key == FIELDTYPE_INTEGER ||
-			 type_of_key == FIELDTYPE_SMDATE) {
-			comparison = intcmp((long*)key, (long*)b);
-		}
 		else if (type_of_key == FIELDTYPE_DOUBLE) {
 			comparison = doublecmp((double*)key, (double*)b);
 		}
@@ -1645,6 +2939,26 @@ int FOCINDEX_BTREE_NODE::find_in_leaf(void *key, FOCPTR *result) {
 	UCHAR *start_b	= Page->Return_byte_offset(node_page_in_memory, 0x14);
 	UCHAR *end_b	= start_b + first_free_byte;
 
+	// Integer and smartdate keys
+	if (type_of_key == FIELDTYPE_INTEGER ||
+			type_of_key == FIELDTYPE_SMDATE) {
+
+		int i = int32_find_first(start_b,
+				first_free_byte / size_of_record,
+				size_of_record, mkint32((UCHAR*) key));
+
+		if (i >= 0) {
+			b = start_b + i * size_of_record;
+			result->set_location(b + size_of_key);
+			debug("INDEX::find Found! %d Page %d Word %d\n",
+				mkint32(b), result->page, result->word);
+			return 1;
+		}
+
+		debug("INDEX::find Couldn't find key.\n");
+		return 0;
+	}
+
 	for(b = start_b; b < end_b; b += size_of_record) {
 
 		if (memcmp(key, b, size_of_key) == 0) {
@@ -1671,6 +2985,93 @@ int FOCINDEX_BTREE_NODE::find_in_leaf(void *key, FOCPTR *result) {
 }
 
 
+
+// The number of records in a node page
+int FOCINDEX_BTREE_NODE::records(int node_page) {
+
+	read_node_page(node_page);
+	return first_free_byte / size_of_record;
+}
+
+int FOCINDEX_BTREE_NODE::leaf(int node_page) {
+
+	read_node_page(node_page);
+	return is_leaf;
+}
+
+UCHAR* FOCINDEX_BTREE_NODE::record(int node_page, int r) {
+
+	read_node_page(node_page);
+	return Page->Return_byte_offset(node_page, 0x14 + r * size_of_record);
+}
+
+// The node page of the child of a non-leaf record
+int FOCINDEX_BTREE_NODE::child(int node_page, int r) {
+
+	return mkshort(record(node_page, r) + size_of_key + 4);
+}
+
+// How many of the records from `from' on have keys less than key, or
+// whose first length bytes are less than it
+int FOCINDEX_BTREE_NODE::count_less(int node_page, int from, void *key,
+		int length) {
+
+	int	count = records(node_page) - from;
+	int	low = 0, high = count;
+	UCHAR	*start_b;
+
+	if (count <= 0) {
+		return 0;
+	}
+	start_b = record(node_page, from);
+
+	if (type_of_key == FIELDTYPE_INTEGER ||
+			type_of_key == FIELDTYPE_SMDATE) {
+
+		int	less, less_or_equal;
+
+		int32_bounds(start_b, count, size_of_record,
+			mkint32((UCHAR*) key), &less, &less_or_equal);
+		return less;
+	}
+
+	while (low < high) {
+		int middle = (low + high) / 2;
+		if (compare(key, start_b + middle * size_of_record,
+				length) > 0) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+// Compares a key with the key of a record, as find() does, or an alpha
+// prefix with as much of it
+int FOCINDEX_BTREE_NODE::compare(void *key, UCHAR *b, int length) {
+
+	if (type_of_key == FIELDTYPE_INTEGER ||
+			type_of_key == FIELDTYPE_SMDATE) {
+		int32_t	k = mkint32((UCHAR*) key), v = mkint32(b);
+		return (k > v) - (k < v);
+	}
+	else if (type_of_key == FIELDTYPE_ALPHA) {
+		return memcmp(key, b, length < 0 ? size_of_key : length);
+	}
+	else if (type_of_key == FIELDTYPE_DOUBLE) {
+		return doublecmp((double*)key, (double*)b);
+	}
+	else if (type_of_key == FIELDTYPE_FLOAT) {
+		return floatcmp((float*)key, (float*)b);
+	}
+
+	die("FOCINDEX_BTREE_NODE::compare has wrong type %c\n", type_of_key);
+	return 0;	// just here to make compilers happy
+}
+
+
 // =============================================================
 // CLASS: FOCINDEXCACHE
 // -------------------------------------------------------------
@@ -1820,8 +3221,15 @@ int FOCJOIN::next(void) {
 	if ( ! first_key_read) {
 		first_key_read = 1;
 		debug("JOIN::next Reading first key...\n");
-		return child_foc->match_index(child_idx, child_type, child_seg,
-			current_key);
+
+		FOCSTATS *stats = parent_seg->Get_stats();
+		stats->join_probes++;
+		if (child_foc->match_index(child_idx, child_type, child_seg,
+				current_key)) {
+			stats->join_hits++;
+			return 1;
+		}
+		return 0;
 	}
 	else {
 		debug("JOIN::next First_key_read...NOP\n");
@@ -1843,9 +3251,20 @@ int FOCJOIN::next(void) {
 // allocate the 4K of memory for the page buffer until a read
 // is requested.
 // =============================================================
-FOCPAGE::FOCPAGE(FILE* fh) {
+FOCPAGE::FOCPAGE(FILE* fh, FOCSTATS* stats, char owner, int owner_id,
+		int level) {
 
 	foc_fh			= fh;
+	Stats			= stats;
+	Pool			= NULL;
+	Owner			= owner;
+	Owner_id		= owner_id;
+	Level			= level;
+
+	// Only segment pages come in chains
+	Readahead		= owner == FOCPAGE_SEGMENT ? READAHEAD_PAGES : 0;
+	Advised_first		= 0;
+	Advised_end		= 0;
 	Page_buffer		= NULL;
 	Page_number_in_buffer	= 0;
 	Page_pointer		= NULL;
@@ -1904,6 +3323,25 @@ void FOCPAGE::Parse_pointer_at_word(int page, int word, FOCPTR *result) {
 }
 
 
+void FOCPAGE::Get_stamp(int page, FOCPAGE_STAMP *stamp) {
+
+	Read_page(page);
+
+	stamp->segment		= Segment_number;
+	stamp->transaction	= Transaction_number;
+	memcpy(stamp->date, Date, 3);
+	memcpy(stamp->time, Time, 4);
+}
+
+int FOCPAGE::Get_fill(int page, int *used, int *last_word, int *next_page) {
+
+	Read_page(page);
+
+	*used		= Free_space - 1;
+	*last_word	= Last_word;
+	*next_page	= Next_page;
+	return Segment_number;
+}
 
 // Simply reads a page from the FOC file into the buffer
 // Dies on an error
@@ -1917,6 +3355,10 @@ void FOCPAGE::Read_page(int page) {
 	// If the page is already in the buffer, we lucked out.
 	if (page == Page_number_in_buffer) {
 		debug("PAGE::Lucky! page %d was already in buffer!\n", page);
+		Stats->buffer_hits++;
+		if (Page_trace) {
+			page_trace_record(foc_fh, page, Owner, Owner_id, Level, 0);
+		}
 		return;
 	}
 #ifdef DEBUG
@@ -1933,6 +3375,20 @@ void FOCPAGE::Read_page(int page) {
 			" ============\n", page);
 	}
 
+	// Was it preloaded?
+	if (Pool && page < Pool->pages && Pool->frame[page]) {
+		debug("PAGE::page %d was preloaded\n", page);
+		memcpy(Page_buffer, Pool->frame[page], 4000);
+		Page_number_in_buffer = page;
+		Stats->pool_hits++;
+		if (Page_trace) {
+			page_trace_record(foc_fh, page, Owner, Owner_id,
+				Level, 0);
+		}
+		Parse_control();
+		return;
+	}
+
 	// Position the read-pointer
 	if(fseek(foc_fh, (page - 1) * 4096, SEEK_SET) < 0) {
 		die("PAGE: fseek returned less-than-zero\n");
@@ -1944,14 +3400,29 @@ void FOCPAGE::Read_page(int page) {
 	debug("*********Ack! reading 4K from disk for page %d************\n",
 		page);
 
+	Stats->buffer_misses++;
+	Stats->pages_read++;
+	if (Page_trace) {
+		page_trace_record(foc_fh, page, Owner, Owner_id, Level,
+			FOCPAGE_TRACE_MISS);
+	}
+
+	OP_BEGIN(FOCOP_READ_PAGE, Owner, Owner_id, page);
+
 	int bytes_read;
 	// Read one page of information.
 	bytes_read = fread(Page_buffer, 1, 4000, foc_fh);
+
+	OP_END(FOCOP_READ_PAGE, Owner, Owner_id, page, bytes_read);
 	if (bytes_read == 4000) {
 		Page_number_in_buffer = page;
 
 		// Parse the control info for this page.
 		Parse_control();
+
+		if (Readahead > 0) {
+			Advise_next();
+		}
 	}
 	else {
 		die("PAGE fread returned %d bytes from page %d "
@@ -1960,6 +3431,46 @@ void FOCPAGE::Read_page(int page) {
 
 }
 
+// Tell the system which pages the chain wants next, so that reading
+// them overlaps with the work on this one. The chain is only known one
+// page ahead, from Next_page, but segments are mostly written in page
+// order: while the chain goes page by page, the window reaches Readahead
+// pages past this one, and it is topped up each time half of it has
+// been used. A jump in the chain starts a new window.
+void FOCPAGE::Advise_next(void) {
+
+#ifdef HAS_FADVISE
+	int	end;
+
+	if (Next_page <= 0) {
+		return;
+	}
+
+	if (Next_page < Advised_first || Next_page > Advised_end) {
+		Advised_first = Advised_end = Next_page;
+	}
+
+	if (Next_page == Page_number_in_buffer + 1) {
+		end = Next_page + Readahead;
+	}
+	else {
+		end = Next_page + 1;
+	}
+
+	if (Advised_end - Next_page > Readahead / 2 || end <= Advised_end) {
+		return;
+	}
+
+	debug("PAGE::Advise_next pages %d to %d\n", Advised_end, end - 1);
+
+	posix_fadvise(fileno(foc_fh), (off_t) (Advised_end - 1) * 4096,
+		(off_t) (end - Advised_end) * 4096, POSIX_FADV_WILLNEED);
+
+	Stats->pages_advised += end - Advised_end;
+	Advised_end = end;
+#endif /* HAS_FADVISE */
+}
+
 void FOCPAGE::Parse_control(void) {
 
 //	UCHAR	Focus_pointer[4];
@@ -1970,7 +3481,7 @@ void FOCPAGE::Parse_control(void) {
 //	memcpy(Focus_pointer,		&Page_buffer[CTRLOFF],    4);
 	memcpy(Date,			&Page_buffer[CTRLOFF+17], 3);
 	memcpy(Time,			&Page_buffer[CTRLOFF+20], 4);
-	memcpy(&Transaction_number,	&Page_buffer[CTRLOFF+24], 4);
+	Transaction_number	= mkint32(&Page_buffer[CTRLOFF+24]);
 
 	Next_page		= mkshort(&Page_buffer[CTRLOFF+ 4]);
 	Segment_number		= mkshort(&Page_buffer[CTRLOFF+ 6]);
@@ -2075,12 +3586,12 @@ int mkshort(UCHAR* ptr) {
 }
 
 // Malloc or die
-void* xmalloc(char *label, int bytes) {
+void* xmalloc(const char *label, long bytes) {
 
 	void*	memory;
 
 	if ((memory = (void*) malloc(bytes)) == NULL) {
-		die("Can't allocate %d bytes for %s\n", bytes, label);
+		die("Can't allocate %ld bytes for %s\n", bytes, label);
 	}
 
 #ifdef DEBUG
@@ -2092,13 +3603,216 @@ void* xmalloc(char *label, int bytes) {
 	return memory;
 }
 
-// Comparison functions for alpha (not null-terminated strings), longs,
+// Realloc or die
+void* xrealloc(const char *label, void *memory, long bytes) {
+
+	if ((memory = realloc(memory, bytes)) == NULL) {
+		die("Can't allocate %ld bytes for %s\n", bytes, label);
+	}
+
+	return memory;
+}
+
+// Compare two fields of the same type. Returns -1, 0, or 1.
+int field_compare(char type, int length, UCHAR *a, UCHAR *b) {
+
+	switch (type) {
+		case FIELDTYPE_DOUBLE: {
+			double x, y;
+			memcpy(&x, a, sizeof(double));
+			memcpy(&y, b, sizeof(double));
+			return (x > y) - (x < y);
+		}
+		case FIELDTYPE_FLOAT: {
+			float x, y;
+			memcpy(&x, a, sizeof(float));
+			memcpy(&y, b, sizeof(float));
+			return (x > y) - (x < y);
+		}
+		case FIELDTYPE_INTEGER:
+		case FIELDTYPE_SMDATE: {
+			int32_t x = mkint32(a);
+			int32_t y = mkint32(b);
+			return (x > y) - (x < y);
+		}
+		default: {
+			int c = memcmp(a, b, length);
+			return (c > 0) - (c < 0);
+		}
+	}
+}
+
+// A numeric field as a double. Smart dates count days.
+double field_value(char type, UCHAR *field) {
+
+	switch (type) {
+		case FIELDTYPE_DOUBLE: {
+			double d;
+			memcpy(&d, field, sizeof(double));
+			return d;
+		}
+		case FIELDTYPE_FLOAT: {
+			float f;
+			memcpy(&f, field, sizeof(float));
+			return f;
+		}
+		default: {
+			return mkint32(field);
+		}
+	}
+}
+
+// A seeded random number, so that a sample can be taken again
+unsigned long sample_random(uint64_t *state) {
+
+	*state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (unsigned long) (*state >> 33);
+}
+
+#ifdef OP_TIMING
+// Nanoseconds on a clock that never goes backwards
+static long now_ns(void) {
+
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+// An operation starts. Returns the time, for op_end().
+long op_begin(FOCOP op, char owner, int id, int page) {
+
+#ifdef TRACE_HOOKS
+	if (Trace_hook) {
+		FOCTRACE_EVENT	event;
+
+		event.op	= op;
+		event.end	= 0;
+		event.owner	= owner;
+		event.id	= id;
+		event.page	= page;
+		event.ns	= 0;
+		event.result	= 0;
+		Trace_hook(&event, Trace_arg);
+	}
+#endif /* TRACE_HOOKS */
+
+	return now_ns();
+}
+
+void op_end(FOCOP op, char owner, int id, int page, int result, long start) {
+
+	long	ns = now_ns() - start;
+
+#ifdef LATENCY_HISTOGRAMS
+	FOCHIST	*h = &Latency[op];
+
+	if (h->count == 0 || ns < h->min_ns) {
+		h->min_ns = ns;
+	}
+	if (ns > h->max_ns) {
+		h->max_ns = ns;
+	}
+	h->count++;
+	h->total_ns += ns;
+	h->bucket[hist_bucket(ns)]++;
+#endif /* LATENCY_HISTOGRAMS */
+
+#ifdef TRACE_HOOKS
+	if (Trace_hook) {
+		FOCTRACE_EVENT	event;
+
+		event.op	= op;
+		event.end	= 1;
+		event.owner	= owner;
+		event.id	= id;
+		event.page	= page;
+		event.ns	= ns;
+		event.result	= result;
+		Trace_hook(&event, Trace_arg);
+	}
+#endif /* TRACE_HOOKS */
+}
+#endif /* OP_TIMING */
+
+#ifdef LATENCY_HISTOGRAMS
+// Values under 16 ns have a bucket each. After that, each power of two
+// is cut into 16 buckets: [16,32) by 1, [32,64) by 2, and so on.
+int hist_bucket(long ns) {
+
+	int	e, bucket;
+
+	if (ns < FOCHIST_SUB) {
+		return ns < 0 ? 0 : (int) ns;
+	}
+
+	// 2^e <= ns < 2^(e+1)
+	for (e = 4; (ns >> (e + 1)) != 0; e++)
+		;
+
+	bucket = (e - 3) * FOCHIST_SUB
+		+ (int) ((ns >> (e - 4)) & (FOCHIST_SUB - 1));
+	return bucket < FOCHIST_BUCKETS ? bucket : FOCHIST_BUCKETS - 1;
+}
+
+// The largest value that falls in a bucket
+long hist_bucket_top(int bucket) {
+
+	int	e, sub;
+
+	if (bucket < FOCHIST_SUB) {
+		return bucket;
+	}
+
+	e = bucket / FOCHIST_SUB + 3;
+	sub = bucket % FOCHIST_SUB;
+	return ((long) (FOCHIST_SUB + sub + 1) << (e - 4)) - 1;
+}
+#endif /* LATENCY_HISTOGRAMS */
+
+// One record of the page trace
+void page_trace_record(FILE *fh, int page, char owner, int owner_id,
+		int level, int flags) {
+
+	FOCPAGE_TRACE_RECORD	r;
+
+	r.page		= page;
+	r.file		= fileno(fh);
+	r.owner		= owner;
+	r.owner_id	= owner_id;
+	r.level		= level;
+	r.flags		= flags;
+	r.unused	= 0;
+
+	if (fwrite(&r, sizeof(r), 1, Page_trace) != 1) {
+		die("Can't write the page trace\n");
+	}
+}
+
+// Add one set of counters to another
+void stats_add(FOCSTATS *total, FOCSTATS *s) {
+
+	total->pages_read	+= s->pages_read;
+	total->buffer_hits	+= s->buffer_hits;
+	total->buffer_misses	+= s->buffer_misses;
+	total->index_finds	+= s->index_finds;
+	total->index_cache_hits	+= s->index_cache_hits;
+	total->read_bytes_calls	+= s->read_bytes_calls;
+	total->bytes_copied	+= s->bytes_copied;
+	total->join_probes	+= s->join_probes;
+	total->join_hits	+= s->join_hits;
+	total->pages_advised	+= s->pages_advised;
+	total->pages_preloaded	+= s->pages_preloaded;
+	total->pool_hits	+= s->pool_hits;
+}
+
+// Comparison functions for alpha (not null-terminated strings),
 // doubles, and floats. Return -1, 0, or 1:
 //
 // -1	: a < b
 //  0	: a == b
 //  1	: a > b
-int intcmp(long* a, long* b) {
+int doublecmp(double* a, double* b) {
 
 	if (*a < *b) {
 		return -1;
@@ -2110,7 +3824,7 @@ int intcmp(long* a, long* b) {
 	return 0;
 }
 
-int doublecmp(double* a, double* b) {
+int floatcmp(float* a, float* b) {
 
 	if (*a < *b) {
 		return -1;
@@ -2122,16 +3836,53 @@ int doublecmp(double* a, double* b) {
 	return 0;
 }
 
-int floatcmp(float* a, float* b) {
+// Kernels for 4-byte integer keys laid out every `stride' bytes, as
+// the records of an index node are. The loops have no early exits, so
+// the compiler can turn them into vector compares.
 
-	if (*a < *b) {
-		return -1;
+// Counts the keys less than, and less than or equal to, key.
+void int32_bounds(UCHAR *b, int count, int stride, int32_t key,
+		int *less, int *less_or_equal) {
+
+	int	lt = 0;
+	int	le = 0;
+
+	for (int i = 0; i < count; i++) {
+		int32_t value = mkint32(b + i * stride);
+		lt += (value < key);
+		le += (value <= key);
 	}
-	else if (*a > *b) {
-		return 1;
+
+	*less = lt;
+	*less_or_equal = le;
+}
+
+// Returns the position of the first key equal to key, or -1.
+// Compares eight keys at a time.
+int int32_find_first(UCHAR *b, int count, int stride, int32_t key) {
+
+	int	i = 0;
+	int	j;
+	int	hits;
+
+	for (; i + 8 <= count; i += 8) {
+		hits = 0;
+		for (j = 0; j < 8; j++) {
+			hits |= (mkint32(b + (i + j) * stride) == key) << j;
+		}
+		if (hits) {
+			for (j = 0; !(hits & (1 << j)); j++);
+			return i + j;
+		}
 	}
 
-	return 0;
+	for (; i < count; i++) {
+		if (mkint32(b + i * stride) == key) {
+			return i;
+		}
+	}
+
+	return -1;
 }
 
 // Some libraries don't have strdup. It's a combo malloc and strcpy.
@@ -36,6 +36,8 @@
 #define FOCFILE_H
 
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 
 #ifndef SMDATE_H
 #include "smdate.h"
@@ -52,11 +54,139 @@ class FOCINDEX_BTREE_NODE;
 //class FOCINDEX_HASH;	// not available yet
 class FOCINDEXCACHE;
 class FOCJOIN;
+class FOCEXPR;
 class FOCPAGE;
 class FOCPTR;
 
 typedef unsigned char UCHAR;	// unsigned character (byte!)
 
+// The types of fields, as the FDT gives them
+#define FIELDTYPE_ALPHA		'A'
+#define FIELDTYPE_INTEGER	'I'
+#define FIELDTYPE_DOUBLE	'D'
+#define FIELDTYPE_FLOAT		'F'
+#define FIELDTYPE_SMDATE	'S'
+
+// FOCUS Pointer types
+#define PTR_KU		1		/* Keyed Unique */
+#define PTR_KM		2		/* Keyed Multiple */
+#define	PTR_CHILD	3		/* Descendant or Child instance */
+#define PTR_NEXT	4		/* Next instance of same segment */
+#define PTR_PARENT	5		/* Parent */
+#define PTR_PRIOR	6		/* (Unused at this time: 6/20/87) */
+#define PTR_EOFILE	7		/* End of File */
+#define PTR_DELETED	8		/* Deleted data */
+#define PTR_IGNORED	9		/* ??? */
+#define PTR_DKU		10		/* Dynamic keyed unique */
+#define PTR_DKM		11		/* Dynamic keyed multiple */
+#define PTR_EOCHAIN	0x010000000	/* End of chain */
+#define PTR_NORECORD	(short)0xdddd	/* No child exists ???*/ /* -8739 */
+
+// I/O and cache counters. They are always kept, and cost an increment
+// each. Every segment and index has its own set, and FOCFILE::stats()
+// adds them all up.
+struct FOCSTATS {
+	long	pages_read;		// 4K reads from the file
+	long	buffer_hits;		// page was already in the page buffer
+	long	buffer_misses;		// page had to be read
+	long	index_finds;		// index lookups...
+	long	index_cache_hits;	// ...answered by the index cache
+	long	read_bytes_calls;	// read_bytes() calls...
+	long	bytes_copied;		// ...and the bytes they copied
+	long	join_probes;		// lookups in a joined FOCFILE...
+	long	join_hits;		// ...that found the key
+	long	pages_advised;		// pages asked to be read ahead
+	long	pages_preloaded;	// pages read by preload()...
+	long	pool_hits;		// ...and later copied from there
+};
+
+// What FOCUS writes in a page's control area each time it writes the
+// page. If the stamp hasn't changed, neither has the page.
+struct FOCPAGE_STAMP {
+	int	segment;	// whose page it is (0 for the FDT)
+	int32_t	transaction;
+	UCHAR	date[3];
+	UCHAR	time[4];
+
+	int	operator==  (const FOCPAGE_STAMP& s) const
+		{return segment == s.segment && transaction == s.transaction &&
+			memcmp(date, s.date, 3) == 0 &&
+			memcmp(time, s.time, 4) == 0;};
+
+	int	operator!=  (const FOCPAGE_STAMP& s) const
+		{return !(*this == s);};
+};
+
+// Pages read ahead of time by FOCFILE::preload(), by page number.
+// A FOCPAGE copies a page from here instead of reading it.
+struct FOCPOOL {
+	UCHAR	**frame;	// [page], NULL if not preloaded
+	int	pages;		// length of frame[]
+	UCHAR	**block;	// the frames, one block per preload()
+	int	blocks;
+};
+
+// Latency histograms and trace events for a few operations. They are
+// only kept when focfile.cpp is compiled with LATENCY_HISTOGRAMS or
+// TRACE_HOOKS defined (see its Flags); otherwise they cost nothing, and
+// FOCFILE::latency() and FOCFILE::trace() return 0.
+enum FOCOP { FOCOP_FIND, FOCOP_MATCH_INDEX, FOCOP_NEXT, FOCOP_READ_PAGE };
+#define FOCOP_COUNT	4
+
+// Who a page was read for
+#define FOCPAGE_FDT	'F'
+#define FOCPAGE_SEGMENT	'S'
+#define FOCPAGE_INDEX	'I'
+
+// HDR-style histogram of nanoseconds: 16 linear buckets for each power
+// of two, so every value is kept to within 1/16 of itself.
+#define FOCHIST_SUB	16
+#define FOCHIST_BUCKETS	(FOCHIST_SUB * 38)
+
+struct FOCHIST {
+	long	count;
+	long	min_ns;
+	long	max_ns;
+	double	total_ns;
+	long	bucket[FOCHIST_BUCKETS];
+};
+
+// Passed to the trace hook once when an operation begins and once when
+// it ends. For FOCOP_READ_PAGE, owner and id say which segment or index
+// the page was read for; for the others, id is the segment or index
+// number. page is the page read, or where the cursor ended up.
+struct FOCTRACE_EVENT {
+	FOCOP	op;
+	int	end;		// 0 at the beginning, 1 at the end
+	char	owner;		// FOCPAGE_SEGMENT, FOCPAGE_INDEX, FOCPAGE_FDT
+	int	id;
+	int	page;		// 0 if not known yet
+	long	ns;		// at the end, how long it took
+	int	result;		// at the end, what the operation returned
+};
+
+typedef void (*FOCTRACE_HOOK)(FOCTRACE_EVENT* event, void* arg);
+
+// Called by FOCFILE::walk() for each record, with the cursors on it
+typedef void (*FOCWALK_FUNC)(FOCFILE* foc, int seg, void* arg);
+
+// A page trace (see FOCFILE::record_pages()) is FOCPAGE_TRACE_MAGIC
+// followed by one record per page request, whether or not the page was
+// already in the buffer, in the byte order of the machine that wrote it.
+// focreplay reads them.
+#define FOCPAGE_TRACE_MAGIC	"FOCPGTR1"
+#define FOCPAGE_TRACE_MISS	1	// the page was read from disk
+
+struct FOCPAGE_TRACE_RECORD {
+	uint16_t	page;
+	uint8_t		file;		// fileno() of the FOCUS file
+	uint8_t		owner;		// FOCPAGE_SEGMENT, FOCPAGE_INDEX, ...
+	uint8_t		owner_id;	// segment or index number
+	uint8_t		level;		// index node level; the root is 0
+	uint8_t		flags;
+	uint8_t		unused;
+};
+
 // This gives the programmer one class to deal with. It controls one FOCUS
 // file, and will move the cursor in any children FOCUS files that are
 // joined to it.
@@ -79,11 +209,13 @@ public:
 	int	next(int seg=0, int offset=0, char type='?', int length=0);
 	int	next_with_uniques(int seg=0, int offset=0, char type='?',
 			int length=0);
+	int	next_batch(int seg, UCHAR** data, int max);
 private:
 	int	match(int seg, int offset, char type, int length, void* key);
 public:
 	int	match(int seg, int offset, char type, int length, char* key);
 	int	match(int seg, int offset, char type, int length, long& key);
+	int	match(int seg, int offset, char type, int length, int32_t& key);
 	int	match(int seg, int offset, char type, int length, double& key);
 	int	match(int seg, int offset, char type, int length, float& key);
 	int	match(int seg, int offset, char type, int length, SMDATE& key);
@@ -91,16 +223,53 @@ public:
 	int	match_with_uniques(int seg, int offset, char type,
 			int length, void* key);
 
+	// Match on a filter expression (see focexpr.h)
+	int	match(int seg, FOCEXPR& where);
+
 	// Index-related functions
 private:
 	int	find(int idx, char type, int seg, void* key);
 public:
 	int	find(int idx, char type, int seg, char* key);
 	int	find(int idx, char type, int seg, long& key);
+	int	find(int idx, char type, int seg, int32_t& key);
 	int	find(int idx, char type, int seg, double& key);
 	int	find(int idx, char type, int seg, float& key);
 	int	find(int idx, char type, int seg, SMDATE& key);
 
+	// Move the cursor to each record with the key in turn: the first
+	// call to the first, each call after that to the next, while the
+	// cursor is still on the last one. Returns 0 after the last.
+private:
+	int	match_postings(int idx, char type, int seg, void* key,
+			int length=-1);
+public:
+	int	match_postings(int idx, char type, int seg, char* key);
+	int	match_postings(int idx, char type, int seg, long& key);
+	int	match_postings(int idx, char type, int seg, int32_t& key);
+	int	match_postings(int idx, char type, int seg, double& key);
+	int	match_postings(int idx, char type, int seg, float& key);
+	int	match_postings(int idx, char type, int seg, SMDATE& key);
+
+	// The same, for each record whose alpha key starts with prefix
+	int	match_prefix(int idx, char type, int seg, char* prefix);
+
+	// Where each record with a key is, without moving a cursor, for
+	// FOCINTERSECT (see focintersect.h)
+	int	index_first(int idx, char type, int seg, void* key,
+			FOCPTR& where);
+	int	index_next(int idx, FOCPTR& where);
+
+	// The keys of an index alone, for FOCKEYS (see fockeys.h)
+	int	index_seek(int idx, char type, int seg, void* key);
+	int	index_next_key(int idx, UCHAR* key, long& records);
+	int	index_key_size(int idx, char type, int seg);
+
+	// Every record of an index, from the first key or backwards from
+	// the last, with its key, for FOCTOPN (see foctop.h)
+	int	index_ends(int idx, char type, int seg, int backward);
+	int	index_step(int idx, UCHAR* key, FOCPTR& where);
+
 	// Join a field in the Parent segment to a field in a Child FOCFILE
 	int	join(int p_seg, int p_offset, char p_type, int p_length,
 			FOCFILE* c_foc,
@@ -118,6 +287,7 @@ public:
 	// Read fields and store them in user-space.
 	int hold(char *s,   	int seg, int offset, char type, int length);
 	int hold(long &l,   	int seg, int offset, char type, int length);
+	int hold(int32_t &i,	int seg, int offset, char type, int length);
 	int hold(double &d, 	int seg, int offset, char type, int length);
 	int hold(float &f,  	int seg, int offset, char type, int length);
 	int hold(SMDATE &smd,	int seg, int offset, char type, int length);
@@ -135,22 +305,98 @@ public:
 	int reccount(int seg=0, int (*filter)(FOCFILE*)=NULL);
 	int reccount(int seg, int offset, char type, int length,
 			int (*filter)(FOCFILE*)=NULL);
+	int reccount(int seg, FOCEXPR& where);
+	int reccount(int seg, int offset, char type, int length,
+			FOCEXPR& where);
+
+	// Roughly how many instances a segment has, from how full its
+	// pages are, without walking it. Reads the segment's last page,
+	// plus sample other pages at random to refine it. error is how
+	// far off the estimate may be: with no sample, only the worst case
+	// (every other page down to one instance), which is nearly the
+	// whole estimate; a 95% interval with one; 0 when it had to read
+	// every page anyway.
+	long reccount_estimate(int seg, long& error, int sample=0,
+			unsigned long seed=1);
 
 	/* ---------------------------------------------------------- */
 
 	// Miscellaneous, used mostly by other methods/classes
 	int read_bytes(UCHAR* b, int seg, int offset, char type, int length);
+	UCHAR* record_data(int seg);
+	int position(int seg, FOCPTR& where);
+	void set_position(int seg, FOCPTR& where);
 	void join_segment_as_child(FOCJOIN* join, int seg);
 	void clear_joined_segment(int seg);
 	void initialize_index(int idx, char type, int seg);
 	int  index_in_use(int idx);
 	int  match_index(int idx, char type, int seg, void* key);
 
+	// After match_index() or set_position(), move the ancestors of seg
+	// to the records it belongs to, by its parent pointers
+	int  position_ancestors(int seg);
+
 	int number_seg(void) { return Num_segments; };
+	int parent(int seg);
+	int key_fields(int seg);
 	int number_idx(void) { return Num_indices; };
 	void segment_name(char* answer, int seg);
 	void index_name(char* answer, int idx);
 
+	// Ask the system to read this many pages ahead of each segment's
+	// page chain (0 turns it off)
+	void readahead(int pages);
+
+	// Read all of a segment's or an index's pages at once, many reads
+	// in flight, and keep them in memory until preload_release().
+	// Returns the number of pages read.
+	int  preload(int seg);
+	int  preload_index(int idx);
+	void preload_release(void);
+
+	// For page-order scans (see foczone.h): read one of a segment's
+	// pages into the segment's page buffer and return the buffer,
+	// good until the segment moves to another page. The stamp of any
+	// page, including the FDT (page 1), is there for checking that a
+	// page hasn't changed.
+	UCHAR* read_page(int seg, int page, FOCPAGE_STAMP& stamp);
+	void page_stamp(int page, FOCPAGE_STAMP& stamp);
+	int  pointers(int seg);		// words before each record's data
+
+	// Call func for every record of seg, in the order a walk from the
+	// root reaches them, with the cursors of seg and its parents on it.
+	// The sidecar indexes and maps are built this way.
+	void walk(int seg, FOCWALK_FUNC func, void* arg);
+
+	// For sampling pages (see focsample.h): the pages a segment's lie
+	// among, and how many it has; the words of each of its instances,
+	// pointers included; and how many words of one of its pages hold
+	// instances
+	int  page_range(int seg, int& first, int& last);
+	int  instance_length(int seg);
+	int  page_used(int seg, int page);
+
+	// I/O and cache counters: the whole file, one segment, one index
+	void stats(FOCSTATS& total);
+	void segment_stats(int seg, FOCSTATS& s);
+	void index_stats(int idx, FOCSTATS& s);
+	void stats_reset(void);
+
+	// Latency of find(), match_index(), next() and page reads, for all
+	// FOCFILEs in the program. Page reads that hit the buffer are not
+	// timed. A percentile is the upper bound of its bucket, in ns.
+	static int  latency(FOCOP op, FOCHIST& h);
+	static long latency_percentile(FOCHIST& h, double percent);
+	static void latency_reset(void);
+
+	// Install a hook (NULL to remove it) that is called with a
+	// FOCTRACE_EVENT when each of those operations begins and ends
+	static int  trace(FOCTRACE_HOOK hook, void* arg);
+
+	// Write every page request of every FOCFILE to a page trace, until
+	// called again with NULL. You fclose() the trace file.
+	static void record_pages(FILE* trace);
+
 
 private:
 	void Parse_fdt(FILE *fh);
@@ -158,7 +404,11 @@ private:
 	void Parse_fdt_idx(FILE *fh, UCHAR *buffer);
 	void Parse_mfd(char *mfd_string);
 	int FDT_index_type(UCHAR *idx_fdt_entry);
+	int Preload_pages(int first, int last);
+	void Walk_path(int* path, int level, int depth, FOCWALK_FUNC func,
+		void* arg);
 private:
+	FILE		*foc_fh;
 	int		Num_segments;
 	int		Num_indices;
 	FOCSEG		*Root_segment; // For convenience
@@ -169,6 +419,9 @@ private:
 
 	// JOINs
 	FOCJOIN		*Join_list;	// Linked list of children joins
+
+	FOCSTATS	Stats;		// reads of the FDT, and preloads
+	FOCPOOL		Pool;		// preloaded pages
 };
 
 
@@ -195,14 +448,28 @@ public:
 	void	Add_child_pointer(FOCSEG* new_child);
 	void	set_segtype(char *segment_type);
 	int	Get_parent(void) { return parent_number; };
+	int	Get_keys(void) { return number_of_keys; };
+	int	Get_first_page(void) { return first_page; };
+	int	Get_last_page(void) { return last_page; };
+	int	Get_pointers(void) { return number_of_pointers; };
+	int	Get_length(void) { return segment_length; };
+	int	Get_pages(void) { return number_of_pages; };
 
 	int	next(void);
+	int	next_batch(UCHAR **data, int max);
 	void	reposition(void);
 	void	next_unique_children(void);
 	int	is_unique(void);
 	void	set_unique_children_array(void);
 
 	int	read_bytes(UCHAR *target, int offset, int length);
+	UCHAR*	record_data(void);
+	int	position(FOCPTR& where);
+	int	parent_of(FOCPTR& where, FOCPTR& parent);
+	void	set_readahead(int pages);
+	void	set_pool(FOCPOOL *pool);
+	UCHAR*	read_page(int page, FOCPAGE_STAMP *stamp);
+	int	page_used(int page);
 
 	void	cursor_set(FOCPTR &position, CURSOR_POS suggested_pos);
 	void	cursor_set_pos(CURSOR_POS position_type);
@@ -212,7 +479,9 @@ public:
 	void	join_segment_as_child(FOCJOIN* join);
 
 	int	reccount(int (*filter)(FOCFILE*), FOCFILE *foc);
+	int	reccount(FOCEXPR& where, FOCFILE *foc);
 	char*	Segment_name(void) { return segment_name; };
+	FOCSTATS* Get_stats(void) { return &Stats; };
 
 private:
 	void	cursor_rewind(void);
@@ -245,6 +514,9 @@ private:
 	int		number_of_children;	// Children segments
 
 	SEGTYPE		segtype;
+	int		number_of_keys;		// n in Sn or SHn
+
+	FOCSTATS	Stats;
 };
 
 
@@ -257,12 +529,36 @@ class FOCINDEX {
 
 public:
 	FOCINDEX(int idx_num, FILE* fh, UCHAR* fdt_entry);
-	~FOCINDEX();
+	virtual ~FOCINDEX();
 
 	int		index_in_use(void);
 	virtual void	initialize(char type, int seg) = 0;
 	virtual int	find(void *key, FOCPTR *position) = 0;
+
+	// Every record with a key, in the order the index keeps them:
+	// first() finds the first, next() each one after it, until it
+	// returns 0. walking() says if the last one found was where,
+	// for that key. With a length of 0 or more, key is a prefix of
+	// alpha keys.
+	virtual int	first(void *key, FOCPTR *position, int length=-1) = 0;
+	virtual int	next(FOCPTR *position) = 0;
+	virtual int	walking(void *key, FOCPTR& where, int length=-1) = 0;
+
+	// The keys alone, in order: seek() to the first not less than key
+	// (NULL for the first of all), then next_key() for each
+	virtual int	seek(void *key) = 0;
+	virtual int	next_key(UCHAR *key, long *records) = 0;
+
+	// Every record, with its key: ends() goes to the first, or to the
+	// last for a walk backwards, and step() gives each in turn
+	virtual int	ends(int backward) = 0;
+	virtual int	step(UCHAR *key, FOCPTR *position) = 0;
 	char*		Index_name(void) { return field_name; };
+	int		key_size(void) { return size_of_key; };
+	FOCSTATS*	Get_stats(void) { return &Stats; };
+	int		Get_first_page(void) { return first_page; };
+	int		Get_last_page(void) { return last_page; };
+	void		set_pool(FOCPOOL *pool) { Pool = pool; };
 
 protected:
 	int	my_id;
@@ -278,6 +574,9 @@ protected:
 	char		in_use;	// Has this index been initialized?
 	FOCINDEXCACHE	*Cache;
 	int		size_of_key;
+
+	FOCSTATS	Stats;
+	FOCPOOL		*Pool;	// for the nodes' pages
 };
 
 
@@ -296,10 +595,38 @@ public:
 
 	void	initialize(char type, int seg);
 	int	find(void *key, FOCPTR *position);
+	int	first(void *key, FOCPTR *position, int length=-1);
+	int	next(FOCPTR *position);
+	int	walking(void *key, FOCPTR& where, int length=-1);
+	int	seek(void *key);
+	int	next_key(UCHAR *key, long *records);
+	int	ends(int backward);
+	int	step(UCHAR *key, FOCPTR *position);
+
+private:
+	int	Walk_down(void *key, int length);
+	int	Walk_step(void);
+	int	Walk_settle(void);
+	int	Walk_down_last(void);
+	int	Walk_back(void);
+	int	Walk_settle_back(void);
+	int	Walk_result(FOCPTR *position);
 
 private:
 	FOCINDEX_BTREE_NODE	*Root_node;
 
+	// For first() and next(): the node of each level, and the node
+	// page and record the walk is at on each. Above the top level,
+	// the record is the one whose child the walk went down.
+	FOCINDEX_BTREE_NODE	**Level;
+	int			Levels;
+	int			*Walk_page;
+	int			*Walk_record;
+	int			Walk_top;	// -1 if not walking
+	UCHAR			*Walk_key;
+	int			Walk_length;	// of the key or prefix
+	int			Walk_backward;	// for step()
+	FOCPTR			*Walk_last;
 };
 
 /* Instead of allocating a structure per node, I'll
@@ -309,13 +636,25 @@ private:
 class FOCINDEX_BTREE_NODE {
 
 public:
-	FOCINDEX_BTREE_NODE(char key_type, int node_page, FILE *fh);
+	FOCINDEX_BTREE_NODE(char key_type, int node_page, FILE *fh,
+			FOCSTATS *stats, FOCPOOL *pool, int idx_num,
+			int level);
 	~FOCINDEX_BTREE_NODE();
 
 	int find(void *key, FOCPTR *result, int node_page=0);
 	int find_in_non_leaf(void *key, FOCPTR *result);
 	int find_in_leaf(void *key, FOCPTR *result);
 	int key_size(void) { return size_of_key; };
+
+	// For walking the tree in key order
+	int	records(int node_page);
+	int	leaf(int node_page);
+	UCHAR*	record(int node_page, int r);
+	int	child(int node_page, int r);
+	int	count_less(int node_page, int from, void *key,
+			int length=-1);
+	int	compare(void *key, UCHAR *b, int length=-1);
+	FOCINDEX_BTREE_NODE* children(void) { return Children_node_level; };
 	
 private:
 	void	read_node_page(int node_page);
@@ -418,7 +757,8 @@ private:
 class FOCPAGE {
 
 public:
-	FOCPAGE(FILE* fh);
+	FOCPAGE(FILE* fh, FOCSTATS* stats, char owner, int owner_id,
+		int level=0);
 	~FOCPAGE();
 
 	UCHAR*	Return_word_offset(int page, int word);
@@ -426,16 +766,35 @@ public:
 
 	void	Parse_page_pointer(int page, FOCPTR *result);
 	void	Parse_pointer_at_word(int page, int word, FOCPTR *result);
+	void	Get_stamp(int page, FOCPAGE_STAMP *stamp);
+
+	// Words used by instances, the last word instances may use, and
+	// the next page in the chain. Returns whose page it is.
+	int	Get_fill(int page, int *used, int *last_word, int *next_page);
+
+	void	Set_readahead(int pages) { Readahead = pages; };
+	void	Set_pool(FOCPOOL *pool) { Pool = pool; };
 
 private:
 	void	Read_page(int page);	// Loads page into buffer
 	void	Parse_control(void);	// Parses control info in buffer
+	void	Advise_next(void);	// Readahead along the page chain
 
 
 private:
 	UCHAR	*Page_buffer;		// buffer to store page data
 	int	Page_number_in_buffer;	// page currently in buffer
 	FILE*	foc_fh;
+	FOCSTATS *Stats;		// the owner's counters
+	FOCPOOL	*Pool;			// preloaded pages, or NULL
+	char	Owner;			// FOCPAGE_SEGMENT, etc.
+	int	Owner_id;
+	int	Level;			// of an index node
+
+	// Readahead window: pages already advised
+	int	Readahead;
+	int	Advised_first;
+	int	Advised_end;
 
 	// Page information for page in buffer
 	int	Next_page;
@@ -447,7 +806,7 @@ private:
 	UCHAR	Encryption_flag; 
 	UCHAR	Date[3];	// I don't know the format of Date
 	UCHAR	Time[4];	// or Time...
-	long	Transaction_number;
+	int32_t	Transaction_number;
 
 	// The members of the page's focus pointer
 	FOCPTR	*Page_pointer;
@@ -479,6 +838,32 @@ public:
 
 };
 
+// =============================================================
+// Extra functions, for the classes built on FOCFILE
+// =============================================================
+
+// Malloc or realloc, or die
+void*	xmalloc(const char *label, long bytes);
+void*	xrealloc(const char *label, void *memory, long bytes);
+
+// Compare two fields of the same type. Returns -1, 0, or 1.
+int	field_compare(char type, int length, UCHAR *a, UCHAR *b);
+
+// A numeric field as a double. Smart dates count days.
+double	field_value(char type, UCHAR *field);
+
+// A seeded random number, 31 bits of it, so that a sample or a sketch
+// can be taken again. The state is the seed to begin with.
+unsigned long	sample_random(uint64_t *state);
+
+// Take the pointer, treat it as a 4-byte int. FOCUS integers and
+// smartdates are 4 bytes, even where a long is 8.
+inline int32_t mkint32(UCHAR* ptr) {
+
+	int32_t i;
+	memcpy(&i, ptr, sizeof(int32_t));
+	return i;
+}
 
 #endif /* FOCFILE_H */
 
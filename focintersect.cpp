@@ -0,0 +1,281 @@
+/*
+    focintersect.cpp
+    ----------------
+    Lookups on several indexed fields at once for the FocFile C++
+    library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "focintersect.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+struct FOCINTERSECT_TERM {
+	int	idx;
+	char	type;
+	int	seg;
+	UCHAR	*key;
+};
+
+static int location_order(const void *a, const void *b);
+
+// =============================================================
+// CLASS: FOCINTERSECT
+// -------------------------------------------------------------
+// The records of a segment with a key in each of several indexes.
+// =============================================================
+FOCINTERSECT::FOCINTERSECT(FOCFILE* foc, int seg) {
+
+	if (seg <= 0 || seg > foc->number_seg()) {
+		die("INTERSECT called for non-existant segment %d\n", seg);
+	}
+
+	Foc		= foc;
+	Seg		= seg;
+	Term		= NULL;
+	Num_terms	= 0;
+	Found		= NULL;
+	Scratch		= NULL;
+	Allocated	= 0;
+	Postings_read	= 0;
+	clear();
+}
+
+FOCINTERSECT::~FOCINTERSECT() {
+
+	clear();
+	free(Found);
+	free(Scratch);
+}
+
+void FOCINTERSECT::clear(void) {
+
+	for (int i = 0; i < Num_terms; i++) {
+		free(Term[i].key);
+	}
+	free(Term);
+	Term = NULL;
+	Num_terms = 0;
+	Num_found = 0;
+	Gathered = 0;
+	Current = 0;
+}
+
+void FOCINTERSECT::key(int idx, char type, int seg, char* key) {
+
+	if (type != FIELDTYPE_ALPHA) {
+		die("INTERSECT::key type not Alpha: %c\n", type);
+	}
+	Add_term(idx, type, seg, key);
+}
+void FOCINTERSECT::key(int idx, char type, int seg, long& key) {
+	int32_t value = (int32_t) key;
+	Add_term(idx, type, seg, &value);
+}
+void FOCINTERSECT::key(int idx, char type, int seg, int32_t& key) {
+	Add_term(idx, type, seg, &key);
+}
+void FOCINTERSECT::key(int idx, char type, int seg, double& key) {
+	Add_term(idx, type, seg, &key);
+}
+void FOCINTERSECT::key(int idx, char type, int seg, float& key) {
+	Add_term(idx, type, seg, &key);
+}
+void FOCINTERSECT::key(int idx, char type, int seg, SMDATE& key) {
+	int32_t date = (int32_t) key.julian();
+	Add_term(idx, type, seg, &date);
+}
+
+void FOCINTERSECT::Add_term(int idx, char type, int seg, void* key) {
+
+	if (seg != Seg) {
+		die("INTERSECT::key index %d is on segment %d, not %d\n",
+			idx, seg, Seg);
+	}
+	if (idx <= 0 || idx > Foc->number_idx()) {
+		die("INTERSECT::key called for non-existant index %d\n", idx);
+	}
+
+	int size = Foc->index_key_size(idx, type, seg);
+
+	Term = (FOCINTERSECT_TERM*) xrealloc("FOCINTERSECT terms", Term,
+			sizeof(FOCINTERSECT_TERM) * (Num_terms + 1));
+	FOCINTERSECT_TERM *t = &Term[Num_terms++];
+	t->idx = idx;
+	t->type = type;
+	t->seg = seg;
+	t->key = (UCHAR*) xrealloc("FOCINTERSECT key", NULL, size);
+
+	// Alpha keys as FOCUS keeps them, padded with blanks
+	if (type == FIELDTYPE_ALPHA) {
+		int length = strlen((char*) key);
+		if (length > size) {
+			length = size;
+		}
+		memset(t->key, ' ', size);
+		memcpy(t->key, key, length);
+	}
+	else {
+		memcpy(t->key, key, size);
+	}
+
+	Gathered = 0;
+	Current = 0;
+}
+
+long FOCINTERSECT::count(void) {
+
+	if (!Gathered) {
+		Gather();
+	}
+	return Num_found;
+}
+
+int FOCINTERSECT::next(void) {
+
+	FOCPTR	where;
+
+	if (!Gathered) {
+		Gather();
+	}
+	if (Current >= Num_found) {
+		return 0;
+	}
+
+	where.type = 0;
+	where.page = Found[Current] >> 16;
+	where.word = Found[Current] & 0xffff;
+	Foc->set_position(Seg, where);
+	Current++;
+	return 1;
+}
+
+void FOCINTERSECT::rewind(void) {
+
+	Current = 0;
+}
+
+// Each index's records for its key come sorted by key, and equal keys
+// are usually kept in file order, so the lists are almost always in
+// order already and only need checking. The first list becomes the
+// result, and each of the others is merged into it, keeping what both
+// have. Once nothing is left, the rest of the indexes aren't read.
+void FOCINTERSECT::Gather(void) {
+
+	long	n, *swap;
+
+	Num_found = 0;
+	Current = 0;
+	Gathered = 1;
+
+	if (Num_terms == 0) {
+		return;
+	}
+
+	Num_found = Pull(&Term[0]);
+	swap = Found;
+	Found = Scratch;
+	Scratch = swap;
+
+	for (int i = 1; i < Num_terms && Num_found > 0; i++) {
+		n = Pull(&Term[i]);
+		Num_found = Merge(Found, Num_found, Scratch, n);
+	}
+
+	debug("INTERSECT::Gather %d terms, %ld records\n", Num_terms,
+		Num_found);
+}
+
+// The records with the term's key, sorted, into Scratch
+long FOCINTERSECT::Pull(FOCINTERSECT_TERM* term) {
+
+	FOCPTR	where;
+	long	n = 0, location;
+	int	sorted = 1;
+
+	int found = Foc->index_first(term->idx, term->type, term->seg,
+			term->key, where);
+	while (found) {
+		if (n == Allocated) {
+			Allocated = Allocated ? Allocated * 2 : 1024;
+			Found = (long*) xrealloc("FOCINTERSECT records",
+					Found, sizeof(long) * Allocated);
+			Scratch = (long*) xrealloc("FOCINTERSECT records",
+					Scratch, sizeof(long) * Allocated);
+		}
+		location = ((long) where.page << 16) | where.word;
+		if (n > 0 && location < Scratch[n - 1]) {
+			sorted = 0;
+		}
+		Scratch[n++] = location;
+
+		found = Foc->index_next(term->idx, where);
+	}
+	Postings_read += n;
+
+	if (!sorted) {
+		qsort(Scratch, n, sizeof(long), location_order);
+	}
+	return n;
+}
+
+// Keeps in a what's also in b. Both are sorted.
+long FOCINTERSECT::Merge(long* a, long na, long* b, long nb) {
+
+	long	i = 0, j = 0, n = 0;
+
+	while (i < na && j < nb) {
+		if (a[i] < b[j]) {
+			i++;
+		}
+		else if (a[i] > b[j]) {
+			j++;
+		}
+		else {
+			a[n++] = a[i];
+			i++;
+			j++;
+		}
+	}
+	return n;
+}
+
+// =============================================================
+// Extra functions
+// =============================================================
+
+int location_order(const void *a, const void *b) {
+
+	long x = *(const long*) a, y = *(const long*) b;
+	return (x > y) - (x < y);
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
@@ -0,0 +1,105 @@
+/*
+    focintersect.h
+    --------------
+    Lookups on several indexed fields at once for the FocFile C++
+    library. A FOCINTERSECT pulls the records with a key from each of
+    two or more B-tree indexes on the same segment, keeps those that
+    every index gave, and visits only them.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCINTERSECT_H
+#define FOCINTERSECT_H
+
+#ifndef FOCFILE_H
+#include "focfile.h"
+#endif /* FOCFILE_H */
+
+struct FOCINTERSECT_TERM;
+
+// Each key() adds an index and the key to look for in it:
+//
+//	FOCINTERSECT both(foc, FOCSEG_ORDERS_ORDERS);
+//	both.key(FOCIDX_ORDERS_QTY, qty);
+//	both.key(FOCIDX_ORDERS_ORDER_DATE, date);
+//	while (both.next()) {
+//		foc->hold(...);
+//	}
+//
+// The records come in page order. Alpha keys are padded with blanks to
+// the key's length. The walks share the indexes with match_postings(),
+// so don't use that on the same indexes while the records are gathered
+// (on the first next() or count()).
+class FOCINTERSECT {
+
+public:
+	FOCINTERSECT(FOCFILE* foc, int seg);
+	~FOCINTERSECT();
+
+	void	key(int idx, char type, int seg, char* key);
+	void	key(int idx, char type, int seg, long& key);
+	void	key(int idx, char type, int seg, int32_t& key);
+	void	key(int idx, char type, int seg, double& key);
+	void	key(int idx, char type, int seg, float& key);
+	void	key(int idx, char type, int seg, SMDATE& key);
+
+	// How many records have every key
+	long	count(void);
+
+	// Move the segment's cursor to the next record with every key, as
+	// match_index() does. Returns 1, or 0 after the last.
+	int	next(void);
+
+	// Start over from the first record; clear() forgets the keys too
+	void	rewind(void);
+	void	clear(void);
+
+	// The postings read from all the indexes
+	long	postings_read(void) { return Postings_read; };
+
+private:
+	void	Add_term(int idx, char type, int seg, void* key);
+	void	Gather(void);
+	long	Pull(FOCINTERSECT_TERM* term);
+	long	Merge(long* a, long na, long* b, long nb);
+
+private:
+	FOCFILE			*Foc;
+	int			Seg;
+
+	FOCINTERSECT_TERM	*Term;
+	int			Num_terms;
+
+	// The records with every key, as page << 16 | word, in order
+	long			*Found;
+	long			Num_found;
+	int			Gathered;
+	long			Current;
+
+	long			*Scratch;
+	long			Allocated;
+	long			Postings_read;
+};
+
+#endif /* FOCINTERSECT_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
@@ -0,0 +1,227 @@
+/*
+    fockeys.cpp
+    -----------
+    Index-only queries for the FocFile C++ library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fockeys.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+#define KEYS_START	0	// nothing read yet
+#define KEYS_WALKING	1
+#define KEYS_DONE	2
+
+// =============================================================
+// CLASS: FOCKEYS
+// -------------------------------------------------------------
+// The keys of a B-tree index, read from its pages alone.
+// =============================================================
+FOCKEYS::FOCKEYS(FOCFILE* foc, int idx, char type, int seg) {
+
+	if (idx <= 0 || idx > foc->number_idx()) {
+		die("KEYS called for non-existant index %d\n", idx);
+	}
+
+	Foc		= foc;
+	Idx		= idx;
+	Type		= type;
+	Seg		= seg;
+	Key_size	= foc->index_key_size(idx, type, seg);
+
+	Key		= (UCHAR*) xmalloc("FOCKEYS key", Key_size);
+	From		= (UCHAR*) xmalloc("FOCKEYS from", Key_size);
+	To		= (UCHAR*) xmalloc("FOCKEYS to", Key_size);
+	memset(Key, 0, Key_size);
+	Records		= 0;
+	Has_from	= 0;
+	Has_to		= 0;
+	State		= KEYS_START;
+}
+
+FOCKEYS::~FOCKEYS() {
+
+	free(Key);
+	free(From);
+	free(To);
+}
+
+void FOCKEYS::from(char* key)		{ Limit(From, &Has_from, key, 0); }
+void FOCKEYS::from(int32_t& key)	{ Limit(From, &Has_from, &key,
+						FIELDTYPE_INTEGER); }
+void FOCKEYS::from(double& key)		{ Limit(From, &Has_from, &key,
+						FIELDTYPE_DOUBLE); }
+void FOCKEYS::from(float& key)		{ Limit(From, &Has_from, &key,
+						FIELDTYPE_FLOAT); }
+void FOCKEYS::from(long& key) {
+	int32_t value = (int32_t) key;
+	Limit(From, &Has_from, &value, FIELDTYPE_INTEGER);
+}
+void FOCKEYS::from(SMDATE& key) {
+	int32_t date = (int32_t) key.julian();
+	Limit(From, &Has_from, &date, FIELDTYPE_SMDATE);
+}
+
+void FOCKEYS::to(char* key)		{ Limit(To, &Has_to, key, 0); }
+void FOCKEYS::to(int32_t& key)		{ Limit(To, &Has_to, &key,
+						FIELDTYPE_INTEGER); }
+void FOCKEYS::to(double& key)		{ Limit(To, &Has_to, &key,
+						FIELDTYPE_DOUBLE); }
+void FOCKEYS::to(float& key)		{ Limit(To, &Has_to, &key,
+						FIELDTYPE_FLOAT); }
+void FOCKEYS::to(long& key) {
+	int32_t value = (int32_t) key;
+	Limit(To, &Has_to, &value, FIELDTYPE_INTEGER);
+}
+void FOCKEYS::to(SMDATE& key) {
+	int32_t date = (int32_t) key.julian();
+	Limit(To, &Has_to, &date, FIELDTYPE_SMDATE);
+}
+
+// Copy a limit in the index's own form. Type 0 is a C string, for an
+// alpha index; it is padded with blanks, or cut, to the key's length.
+void FOCKEYS::Limit(UCHAR* limit, int* has, void* key, char type) {
+
+	if (type == 0) {
+		Check_type(FIELDTYPE_ALPHA, "limit");
+
+		int length = strlen((char*) key);
+		if (length > Key_size) {
+			length = Key_size;
+		}
+		memset(limit, ' ', Key_size);
+		memcpy(limit, key, length);
+	}
+	else {
+		Check_type(type, "limit");
+		memcpy(limit, key, Key_size);
+	}
+
+	*has = 1;
+	rewind();
+}
+
+void FOCKEYS::Check_type(char type, const char* what) {
+
+	if (type != Type) {
+		die("KEYS: %s of type %c for index %d of type %c\n", what,
+			type, Idx, Type);
+	}
+}
+
+void FOCKEYS::rewind(void) {
+
+	State = KEYS_START;
+	Records = 0;
+}
+
+int FOCKEYS::next(void) {
+
+	if (State == KEYS_DONE) {
+		return 0;
+	}
+
+	if (State == KEYS_START) {
+		Foc->index_seek(Idx, Type, Seg, Has_from ? From : NULL);
+		State = KEYS_WALKING;
+	}
+
+	if (!Foc->index_next_key(Idx, Key, Records) ||
+		(Has_to && field_compare(Type, Key_size, Key, To) > 0)) {
+		State = KEYS_DONE;
+		Records = 0;
+		return 0;
+	}
+
+	debug("KEYS::next key has %ld records\n", Records);
+	return 1;
+}
+
+long FOCKEYS::distinct(long* records) {
+
+	long	keys = 0, total = 0;
+
+	rewind();
+	while (next()) {
+		keys++;
+		total += Records;
+	}
+
+	if (records) {
+		*records = total;
+	}
+	return keys;
+}
+
+void FOCKEYS::hold(char* s) {
+
+	int	length = Key_size;
+
+	Check_type(FIELDTYPE_ALPHA, "hold");
+	while (length > 0 && Key[length - 1] == ' ') {
+		length--;
+	}
+	memcpy(s, Key, length);
+	s[length] = 0;
+}
+
+void FOCKEYS::hold(long& l) {
+
+	Check_type(FIELDTYPE_INTEGER, "hold");
+	l = mkint32(Key);
+}
+
+void FOCKEYS::hold(int32_t& i) {
+
+	Check_type(FIELDTYPE_INTEGER, "hold");
+	i = mkint32(Key);
+}
+
+void FOCKEYS::hold(double& d) {
+
+	Check_type(FIELDTYPE_DOUBLE, "hold");
+	memcpy(&d, Key, sizeof(double));
+}
+
+void FOCKEYS::hold(float& f) {
+
+	Check_type(FIELDTYPE_FLOAT, "hold");
+	memcpy(&f, Key, sizeof(float));
+}
+
+void FOCKEYS::hold(SMDATE& smd) {
+
+	Check_type(FIELDTYPE_SMDATE, "hold");
+	smd.set_julian(mkint32(Key), SMDATE_FOCUS);
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
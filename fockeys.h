@@ -0,0 +1,121 @@
+/*
+    fockeys.h
+    ---------
+    Index-only queries for the FocFile C++ library. A FOCKEYS walks the
+    keys of a B-tree index in order, with how many records have each,
+    from the index pages alone: key listings, key ranges, distinct
+    counts and histograms, without reading a data page.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCKEYS_H
+#define FOCKEYS_H
+
+#ifndef FOCFILE_H
+#include "focfile.h"
+#endif /* FOCFILE_H */
+
+// Each next() goes to the next distinct key; records() says how many
+// records have it, so the keys and their counts are the histogram:
+//
+//	FOCKEYS names(foc, FOCIDX_ORDERS_CUST_NAME);
+//	names.from("SMITH");
+//	names.to("SMYTH");
+//	while (names.next()) {
+//		names.hold(name);
+//		printf("%s %ld\n", name, names.records());
+//	}
+//
+// Alpha limits are padded with blanks, as FOCUS pads keys. Both limits
+// are inclusive. No cursor moves, but the walk shares the index with
+// match_postings() and match_prefix(), so don't use those on the same
+// index of the same FOCFILE while a FOCKEYS is walking it.
+class FOCKEYS {
+
+public:
+	FOCKEYS(FOCFILE* foc, int idx, char type, int seg);
+	~FOCKEYS();
+
+	// The first and last keys to walk; without them, all of them
+	void	from(char* key);
+	void	from(long& key);
+	void	from(int32_t& key);
+	void	from(double& key);
+	void	from(float& key);
+	void	from(SMDATE& key);
+
+	void	to(char* key);
+	void	to(long& key);
+	void	to(int32_t& key);
+	void	to(double& key);
+	void	to(float& key);
+	void	to(SMDATE& key);
+
+	// Go to the next key. Returns 1, or 0 after the last.
+	int	next(void);
+
+	// Start over from the first key
+	void	rewind(void);
+
+	// The current key, and how many records have it. Alpha keys are
+	// NUL-terminated with trailing blanks removed, so the string needs
+	// the key's length + 1 bytes.
+	long	records(void) { return Records; };
+	UCHAR*	key(void) { return Key; };
+	void	hold(char* s);
+	void	hold(long& l);
+	void	hold(int32_t& i);
+	void	hold(double& d);
+	void	hold(float& f);
+	void	hold(SMDATE& smd);
+
+	// Starts over, and counts the keys between the limits, and the
+	// records with them if asked. Leaves the walk after the last key.
+	long	distinct(long* records=NULL);
+
+	int	key_size(void) { return Key_size; };
+
+private:
+	void	Limit(UCHAR* limit, int* has, void* key, char type);
+	void	Check_type(char type, const char* what);
+
+private:
+	FOCFILE	*Foc;
+	int	Idx;
+	char	Type;
+	int	Seg;
+	int	Key_size;
+
+	UCHAR	*Key;
+	long	Records;
+
+	UCHAR	*From;
+	UCHAR	*To;
+	int	Has_from;
+	int	Has_to;
+
+	int	State;
+};
+
+#endif /* FOCKEYS_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
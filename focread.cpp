@@ -0,0 +1,421 @@
+/*
+    focread.cpp
+    -----------
+    Batched page reads for the FocFile C++ library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "focread.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+#define HAS_IO_URING		// Linux 5.1 or later
+#define RUN_PAGES	256	// most pages in one read (1MB)
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+#ifdef HAS_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif /* HAS_IO_URING */
+
+#define PAGE_SIZE	4096	// on disk
+#define PAGE_DATA	4000	// what FocFile reads of each
+
+// =============================================================
+// CLASS: FOCREADER
+// -------------------------------------------------------------
+// Reads a queue of pages into their frames, as many at a time
+// as the system allows.
+// =============================================================
+FOCREADER::FOCREADER(FILE* fh, int depth) {
+
+	Fd		= fileno(fh);
+	Depth		= depth;
+	Read_calls	= 0;
+
+	Page		= NULL;
+	Frame		= NULL;
+	Queued		= 0;
+	Allocated	= 0;
+
+	Ring_fd		= -1;
+	Entries		= 0;
+
+	Iovecs		= NULL;
+	Run_first	= NULL;
+	Run_pages	= NULL;
+	Run_iov		= NULL;
+	Run_done	= NULL;
+	Run_retry	= NULL;
+	Runs		= 0;
+
+	if (depth > 1 && !Ring_setup(depth)) {
+		debug("READER: no io_uring, using pread()\n");
+	}
+}
+
+FOCREADER::~FOCREADER() {
+
+	Ring_close();
+	free(Page);
+	free(Frame);
+	free(Iovecs);
+	free(Run_first);
+	free(Run_pages);
+	free(Run_iov);
+	free(Run_done);
+	free(Run_retry);
+}
+
+void FOCREADER::add(int page, UCHAR* frame) {
+
+	if (page <= 0) {
+		die("READER: bad page %d\n", page);
+	}
+
+	if (Queued == Allocated) {
+		Allocated = Allocated ? Allocated * 2 : 256;
+		Page = (int*) xrealloc("READER pages", Page,
+				sizeof(int) * Allocated);
+		Frame = (UCHAR**) xrealloc("READER frames", Frame,
+				sizeof(UCHAR*) * Allocated);
+		Iovecs = xrealloc("READER iovecs", Iovecs,
+				sizeof(struct iovec) * 2 * Allocated);
+		Run_first = (int*) xrealloc("READER runs", Run_first,
+				sizeof(int) * Allocated);
+		Run_pages = (int*) xrealloc("READER runs", Run_pages,
+				sizeof(int) * Allocated);
+		Run_iov = (int*) xrealloc("READER runs", Run_iov,
+				sizeof(int) * Allocated);
+		Run_done = (int*) xrealloc("READER runs", Run_done,
+				sizeof(int) * Allocated);
+		Run_retry = (int*) xrealloc("READER runs", Run_retry,
+				sizeof(int) * Allocated);
+	}
+
+	Page[Queued]	= page;
+	Frame[Queued]	= frame;
+	Queued++;
+}
+
+// Read everything in the queue. Returns the number of pages read.
+int FOCREADER::flush(void) {
+
+	int	pages = Queued;
+
+	if (Queued == 0) {
+		return 0;
+	}
+
+	Plan_runs();
+	if (Ring_fd >= 0) {
+		Flush_ring();
+	}
+	else {
+		Flush_preadv();
+	}
+
+	Queued = 0;
+	return pages;
+}
+
+// Split the queue into runs of pages that follow one another in the
+// file. Each page of a run gets two iovecs, its frame and the scratch
+// buffer; the last page of a run doesn't need the scratch one, so a run
+// of n pages is read with 2n - 1 iovecs starting at Iovecs[2 * first].
+void FOCREADER::Plan_runs(void) {
+
+	struct iovec	*iov = (struct iovec*) Iovecs;
+
+	Runs = 0;
+	for (int i = 0; i < Queued; i++) {
+		iov[2 * i].iov_base	= Frame[i];
+		iov[2 * i].iov_len	= PAGE_DATA;
+		iov[2 * i + 1].iov_base	= Scratch;
+		iov[2 * i + 1].iov_len	= PAGE_SIZE - PAGE_DATA;
+
+		if (Runs > 0 && Page[i] == Page[i - 1] + 1 &&
+				Run_pages[Runs - 1] < RUN_PAGES) {
+			Run_pages[Runs - 1]++;
+		}
+		else {
+			Run_first[Runs] = i;
+			Run_pages[Runs] = 1;
+			Run_iov[Runs] = 2 * i;
+			Run_done[Runs] = 0;
+			Runs++;
+		}
+	}
+
+	debug("READER: %d pages in %d runs\n", Queued, Runs);
+}
+
+// The iovecs of a run still to be read into, and where in the file the
+// rest of it starts
+int FOCREADER::Run_iovecs(int r) {
+
+	return 2 * (Run_first[r] + Run_pages[r]) - 1 - Run_iov[r];
+}
+
+off_t FOCREADER::Run_offset(int r) {
+
+	return (off_t) (Page[Run_first[r]] - 1) * PAGE_SIZE + Run_done[r];
+}
+
+// A read of a run brought in bytes more of it. Step its iovecs past
+// them, trimming the one it stopped in. Returns 1 once the run is whole.
+int FOCREADER::Advance_run(int r, int bytes) {
+
+	struct iovec	*iov = (struct iovec*) Iovecs;
+	struct iovec	*v;
+
+	Run_done[r] += bytes;
+	while (bytes > 0) {
+		v = &iov[Run_iov[r]];
+		if ((size_t) bytes < v->iov_len) {
+			v->iov_base = (char*) v->iov_base + bytes;
+			v->iov_len -= bytes;
+			break;
+		}
+		bytes -= v->iov_len;
+		Run_iov[r]++;
+	}
+
+	if (Run_done[r] < Run_bytes(r)) {
+		debug("READER: short read, %d of %d bytes from page %d\n",
+			Run_done[r], Run_bytes(r), Page[Run_first[r]]);
+		return 0;
+	}
+	return 1;
+}
+
+void FOCREADER::Flush_preadv(void) {
+
+	struct iovec	*iov = (struct iovec*) Iovecs;
+	ssize_t		bytes;
+
+	for (int r = 0; r < Runs; r++) {
+		do {
+			bytes = preadv(Fd, &iov[Run_iov[r]], Run_iovecs(r),
+					Run_offset(r));
+			Read_calls++;
+			if (bytes < 0 && errno == EINTR) {
+				bytes = 0;
+				continue;
+			}
+			if (bytes <= 0) {
+				die("READER: preadv from page %d stopped at "
+					"%d of %d bytes: %s\n",
+					Page[Run_first[r]], Run_done[r],
+					Run_bytes(r), bytes < 0 ?
+					strerror(errno) : "end of file");
+			}
+		} while (!Advance_run(r, (int) bytes));
+	}
+}
+
+#ifdef HAS_IO_URING
+
+// Keep the ring full: submit as many runs as there are free entries,
+// wait for at least one to finish, reap whatever has finished, repeat.
+// A run that comes back short goes in again for the rest.
+void FOCREADER::Flush_ring(void) {
+
+	struct io_uring_sqe	*sqes = (struct io_uring_sqe*) Sqes;
+	struct io_uring_cqe	*cqes = (struct io_uring_cqe*) Cqes;
+	struct iovec		*iov = (struct iovec*) Iovecs;
+	int			next = 0, done = 0, in_flight = 0, retries = 0;
+	int			ret, r;
+	unsigned		tail, head, index, pending;
+
+	while (done < Runs) {
+		tail = *Sq_tail;
+		while ((retries > 0 || next < Runs) && in_flight < Entries) {
+			index = tail & *Sq_mask;
+			r = retries > 0 ? Run_retry[--retries] : next++;
+
+			struct io_uring_sqe *sqe = &sqes[index];
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode	= IORING_OP_READV;
+			sqe->fd		= Fd;
+			sqe->addr	= (unsigned long) &iov[Run_iov[r]];
+			sqe->len	= Run_iovecs(r);
+			sqe->off	= Run_offset(r);
+			sqe->user_data	= r;
+
+			Sq_array[index] = index;
+			tail++;
+			in_flight++;
+		}
+		__atomic_store_n(Sq_tail, tail, __ATOMIC_RELEASE);
+
+		// Submit every entry the kernel hasn't taken yet, not only
+		// those queued just now: an interrupted or short submit
+		// leaves some behind, and nothing would wait for them
+		pending = tail - __atomic_load_n(Sq_head, __ATOMIC_ACQUIRE);
+		ret = syscall(__NR_io_uring_enter, Ring_fd, pending, 1,
+				IORING_ENTER_GETEVENTS, NULL, 0);
+		Read_calls++;
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			die("READER: io_uring_enter failed: %s\n",
+				strerror(errno));
+		}
+		debug("READER: submitted %d of %u entries\n", ret, pending);
+
+		head = *Cq_head;
+		tail = __atomic_load_n(Cq_tail, __ATOMIC_ACQUIRE);
+		while (head != tail) {
+			struct io_uring_cqe *cqe = &cqes[head & *Cq_mask];
+			int res = cqe->res;
+
+			r = (int) cqe->user_data;
+			head++;
+			in_flight--;
+
+			if (res == -EINTR || res == -EAGAIN) {
+				res = 0;
+			}
+			else if (res <= 0) {
+				die("READER: read from page %d stopped at %d "
+					"of %d bytes: %s\n", Page[Run_first[r]],
+					Run_done[r], Run_bytes(r), res < 0 ?
+					strerror(-res) : "end of file");
+			}
+			if (Advance_run(r, res)) {
+				done++;
+			}
+			else {
+				Run_retry[retries++] = r;
+			}
+		}
+		__atomic_store_n(Cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	debug("READER: %d runs through io_uring\n", Runs);
+}
+
+// Returns 1 if the ring is ready, 0 if the system won't give us one
+int FOCREADER::Ring_setup(int entries) {
+
+	struct io_uring_params	p;
+	char			*sq, *cq;
+	int			single;
+
+	memset(&p, 0, sizeof(p));
+	Ring_fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (Ring_fd < 0) {
+		Ring_fd = -1;
+		return 0;
+	}
+
+	Entries		= p.sq_entries;
+	Sq_ring_size	= p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	Cq_ring_size	= p.cq_off.cqes + p.cq_entries
+				* sizeof(struct io_uring_cqe);
+	Sqes_size	= p.sq_entries * sizeof(struct io_uring_sqe);
+
+	single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single && Cq_ring_size > Sq_ring_size) {
+		Sq_ring_size = Cq_ring_size;
+	}
+
+	Sq_ring = mmap(NULL, Sq_ring_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, Ring_fd, IORING_OFF_SQ_RING);
+	Cq_ring = single ? Sq_ring : mmap(NULL, Cq_ring_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			Ring_fd, IORING_OFF_CQ_RING);
+	Sqes = mmap(NULL, Sqes_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, Ring_fd, IORING_OFF_SQES);
+
+	if (Sq_ring == MAP_FAILED || Cq_ring == MAP_FAILED ||
+			Sqes == MAP_FAILED) {
+		if (Sq_ring == MAP_FAILED) Sq_ring = NULL;
+		if (Cq_ring == MAP_FAILED) Cq_ring = NULL;
+		if (Sqes == MAP_FAILED) Sqes = NULL;
+		Ring_close();
+		return 0;
+	}
+
+	sq = (char*) Sq_ring;
+	cq = (char*) Cq_ring;
+	Sq_head		= (unsigned*) (sq + p.sq_off.head);
+	Sq_tail		= (unsigned*) (sq + p.sq_off.tail);
+	Sq_mask		= (unsigned*) (sq + p.sq_off.ring_mask);
+	Sq_array	= (unsigned*) (sq + p.sq_off.array);
+	Cq_head		= (unsigned*) (cq + p.cq_off.head);
+	Cq_tail		= (unsigned*) (cq + p.cq_off.tail);
+	Cq_mask		= (unsigned*) (cq + p.cq_off.ring_mask);
+	Cqes		= cq + p.cq_off.cqes;
+
+	debug("READER: io_uring with %d entries\n", Entries);
+	return 1;
+}
+
+void FOCREADER::Ring_close(void) {
+
+	if (Ring_fd < 0) {
+		return;
+	}
+
+	if (Sqes) {
+		munmap(Sqes, Sqes_size);
+	}
+	if (Cq_ring && Cq_ring != Sq_ring) {
+		munmap(Cq_ring, Cq_ring_size);
+	}
+	if (Sq_ring) {
+		munmap(Sq_ring, Sq_ring_size);
+	}
+	close(Ring_fd);
+	Ring_fd = -1;
+}
+
+#else /* not HAS_IO_URING */
+
+void FOCREADER::Flush_ring(void) {
+	Flush_preadv();
+}
+
+int FOCREADER::Ring_setup(int entries) {
+	return 0;
+}
+
+void FOCREADER::Ring_close(void) {
+}
+
+#endif /* HAS_IO_URING */
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
@@ -0,0 +1,110 @@
+/*
+    focread.h
+    ---------
+    Batched page reads for the FocFile C++ library. A FOCREADER reads
+    runs of pages that follow one another in the file with one vectored
+    read each, keeping many in flight at once with io_uring where the
+    system has it, and making one preadv() at a time where it doesn't.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCREAD_H
+#define FOCREAD_H
+
+#ifndef FOCFILE_H
+#include "focfile.h"
+#endif /* FOCFILE_H */
+
+// Queue up pages, each with a 4000-byte frame to land in, then flush():
+//
+//	FOCREADER reader(fh);
+//	for (page = first; page <= last; page++) {
+//		reader.add(page, frame[page - first]);
+//	}
+//	reader.flush();
+//
+// flush() returns when every queued page is in its frame. A read that
+// stops short is taken up where it stopped; flush() dies if one fails or
+// the file ends before a page does. Pages queued one after the other that also
+// follow one another in the file are read together, up to 1MB at a
+// time, with each page's 96 unused bytes read into a scratch buffer.
+// Depth is how many reads may be in flight; a depth of 1 or less, or a
+// system without io_uring, makes one preadv() at a time.
+class FOCREADER {
+
+public:
+	FOCREADER(FILE* fh, int depth=64);
+	~FOCREADER();
+
+	void	add(int page, UCHAR* frame);
+	int	flush(void);
+
+	int	uses_io_uring(void) { return Ring_fd >= 0; };
+
+	// System calls made so far: preadv()s or io_uring_enter()s
+	long	read_calls(void) { return Read_calls; };
+
+private:
+	void	Plan_runs(void);
+	int	Run_bytes(int r) { return Run_pages[r] * 4096 - 96; };
+	int	Run_iovecs(int r);
+	off_t	Run_offset(int r);
+	int	Advance_run(int r, int bytes);
+	void	Flush_preadv(void);
+	void	Flush_ring(void);
+	int	Ring_setup(int entries);
+	void	Ring_close(void);
+
+private:
+	int	Fd;
+	int	Depth;
+	long	Read_calls;
+
+	// The queue
+	int	*Page;
+	UCHAR	**Frame;
+	int	Queued;
+	int	Allocated;
+
+	// io_uring, or Ring_fd < 0
+	int	Ring_fd;
+	void	*Sq_ring, *Cq_ring, *Sqes;
+	size_t	Sq_ring_size, Cq_ring_size, Sqes_size;
+	unsigned *Sq_head, *Sq_tail, *Sq_mask, *Sq_array;
+	unsigned *Cq_head, *Cq_tail, *Cq_mask;
+	void	*Cqes;
+	int	Entries;
+
+	// Runs of pages that are read together
+	void	*Iovecs;		// two per queued page
+	int	*Run_first;		// index of its first page in the queue
+	int	*Run_pages;
+	int	*Run_iov;		// its first iovec not yet read into
+	int	*Run_done;		// bytes read so far
+	int	*Run_retry;		// runs to submit again, for the ring
+	int	Runs;
+	UCHAR	Scratch[96];		// where the unused bytes go
+};
+
+#endif /* FOCREAD_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
@@ -0,0 +1,832 @@
+/*
+    focreplay
+    ---------
+    Replays a page trace written by FOCFILE::record_pages() against
+    simulated buffer pools, to find the cache size, replacement policy,
+    and readahead that suit a workload.
+
+    *********************************************************
+    This library is in no way related to or supported by IBI.
+    IBI's FOCUS is a proprietary database whose format may
+    change at any time. If you have any problems, suggestions,
+    or comments about the FocFile C++ library, contact
+    the author, not Information Builders!
+    *********************************************************
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+/*
+   focreplay [-s sizes] [-p policies] [-r readaheads] [-l levels] trace
+
+   -s	Pool sizes in pages, separated by commas (default 16,64,256,1024)
+   -p	Replacement policies (default lru,clock,arc,pin):
+	lru	least recently used
+	clock	second chance
+	arc	adaptive replacement cache (Megiddo and Modha)
+	pin	the top index levels stay in memory; LRU for the rest
+   -r	Readahead depths (default 0). On a miss for page p, pages
+	p+1 ... p+depth of the same file are read too.
+   -l	Index levels kept by the pin policy (default 2). They may
+	take up to half the pool.
+
+   The pool is shared by every segment and index of every file in the
+   trace. The first line describes the trace; "recorded_misses" is what
+   FocFile itself read, with its one buffer per segment and index level.
+   Then there is one line per simulation:
+
+	policy=lru size=64 readahead=0 accesses=1040000 hits=1035342
+	misses=4658 hit_ratio=0.995521 disk_reads=4658 prefetched=0
+	prefetch_used=0
+
+   disk_reads are the misses plus the pages read ahead.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "focfile.h"
+
+#define die(format, args...) { \
+	fprintf(stderr, "focreplay: " format, ## args); \
+	exit(-1); \
+	}
+
+#define MAX_PAGE	32768		// pages per file, see mkfoc.cpp
+#define MAX_LIST	32
+
+// A simulated buffer pool. Keys are page numbers, offset by the file.
+class REPLAY_CACHE {
+
+public:
+	virtual ~REPLAY_CACHE() {};
+
+	// Ask for a page. Returns 1 on a hit; a miss loads the page.
+	// Pin asks to keep the page for good, if the policy can.
+	virtual int	access(int key, int pin) = 0;
+	virtual int	contains(int key) = 0;
+
+	// Load a page that nobody asked for yet
+	virtual void	prefetch(int key) = 0;
+};
+
+// -------------------------------------------------------------
+// LRU. A doubly linked list through arrays indexed by key; the
+// head is the most recently used.
+// -------------------------------------------------------------
+class LRU_CACHE : public REPLAY_CACHE {
+
+public:
+	LRU_CACHE(int capacity, int keys);
+	~LRU_CACHE();
+
+	int	access(int key, int pin);
+	int	contains(int key) { return In[key]; };
+	void	prefetch(int key);
+	void	remove(int key);
+	void	set_capacity(int capacity);
+
+private:
+	void	Push_front(int key);
+	void	Unlink(int key);
+	void	Fit(int room);
+
+private:
+	int	Capacity;
+	int	Count;
+	int	Head, Tail;
+	int	*Prev, *Next;
+	char	*In;
+};
+
+// -------------------------------------------------------------
+// CLOCK: one reference bit per slot, and a hand that clears the
+// bits until it finds a page that wasn't used since its last pass.
+// -------------------------------------------------------------
+class CLOCK_CACHE : public REPLAY_CACHE {
+
+public:
+	CLOCK_CACHE(int capacity, int keys);
+	~CLOCK_CACHE();
+
+	int	access(int key, int pin);
+	int	contains(int key) { return Where[key] >= 0; };
+	void	prefetch(int key);
+
+private:
+	void	Load(int key, int referenced);
+
+private:
+	int	Capacity;
+	int	Used;
+	int	Hand;
+	int	*Slot_key;
+	char	*Referenced;
+	int	*Where;		// slot of each key, or -1
+};
+
+// -------------------------------------------------------------
+// ARC: T1 holds pages seen once lately, T2 pages seen at least
+// twice; B1 and B2 remember what was evicted from each, and hits
+// there move the target size P of T1.
+// -------------------------------------------------------------
+#define ARC_NONE	0
+#define ARC_T1		1
+#define ARC_T2		2
+#define ARC_B1		3
+#define ARC_B2		4
+
+class ARC_CACHE : public REPLAY_CACHE {
+
+public:
+	ARC_CACHE(int capacity, int keys);
+	~ARC_CACHE();
+
+	int	access(int key, int pin);
+	int	contains(int key);
+	void	prefetch(int key);
+
+private:
+	void	Replace(int in_b2);
+	void	Insert_new(int key);
+	void	Push_front(int list, int key);
+	void	Unlink(int key);
+	int	Pop_back(int list);
+
+private:
+	int	C;
+	double	P;
+	int	Head[5], Tail[5], Size[5];
+	int	*Prev, *Next;
+	char	*List;		// ARC_NONE, ARC_T1, ...
+};
+
+// -------------------------------------------------------------
+// Pinned index levels: pages asked for with pin set stay for good
+// and take their room from an LRU pool. At most half the pool is
+// pinned; after that, pinned levels are cached like any other page.
+// -------------------------------------------------------------
+class PIN_CACHE : public REPLAY_CACHE {
+
+public:
+	PIN_CACHE(int capacity, int keys);
+	~PIN_CACHE();
+
+	int	access(int key, int pin);
+	int	contains(int key) { return Pinned[key] || Lru->contains(key); };
+	void	prefetch(int key);
+
+private:
+	int		Capacity;
+	int		Number_pinned;
+	char		*Pinned;
+	LRU_CACHE	*Lru;
+};
+
+static FOCPAGE_TRACE_RECORD	*Trace;
+static long			Trace_length;
+static int			File_of[256];	// fileno -> 0, 1, ...
+static int			Number_of_files;
+static int			Pin_levels = 2;
+
+void read_trace(char *name);
+int parse_list(char *s, int *list, const char *what);
+void describe_trace(void);
+void replay(const char *policy, int size, int readahead);
+void* xmalloc(const char *label, long bytes);
+
+int main(int argc, char **argv) {
+
+	char	policy_list[256] = "lru,clock,arc,pin";
+	int	sizes[MAX_LIST] = { 16, 64, 256, 1024 };
+	int	readaheads[MAX_LIST] = { 0 };
+	int	number_of_sizes = 4, number_of_readaheads = 1;
+	char	*policies[MAX_LIST];
+	int	number_of_policies = 0;
+	int	c, i, j, k;
+
+	while ((c = getopt(argc, argv, "s:p:r:l:")) != EOF) {
+		switch (c) {
+			case 's':
+				number_of_sizes = parse_list(optarg, sizes,
+							"size");
+				break;
+			case 'p':
+				strncpy(policy_list, optarg, 255);
+				break;
+			case 'r':
+				number_of_readaheads = parse_list(optarg,
+							readaheads, "readahead");
+				break;
+			case 'l':
+				Pin_levels = atoi(optarg);
+				break;
+			default:
+				die("usage: focreplay [-s sizes] [-p policies] "
+					"[-r readaheads] [-l levels] trace\n");
+		}
+	}
+
+	if (optind != argc - 1) {
+		die("Must supply the name of a page trace.\n");
+	}
+
+	for (char *p = strtok(policy_list, ","); p; p = strtok(NULL, ",")) {
+		if (strcmp(p, "lru") && strcmp(p, "clock") &&
+				strcmp(p, "arc") && strcmp(p, "pin")) {
+			die("Unknown policy %s\n", p);
+		}
+		if (number_of_policies == MAX_LIST) {
+			die("Too many policies\n");
+		}
+		policies[number_of_policies++] = p;
+	}
+
+	read_trace(argv[optind]);
+	describe_trace();
+
+	for (i = 0; i < number_of_policies; i++)
+	for (j = 0; j < number_of_sizes; j++)
+	for (k = 0; k < number_of_readaheads; k++) {
+		replay(policies[i], sizes[j], readaheads[k]);
+	}
+
+	return 0;
+}
+
+// Run the whole trace through one pool
+void replay(const char *policy, int size, int readahead) {
+
+	REPLAY_CACHE	*cache;
+	long		hits = 0, misses = 0, prefetched = 0, used = 0;
+	int		keys = Number_of_files * MAX_PAGE;
+	char		*was_prefetched;
+	long		i;
+
+	if (size < 1) {
+		die("Pool size must be at least 1 page\n");
+	}
+
+	if (strcmp(policy, "lru") == 0) {
+		cache = new LRU_CACHE(size, keys);
+	}
+	else if (strcmp(policy, "clock") == 0) {
+		cache = new CLOCK_CACHE(size, keys);
+	}
+	else if (strcmp(policy, "arc") == 0) {
+		cache = new ARC_CACHE(size, keys);
+	}
+	else {
+		cache = new PIN_CACHE(size, keys);
+	}
+
+	was_prefetched = (char*) xmalloc("prefetch flags", keys);
+	memset(was_prefetched, 0, keys);
+
+	for (i = 0; i < Trace_length; i++) {
+		FOCPAGE_TRACE_RECORD *r = &Trace[i];
+		int file = File_of[r->file];
+		int key = file * MAX_PAGE + r->page;
+		int pin = r->owner == FOCPAGE_INDEX && r->level < Pin_levels;
+
+		if (cache->access(key, pin)) {
+			hits++;
+			if (was_prefetched[key]) {
+				used++;
+				was_prefetched[key] = 0;
+			}
+			continue;
+		}
+
+		misses++;
+		was_prefetched[key] = 0;
+
+		for (int ahead = 1; ahead <= readahead; ahead++) {
+			int page = r->page + ahead;
+
+			if (page >= MAX_PAGE) {
+				break;
+			}
+			if (!cache->contains(key + ahead)) {
+				cache->prefetch(key + ahead);
+				was_prefetched[key + ahead] = 1;
+				prefetched++;
+			}
+		}
+	}
+
+	printf("policy=%s size=%d readahead=%d accesses=%ld hits=%ld "
+		"misses=%ld hit_ratio=%.6f disk_reads=%ld prefetched=%ld "
+		"prefetch_used=%ld\n",
+		policy, size, readahead, Trace_length, hits, misses,
+		Trace_length ? (double) hits / Trace_length : 0.0,
+		misses + prefetched, prefetched, used);
+
+	free(was_prefetched);
+	delete cache;
+}
+
+void read_trace(char *name) {
+
+	FILE	*fh;
+	char	magic[8];
+	long	allocated = 65536;
+	size_t	n;
+
+	if (!(fh = fopen(name, "rb"))) {
+		die("Can't open %s\n", name);
+	}
+
+	if (fread(magic, 1, 8, fh) != 8 ||
+			memcmp(magic, FOCPAGE_TRACE_MAGIC, 8) != 0) {
+		die("%s is not a FocFile page trace\n", name);
+	}
+
+	Trace = (FOCPAGE_TRACE_RECORD*) xmalloc("trace",
+			allocated * sizeof(FOCPAGE_TRACE_RECORD));
+	Trace_length = 0;
+
+	for (;;) {
+		if (Trace_length == allocated) {
+			allocated *= 2;
+			Trace = (FOCPAGE_TRACE_RECORD*) realloc(Trace,
+				allocated * sizeof(FOCPAGE_TRACE_RECORD));
+			if (!Trace) {
+				die("Can't allocate memory for the trace\n");
+			}
+		}
+		n = fread(&Trace[Trace_length], sizeof(FOCPAGE_TRACE_RECORD),
+				allocated - Trace_length, fh);
+		if (n == 0) {
+			break;
+		}
+		Trace_length += n;
+	}
+
+	fclose(fh);
+
+	// Number the files in the order they appear
+	memset(File_of, -1, sizeof(File_of));
+	Number_of_files = 0;
+	for (long i = 0; i < Trace_length; i++) {
+		if (File_of[Trace[i].file] < 0) {
+			File_of[Trace[i].file] = Number_of_files++;
+		}
+	}
+}
+
+void describe_trace(void) {
+
+	long	misses = 0, index = 0, distinct = 0;
+	int	keys = Number_of_files * MAX_PAGE;
+	char	*seen = (char*) xmalloc("seen pages", keys > 0 ? keys : 1);
+
+	memset(seen, 0, keys);
+	for (long i = 0; i < Trace_length; i++) {
+		FOCPAGE_TRACE_RECORD *r = &Trace[i];
+		int key = File_of[r->file] * MAX_PAGE + r->page;
+
+		misses += (r->flags & FOCPAGE_TRACE_MISS) != 0;
+		index += r->owner == FOCPAGE_INDEX;
+		if (!seen[key]) {
+			seen[key] = 1;
+			distinct++;
+		}
+	}
+	free(seen);
+
+	printf("trace accesses=%ld index_accesses=%ld files=%d "
+		"distinct_pages=%ld recorded_misses=%ld\n",
+		Trace_length, index, Number_of_files, distinct, misses);
+}
+
+int parse_list(char *s, int *list, const char *what) {
+
+	int	n = 0;
+
+	for (char *p = strtok(s, ","); p; p = strtok(NULL, ",")) {
+		if (n == MAX_LIST) {
+			die("Too many %s values\n", what);
+		}
+		list[n++] = atoi(p);
+	}
+
+	if (n == 0) {
+		die("No %s values\n", what);
+	}
+	return n;
+}
+
+// =============================================================
+// CLASS: LRU_CACHE
+// =============================================================
+LRU_CACHE::LRU_CACHE(int capacity, int keys) {
+
+	Capacity	= capacity;
+	Count		= 0;
+	Head = Tail	= -1;
+	Prev		= (int*) xmalloc("LRU", sizeof(int) * (long) keys);
+	Next		= (int*) xmalloc("LRU", sizeof(int) * (long) keys);
+	In		= (char*) xmalloc("LRU", keys);
+	memset(In, 0, keys);
+}
+
+LRU_CACHE::~LRU_CACHE() {
+
+	free(Prev);
+	free(Next);
+	free(In);
+}
+
+int LRU_CACHE::access(int key, int pin) {
+
+	if (In[key]) {
+		if (Head != key) {
+			Unlink(key);
+			Push_front(key);
+		}
+		return 1;
+	}
+
+	Fit(1);
+	Push_front(key);
+	return 0;
+}
+
+void LRU_CACHE::prefetch(int key) {
+
+	if (!In[key]) {
+		Fit(1);
+		Push_front(key);
+	}
+}
+
+void LRU_CACHE::remove(int key) {
+
+	if (In[key]) {
+		Unlink(key);
+	}
+}
+
+void LRU_CACHE::set_capacity(int capacity) {
+
+	Capacity = capacity;
+	Fit(0);
+}
+
+// Evict until there is room for this many more pages
+void LRU_CACHE::Fit(int room) {
+
+	while (Count > 0 && Count + room > Capacity) {
+		Unlink(Tail);
+	}
+}
+
+void LRU_CACHE::Push_front(int key) {
+
+	Prev[key] = -1;
+	Next[key] = Head;
+	if (Head >= 0) {
+		Prev[Head] = key;
+	}
+	Head = key;
+	if (Tail < 0) {
+		Tail = key;
+	}
+	In[key] = 1;
+	Count++;
+}
+
+void LRU_CACHE::Unlink(int key) {
+
+	if (Prev[key] >= 0) {
+		Next[Prev[key]] = Next[key];
+	}
+	else {
+		Head = Next[key];
+	}
+
+	if (Next[key] >= 0) {
+		Prev[Next[key]] = Prev[key];
+	}
+	else {
+		Tail = Prev[key];
+	}
+
+	In[key] = 0;
+	Count--;
+}
+
+// =============================================================
+// CLASS: CLOCK_CACHE
+// =============================================================
+CLOCK_CACHE::CLOCK_CACHE(int capacity, int keys) {
+
+	Capacity	= capacity;
+	Used		= 0;
+	Hand		= 0;
+	Slot_key	= (int*) xmalloc("CLOCK", sizeof(int) * (long) capacity);
+	Referenced	= (char*) xmalloc("CLOCK", capacity);
+	Where		= (int*) xmalloc("CLOCK", sizeof(int) * (long) keys);
+	memset(Where, -1, sizeof(int) * (long) keys);
+}
+
+CLOCK_CACHE::~CLOCK_CACHE() {
+
+	free(Slot_key);
+	free(Referenced);
+	free(Where);
+}
+
+int CLOCK_CACHE::access(int key, int pin) {
+
+	if (Where[key] >= 0) {
+		Referenced[Where[key]] = 1;
+		return 1;
+	}
+
+	Load(key, 1);
+	return 0;
+}
+
+// Pages read ahead start without their bit, so they go first
+// if nobody uses them
+void CLOCK_CACHE::prefetch(int key) {
+
+	if (Where[key] < 0) {
+		Load(key, 0);
+	}
+}
+
+void CLOCK_CACHE::Load(int key, int referenced) {
+
+	int	slot;
+
+	if (Used < Capacity) {
+		slot = Used++;
+	}
+	else {
+		while (Referenced[Hand]) {
+			Referenced[Hand] = 0;
+			Hand = (Hand + 1) % Capacity;
+		}
+		slot = Hand;
+		Where[Slot_key[slot]] = -1;
+		Hand = (Hand + 1) % Capacity;
+	}
+
+	Slot_key[slot]		= key;
+	Referenced[slot]	= referenced;
+	Where[key]		= slot;
+}
+
+// =============================================================
+// CLASS: ARC_CACHE
+// =============================================================
+ARC_CACHE::ARC_CACHE(int capacity, int keys) {
+
+	C	= capacity;
+	P	= 0;
+	for (int l = 0; l < 5; l++) {
+		Head[l] = Tail[l] = -1;
+		Size[l] = 0;
+	}
+	Prev	= (int*) xmalloc("ARC", sizeof(int) * (long) keys);
+	Next	= (int*) xmalloc("ARC", sizeof(int) * (long) keys);
+	List	= (char*) xmalloc("ARC", keys);
+	memset(List, ARC_NONE, keys);
+}
+
+ARC_CACHE::~ARC_CACHE() {
+
+	free(Prev);
+	free(Next);
+	free(List);
+}
+
+int ARC_CACHE::contains(int key) {
+
+	return List[key] == ARC_T1 || List[key] == ARC_T2;
+}
+
+int ARC_CACHE::access(int key, int pin) {
+
+	double	delta;
+
+	switch (List[key]) {
+		case ARC_T1:
+		case ARC_T2:
+			Unlink(key);
+			Push_front(ARC_T2, key);
+			return 1;
+
+		case ARC_B1:
+			delta = Size[ARC_B1] >= Size[ARC_B2] ? 1.0 :
+				(double) Size[ARC_B2] / Size[ARC_B1];
+			P = P + delta < C ? P + delta : C;
+			Replace(0);
+			Unlink(key);
+			Push_front(ARC_T2, key);
+			return 0;
+
+		case ARC_B2:
+			delta = Size[ARC_B2] >= Size[ARC_B1] ? 1.0 :
+				(double) Size[ARC_B1] / Size[ARC_B2];
+			P = P - delta > 0 ? P - delta : 0;
+			Replace(1);
+			Unlink(key);
+			Push_front(ARC_T2, key);
+			return 0;
+	}
+
+	Insert_new(key);
+	return 0;
+}
+
+// A page read ahead is new to the cache, whatever the ghosts say
+void ARC_CACHE::prefetch(int key) {
+
+	if (contains(key)) {
+		return;
+	}
+	if (List[key] != ARC_NONE) {
+		Unlink(key);
+	}
+	Insert_new(key);
+}
+
+void ARC_CACHE::Insert_new(int key) {
+
+	int	l1 = Size[ARC_T1] + Size[ARC_B1];
+	int	total = l1 + Size[ARC_T2] + Size[ARC_B2];
+
+	if (l1 == C) {
+		if (Size[ARC_T1] < C) {
+			Pop_back(ARC_B1);
+			Replace(0);
+		}
+		else {
+			List[Pop_back(ARC_T1)] = ARC_NONE;
+		}
+	}
+	else if (total >= C) {
+		if (total == 2 * C) {
+			Pop_back(ARC_B2);
+		}
+		Replace(0);
+	}
+
+	Push_front(ARC_T1, key);
+}
+
+// Make room in T1 + T2 by moving a page to its ghost list
+void ARC_CACHE::Replace(int in_b2) {
+
+	int	key;
+
+	if (Size[ARC_T1] + Size[ARC_T2] < C) {
+		return;
+	}
+
+	if (Size[ARC_T1] > 0 && (Size[ARC_T2] == 0 || Size[ARC_T1] > P ||
+			(in_b2 && Size[ARC_T1] == (int) P))) {
+		key = Pop_back(ARC_T1);
+		Push_front(ARC_B1, key);
+	}
+	else {
+		key = Pop_back(ARC_T2);
+		Push_front(ARC_B2, key);
+	}
+}
+
+void ARC_CACHE::Push_front(int list, int key) {
+
+	Prev[key] = -1;
+	Next[key] = Head[list];
+	if (Head[list] >= 0) {
+		Prev[Head[list]] = key;
+	}
+	Head[list] = key;
+	if (Tail[list] < 0) {
+		Tail[list] = key;
+	}
+	List[key] = list;
+	Size[list]++;
+}
+
+void ARC_CACHE::Unlink(int key) {
+
+	int	list = List[key];
+
+	if (Prev[key] >= 0) {
+		Next[Prev[key]] = Next[key];
+	}
+	else {
+		Head[list] = Next[key];
+	}
+
+	if (Next[key] >= 0) {
+		Prev[Next[key]] = Prev[key];
+	}
+	else {
+		Tail[list] = Prev[key];
+	}
+
+	List[key] = ARC_NONE;
+	Size[list]--;
+}
+
+// Takes the least recent page off a list, and returns it
+int ARC_CACHE::Pop_back(int list) {
+
+	int	key = Tail[list];
+
+	if (key < 0) {
+		die("ARC list %d is empty\n", list);
+	}
+	Unlink(key);
+	return key;
+}
+
+// =============================================================
+// CLASS: PIN_CACHE
+// =============================================================
+PIN_CACHE::PIN_CACHE(int capacity, int keys) {
+
+	Capacity	= capacity;
+	Number_pinned	= 0;
+	Pinned		= (char*) xmalloc("PIN", keys);
+	memset(Pinned, 0, keys);
+	Lru		= new LRU_CACHE(capacity, keys);
+}
+
+PIN_CACHE::~PIN_CACHE() {
+
+	free(Pinned);
+	delete Lru;
+}
+
+int PIN_CACHE::access(int key, int pin) {
+
+	int	hit;
+
+	if (Pinned[key]) {
+		return 1;
+	}
+
+	if (!pin || Number_pinned >= Capacity / 2) {
+		return Lru->access(key, 0);
+	}
+
+	// Pin it, and shrink the LRU part to make room
+	hit = Lru->contains(key);
+	Lru->remove(key);
+	Pinned[key] = 1;
+	Number_pinned++;
+	Lru->set_capacity(Capacity - Number_pinned);
+	return hit;
+}
+
+void PIN_CACHE::prefetch(int key) {
+
+	if (!Pinned[key]) {
+		Lru->prefetch(key);
+	}
+}
+
+// =============================================================
+// Extra functions
+// =============================================================
+
+// Malloc or die
+void* xmalloc(const char *label, long bytes) {
+
+	void	*memory;
+
+	if ((memory = malloc(bytes)) == NULL) {
+		die("Can't allocate %ld bytes for %s\n", bytes, label);
+	}
+
+	return memory;
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
@@ -0,0 +1,176 @@
+/*
+    focsample.cpp
+    -------------
+    Sampled scans for the FocFile C++ library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "focsample.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+// =============================================================
+// CLASS: FOCSAMPLESCAN
+// -------------------------------------------------------------
+// A random part of a segment's pages, and the records on them.
+// =============================================================
+FOCSAMPLESCAN::FOCSAMPLESCAN(FOCFILE* foc, int seg, double fraction,
+		unsigned long seed) {
+
+	if (seg < 1 || seg > foc->number_seg()) {
+		die("SAMPLESCAN on non-existant segment %d\n", seg);
+	}
+	if (fraction <= 0 || fraction > 1) {
+		die("SAMPLESCAN fraction %g is not above 0 and at most 1\n",
+			fraction);
+	}
+
+	Foc	= foc;
+	Seg	= seg;
+	Where	= NULL;
+	Limit	= -1;
+
+	Pages	= foc->page_range(seg, First, Last);
+	Length	= foc->instance_length(seg);
+
+	// An instance is its child pointers, its chain pointer, its
+	// parent pointer if it has a parent, and then its data
+	Pointers = foc->pointers(seg);
+	Children = Pointers - 1 - (foc->parent(seg) > 0 ? 1 : 0);
+
+	// sample_random() gives 31 bits
+	Seed		= seed;
+	Threshold	= (unsigned long) (fraction * 2147483648.0);
+
+	rewind();
+}
+
+void FOCSAMPLESCAN::where(FOCEXPR& expr) {
+
+	expr.compile(Foc);
+	if (expr.number_of_segments() > 1 ||
+			(expr.number_of_segments() == 1 &&
+			 expr.segment() != Seg)) {
+		die("SAMPLESCAN WHERE may only test segment %d\n", Seg);
+	}
+
+	Where = &expr;
+}
+
+void FOCSAMPLESCAN::rewind(void) {
+
+	State		= Seed;
+	Current		= First - 1;
+	Word		= 0;
+	Used		= 0;
+	Page_data	= NULL;
+
+	Pages_read	= 0;
+	Pages_sampled	= 0;
+	Records_read	= 0;
+	Records_selected = 0;
+}
+
+void FOCSAMPLESCAN::limit(long n) {
+
+	Limit = n < 0 ? -1 : n;
+}
+
+double FOCSAMPLESCAN::scale(void) {
+
+	return Pages_sampled ? (double) Pages / Pages_sampled : 0;
+}
+
+// The next selected record's data area, or NULL at the end
+UCHAR* FOCSAMPLESCAN::next(void) {
+
+	UCHAR	*instance, *data;
+
+	if (Limit >= 0 && Records_selected >= Limit) {
+		return NULL;
+	}
+
+	for (;;) {
+		if (Word + Length > Used) {
+			if (!Next_page()) {
+				return NULL;
+			}
+		}
+
+		instance = Page_data + Word * 4;
+		Word += Length;
+
+		FOCPTR chain(instance + Children * 4);
+		if (chain.type == PTR_DELETED) {
+			continue;
+		}
+
+		data = instance + Pointers * 4;
+		Records_read++;
+
+		if (!Where || Where->eval_record(data)) {
+			Records_selected++;
+			return data;
+		}
+	}
+}
+
+// Move to the next page taken that is the segment's. Whether a page is
+// taken is drawn for every page in the range, in order, so the same
+// seed takes the same pages whatever they turn out to hold.
+int FOCSAMPLESCAN::Next_page(void) {
+
+	FOCPAGE_STAMP	stamp;
+
+	while (++Current <= Last) {
+		if (sample_random(&State) >= Threshold) {
+			continue;
+		}
+
+		Page_data = Foc->read_page(Seg, Current, stamp);
+		Pages_read++;
+		if (stamp.segment != Seg) {
+			continue;
+		}
+
+		Pages_sampled++;
+		Used = Foc->page_used(Seg, Current);
+		Word = 0;
+		if (Used >= Length) {
+			return 1;
+		}
+	}
+
+	Used = 0;
+	return 0;
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
@@ -0,0 +1,113 @@
+/*
+    focsample.h
+    -----------
+    Sampled scans for the FocFile C++ library. A FOCSAMPLESCAN reads a
+    random part of a segment's pages, in page order, and hands out
+    every record on them, for statistics that don't need every record.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCSAMPLE_H
+#define FOCSAMPLE_H
+
+#ifndef FOCEXPR_H
+#include "focexpr.h"
+#endif /* FOCEXPR_H */
+
+// Reads about a fraction of one segment's pages, picked at random:
+//
+//	FOCSAMPLESCAN scan(foc, FOCSEG_ORDERS_ORDERS, 0.01, seed);
+//	while ((data = scan.next())) {
+//		memcpy(&qty, data + 12, sizeof(int32_t));
+//		total += qty;
+//	}
+//	total *= scan.scale();
+//
+// Each page between the segment's first and last is taken or not on
+// its own, with the same odds, before it is read; those that turn out
+// to be another segment's are passed over. The same seed takes the same
+// pages. Records come in the order they lie on each page, and their
+// parents aren't known, so the WHERE expression may only test fields of
+// the scanned segment. next() returns the record's data area, in the
+// segment's page buffer.
+class FOCSAMPLESCAN {
+
+public:
+	FOCSAMPLESCAN(FOCFILE* foc, int seg, double fraction,
+		unsigned long seed=1);
+
+	// The filter. The FOCEXPR must outlive the scan.
+	void	where(FOCEXPR& expr);
+
+	// Stop after n selected records, before reading another page. A
+	// negative n takes the limit off; rewind() starts the count over.
+	void	limit(long n);
+
+	UCHAR*	next(void);
+
+	// Start over, on the same pages
+	void	rewind(void);
+
+	// What to multiply a count or a sum over the sample by, to make it
+	// one over the whole segment: its pages over the pages sampled. It
+	// is only final once next() has returned NULL, and not then if
+	// limit() stopped the scan.
+	double	scale(void);
+
+	long	pages_read(void) { return Pages_read; };
+	long	pages_sampled(void) { return Pages_sampled; };
+	long	records_read(void) { return Records_read; };
+	long	records_selected(void) { return Records_selected; };
+
+private:
+	int	Next_page(void);
+
+private:
+	FOCFILE		*Foc;
+	int		Seg;
+	FOCEXPR		*Where;
+	long		Limit;		// or -1
+
+	int		First, Last;	// the segment's pages lie among these
+	int		Pages;		// and it has this many
+	int		Length;		// words of each instance
+	int		Pointers;
+	int		Children;	// pointers before the chain pointer
+
+	uint64_t	Seed;
+	uint64_t	State;
+	unsigned long	Threshold;	// a page is taken below this
+
+	int		Current;	// page, or First - 1
+	int		Word;		// next instance on that page
+	int		Used;
+	UCHAR		*Page_data;
+
+	long		Pages_read;
+	long		Pages_sampled;
+	long		Records_read;
+	long		Records_selected;
+};
+
+#endif /* FOCSAMPLE_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
@@ -0,0 +1,422 @@
+/*
+    focscan.cpp
+    -----------
+    Filtered extracts for the FocFile C++ library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "focscan.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+// Column kinds; what the target variable is
+#define COLUMN_STRING	0
+#define COLUMN_LONG	1
+#define COLUMN_INT32	2
+#define COLUMN_DOUBLE	3
+#define COLUMN_FLOAT	4
+#define COLUMN_SMDATE	5
+
+// Scan states
+#define SCAN_START	0	// nothing read yet
+#define SCAN_CHAIN	1	// reading a chain of Seg
+#define SCAN_BETWEEN	2	// chain finished, ancestors must move
+#define SCAN_DONE	3
+
+struct FOCSCAN_COLUMN {
+	void	*target;
+	char	kind;
+	int	seg;
+	int	offset;
+	int	length;
+};
+
+// =============================================================
+// CLASS: FOCSCAN
+// -------------------------------------------------------------
+// Walks all the records of one segment, across all the parent
+// chains, copying out columns of the records that pass a filter.
+// =============================================================
+FOCSCAN::FOCSCAN(FOCFILE* foc, int seg) {
+
+	int	s;
+
+	if (seg <= 0 || seg > foc->number_seg()) {
+		die("SCAN called for non-existant segment %d\n", seg);
+	}
+
+	Foc	= foc;
+	Seg	= seg;
+
+	// Find the path from the root down to seg
+	Depth = 0;
+	for (s = foc->parent(seg); s != 0; s = foc->parent(s)) {
+		Depth++;
+	}
+
+	Path = (int*) xrealloc("SCAN path", NULL, sizeof(int) * (Depth + 1));
+	s = seg;
+	for (int level = Depth; level >= 0; level--) {
+		Path[level] = s;
+		s = foc->parent(s);
+	}
+
+	Where		= NULL;
+	Where_reads_seg	= 0;
+
+	Column		= NULL;
+	Num_columns	= 0;
+
+	Records_read	= 0;
+	Records_selected = 0;
+	Chains		= 0;
+	Limit		= -1;
+
+	rewind();
+}
+
+FOCSCAN::~FOCSCAN() {
+
+	free(Path);
+	free(Column);
+}
+
+void FOCSCAN::where(FOCEXPR& expr) {
+
+	expr.compile(Foc);
+
+	for (int s = 1; s <= Foc->number_seg(); s++) {
+		if (expr.reads_segment(s) && !On_path(s)) {
+			die("SCAN::where tests segment %d, which is not segment "
+				"%d or one of its parents\n", s, Seg);
+		}
+	}
+
+	Where = &expr;
+	Where_reads_seg = expr.reads_segment(Seg);
+}
+
+void FOCSCAN::column(char* s, int seg, int offset, char type, int length) {
+
+	if (type != FIELDTYPE_ALPHA) {
+		die("SCAN::column type not Alpha: %c\n", type);
+	}
+	Add_column(s, COLUMN_STRING, seg, offset, type, length);
+}
+
+void FOCSCAN::column(long& l, int seg, int offset, char type, int length) {
+
+	if (type != FIELDTYPE_INTEGER) {
+		die("SCAN::column type not Integer: %c\n", type);
+	}
+	Add_column(&l, COLUMN_LONG, seg, offset, type, length);
+}
+
+void FOCSCAN::column(int32_t& i, int seg, int offset, char type, int length) {
+
+	if (type != FIELDTYPE_INTEGER) {
+		die("SCAN::column type not Integer: %c\n", type);
+	}
+	Add_column(&i, COLUMN_INT32, seg, offset, type, length);
+}
+
+void FOCSCAN::column(double& d, int seg, int offset, char type, int length) {
+
+	if (type != FIELDTYPE_DOUBLE) {
+		die("SCAN::column type not Double: %c\n", type);
+	}
+	Add_column(&d, COLUMN_DOUBLE, seg, offset, type, length);
+}
+
+void FOCSCAN::column(float& f, int seg, int offset, char type, int length) {
+
+	if (type != FIELDTYPE_FLOAT) {
+		die("SCAN::column type not Float: %c\n", type);
+	}
+	Add_column(&f, COLUMN_FLOAT, seg, offset, type, length);
+}
+
+void FOCSCAN::column(SMDATE& smd, int seg, int offset, char type,
+			int length) {
+
+	if (type != FIELDTYPE_SMDATE) {
+		die("SCAN::column type not SMDATE: %c\n", type);
+	}
+	Add_column(&smd, COLUMN_SMDATE, seg, offset, type, length);
+}
+
+void FOCSCAN::Add_column(void* target, char kind, int seg, int offset,
+			char type, int length) {
+
+	if (!On_path(seg)) {
+		die("SCAN::column in segment %d, which is not segment %d or "
+			"one of its parents\n", seg, Seg);
+	}
+
+	Column = (FOCSCAN_COLUMN*) xrealloc("SCAN columns", Column,
+			sizeof(FOCSCAN_COLUMN) * (Num_columns + 1));
+
+	FOCSCAN_COLUMN *col = &Column[Num_columns++];
+	col->target	= target;
+	col->kind	= kind;
+	col->seg	= seg;
+	col->offset	= offset;
+	col->length	= length;
+}
+
+int FOCSCAN::On_path(int seg) {
+
+	for (int level = 0; level <= Depth; level++) {
+		if (Path[level] == seg) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+void FOCSCAN::rewind(void) {
+
+	State		= SCAN_START;
+	Num_selected	= 0;
+	Num_batch	= 0;
+	Current		= 0;
+	Returned	= 0;
+}
+
+void FOCSCAN::limit(long n) {
+
+	Limit = n < 0 ? -1 : n;
+}
+
+int FOCSCAN::next(void) {
+
+	int	i;
+	UCHAR	*data;
+
+	// Once the limit is reached, no more pages are read
+	if (Limit >= 0 && Returned >= Limit) {
+		return 0;
+	}
+
+	if (Current >= Num_selected) {
+		Chain_level = Depth;
+		if (!Fill_batch()) {
+			return 0;
+		}
+	}
+
+	data = Batch[Selected[Current++]];
+	Records_selected++;
+	Returned++;
+
+	// Ancestor columns only change when a new chain starts
+	if (!Ancestors_copied) {
+		for (i = 0; i < Num_columns; i++) {
+			if (Column[i].seg != Seg) {
+				Copy_column(&Column[i],
+					Foc->record_data(Column[i].seg));
+			}
+		}
+		Ancestors_copied = 1;
+	}
+
+	for (i = 0; i < Num_columns; i++) {
+		if (Column[i].seg == Seg) {
+			Copy_column(&Column[i], data);
+		}
+	}
+
+	return 1;
+}
+
+UCHAR* FOCSCAN::record(void) {
+
+	if (Current == 0) {
+		return NULL;
+	}
+
+	return Batch[Selected[Current - 1]];
+}
+
+// A batch lies on one page, and the segment's cursor is on its last
+// record, so the others are as many words before it as their data is.
+int FOCSCAN::position(FOCPTR& where) {
+
+	if (Current == 0 || !Foc->position(Seg, where)) {
+		return 0;
+	}
+
+	where.word -= (Batch[Num_batch - 1] - Batch[Selected[Current - 1]]) / 4;
+	return 1;
+}
+
+// Move the ancestors to the next chain of Seg. Works like an odometer:
+// the deepest ancestor that still has records moves, and the ones
+// under it start over from their first record.
+int FOCSCAN::Next_chain(void) {
+
+	int	level;
+
+	for (;;) {
+		if (State == SCAN_START) {
+			Foc->reposition(Path[0]);
+			level = 0;
+			Chain_level = 0;
+		}
+		else if (State == SCAN_DONE || Depth == 0) {
+			State = SCAN_DONE;
+			return 0;
+		}
+		else {
+			level = Depth - 1;
+		}
+
+		while (level >= 0 && level < Depth) {
+			if (Foc->next(Path[level])) {
+				if (level < Chain_level) {
+					Chain_level = level;
+				}
+				level++;
+			}
+			else {
+				level--;
+			}
+		}
+
+		if (level < 0) {
+			State = SCAN_DONE;
+			return 0;
+		}
+
+		State = SCAN_CHAIN;
+		Chains++;
+		Ancestors_copied = 0;
+
+		if (!Where) {
+			return 1;
+		}
+
+		Where->bind(Foc, Seg);
+
+		// If the filter only looks at the ancestors, the whole chain
+		// passes or fails at once.
+		if (Where_reads_seg || Where->eval_bound(NULL)) {
+			return 1;
+		}
+
+		State = SCAN_BETWEEN;
+	}
+}
+
+// Read the next batch of records and decide which pass the filter
+int FOCSCAN::Fill_batch(void) {
+
+	int	i, n;
+
+	for (;;) {
+		if (State != SCAN_CHAIN && !Next_chain()) {
+			return 0;
+		}
+
+		n = Foc->next_batch(Seg, Batch, FOCSCAN_BATCH);
+		if (n == 0) {
+			State = SCAN_BETWEEN;
+			continue;
+		}
+
+		Records_read += n;
+		Num_batch = n;
+		Num_selected = 0;
+		Current = 0;
+
+		if (Where && Where_reads_seg) {
+			for (i = 0; i < n; i++) {
+				if (Where->eval_bound(Batch[i])) {
+					Selected[Num_selected++] = i;
+				}
+			}
+		}
+		else {
+			for (i = 0; i < n; i++) {
+				Selected[i] = i;
+			}
+			Num_selected = n;
+		}
+
+		debug("SCAN::Fill_batch %d of %d records selected\n",
+			Num_selected, n);
+
+		if (Num_selected > 0) {
+			return 1;
+		}
+	}
+}
+
+// Decode one field from the record into the user's variable
+void FOCSCAN::Copy_column(FOCSCAN_COLUMN* col, UCHAR* data) {
+
+	UCHAR	*field = data + col->offset;
+	int32_t	value;
+
+	switch (col->kind) {
+		case COLUMN_STRING: {
+			char	*s = (char*) col->target;
+			int	length = col->length;
+
+			while (length > 0 && field[length - 1] == ' ') {
+				length--;
+			}
+			memcpy(s, field, length);
+			s[length] = 0;
+			break;
+		}
+		case COLUMN_LONG:
+			memcpy(&value, field, sizeof(int32_t));
+			*(long*) col->target = value;
+			break;
+		case COLUMN_INT32:
+			memcpy(col->target, field, sizeof(int32_t));
+			break;
+		case COLUMN_DOUBLE:
+			memcpy(col->target, field, sizeof(double));
+			break;
+		case COLUMN_FLOAT:
+			memcpy(col->target, field, sizeof(float));
+			break;
+		case COLUMN_SMDATE:
+			memcpy(&value, field, sizeof(int32_t));
+			((SMDATE*) col->target)->set_julian(value, SMDATE_FOCUS);
+			break;
+	}
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
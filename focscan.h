@@ -0,0 +1,146 @@
+/*
+    focscan.h
+    ---------
+    Filtered extracts for the FocFile C++ library. A FOCSCAN walks every
+    record of one segment in the FOCUS file, tests a FOCEXPR, and copies
+    out only the fields that you ask for, only for records that pass.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCSCAN_H
+#define FOCSCAN_H
+
+#ifndef FOCEXPR_H
+#include "focexpr.h"
+#endif /* FOCEXPR_H */
+
+// A page holds 1000 words, so no batch is ever larger than this
+#define FOCSCAN_BATCH	1000
+
+struct FOCSCAN_COLUMN;
+
+// The scan reads a page's worth of records at a time. It runs the
+// WHERE expression over the whole batch first, straight on the page
+// buffer, and only then copies the columns of the records that passed.
+// Alpha columns are trimmed and smart dates decoded only for those.
+//
+//	FOCSCAN scan(foc, FOCSEG_CAR_BODY);
+//	char *model = foc->string_alloc(FOCFLD_CAR_MODEL);
+//	double cost;
+//
+//	scan.where(expensive);
+//	scan.column(model, FOCFLD_CAR_MODEL);
+//	scan.column(cost, FOCFLD_CAR_DEALER_COST);
+//
+//	while (scan.next()) {
+//		printf("%s %7.0lf\n", model, cost);
+//	}
+//
+// Columns and WHERE fields may lie in the scanned segment or any of its
+// ancestors. The scan moves the cursors of the segment and its
+// ancestors; don't move them yourself while a scan is running.
+class FOCSCAN {
+
+public:
+	FOCSCAN(FOCFILE* foc, int seg);
+	~FOCSCAN();
+
+	// The filter. The FOCEXPR must outlive the scan.
+	void	where(FOCEXPR& expr);
+
+	// Where to put each field of a selected record. Alpha columns
+	// are NUL-terminated with trailing blanks removed, so the string
+	// needs length + 1 bytes (string_alloc() does that).
+	void	column(char* s,	   int seg, int offset, char type, int length);
+	void	column(long& l,	   int seg, int offset, char type, int length);
+	void	column(int32_t& i, int seg, int offset, char type, int length);
+	void	column(double& d,  int seg, int offset, char type, int length);
+	void	column(float& f,   int seg, int offset, char type, int length);
+	void	column(SMDATE& smd, int seg, int offset, char type, int length);
+
+	// Stop after n selected records, before reading another page. A
+	// negative n takes the limit off; rewind() starts the count over.
+	void	limit(long n);
+
+	// Go to the next selected record and fill in the columns.
+	// Returns 1, or 0 when there are no more.
+	int	next(void);
+
+	// Start over from the first record in the file
+	void	rewind(void);
+
+	// The data area of the current record, in the page buffer
+	UCHAR*	record(void);
+
+	// Where the current record is, for FOCFILE's set_position().
+	// Returns 0 before the first record.
+	int	position(FOCPTR& where);
+
+	// Chains counts the parent chains entered so far. Chain_level is
+	// the shallowest level of the path (0 is the root segment) that
+	// moved since the previous record.
+	long	chains(void) { return Chains; };
+	int	chain_level(void) { return Chain_level; };
+
+	long	records_read(void) { return Records_read; };
+	long	records_selected(void) { return Records_selected; };
+
+private:
+	void	Add_column(void* target, char kind, int seg, int offset,
+			char type, int length);
+	int	On_path(int seg);
+	int	Next_chain(void);
+	int	Fill_batch(void);
+	void	Copy_column(FOCSCAN_COLUMN* col, UCHAR* data);
+
+private:
+	FOCFILE		*Foc;
+	int		Seg;
+	int		*Path;		// root ... Seg
+	int		Depth;		// Path[Depth] == Seg
+	int		State;
+	long		Chains;
+	int		Chain_level;
+
+	FOCEXPR		*Where;
+	int		Where_reads_seg;
+
+	FOCSCAN_COLUMN	*Column;
+	int		Num_columns;
+	int		Ancestors_copied;
+
+	UCHAR		*Batch[FOCSCAN_BATCH];
+	int		Selected[FOCSCAN_BATCH];
+	int		Num_selected;
+	int		Num_batch;
+	int		Current;
+
+	long		Limit;		// or -1
+	long		Returned;	// since rewind()
+
+	long		Records_read;
+	long		Records_selected;
+};
+
+#endif /* FOCSCAN_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
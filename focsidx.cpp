@@ -0,0 +1,526 @@
+/*
+    focsidx.cpp
+    -----------
+    Sidecar indexes for the FocFile C++ library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "focsidx.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+// The file is these structures, in this order and in the machine's
+// byte order: the header, the keys, the key starts, the postings, the
+// hash slots, the page stamps.
+struct FOCSIDX_HEADER {
+	char	magic[8];
+	int32_t	kind;
+	int32_t	seg;
+	int32_t	offset;
+	int32_t	length;
+	int32_t	keys;
+	int32_t	postings;
+	int32_t	slots;
+	char	type;
+	UCHAR	unused[3];
+};
+
+// Where a record is, as FOCFILE::position() gives it
+struct FOCSIDX_POSTING {
+	int32_t	page;
+	int32_t	word;
+};
+
+// For entry_order(), which qsort() can't pass them to
+static char	Sort_type;
+static int	Sort_length;
+
+static int entry_order(const void *a, const void *b);
+
+// =============================================================
+// CLASS: FOCSIDX
+// -------------------------------------------------------------
+// The records of a segment by the value of one field.
+// =============================================================
+FOCSIDX::FOCSIDX() {
+
+	Kind		= FOCSIDX_SORTED;
+	Seg		= 0;
+	Offset		= 0;
+	Type		= FIELDTYPE_ALPHA;
+	Length		= 0;
+
+	Key		= NULL;
+	Key_first	= NULL;
+	Posting		= NULL;
+	Slot		= NULL;
+	Entry		= NULL;
+	Clear();
+}
+
+FOCSIDX::~FOCSIDX() {
+
+	Clear();
+}
+
+void FOCSIDX::Clear(void) {
+
+	free(Key);
+	free(Key_first);
+	free(Posting);
+	free(Slot);
+	Stamps.clear();
+
+	Key		= NULL;
+	Key_first	= NULL;
+	Num_keys	= 0;
+	Posting		= NULL;
+	Num_postings	= 0;
+	Slot		= NULL;
+	Num_slots	= 0;
+	Last		= -1;
+}
+
+// Walk every record of seg, then sort or hash what was found
+void FOCSIDX::build(FOCFILE* foc, int seg, int offset, char type,
+			int length, int kind) {
+
+	if (seg < 1 || seg > foc->number_seg()) {
+		die("SIDX on non-existant segment %d\n", seg);
+	}
+	if (type == FIELDTYPE_INTEGER || type == FIELDTYPE_SMDATE ||
+			type == FIELDTYPE_FLOAT) {
+		length = 4;
+	}
+	else if (type == FIELDTYPE_DOUBLE) {
+		length = 8;
+	}
+	else if (type != FIELDTYPE_ALPHA) {
+		die("SIDX field has unknown type %c\n", type);
+	}
+	if (kind != FOCSIDX_SORTED && kind != FOCSIDX_HASHED) {
+		die("SIDX has unknown kind %d\n", kind);
+	}
+
+	Clear();
+	Kind		= kind;
+	Seg		= seg;
+	Offset		= offset;
+	Type		= type;
+	Length		= length;
+	Allocated_entries = 0;
+
+	Stamps.start(foc);
+	foc->walk(Seg, Walked, this);
+	Stamps.end();
+
+	if (Kind == FOCSIDX_SORTED) {
+		Make_sorted();
+	}
+	else {
+		Make_hashed();
+	}
+
+	free(Entry);
+	Entry = NULL;
+	Allocated_entries = 0;
+
+	debug("SIDX::build %ld keys, %ld postings, %d pages\n",
+		Num_keys, Num_postings, Stamps.pages());
+}
+
+void FOCSIDX::Walked(FOCFILE* foc, int seg, void* arg) {
+
+	((FOCSIDX*) arg)->Add_entry(foc);
+}
+
+void FOCSIDX::Add_entry(FOCFILE* foc) {
+
+	FOCPTR		where;
+	UCHAR		*entry;
+	int32_t		n;
+	int		width = Length + 3 * sizeof(int32_t);
+
+	foc->position(Seg, where);
+	Stamps.add(foc, Seg, where.page);
+
+	if (Num_postings == Allocated_entries) {
+		Allocated_entries = Allocated_entries ?
+				Allocated_entries * 2 : 4096;
+		Entry = (UCHAR*) xrealloc("SIDX entries", Entry,
+				width * Allocated_entries);
+	}
+
+	entry = Entry + width * Num_postings;
+	memcpy(entry, foc->record_data(Seg) + Offset, Length);
+	n = Num_postings;
+	memcpy(entry + Length, &n, sizeof(int32_t));
+	memcpy(entry + Length + 4, &where.page, sizeof(int32_t));
+	memcpy(entry + Length + 8, &where.word, sizeof(int32_t));
+	Num_postings++;
+}
+
+// Sort the entries by key, then by the order they were found in, and
+// pull out the distinct keys.
+void FOCSIDX::Make_sorted(void) {
+
+	int	width = Length + 3 * sizeof(int32_t);
+	UCHAR	*entry;
+
+	Sort_type	= Type;
+	Sort_length	= Length;
+	qsort(Entry, Num_postings, width, entry_order);
+
+	Key = (UCHAR*) xrealloc("SIDX keys", NULL,
+			(long) Length * Num_postings + 1);
+	Key_first = (int32_t*) xrealloc("SIDX keys", NULL,
+			sizeof(int32_t) * (Num_postings + 1));
+	Posting = (FOCSIDX_POSTING*) xrealloc("SIDX postings", NULL,
+			sizeof(FOCSIDX_POSTING) * (Num_postings + 1));
+
+	Num_keys = 0;
+	for (long i = 0; i < Num_postings; i++) {
+		entry = Entry + width * i;
+		if (Num_keys == 0 || field_compare(Type, Length, entry,
+				Key + Length * (Num_keys - 1)) != 0) {
+			memcpy(Key + Length * Num_keys, entry, Length);
+			Key_first[Num_keys++] = i;
+		}
+		memcpy(&Posting[i].page, entry + Length + 4, sizeof(int32_t));
+		memcpy(&Posting[i].word, entry + Length + 8, sizeof(int32_t));
+	}
+	Key_first[Num_keys] = Num_postings;
+}
+
+// Hash the entries in the order they were found in, count each key's
+// postings, then lay the postings out key by key.
+void FOCSIDX::Make_hashed(void) {
+
+	int	width = Length + 3 * sizeof(int32_t);
+	int32_t	*key_of;
+	UCHAR	*entry;
+	long	i, s, k;
+
+	for (Num_slots = 1024; Num_slots < 2 * Num_postings; Num_slots *= 2)
+		;
+	Slot = (int32_t*) xrealloc("SIDX slots", NULL,
+			sizeof(int32_t) * Num_slots);
+	memset(Slot, 0, sizeof(int32_t) * Num_slots);
+
+	Key = (UCHAR*) xrealloc("SIDX keys", NULL,
+			(long) Length * Num_postings + 1);
+	Key_first = (int32_t*) xrealloc("SIDX keys", NULL,
+			sizeof(int32_t) * (Num_postings + 1));
+	key_of = (int32_t*) xrealloc("SIDX keys", NULL,
+			sizeof(int32_t) * (Num_postings + 1));
+
+	Num_keys = 0;
+	for (i = 0; i < Num_postings; i++) {
+		entry = Entry + width * i;
+		s = Hash_slot(entry);
+		if (Slot[s] == 0) {
+			memcpy(Key + Length * Num_keys, entry, Length);
+			Key_first[Num_keys] = 0;
+			Slot[s] = ++Num_keys;
+		}
+		k = Slot[s] - 1;
+		key_of[i] = k;
+		Key_first[k]++;
+	}
+
+	// Counts to starts
+	long start = 0;
+	for (k = 0; k < Num_keys; k++) {
+		long count = Key_first[k];
+		Key_first[k] = start;
+		start += count;
+	}
+	Key_first[Num_keys] = start;
+
+	Posting = (FOCSIDX_POSTING*) xrealloc("SIDX postings", NULL,
+			sizeof(FOCSIDX_POSTING) * (Num_postings + 1));
+	for (i = 0; i < Num_postings; i++) {
+		entry = Entry + width * i;
+		FOCSIDX_POSTING *p = &Posting[Key_first[key_of[i]]++];
+		memcpy(&p->page, entry + Length + 4, sizeof(int32_t));
+		memcpy(&p->word, entry + Length + 8, sizeof(int32_t));
+	}
+
+	// Filling them in moved each start to the next key's
+	for (k = Num_keys; k > 0; k--) {
+		Key_first[k] = Key_first[k - 1];
+	}
+	Key_first[0] = 0;
+
+	free(key_of);
+}
+
+// The slot that holds the key, or the empty one it would go in.
+// Hashed on the raw bytes, the way match() compares them.
+long FOCSIDX::Hash_slot(UCHAR* key) {
+
+	uint32_t	hash = 2166136261u;
+	long		s;
+
+	for (int i = 0; i < Length; i++) {
+		hash = (hash ^ key[i]) * 16777619u;
+	}
+
+	for (s = hash & (Num_slots - 1); Slot[s] != 0;
+			s = (s + 1) & (Num_slots - 1)) {
+		if (memcmp(Key + Length * (Slot[s] - 1), key, Length) == 0) {
+			break;
+		}
+	}
+
+	return s;
+}
+
+// The key's number, or -1
+long FOCSIDX::Lookup(void* key) {
+
+	if (Num_keys == 0) {
+		return -1;
+	}
+
+	if (Kind == FOCSIDX_HASHED) {
+		long s = Hash_slot((UCHAR*) key);
+		return Slot[s] - 1;
+	}
+
+	long	low = 0, high = Num_keys;
+	while (low < high) {
+		long middle = (low + high) / 2;
+		if (field_compare(Type, Length, Key + Length * middle,
+					(UCHAR*) key) < 0) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	if (low < Num_keys && field_compare(Type, Length,
+				Key + Length * low, (UCHAR*) key) == 0) {
+		return low;
+	}
+	return -1;
+}
+
+void FOCSIDX::write(FILE* fh) {
+
+	FOCSIDX_HEADER	h;
+
+	memset(&h, 0, sizeof(FOCSIDX_HEADER));
+	memcpy(h.magic, FOCSIDX_MAGIC, 8);
+	h.kind		= Kind;
+	h.seg		= Seg;
+	h.offset	= Offset;
+	h.type		= Type;
+	h.length	= Length;
+	h.keys		= Num_keys;
+	h.postings	= Num_postings;
+	h.slots		= Num_slots;
+
+	if (fwrite(&h, sizeof(FOCSIDX_HEADER), 1, fh) != 1 ||
+		fwrite(Key, Length, Num_keys, fh) != (size_t) Num_keys ||
+		fwrite(Key_first, sizeof(int32_t), Num_keys + 1, fh) !=
+			(size_t) Num_keys + 1 ||
+		fwrite(Posting, sizeof(FOCSIDX_POSTING), Num_postings, fh) !=
+			(size_t) Num_postings ||
+		fwrite(Slot, sizeof(int32_t), Num_slots, fh) !=
+			(size_t) Num_slots ||
+		!Stamps.write(fh)) {
+		die("SIDX: can't write the index\n");
+	}
+}
+
+// Returns 1, or 0 if the FOCUS file has changed since it was built
+int FOCSIDX::read(FILE* fh, FOCFILE* foc) {
+
+	FOCSIDX_HEADER	h;
+
+	if (fread(&h, sizeof(FOCSIDX_HEADER), 1, fh) != 1 ||
+			memcmp(h.magic, FOCSIDX_MAGIC, 8) != 0) {
+		die("SIDX: not a sidecar index\n");
+	}
+
+	Clear();
+	Kind		= h.kind;
+	Seg		= h.seg;
+	Offset		= h.offset;
+	Type		= h.type;
+	Length		= h.length;
+	Num_keys	= h.keys;
+	Num_postings	= h.postings;
+	Num_slots	= h.slots;
+
+	Key = (UCHAR*) xrealloc("SIDX keys", NULL,
+			(long) Length * Num_keys + 1);
+	Key_first = (int32_t*) xrealloc("SIDX keys", NULL,
+			sizeof(int32_t) * (Num_keys + 1));
+	Posting = (FOCSIDX_POSTING*) xrealloc("SIDX postings", NULL,
+			sizeof(FOCSIDX_POSTING) * (Num_postings + 1));
+	if (Num_slots > 0) {
+		Slot = (int32_t*) xrealloc("SIDX slots", NULL,
+				sizeof(int32_t) * Num_slots);
+	}
+
+	if (fread(Key, Length, Num_keys, fh) != (size_t) Num_keys ||
+		fread(Key_first, sizeof(int32_t), Num_keys + 1, fh) !=
+			(size_t) Num_keys + 1 ||
+		fread(Posting, sizeof(FOCSIDX_POSTING), Num_postings, fh) !=
+			(size_t) Num_postings ||
+		fread(Slot, sizeof(int32_t), Num_slots, fh) !=
+			(size_t) Num_slots ||
+		!Stamps.read(fh)) {
+		die("SIDX: index is cut short\n");
+	}
+
+	return Stamps.current(foc);
+}
+
+// Read every page with a record on it, and count those that have changed
+int FOCSIDX::stale(FOCFILE* foc) {
+
+	return Stamps.stale(foc);
+}
+
+int FOCSIDX::find(char* key) {
+	return find((void*) key);
+}
+int FOCSIDX::find(long& key) {
+	int32_t value = (int32_t) key;
+	return find((void*) &value);
+}
+int FOCSIDX::find(int32_t& key) {
+	return find((void*) &key);
+}
+int FOCSIDX::find(double& key) {
+	return find((void*) &key);
+}
+int FOCSIDX::find(float& key) {
+	return find((void*) &key);
+}
+int FOCSIDX::find(SMDATE& key) {
+	int32_t date = (int32_t) key.julian();
+	return find((void*) &date);
+}
+
+int FOCSIDX::find(void* key) {
+
+	long k = Lookup(key);
+
+	if (k < 0) {
+		return 0;
+	}
+	return Key_first[k + 1] - Key_first[k];
+}
+
+int FOCSIDX::match(FOCFILE* foc, char* key) {
+	return match(foc, (void*) key);
+}
+int FOCSIDX::match(FOCFILE* foc, long& key) {
+	int32_t value = (int32_t) key;
+	return match(foc, (void*) &value);
+}
+int FOCSIDX::match(FOCFILE* foc, int32_t& key) {
+	return match(foc, (void*) &key);
+}
+int FOCSIDX::match(FOCFILE* foc, double& key) {
+	return match(foc, (void*) &key);
+}
+int FOCSIDX::match(FOCFILE* foc, float& key) {
+	return match(foc, (void*) &key);
+}
+int FOCSIDX::match(FOCFILE* foc, SMDATE& key) {
+	int32_t date = (int32_t) key.julian();
+	return match(foc, (void*) &date);
+}
+
+// The postings of a key lie together, in the order a walk from the
+// root reaches them. The cursor still being on the last one moved to
+// means the caller wants the next.
+int FOCSIDX::match(FOCFILE* foc, void* key) {
+
+	FOCPTR		where;
+	long		k = Lookup(key), next;
+
+	if (k < 0) {
+		Last = -1;
+		return 0;
+	}
+
+	next = Key_first[k];
+	if (Last >= Key_first[k] && Last < Key_first[k + 1] &&
+			foc->position(Seg, where) &&
+			where.page == Posting[Last].page &&
+			where.word == Posting[Last].word) {
+		next = Last + 1;
+	}
+
+	if (next == Key_first[k + 1]) {
+		Last = -1;
+		return 0;
+	}
+
+	// Is the page as it was?
+	if (!Stamps.read_page(foc, Seg, Posting[next].page)) {
+		die("SIDX page %d has changed since the index was built\n",
+			Posting[next].page);
+	}
+
+	where.type = 0;
+	where.page = Posting[next].page;
+	where.word = Posting[next].word;
+	foc->set_position(Seg, where);
+
+	Last = next;
+	return 1;
+}
+
+// =============================================================
+// Extra functions
+// =============================================================
+
+int entry_order(const void *a, const void *b) {
+
+	int c = field_compare(Sort_type, Sort_length, (UCHAR*) a, (UCHAR*) b);
+	if (c != 0) {
+		return c;
+	}
+
+	int32_t x = mkint32((UCHAR*) a + Sort_length);
+	int32_t y = mkint32((UCHAR*) b + Sort_length);
+	return (x > y) - (x < y);
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
@@ -0,0 +1,144 @@
+/*
+    focsidx.h
+    ---------
+    Sidecar indexes for the FocFile C++ library. A FOCSIDX indexes any
+    field of a segment, indexed in the master or not, and is kept in a
+    file of its own next to the FOCUS file. A lookup moves the segment's
+    cursor to each record with the key in turn, as match_index() does.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCSIDX_H
+#define FOCSIDX_H
+
+#ifndef FOCSTAMP_H
+#include "focstamp.h"
+#endif /* FOCSTAMP_H */
+
+#define FOCSIDX_MAGIC	"FOCSIDX2"
+
+// How the keys are looked up
+#define FOCSIDX_SORTED	1	// binary search; smaller
+#define FOCSIDX_HASHED	2	// one probe or so; quicker to build
+
+struct FOCSIDX_POSTING;
+
+// The index is built once by walking every record of the segment, and
+// kept in a file next to the FOCUS file:
+//
+//	FOCSIDX sidx;
+//	sidx.build(foc, FOCFLD_ORDERS_AMOUNT, FOCSIDX_HASHED);
+//	sidx.write(fh);
+//
+// and later:
+//
+//	if (!sidx.read(fh, foc)) ...rebuild it...
+//	while (sidx.match(foc, amount)) {
+//		foc->hold(...);
+//	}
+//
+// The stamp of each page with a record on it is kept in the index, and
+// the FDT's (see focstamp.h). read() returns 0 if the FDT has changed since, stale()
+// reads every page to count those that have, and match() dies if the
+// page it moves to has changed.
+class FOCSIDX {
+
+public:
+	FOCSIDX();
+	~FOCSIDX();
+
+	void	build(FOCFILE* foc, int seg, int offset, char type,
+			int length, int kind=FOCSIDX_SORTED);
+	void	write(FILE* fh);
+	int	read(FILE* fh, FOCFILE* foc);
+	int	stale(FOCFILE* foc);
+
+	// How many records have the key
+private:
+	int	find(void* key);
+public:
+	int	find(char* key);
+	int	find(long& key);
+	int	find(int32_t& key);
+	int	find(double& key);
+	int	find(float& key);
+	int	find(SMDATE& key);
+
+	// Move the segment's cursor to the first record with the key, or
+	// if it's still on the record the last match() moved it to, to the
+	// next one. Returns 0 after the last.
+private:
+	int	match(FOCFILE* foc, void* key);
+public:
+	int	match(FOCFILE* foc, char* key);
+	int	match(FOCFILE* foc, long& key);
+	int	match(FOCFILE* foc, int32_t& key);
+	int	match(FOCFILE* foc, double& key);
+	int	match(FOCFILE* foc, float& key);
+	int	match(FOCFILE* foc, SMDATE& key);
+
+	int	kind(void) { return Kind; };
+	int	segment(void) { return Seg; };
+	long	keys(void) { return Num_keys; };
+	long	postings(void) { return Num_postings; };
+
+private:
+	void	Clear(void);
+	static void Walked(FOCFILE* foc, int seg, void* arg);
+	void	Add_entry(FOCFILE* foc);
+	void	Make_sorted(void);
+	void	Make_hashed(void);
+	long	Lookup(void* key);
+	long	Hash_slot(UCHAR* key);
+
+private:
+	int		Kind;
+	int		Seg;
+	int		Offset;
+	char		Type;
+	int		Length;
+
+	// Each distinct key, and where its postings start in Posting
+	UCHAR		*Key;
+	int32_t		*Key_first;	// [Num_keys + 1]
+	long		Num_keys;
+	FOCSIDX_POSTING	*Posting;
+	long		Num_postings;
+
+	// Hashed: key number + 1, or 0 for an empty slot
+	int32_t		*Slot;
+	long		Num_slots;
+
+	// The FDT and the pages the records are on
+	FOCSTAMPTABLE	Stamps;
+
+	// The posting the last match() moved to, or -1
+	long		Last;
+
+	// While building: key, sequence number, page, word
+	UCHAR		*Entry;
+	long		Allocated_entries;
+};
+
+#endif /* FOCSIDX_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
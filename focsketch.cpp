@@ -0,0 +1,642 @@
+/*
+    focsketch.cpp
+    -------------
+    Sketches for the FocFile C++ library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "focsketch.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+// Where a sketch file says what it is a sketch of, in the machine's
+// byte order
+struct FOCSKETCH_HEADER {
+	char	magic[8];
+	int32_t	seg;
+	int32_t	offset;
+	int32_t	length;
+	int32_t	size;		// precision, or k
+	int32_t	levels;		// FOCQUANTILES only
+	char	type;
+	UCHAR	unused[3];
+};
+
+struct FOCQUANTILES_LEVEL {
+	double	*value;
+	int	count;
+	int	allocated;
+};
+
+struct FOCQUANTILES_ITEM {
+	double	value;
+	long	weight;
+};
+
+static uint64_t hash_field(UCHAR *field, int length);
+static int double_order(const void *a, const void *b);
+static int item_order(const void *a, const void *b);
+
+// =============================================================
+// CLASS: FOCHLL
+// -------------------------------------------------------------
+// HyperLogLog: about how many distinct values a field has.
+// =============================================================
+FOCHLL::FOCHLL(int seg, int offset, char type, int length, int precision) {
+
+	if (precision < 4 || precision > 16) {
+		die("HLL precision %d is not from 4 to 16\n", precision);
+	}
+
+	Seg		= seg;
+	Offset		= offset;
+	Type		= type;
+	Length		= length;
+	Precision	= precision;
+	Num_registers	= 1 << precision;
+	Register	= (UCHAR*) xrealloc("HLL registers", NULL,
+				Num_registers);
+
+	clear();
+}
+
+FOCHLL::FOCHLL(const FOCHLL& other) {
+
+	Register = NULL;
+	*this = other;
+}
+
+FOCHLL& FOCHLL::operator=(const FOCHLL& other) {
+
+	if (this == &other) {
+		return *this;
+	}
+
+	Seg		= other.Seg;
+	Offset		= other.Offset;
+	Type		= other.Type;
+	Length		= other.Length;
+	Precision	= other.Precision;
+	Num_registers	= other.Num_registers;
+	Register	= (UCHAR*) xrealloc("HLL registers", Register,
+				Num_registers);
+	memcpy(Register, other.Register, Num_registers);
+
+	return *this;
+}
+
+FOCHLL::~FOCHLL() {
+
+	free(Register);
+}
+
+void FOCHLL::clear(void) {
+
+	memset(Register, 0, Num_registers);
+}
+
+void FOCHLL::add(UCHAR* data) {
+
+	add_bytes(data + Offset);
+}
+
+// The first Precision bits of the hash pick the register; it keeps the
+// most leading zeros, plus one, seen in the rest
+void FOCHLL::add_bytes(UCHAR* field) {
+
+	uint64_t	h = hash_field(field, Length);
+	int		j = (int) (h >> (64 - Precision));
+	int		rank = 1;
+
+	h <<= Precision;
+	while (rank <= 64 - Precision && !(h & 0x8000000000000000ULL)) {
+		rank++;
+		h <<= 1;
+	}
+
+	if (rank > Register[j]) {
+		Register[j] = rank;
+	}
+}
+
+void FOCHLL::merge(FOCHLL& other) {
+
+	if (other.Seg != Seg || other.Offset != Offset ||
+			other.Type != Type || other.Length != Length) {
+		die("HLL can't merge field %d,%d,%c,%d into field %d,%d,%c,%d\n",
+			other.Seg, other.Offset, other.Type, other.Length,
+			Seg, Offset, Type, Length);
+	}
+	if (other.Precision != Precision) {
+		die("HLL can't merge precision %d into precision %d\n",
+			other.Precision, Precision);
+	}
+
+	for (int j = 0; j < Num_registers; j++) {
+		if (other.Register[j] > Register[j]) {
+			Register[j] = other.Register[j];
+		}
+	}
+}
+
+// The harmonic mean of 2^register, scaled; while many registers are
+// still 0, counting those is closer
+double FOCHLL::estimate(void) {
+
+	double	m = Num_registers;
+	double	sum = 0, estimate;
+	int	zeros = 0;
+
+	for (int j = 0; j < Num_registers; j++) {
+		sum += ldexp(1.0, -Register[j]);
+		if (Register[j] == 0) {
+			zeros++;
+		}
+	}
+
+	estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+	if (estimate <= 2.5 * m && zeros > 0) {
+		estimate = m * log(m / zeros);
+	}
+
+	return estimate;
+}
+
+void FOCHLL::write(FILE* fh) {
+
+	FOCSKETCH_HEADER	header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, FOCHLL_MAGIC, 8);
+	header.seg	= Seg;
+	header.offset	= Offset;
+	header.length	= Length;
+	header.size	= Precision;
+	header.type	= Type;
+
+	if (fwrite(&header, sizeof(header), 1, fh) != 1 ||
+			fwrite(Register, 1, Num_registers, fh) !=
+			(size_t) Num_registers) {
+		die("HLL: can't write the sketch\n");
+	}
+}
+
+// Replace the sketch with one of the same field, written with the
+// same precision
+void FOCHLL::read(FILE* fh) {
+
+	FOCSKETCH_HEADER	header;
+
+	if (fread(&header, sizeof(header), 1, fh) != 1 ||
+			memcmp(header.magic, FOCHLL_MAGIC, 8) != 0) {
+		die("HLL: not a HyperLogLog sketch\n");
+	}
+	if (header.seg != Seg || header.offset != Offset ||
+			header.type != Type || header.length != Length) {
+		die("HLL: sketch is of field %d,%d,%c,%d, not %d,%d,%c,%d\n",
+			header.seg, header.offset, header.type, header.length,
+			Seg, Offset, Type, Length);
+	}
+	if (header.size != Precision) {
+		die("HLL: sketch has precision %d, not %d\n", header.size,
+			Precision);
+	}
+	if (fread(Register, 1, Num_registers, fh) != (size_t) Num_registers) {
+		die("HLL: sketch is cut short\n");
+	}
+}
+
+// =============================================================
+// CLASS: FOCQUANTILES
+// -------------------------------------------------------------
+// A KLL sketch: about where the quantiles of a numeric field lie.
+// =============================================================
+FOCQUANTILES::FOCQUANTILES(int seg, int offset, char type, int length,
+		int k, unsigned long seed) {
+
+	if (type != FIELDTYPE_INTEGER && type != FIELDTYPE_DOUBLE &&
+			type != FIELDTYPE_FLOAT && type != FIELDTYPE_SMDATE) {
+		die("QUANTILES can't sketch a field of type %c\n", type);
+	}
+	if (k < 8) {
+		die("QUANTILES k %d is less than 8\n", k);
+	}
+
+	Seg	= seg;
+	Offset	= offset;
+	Type	= type;
+	Length	= length;
+	K	= k;
+	State	= seed;
+
+	Level		= NULL;
+	Num_levels	= 0;
+	clear();
+}
+
+FOCQUANTILES::FOCQUANTILES(const FOCQUANTILES& other) {
+
+	Level		= NULL;
+	Num_levels	= 0;
+	Copy(other);
+}
+
+FOCQUANTILES& FOCQUANTILES::operator=(const FOCQUANTILES& other) {
+
+	if (this != &other) {
+		Copy(other);
+	}
+	return *this;
+}
+
+FOCQUANTILES::~FOCQUANTILES() {
+
+	Free_levels();
+}
+
+void FOCQUANTILES::Copy(const FOCQUANTILES& other) {
+
+	Free_levels();
+
+	Seg	= other.Seg;
+	Offset	= other.Offset;
+	Type	= other.Type;
+	Length	= other.Length;
+	K	= other.K;
+	State	= other.State;
+	Size	= other.Size;
+	Count	= other.Count;
+	Min	= other.Min;
+	Max	= other.Max;
+
+	for (int h = 0; h < other.Num_levels; h++) {
+		Add_level();
+		for (int i = 0; i < other.Level[h].count; i++) {
+			Append(h, other.Level[h].value[i]);
+		}
+	}
+}
+
+void FOCQUANTILES::Free_levels(void) {
+
+	for (int h = 0; h < Num_levels; h++) {
+		free(Level[h].value);
+	}
+	free(Level);
+
+	Level		= NULL;
+	Num_levels	= 0;
+	Max_size	= 0;
+}
+
+void FOCQUANTILES::clear(void) {
+
+	Free_levels();
+	Size	= 0;
+	Count	= 0;
+	Min	= 0;
+	Max	= 0;
+}
+
+// The top level holds k values, and each one below it 2/3 as many
+int FOCQUANTILES::Capacity(int level) {
+
+	double c = K;
+
+	for (int h = level + 1; h < Num_levels; h++) {
+		c *= 2.0 / 3.0;
+	}
+
+	return c < 2 ? 2 : (int) ceil(c);
+}
+
+void FOCQUANTILES::Add_level(void) {
+
+	Level = (FOCQUANTILES_LEVEL*) xrealloc("QUANTILES levels", Level,
+			sizeof(FOCQUANTILES_LEVEL) * (Num_levels + 1));
+	memset(&Level[Num_levels], 0, sizeof(FOCQUANTILES_LEVEL));
+	Num_levels++;
+
+	Max_size = 0;
+	for (int h = 0; h < Num_levels; h++) {
+		Max_size += Capacity(h);
+	}
+}
+
+void FOCQUANTILES::Append(int level, double value) {
+
+	FOCQUANTILES_LEVEL *l = &Level[level];
+
+	if (l->count == l->allocated) {
+		l->allocated = l->allocated ? l->allocated * 2 : 16;
+		l->value = (double*) xrealloc("QUANTILES values", l->value,
+				sizeof(double) * l->allocated);
+	}
+	l->value[l->count++] = value;
+}
+
+void FOCQUANTILES::add(UCHAR* data) {
+
+	add_value(field_value(Type, data + Offset));
+}
+
+void FOCQUANTILES::add_value(double value) {
+
+	if (Count == 0 || value < Min) Min = value;
+	if (Count == 0 || value > Max) Max = value;
+	Count++;
+
+	if (Num_levels == 0) {
+		Add_level();
+	}
+	Append(0, value);
+	Size++;
+
+	Compress();
+}
+
+// While the sketch holds more than its levels' capacities, halve the
+// lowest full level: sort it and move every other value up a level,
+// the first or the second at random. An odd one out stays behind.
+void FOCQUANTILES::Compress(void) {
+
+	FOCQUANTILES_LEVEL	*l;
+	int			h, i, c, pairs, first;
+
+	while (Size >= Max_size) {
+		for (h = 0; h < Num_levels; h++) {
+			if (Level[h].count >= Capacity(h)) {
+				break;
+			}
+		}
+		if (h == Num_levels) {
+			return;
+		}
+		if (h + 1 == Num_levels) {
+			Add_level();
+		}
+
+		l = &Level[h];
+		qsort(l->value, l->count, sizeof(double), double_order);
+
+		c	= l->count;
+		pairs	= c / 2;
+		first	= sample_random(&State) & 1;
+		for (i = 0; i < pairs; i++) {
+			Append(h + 1, l->value[2 * i + first]);
+		}
+
+		l = &Level[h];
+		if (c & 1) {
+			l->value[0] = l->value[c - 1];
+		}
+		l->count = c & 1;
+		Size -= pairs;
+	}
+}
+
+void FOCQUANTILES::merge(FOCQUANTILES& other) {
+
+	if (other.Seg != Seg || other.Offset != Offset ||
+			other.Type != Type || other.Length != Length) {
+		die("QUANTILES can't merge field %d,%d,%c,%d into field "
+			"%d,%d,%c,%d\n", other.Seg, other.Offset, other.Type,
+			other.Length, Seg, Offset, Type, Length);
+	}
+	if (other.K != K) {
+		die("QUANTILES can't merge k %d into k %d\n", other.K, K);
+	}
+	if (other.Count == 0) {
+		return;
+	}
+
+	if (Count == 0 || other.Min < Min) Min = other.Min;
+	if (Count == 0 || other.Max > Max) Max = other.Max;
+	Count += other.Count;
+
+	for (int h = 0; h < other.Num_levels; h++) {
+		while (Num_levels <= h) {
+			Add_level();
+		}
+		for (int i = 0; i < other.Level[h].count; i++) {
+			Append(h, other.Level[h].value[i]);
+		}
+		Size += other.Level[h].count;
+	}
+
+	Compress();
+}
+
+// Every value kept, with how many it stands for, in order
+long FOCQUANTILES::Sorted(FOCQUANTILES_ITEM** items) {
+
+	long	n = 0;
+
+	*items = (FOCQUANTILES_ITEM*) xrealloc("QUANTILES items", NULL,
+			sizeof(FOCQUANTILES_ITEM) * (Size + 1));
+
+	for (int h = 0; h < Num_levels; h++) {
+		for (int i = 0; i < Level[h].count; i++, n++) {
+			(*items)[n].value  = Level[h].value[i];
+			(*items)[n].weight = 1L << h;
+		}
+	}
+
+	qsort(*items, n, sizeof(FOCQUANTILES_ITEM), item_order);
+	return n;
+}
+
+double FOCQUANTILES::quantile(double q) {
+
+	FOCQUANTILES_ITEM	*items;
+	long			n, i;
+	double			seen = 0, value;
+
+	if (Count == 0) {
+		return 0;
+	}
+	if (q <= 0) {
+		return Min;
+	}
+	if (q >= 1) {
+		return Max;
+	}
+
+	n = Sorted(&items);
+	value = Max;
+	for (i = 0; i < n; i++) {
+		seen += items[i].weight;
+		if (seen >= q * Count) {
+			value = items[i].value;
+			break;
+		}
+	}
+
+	free(items);
+	return value;
+}
+
+double FOCQUANTILES::rank(double value) {
+
+	FOCQUANTILES_ITEM	*items;
+	long			n, i;
+	double			below = 0;
+
+	if (Count == 0) {
+		return 0;
+	}
+
+	n = Sorted(&items);
+	for (i = 0; i < n && items[i].value < value; i++) {
+		below += items[i].weight;
+	}
+
+	free(items);
+	return below / Count;
+}
+
+// The header, the count, min and max, then each level's count and
+// values
+void FOCQUANTILES::write(FILE* fh) {
+
+	FOCSKETCH_HEADER	header;
+	int64_t			count = Count;
+	int32_t			n;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, FOCQUANTILES_MAGIC, 8);
+	header.seg	= Seg;
+	header.offset	= Offset;
+	header.length	= Length;
+	header.size	= K;
+	header.levels	= Num_levels;
+	header.type	= Type;
+
+	if (fwrite(&header, sizeof(header), 1, fh) != 1 ||
+			fwrite(&count, sizeof(int64_t), 1, fh) != 1 ||
+			fwrite(&Min, sizeof(double), 1, fh) != 1 ||
+			fwrite(&Max, sizeof(double), 1, fh) != 1) {
+		die("QUANTILES: can't write the sketch\n");
+	}
+
+	for (int h = 0; h < Num_levels; h++) {
+		n = Level[h].count;
+		if (fwrite(&n, sizeof(int32_t), 1, fh) != 1 ||
+				fwrite(Level[h].value, sizeof(double), n, fh) !=
+				(size_t) n) {
+			die("QUANTILES: can't write the sketch\n");
+		}
+	}
+}
+
+// Replace the sketch with one written with the same k
+void FOCQUANTILES::read(FILE* fh) {
+
+	FOCSKETCH_HEADER	header;
+	int64_t			count;
+	int32_t			n;
+	double			value;
+
+	if (fread(&header, sizeof(header), 1, fh) != 1 ||
+			memcmp(header.magic, FOCQUANTILES_MAGIC, 8) != 0) {
+		die("QUANTILES: not a quantile sketch\n");
+	}
+	if (header.seg != Seg || header.offset != Offset ||
+			header.type != Type || header.length != Length) {
+		die("QUANTILES: sketch is of field %d,%d,%c,%d, not "
+			"%d,%d,%c,%d\n", header.seg, header.offset,
+			header.type, header.length, Seg, Offset, Type, Length);
+	}
+	if (header.size != K) {
+		die("QUANTILES: sketch has k %d, not %d\n", header.size, K);
+	}
+
+	clear();
+	if (fread(&count, sizeof(int64_t), 1, fh) != 1 ||
+			fread(&Min, sizeof(double), 1, fh) != 1 ||
+			fread(&Max, sizeof(double), 1, fh) != 1) {
+		die("QUANTILES: sketch is cut short\n");
+	}
+	Count = (long) count;
+
+	for (int h = 0; h < header.levels; h++) {
+		Add_level();
+		if (fread(&n, sizeof(int32_t), 1, fh) != 1) {
+			die("QUANTILES: sketch is cut short\n");
+		}
+		for (int i = 0; i < n; i++) {
+			if (fread(&value, sizeof(double), 1, fh) != 1) {
+				die("QUANTILES: sketch is cut short\n");
+			}
+			Append(h, value);
+		}
+		Size += n;
+	}
+}
+
+// =============================================================
+// Extra functions
+// =============================================================
+
+// FNV-1a, then mixed so that every bit of a short field reaches every
+// bit of the hash
+uint64_t hash_field(UCHAR *field, int length) {
+
+	uint64_t h = 14695981039346656037ULL;
+
+	for (int i = 0; i < length; i++) {
+		h = (h ^ field[i]) * 1099511628211ULL;
+	}
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	return h;
+}
+
+int double_order(const void *a, const void *b) {
+
+	double x = *(const double*) a, y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+int item_order(const void *a, const void *b) {
+
+	double x = ((const FOCQUANTILES_ITEM*) a)->value;
+	double y = ((const FOCQUANTILES_ITEM*) b)->value;
+	return (x > y) - (x < y);
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
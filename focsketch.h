@@ -0,0 +1,173 @@
+/*
+    focsketch.h
+    -----------
+    Sketches for the FocFile C++ library. A FOCHLL estimates how many
+    distinct values a field has, and a FOCQUANTILES the quantiles of a
+    numeric field, each in a fixed amount of memory however many records
+    it is fed. Sketches of the same field can be merged, so that parts of
+    a segment can be read apart and their sketches put together.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCSKETCH_H
+#define FOCSKETCH_H
+
+#ifndef FOCFILE_H
+#include "focfile.h"
+#endif /* FOCFILE_H */
+
+#define FOCHLL_MAGIC		"FOCHLL01"
+#define FOCQUANTILES_MAGIC	"FOCKLL01"
+
+// The defaults: 2^12 registers, for a standard error of 1.6%, and 200
+// values on the top level, for ranks within about 2% of the records
+#define FOCHLL_PRECISION	12
+#define FOCQUANTILES_K		200
+
+struct FOCQUANTILES_LEVEL;
+struct FOCQUANTILES_ITEM;
+
+// HyperLogLog. Each value's field bytes are hashed; the first bits of
+// the hash pick a register, which keeps the longest run of zero bits
+// seen after them. A field is given as its FOCFLD macro, and add() is
+// passed the data area of a record of its segment, from FOCSCAN,
+// FOCZONESCAN, FOCSAMPLESCAN or FOCFILE::record_data():
+//
+//	FOCHLL days(FOCFLD_ORDERS_ORDER_DATE);
+//	while (scan.next()) {
+//		days.add(scan.record());
+//	}
+//	printf("orders on about %.0lf days\n", days.estimate());
+class FOCHLL {
+
+public:
+	FOCHLL(int seg, int offset, char type, int length,
+		int precision=FOCHLL_PRECISION);
+	FOCHLL(const FOCHLL& other);
+	FOCHLL& operator=(const FOCHLL& other);
+	~FOCHLL();
+
+	void	add(UCHAR* data);
+	void	add_bytes(UCHAR* field);	// the field itself
+
+	// Take in the values of another sketch of the same field, with
+	// the same precision
+	void	merge(FOCHLL& other);
+
+	double	estimate(void);
+	void	clear(void);
+
+	void	write(FILE* fh);
+	void	read(FILE* fh);
+
+	int	segment(void) { return Seg; };
+	int	precision(void) { return Precision; };
+
+private:
+	int	Seg;
+	int	Offset;
+	char	Type;
+	int	Length;
+	int	Precision;
+	int	Num_registers;
+	UCHAR	*Register;
+};
+
+// A KLL sketch of a numeric field (I, D, F, or S, as its day number).
+// Values are kept in levels; a value on level h stands for 2^h of
+// them. When a level fills up it is sorted and every other value, from
+// the first or the second at random, moves up a level. Lower levels
+// are kept smaller than higher ones, so the whole sketch stays near 3k
+// values.
+//
+//	FOCQUANTILES amounts(FOCFLD_ORDERS_AMOUNT);
+//	while (scan.next()) {
+//		amounts.add(scan.record());
+//	}
+//	printf("p95 %.2lf\n", amounts.quantile(0.95));
+//
+// The coin that picks first or second is seeded, so the same values in
+// the same order give the same sketch.
+class FOCQUANTILES {
+
+public:
+	FOCQUANTILES(int seg, int offset, char type, int length,
+		int k=FOCQUANTILES_K, unsigned long seed=1);
+	FOCQUANTILES(const FOCQUANTILES& other);
+	FOCQUANTILES& operator=(const FOCQUANTILES& other);
+	~FOCQUANTILES();
+
+	void	add(UCHAR* data);
+	void	add_value(double value);
+
+	// Take in the values of another sketch of the same field, with
+	// the same k
+	void	merge(FOCQUANTILES& other);
+
+	// The value with about a fraction q of the values below it; the
+	// smallest for 0 and the largest for 1. 0 if nothing was added.
+	double	quantile(double q);
+
+	// About what fraction of the values are below value
+	double	rank(double value);
+
+	long	count(void) { return Count; };
+	double	min(void) { return Min; };
+	double	max(void) { return Max; };
+	void	clear(void);
+
+	void	write(FILE* fh);
+	void	read(FILE* fh);
+
+	int	segment(void) { return Seg; };
+
+private:
+	int	Capacity(int level);
+	void	Add_level(void);
+	void	Append(int level, double value);
+	void	Compress(void);
+	void	Copy(const FOCQUANTILES& other);
+	void	Free_levels(void);
+	long	Sorted(FOCQUANTILES_ITEM** items);
+
+private:
+	int		Seg;
+	int		Offset;
+	char		Type;
+	int		Length;
+	int		K;
+
+	FOCQUANTILES_LEVEL *Level;
+	int		Num_levels;
+	long		Size;		// values kept, on all levels
+	long		Max_size;	// the levels' capacities, added up
+
+	long		Count;		// values added
+	double		Min;
+	double		Max;
+
+	uint64_t	State;		// the coin
+};
+
+#endif /* FOCSKETCH_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
@@ -0,0 +1,229 @@
+/*
+    focstamp.cpp
+    ------------
+    Page stamps for the FocFile C++ library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "focstamp.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+#define MAX_PAGES	32768	// page numbers are signed shorts
+
+// In a file, in the machine's byte order: the header, then the pages
+struct FOCSTAMPTABLE_HEADER {
+	int32_t		segments;
+	int32_t		pages;
+	FOCPAGE_STAMP	fdt;
+};
+
+struct FOCSTAMPTABLE_ENTRY {
+	int32_t		page;
+	FOCPAGE_STAMP	stamp;
+};
+
+static int entry_order(const void *a, const void *b);
+
+// =============================================================
+// CLASS: FOCSTAMPTABLE
+// -------------------------------------------------------------
+// The stamps of the FDT and of the pages something was built from.
+// =============================================================
+FOCSTAMPTABLE::FOCSTAMPTABLE() {
+
+	Page		= NULL;
+	Page_slot	= NULL;
+	clear();
+}
+
+FOCSTAMPTABLE::~FOCSTAMPTABLE() {
+
+	clear();
+}
+
+void FOCSTAMPTABLE::clear(void) {
+
+	free(Page);
+	free(Page_slot);
+
+	Num_segments	= 0;
+	memset(&Fdt_stamp, 0, sizeof(FOCPAGE_STAMP));
+	Page		= NULL;
+	Num_pages	= 0;
+	Allocated_pages	= 0;
+	Page_slot	= NULL;
+}
+
+void FOCSTAMPTABLE::start(FOCFILE* foc) {
+
+	clear();
+	Num_segments = foc->number_seg();
+	foc->page_stamp(1, Fdt_stamp);
+
+	Page_slot = (int*) xmalloc("STAMPS slots", sizeof(int) * MAX_PAGES);
+	for (int i = 0; i < MAX_PAGES; i++) {
+		Page_slot[i] = -1;
+	}
+}
+
+int FOCSTAMPTABLE::add(FOCFILE* foc, int seg, int page) {
+
+	if (page <= 0 || page >= MAX_PAGES) {
+		die("STAMPS: record on bad page %d\n", page);
+	}
+	if (Page_slot[page] >= 0) {
+		return Page_slot[page];
+	}
+
+	if (Num_pages == Allocated_pages) {
+		Allocated_pages = Allocated_pages ? Allocated_pages * 2 : 256;
+		Page = (FOCSTAMPTABLE_ENTRY*) xrealloc("STAMPS pages", Page,
+				sizeof(FOCSTAMPTABLE_ENTRY) * Allocated_pages);
+	}
+
+	FOCSTAMPTABLE_ENTRY *e = &Page[Num_pages];
+	memset(e, 0, sizeof(FOCSTAMPTABLE_ENTRY));
+	e->page = page;
+	foc->read_page(seg, page, e->stamp);
+
+	Page_slot[page] = Num_pages;
+	return Num_pages++;
+}
+
+void FOCSTAMPTABLE::end(void) {
+
+	qsort(Page, Num_pages, sizeof(FOCSTAMPTABLE_ENTRY), entry_order);
+	free(Page_slot);
+	Page_slot = NULL;
+
+	debug("STAMPS::end %d pages\n", Num_pages);
+}
+
+int FOCSTAMPTABLE::write(FILE* fh) {
+
+	FOCSTAMPTABLE_HEADER	h;
+
+	memset(&h, 0, sizeof(FOCSTAMPTABLE_HEADER));
+	h.segments	= Num_segments;
+	h.pages		= Num_pages;
+	h.fdt		= Fdt_stamp;
+
+	return fwrite(&h, sizeof(FOCSTAMPTABLE_HEADER), 1, fh) == 1 &&
+		fwrite(Page, sizeof(FOCSTAMPTABLE_ENTRY), Num_pages, fh) ==
+			(size_t) Num_pages;
+}
+
+int FOCSTAMPTABLE::read(FILE* fh) {
+
+	FOCSTAMPTABLE_HEADER	h;
+
+	clear();
+	if (fread(&h, sizeof(FOCSTAMPTABLE_HEADER), 1, fh) != 1) {
+		return 0;
+	}
+
+	Num_segments	= h.segments;
+	Fdt_stamp	= h.fdt;
+	Num_pages	= Allocated_pages = h.pages;
+	Page = (FOCSTAMPTABLE_ENTRY*) xmalloc("STAMPS pages",
+			sizeof(FOCSTAMPTABLE_ENTRY) * (Num_pages + 1));
+
+	return fread(Page, sizeof(FOCSTAMPTABLE_ENTRY), Num_pages, fh) ==
+		(size_t) Num_pages;
+}
+
+int FOCSTAMPTABLE::current(FOCFILE* foc) {
+
+	FOCPAGE_STAMP	stamp;
+
+	foc->page_stamp(1, stamp);
+	if (Num_segments != foc->number_seg() || stamp != Fdt_stamp) {
+		debug("STAMPS::current FDT has changed\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+int FOCSTAMPTABLE::stale(FOCFILE* foc) {
+
+	FOCPAGE_STAMP	stamp;
+	int		changed = 0;
+
+	for (int i = 0; i < Num_pages; i++) {
+		foc->read_page(Page[i].stamp.segment, Page[i].page, stamp);
+		if (stamp != Page[i].stamp) {
+			debug("STAMPS::stale page %d\n", Page[i].page);
+			changed++;
+		}
+	}
+
+	return changed;
+}
+
+// Find the page, then see that it's as it was
+UCHAR* FOCSTAMPTABLE::read_page(FOCFILE* foc, int seg, int page) {
+
+	FOCPAGE_STAMP	stamp;
+	UCHAR		*data;
+	int		low = 0, high = Num_pages;
+
+	while (low < high) {
+		int middle = (low + high) / 2;
+		if (Page[middle].page < page) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	data = foc->read_page(seg, page, stamp);
+	if (low == Num_pages || Page[low].page != page ||
+			stamp != Page[low].stamp) {
+		return NULL;
+	}
+
+	return data;
+}
+
+// =============================================================
+// Extra functions
+// =============================================================
+
+int entry_order(const void *a, const void *b) {
+
+	return ((const FOCSTAMPTABLE_ENTRY*) a)->page -
+		((const FOCSTAMPTABLE_ENTRY*) b)->page;
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
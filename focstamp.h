@@ -0,0 +1,96 @@
+/*
+    focstamp.h
+    ----------
+    Page stamps for the FocFile C++ library. A FOCSTAMPTABLE keeps the
+    stamps of the FDT and of the pages a sidecar index or map was built
+    from, so that it can tell when the FOCUS file has changed since.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCSTAMP_H
+#define FOCSTAMP_H
+
+#ifndef FOCFILE_H
+#include "focfile.h"
+#endif /* FOCFILE_H */
+
+struct FOCSTAMPTABLE_ENTRY;
+
+// Built alongside the index or map, as FOCFILE::walk() meets each
+// record, and written at the end of its file:
+//
+//	stamps.start(foc);
+//	...for each record: stamps.add(foc, seg, where.page);
+//	stamps.end();
+//	stamps.write(fh);
+//
+// and later:
+//
+//	if (!stamps.read(fh)) ...cut short...
+//	if (!stamps.current(foc)) ...rebuild it...
+//	if (!(data = stamps.read_page(foc, seg, page))) ...it changed...
+class FOCSTAMPTABLE {
+
+public:
+	FOCSTAMPTABLE();
+	~FOCSTAMPTABLE();
+
+	void	clear(void);
+
+	// Take the FDT's stamp; then each page's, the first time one of
+	// its records is met. add() returns the page's number in the order
+	// they were met. end() puts them in page order.
+	void	start(FOCFILE* foc);
+	int	add(FOCFILE* foc, int seg, int page);
+	void	end(void);
+
+	// Return 1, or 0 if the file couldn't be written, or is cut short
+	int	write(FILE* fh);
+	int	read(FILE* fh);
+
+	// Has the FDT (or the number of segments) stayed as it was?
+	int	current(FOCFILE* foc);
+
+	// Read every page, and count those that have changed
+	int	stale(FOCFILE* foc);
+
+	// Read a page through seg's page buffer, as FOCFILE::read_page()
+	// does. NULL if it has changed, or isn't in the table.
+	UCHAR*	read_page(FOCFILE* foc, int seg, int page);
+
+	int	pages(void) { return Num_pages; };
+
+private:
+	int			Num_segments;
+	FOCPAGE_STAMP		Fdt_stamp;
+
+	// In page order, once built
+	FOCSTAMPTABLE_ENTRY	*Page;
+	int			Num_pages;
+	int			Allocated_pages;
+
+	int			*Page_slot;	// while building: [page], or -1
+};
+
+#endif /* FOCSTAMP_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
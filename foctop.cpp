@@ -0,0 +1,337 @@
+/*
+    foctop.cpp
+    ----------
+    Top-N queries for the FocFile C++ library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "foctop.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+struct FOCTOP_ENTRY {
+	UCHAR	*key;		// its slot in Keys
+	int	page;
+	int	word;
+	long	seen;		// the scan's count, for ties
+};
+
+static int on_path(FOCFILE *foc, int seg, int s);
+
+// =============================================================
+// CLASS: FOCTOPN
+// -------------------------------------------------------------
+// The best n records of a segment by one field.
+// =============================================================
+FOCTOPN::FOCTOPN(FOCFILE* foc, int seg, int n,
+		int f_seg, int offset, char type, int length, int order) {
+
+	if (seg < 1 || seg > foc->number_seg()) {
+		die("TOPN on non-existant segment %d\n", seg);
+	}
+	if (!on_path(foc, seg, f_seg)) {
+		die("TOPN field in segment %d, which is not segment %d or one "
+			"of its parents\n", f_seg, seg);
+	}
+	if (n < 1) {
+		die("TOPN of %d records\n", n);
+	}
+
+	Foc		= foc;
+	Seg		= seg;
+	N		= n;
+
+	F_seg		= f_seg;
+	Offset		= offset;
+	Type		= type;
+	Length		= length;
+	Order		= order;
+
+	Where		= NULL;
+	Idx		= 0;
+
+	Entry		= NULL;
+	Keys		= NULL;
+	Num_entries	= 0;
+	Gathered	= 0;
+	Key		= NULL;
+
+	Records_read	= 0;
+	rewind();
+}
+
+FOCTOPN::~FOCTOPN() {
+
+	free(Entry);
+	free(Keys);
+	free(Key);
+}
+
+void FOCTOPN::where(FOCEXPR& expr) {
+
+	expr.compile(Foc);
+
+	for (int s = 1; s <= Foc->number_seg(); s++) {
+		if (expr.reads_segment(s) && !on_path(Foc, Seg, s)) {
+			die("TOPN::where tests segment %d, which is not segment "
+				"%d or one of its parents\n", s, Seg);
+		}
+	}
+
+	Where		= &expr;
+	Gathered	= 0;
+	rewind();
+}
+
+void FOCTOPN::index(int idx, char type, int seg) {
+
+	if (idx <= 0 || idx > Foc->number_idx()) {
+		die("TOPN called for non-existant index %d\n", idx);
+	}
+	if (seg != Seg || F_seg != Seg) {
+		die("TOPN::index of segment %d, for a field of segment %d; only "
+			"one on segment %d can be walked\n", seg, F_seg, Seg);
+	}
+	if (type != Type) {
+		die("TOPN::index %d of type %c for a field of type %c\n",
+			idx, type, Type);
+	}
+
+	int key_size = Foc->index_key_size(idx, Type, Seg);
+	if (key_size != Length) {
+		die("TOPN::index %d keys are %d bytes, not the field's %d\n",
+			idx, key_size, Length);
+	}
+
+	free(Key);
+	Key	= (UCHAR*) xmalloc("TOPN key", key_size);
+	Idx	= idx;
+	rewind();
+}
+
+void FOCTOPN::rewind(void) {
+
+	Started	= 0;
+	Current	= 0;
+}
+
+int FOCTOPN::next(void) {
+
+	if (Current >= N) {
+		return 0;
+	}
+
+	return Idx ? Next_indexed() : Next_scanned();
+}
+
+int FOCTOPN::Next_scanned(void) {
+
+	FOCPTR	where;
+
+	if (!Gathered) {
+		Gather();
+	}
+	if (Current >= Num_entries) {
+		return 0;
+	}
+
+	where.type = 0;
+	where.page = Entry[Current].page;
+	where.word = Entry[Current].word;
+	Move_to(where);
+
+	Current++;
+	return 1;
+}
+
+// From the end of the index the best values are at, to the next record
+// that passes the filter. Nothing past the n'th is read.
+int FOCTOPN::Next_indexed(void) {
+
+	FOCPTR	where;
+
+	if (!Started) {
+		Foc->index_ends(Idx, Type, Seg, Order == FOCTOP_HIGHEST);
+		Started = 1;
+	}
+
+	while (Foc->index_step(Idx, Key, where)) {
+		Records_read++;
+		Move_to(where);
+		if (!Where || Where->eval(Foc)) {
+			Current++;
+			return 1;
+		}
+	}
+
+	Current = N;
+	return 0;
+}
+
+// Scan the segment once, keeping the best N records in a heap whose top
+// is the worst of them: a record only goes in if it beats that one, and
+// takes its place. Then sort them, best first, by taking the worst off
+// the top and putting it at the end.
+void FOCTOPN::Gather(void) {
+
+	FOCSCAN		scan(Foc, Seg);
+	FOCTOP_ENTRY	swap;
+	UCHAR		*field;
+	FOCPTR		where;
+	long		seen = 0;
+	int		i, parent;
+
+	if (!Entry) {
+		Entry = (FOCTOP_ENTRY*) xmalloc("TOPN entries",
+				sizeof(FOCTOP_ENTRY) * N);
+		Keys = (UCHAR*) xmalloc("TOPN keys", Length * N);
+	}
+	for (i = 0; i < N; i++) {
+		Entry[i].key = Keys + i * Length;
+	}
+	Num_entries = 0;
+
+	if (Where) {
+		scan.where(*Where);
+	}
+
+	while (scan.next()) {
+		field = (F_seg == Seg ? scan.record() :
+				Foc->record_data(F_seg)) + Offset;
+		seen++;
+
+		// Ties go to the record met first
+		if (Num_entries == N) {
+			int c = field_compare(Type, Length, field, Entry[0].key);
+			if ((Order == FOCTOP_HIGHEST ? c : -c) <= 0) {
+				continue;
+			}
+			i = 0;
+		}
+		else {
+			i = Num_entries++;
+		}
+
+		scan.position(where);
+		memcpy(Entry[i].key, field, Length);
+		Entry[i].page = where.page;
+		Entry[i].word = where.word;
+		Entry[i].seen = seen;
+
+		// A new record at the bottom rises past the better ones
+		// above it; one on top sinks past the worse ones below
+		if (i == 0) {
+			Sift_down(0, Num_entries);
+			continue;
+		}
+		for (; i > 0; i = parent) {
+			parent = (i - 1) / 2;
+			if (!Better(&Entry[parent], &Entry[i])) {
+				break;
+			}
+			swap = Entry[i];
+			Entry[i] = Entry[parent];
+			Entry[parent] = swap;
+		}
+	}
+
+	Records_read += scan.records_read();
+
+	for (i = Num_entries - 1; i > 0; i--) {
+		swap = Entry[0];
+		Entry[0] = Entry[i];
+		Entry[i] = swap;
+		Sift_down(0, i);
+	}
+
+	debug("TOPN::Gather kept %d of %ld records\n", Num_entries, seen);
+	Gathered = 1;
+}
+
+// Is a better than b? Of equal values, the one met first is.
+int FOCTOPN::Better(FOCTOP_ENTRY* a, FOCTOP_ENTRY* b) {
+
+	int c = field_compare(Type, Length, a->key, b->key);
+
+	if (c == 0) {
+		return a->seen < b->seen;
+	}
+	return Order == FOCTOP_HIGHEST ? c > 0 : c < 0;
+}
+
+// Move the entry at i down the heap until none below it is worse
+void FOCTOPN::Sift_down(int i, int size) {
+
+	FOCTOP_ENTRY	swap;
+	int		worst, child;
+
+	for (;;) {
+		worst = i;
+		for (child = 2 * i + 1; child <= 2 * i + 2; child++) {
+			if (child < size &&
+					Better(&Entry[worst], &Entry[child])) {
+				worst = child;
+			}
+		}
+		if (worst == i) {
+			return;
+		}
+
+		swap = Entry[i];
+		Entry[i] = Entry[worst];
+		Entry[worst] = swap;
+		i = worst;
+	}
+}
+
+void FOCTOPN::Move_to(FOCPTR& where) {
+
+	Foc->set_position(Seg, where);
+	Foc->position_ancestors(Seg);
+}
+
+// =============================================================
+// Extra functions
+// =============================================================
+
+// Is s the segment seg, or one of its parents?
+int on_path(FOCFILE *foc, int seg, int s) {
+
+	for (; seg != 0; seg = foc->parent(seg)) {
+		if (seg == s) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
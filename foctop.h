@@ -0,0 +1,128 @@
+/*
+    foctop.h
+    --------
+    Top-N queries for the FocFile C++ library. A FOCTOPN finds the
+    records of a segment with the highest (or lowest) values of a field,
+    keeping only as many as were asked for, or walking the field's index
+    from the right end and stopping once it has them.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCTOP_H
+#define FOCTOP_H
+
+#ifndef FOCSCAN_H
+#include "focscan.h"
+#endif /* FOCSCAN_H */
+
+#define FOCTOP_LOWEST	0
+#define FOCTOP_HIGHEST	1
+
+struct FOCTOP_ENTRY;
+
+// The n records with the highest values of a field, best first:
+//
+//	FOCTOPN top(foc, FOCSEG_ORDERS_ORDERS, 10, FOCFLD_ORDERS_QTY);
+//	top.where(last_month);
+//	top.index(FOCIDX_ORDERS_QTY);
+//	while (top.next()) {
+//		foc->hold(qty, FOCFLD_ORDERS_QTY);
+//		foc->hold(name, FOCFLD_ORDERS_CUST_NAME);
+//	}
+//
+// Without index(), the first next() scans the whole segment (see
+// focscan.h), keeping the best n records so far in a heap. With it,
+// each next() walks the index from the top down (or the bottom up) to
+// the next record that passes the WHERE expression, and the n'th is the
+// last read. Records with equal values come in the order the scan met
+// them, or the index keeps them.
+//
+// The field and the WHERE expression may be in the segment or any of
+// its ancestors; an indexed field must be in the segment itself. next()
+// moves the cursors of the segment and its ancestors, as match_index()
+// and position_ancestors() would, so hold() reads any of them.
+class FOCTOPN {
+
+public:
+	FOCTOPN(FOCFILE* foc, int seg, int n,
+		int f_seg, int offset, char type, int length,
+		int order=FOCTOP_HIGHEST);
+	~FOCTOPN();
+
+	// The filter. The FOCEXPR must outlive the FOCTOPN.
+	void	where(FOCEXPR& expr);
+
+	// Walk this index of the field instead of scanning the segment.
+	// The walk shares the index with match_postings() and FOCKEYS,
+	// so don't use those on it until the last next().
+	void	index(int idx, char type, int seg);
+
+	// Move the cursors to the next of the n records. Returns 1, or 0
+	// after the last.
+	int	next(void);
+
+	// Start over from the best record. A scan's records are kept; an
+	// index is walked again.
+	void	rewind(void);
+
+	// The records looked at, in the scan or along the index
+	long	records_read(void) { return Records_read; };
+
+private:
+	int	Next_scanned(void);
+	int	Next_indexed(void);
+	void	Gather(void);
+	int	Better(FOCTOP_ENTRY* a, FOCTOP_ENTRY* b);
+	void	Sift_down(int i, int size);
+	void	Move_to(FOCPTR& where);
+
+private:
+	FOCFILE		*Foc;
+	int		Seg;
+	int		N;
+
+	int		F_seg;		// the field
+	int		Offset;
+	char		Type;
+	int		Length;
+	int		Order;
+
+	FOCEXPR		*Where;
+	int		Idx;		// or 0
+
+	// The scan's best records: a heap with the worst on top while
+	// gathering, then sorted best first
+	FOCTOP_ENTRY	*Entry;
+	UCHAR		*Keys;
+	int		Num_entries;
+	int		Gathered;
+
+	UCHAR		*Key;		// the index's, for index_step()
+	int		Started;
+	int		Current;	// records given out
+
+	long		Records_read;
+};
+
+#endif /* FOCTOP_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
@@ -0,0 +1,580 @@
+/*
+    foczone.cpp
+    -----------
+    Zone maps for the FocFile C++ library.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "foczone.h"
+
+// Flags
+// ---------------------------------
+//#define DEBUG
+// ---------------------------------
+
+#define DEBUG_PROGRAM_NAME	"FocFile"
+#include "debug.h"
+
+// The file is these structures, in this order and in the machine's
+// byte order: the header, the fields, the pages, the words, the bounds,
+// the page stamps.
+struct FOCZONE_HEADER {
+	char	magic[8];
+	int32_t	fields;
+	int32_t	pages;
+	int32_t	words;
+	int32_t	bound_length;
+};
+
+struct FOCZONE_FIELD {
+	int32_t	seg;
+	int32_t	offset;
+	int32_t	length;
+	int32_t	at;		// where its bounds start in a page's
+	char	type;
+	UCHAR	unused[3];
+};
+
+struct FOCZONE_PAGE {
+	int32_t	page;
+	int32_t	seg;
+	int32_t	records;
+	int32_t	first_word;	// in Word
+	int32_t	bound;		// in Bound
+};
+
+// A record seen while building
+struct FOCZONE_RECORD {
+	int	seg;
+	int	page;
+	int	word;
+};
+
+static int page_order(const void *a, const void *b);
+static int record_order(const void *a, const void *b);
+
+// =============================================================
+// CLASS: FOCZONEMAP
+// -------------------------------------------------------------
+// Where each page's records are, and the bounds of some of their
+// fields.
+// =============================================================
+FOCZONEMAP::FOCZONEMAP() {
+
+	Field		= NULL;
+	Num_fields	= 0;
+
+	Page		= NULL;
+	Word		= NULL;
+	Bound		= NULL;
+	Records		= NULL;
+	Num_records	= 0;
+	Allocated_records = 0;
+	Current		= NULL;
+	Clear();
+}
+
+FOCZONEMAP::~FOCZONEMAP() {
+
+	Clear();
+	free(Field);
+}
+
+void FOCZONEMAP::Clear(void) {
+
+	free(Page);
+	free(Word);
+	free(Bound);
+	Stamps.clear();
+
+	Page		= NULL;
+	Num_pages	= 0;
+	Allocated_pages	= 0;
+	Word		= NULL;
+	Num_words	= 0;
+	Allocated_words	= 0;
+	Bound		= NULL;
+	Bound_length	= 0;
+	Allocated_bound	= 0;
+}
+
+void FOCZONEMAP::field(int seg, int offset, char type, int length) {
+
+	if (type == FIELDTYPE_INTEGER || type == FIELDTYPE_SMDATE ||
+			type == FIELDTYPE_FLOAT) {
+		length = 4;
+	}
+	else if (type == FIELDTYPE_DOUBLE) {
+		length = 8;
+	}
+	else if (type != FIELDTYPE_ALPHA) {
+		die("ZONE field has unknown type %c\n", type);
+	}
+
+	Field = (FOCZONE_FIELD*) xrealloc("ZONE fields", Field,
+			sizeof(FOCZONE_FIELD) * (Num_fields + 1));
+
+	FOCZONE_FIELD *f = &Field[Num_fields];
+	memset(f, 0, sizeof(FOCZONE_FIELD));
+	f->seg		= seg;
+	f->offset	= offset;
+	f->type		= type;
+	f->length	= length;
+	f->at		= 0;
+
+	for (int i = 0; i < Num_fields; i++) {
+		if (Field[i].seg == seg) {
+			f->at += Field[i].length;
+		}
+	}
+	Num_fields++;
+}
+
+// Walk every record of every segment that has a field in the map.
+// Records are gathered as they come, then sorted into page order.
+void FOCZONEMAP::build(FOCFILE* foc) {
+
+	int	seg, i;
+
+	Clear();
+	Stamps.start(foc);
+	Num_records = 0;
+
+	for (seg = 1; seg <= foc->number_seg(); seg++) {
+
+		for (i = 0; i < Num_fields; i++) {
+			if (Field[i].seg == seg) break;
+		}
+		if (i == Num_fields) {
+			continue;
+		}
+
+		debug("ZONE::build segment %d\n", seg);
+		foc->walk(seg, Walked, this);
+	}
+	Stamps.end();
+
+	// Pages in order, and their records in the same order, so that
+	// each page's records follow the last page's
+	qsort(Page, Num_pages, sizeof(FOCZONE_PAGE), page_order);
+	qsort(Records, Num_records, sizeof(FOCZONE_RECORD), record_order);
+
+	Word = (unsigned short*) xrealloc("ZONE words", NULL,
+			sizeof(unsigned short) * (Num_records + 1));
+	Num_words = Allocated_words = Num_records;
+	i = 0;
+	for (long r = 0; r < Num_records; r++) {
+		while (Page[i].page != Records[r].page) {
+			i++;
+		}
+		FOCZONE_PAGE *p = &Page[i];
+		if (p->records == 0) {
+			p->first_word = r;
+		}
+		p->records++;
+		Word[r] = Records[r].word;
+	}
+
+	free(Records);
+	Records = NULL;
+	Allocated_records = 0;
+
+	debug("ZONE::build %d pages, %ld records\n", Num_pages, Num_words);
+}
+
+void FOCZONEMAP::Walked(FOCFILE* foc, int seg, void* arg) {
+
+	((FOCZONEMAP*) arg)->Add_record(foc, seg);
+}
+
+// The page's slot in Stamps is its slot in Page, while building
+void FOCZONEMAP::Add_record(FOCFILE* foc, int seg) {
+
+	FOCPTR		where;
+	UCHAR		*data;
+	int		i, n, width = 0, first;
+
+	foc->position(seg, where);
+	n = Stamps.add(foc, seg, where.page);
+
+	for (i = 0; i < Num_fields; i++) {
+		if (Field[i].seg == seg) {
+			width += Field[i].length;
+		}
+	}
+
+	first = n == Num_pages;
+	if (first) {
+		if (Num_pages == Allocated_pages) {
+			Allocated_pages = Allocated_pages ?
+					Allocated_pages * 2 : 256;
+			Page = (FOCZONE_PAGE*) xrealloc("ZONE pages", Page,
+					sizeof(FOCZONE_PAGE) * Allocated_pages);
+		}
+		if (Bound_length + 2 * width > Allocated_bound) {
+			Allocated_bound = (Bound_length + 2 * width) * 2;
+			Bound = (UCHAR*) xrealloc("ZONE bounds", Bound,
+					Allocated_bound);
+		}
+
+		FOCZONE_PAGE *p = &Page[Num_pages];
+		memset(p, 0, sizeof(FOCZONE_PAGE));
+		p->page		= where.page;
+		p->seg		= seg;
+		p->bound	= Bound_length;
+
+		Num_pages++;
+		Bound_length += 2 * width;
+	}
+
+	if (Num_records == Allocated_records) {
+		Allocated_records = Allocated_records ?
+				Allocated_records * 2 : 4096;
+		Records = (FOCZONE_RECORD*) xrealloc("ZONE records", Records,
+				sizeof(FOCZONE_RECORD) * Allocated_records);
+	}
+	Records[Num_records].seg = seg;
+	Records[Num_records].page = where.page;
+	Records[Num_records].word = where.word + foc->pointers(seg);
+	Num_records++;
+
+	// The bounds
+	data = foc->record_data(seg);
+	UCHAR *low = Bound + Page[n].bound;
+	UCHAR *high = low + width;
+
+	for (i = 0; i < Num_fields; i++) {
+		FOCZONE_FIELD	*f = &Field[i];
+		UCHAR		*value = data + f->offset;
+
+		if (f->seg != seg) {
+			continue;
+		}
+		if (first || field_compare(f->type, f->length, value,
+					low + f->at) < 0) {
+			memcpy(low + f->at, value, f->length);
+		}
+		if (first || field_compare(f->type, f->length, value,
+					high + f->at) > 0) {
+			memcpy(high + f->at, value, f->length);
+		}
+	}
+}
+
+void FOCZONEMAP::write(FILE* fh) {
+
+	FOCZONE_HEADER	h;
+
+	memset(&h, 0, sizeof(FOCZONE_HEADER));
+	memcpy(h.magic, FOCZONE_MAGIC, 8);
+	h.fields	= Num_fields;
+	h.pages		= Num_pages;
+	h.words		= Num_words;
+	h.bound_length	= Bound_length;
+
+	if (fwrite(&h, sizeof(FOCZONE_HEADER), 1, fh) != 1 ||
+		fwrite(Field, sizeof(FOCZONE_FIELD), Num_fields, fh) !=
+			(size_t) Num_fields ||
+		fwrite(Page, sizeof(FOCZONE_PAGE), Num_pages, fh) !=
+			(size_t) Num_pages ||
+		fwrite(Word, sizeof(unsigned short), Num_words, fh) !=
+			(size_t) Num_words ||
+		fwrite(Bound, 1, Bound_length, fh) != (size_t) Bound_length ||
+		!Stamps.write(fh)) {
+		die("ZONE: can't write the zone map\n");
+	}
+}
+
+// Returns 1, or 0 if the FOCUS file has changed since the map was built
+int FOCZONEMAP::read(FILE* fh, FOCFILE* foc) {
+
+	FOCZONE_HEADER	h;
+
+	if (fread(&h, sizeof(FOCZONE_HEADER), 1, fh) != 1 ||
+			memcmp(h.magic, FOCZONE_MAGIC, 8) != 0) {
+		die("ZONE: not a zone map\n");
+	}
+
+	Clear();
+	free(Field);
+
+	Num_fields	= h.fields;
+	Num_pages	= Allocated_pages = h.pages;
+	Num_words	= Allocated_words = h.words;
+	Bound_length	= Allocated_bound = h.bound_length;
+
+	Field = (FOCZONE_FIELD*) xrealloc("ZONE fields", NULL,
+			sizeof(FOCZONE_FIELD) * (Num_fields + 1));
+	Page = (FOCZONE_PAGE*) xrealloc("ZONE pages", NULL,
+			sizeof(FOCZONE_PAGE) * (Num_pages + 1));
+	Word = (unsigned short*) xrealloc("ZONE words", NULL,
+			sizeof(unsigned short) * (Num_words + 1));
+	Bound = (UCHAR*) xrealloc("ZONE bounds", NULL, Bound_length + 1);
+
+	if (fread(Field, sizeof(FOCZONE_FIELD), Num_fields, fh) !=
+			(size_t) Num_fields ||
+		fread(Page, sizeof(FOCZONE_PAGE), Num_pages, fh) !=
+			(size_t) Num_pages ||
+		fread(Word, sizeof(unsigned short), Num_words, fh) !=
+			(size_t) Num_words ||
+		fread(Bound, 1, Bound_length, fh) != (size_t) Bound_length ||
+		!Stamps.read(fh)) {
+		die("ZONE: zone map is cut short\n");
+	}
+
+	return Stamps.current(foc);
+}
+
+// Read every page in the map, and count those that have changed
+int FOCZONEMAP::stale(FOCFILE* foc) {
+
+	return Stamps.stale(foc);
+}
+
+int FOCZONEMAP::pages(int seg) {
+
+	int	n = Segment_start(seg);
+	int	count = 0;
+
+	while (n + count < Num_pages && Page[n + count].seg == seg) {
+		count++;
+	}
+
+	return count;
+}
+
+long FOCZONEMAP::records(int seg) {
+
+	long	count = 0;
+
+	for (int n = Segment_start(seg); n < Num_pages && Page[n].seg == seg;
+			n++) {
+		count += Page[n].records;
+	}
+
+	return count;
+}
+
+int FOCZONEMAP::may_pass(int seg, int n, FOCEXPR& where) {
+
+	n += Segment_start(seg);
+	if (n >= Num_pages || Page[n].seg != seg) {
+		die("ZONE::may_pass segment %d has no page %d\n", seg, n);
+	}
+
+	Current = &Page[n];
+	return where.may_pass(Bounds, this);
+}
+
+// The first page of seg in the map (or where it would be)
+int FOCZONEMAP::Segment_start(int seg) {
+
+	int	low = 0, high = Num_pages;
+
+	while (low < high) {
+		int middle = (low + high) / 2;
+		if (Page[middle].seg < seg) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
+// FOCEXPR_BOUNDS for the page in Current
+int FOCZONEMAP::Bounds(int seg, int offset, char type, int length,
+			UCHAR** low, UCHAR** high, void* arg) {
+
+	FOCZONEMAP	*map = (FOCZONEMAP*) arg;
+	int		width = 0, i;
+
+	if (seg != map->Current->seg) {
+		return 0;
+	}
+
+	for (i = 0; i < map->Num_fields; i++) {
+		if (map->Field[i].seg == seg) {
+			width += map->Field[i].length;
+		}
+	}
+
+	for (i = 0; i < map->Num_fields; i++) {
+		FOCZONE_FIELD *f = &map->Field[i];
+
+		if (f->seg == seg && f->offset == offset &&
+				f->type == type && f->length == length) {
+			*low = map->Bound + map->Current->bound + f->at;
+			*high = *low + width;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// =============================================================
+// CLASS: FOCZONESCAN
+// -------------------------------------------------------------
+// Reads a segment page by page, skipping what the map rules out.
+// =============================================================
+FOCZONESCAN::FOCZONESCAN(FOCFILE* foc, FOCZONEMAP& map, int seg) {
+
+	if (seg < 1 || seg > foc->number_seg()) {
+		die("ZONESCAN on non-existant segment %d\n", seg);
+	}
+
+	Foc	= foc;
+	Map	= &map;
+	Seg	= seg;
+	Where	= NULL;
+	Limit	= -1;
+
+	First	= map.Segment_start(seg);
+	End	= First + map.pages(seg);
+
+	rewind();
+}
+
+void FOCZONESCAN::where(FOCEXPR& expr) {
+
+	expr.compile(Foc);
+	if (expr.number_of_segments() > 1 ||
+			(expr.number_of_segments() == 1 &&
+			 expr.segment() != Seg)) {
+		die("ZONESCAN WHERE may only test segment %d\n", Seg);
+	}
+
+	Where = &expr;
+}
+
+void FOCZONESCAN::rewind(void) {
+
+	Current		= -1;
+	Record		= 0;
+	Page_data	= NULL;
+
+	Pages_read	= 0;
+	Pages_skipped	= 0;
+	Records_read	= 0;
+	Records_selected = 0;
+}
+
+void FOCZONESCAN::limit(long n) {
+
+	Limit = n < 0 ? -1 : n;
+}
+
+// The next selected record's data area, or NULL at the end
+UCHAR* FOCZONESCAN::next(void) {
+
+	FOCZONE_PAGE	*p;
+	UCHAR		*data;
+
+	if (Limit >= 0 && Records_selected >= Limit) {
+		return NULL;
+	}
+
+	for (;;) {
+		if (Current < 0 || Record == Map->Page[Current].records) {
+			if (!Next_page()) {
+				return NULL;
+			}
+		}
+
+		p = &Map->Page[Current];
+		data = Page_data + (Map->Word[p->first_word + Record] - 1) * 4;
+		Record++;
+		Records_read++;
+
+		if (!Where || Where->eval_record(data)) {
+			Records_selected++;
+			return data;
+		}
+	}
+}
+
+// Move to the next page that may hold a selected record
+int FOCZONESCAN::Next_page(void) {
+
+	FOCZONE_PAGE	*p;
+
+	for (Current = Current < 0 ? First : Current + 1; Current < End;
+			Current++) {
+
+		if (Where && !Map->may_pass(Seg, Current - First, *Where)) {
+			Pages_skipped++;
+			continue;
+		}
+
+		p = &Map->Page[Current];
+		Page_data = Map->Stamps.read_page(Foc, Seg, p->page);
+		if (!Page_data) {
+			die("ZONESCAN page %d has changed since the zone map "
+				"was built\n", p->page);
+		}
+
+		Pages_read++;
+		Record = 0;
+		if (p->records > 0) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// =============================================================
+// Extra functions
+// =============================================================
+
+int page_order(const void *a, const void *b) {
+
+	const FOCZONE_PAGE *x = (const FOCZONE_PAGE*) a;
+	const FOCZONE_PAGE *y = (const FOCZONE_PAGE*) b;
+
+	if (x->seg != y->seg) {
+		return x->seg - y->seg;
+	}
+	return x->page - y->page;
+}
+
+int record_order(const void *a, const void *b) {
+
+	const FOCZONE_RECORD *x = (const FOCZONE_RECORD*) a;
+	const FOCZONE_RECORD *y = (const FOCZONE_RECORD*) b;
+
+	if (x->seg != y->seg) {
+		return x->seg - y->seg;
+	}
+	if (x->page != y->page) {
+		return x->page - y->page;
+	}
+	return x->word - y->word;
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
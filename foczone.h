@@ -0,0 +1,172 @@
+/*
+    foczone.h
+    ---------
+    Zone maps for the FocFile C++ library. A FOCZONEMAP records, for
+    each data page of a segment, where its records are and the lowest
+    and highest value of a few of their fields. A FOCZONESCAN reads a
+    segment page by page and skips the pages whose values can't pass
+    its WHERE expression.
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef FOCZONE_H
+#define FOCZONE_H
+
+#ifndef FOCEXPR_H
+#include "focexpr.h"
+#endif /* FOCEXPR_H */
+
+#ifndef FOCSTAMP_H
+#include "focstamp.h"
+#endif /* FOCSTAMP_H */
+
+#define FOCZONE_MAGIC	"FOCZONE2"
+
+struct FOCZONE_FIELD;
+struct FOCZONE_PAGE;
+struct FOCZONE_RECORD;
+
+// The map is built once by walking every record of the segments that
+// have fields in it, and kept in a file next to the FOCUS file:
+//
+//	FOCZONEMAP map;
+//	map.field(FOCFLD_ORDERS_ORDER_DATE);
+//	map.build(foc);
+//	map.write(fh);
+//
+// Each page's stamp (see focstamp.h) is kept in the map, and the FDT's.
+// read() returns 0 if the FDT has changed since, and stale() reads
+// every page to count those that have.
+class FOCZONEMAP {
+
+public:
+	FOCZONEMAP();
+	~FOCZONEMAP();
+
+	// Fields to keep the bounds of, before build()
+	void	field(int seg, int offset, char type, int length);
+
+	void	build(FOCFILE* foc);
+	void	write(FILE* fh);
+	int	read(FILE* fh, FOCFILE* foc);
+	int	stale(FOCFILE* foc);
+
+	// Pages and records of a segment in the map
+	int	pages(int seg);
+	long	records(int seg);
+
+	// Could a record on the n'th page of seg pass the expression?
+	int	may_pass(int seg, int n, FOCEXPR& where);
+
+private:
+	void	Clear(void);
+	static void Walked(FOCFILE* foc, int seg, void* arg);
+	void	Add_record(FOCFILE* foc, int seg);
+	int	Segment_start(int seg);
+	static int Bounds(int seg, int offset, char type, int length,
+			UCHAR** low, UCHAR** high, void* arg);
+
+	friend class FOCZONESCAN;
+
+private:
+	FOCZONE_FIELD	*Field;
+	int		Num_fields;
+
+	// Sorted by segment, then page
+	FOCZONE_PAGE	*Page;
+	int		Num_pages;
+	int		Allocated_pages;
+
+	// Each page's records, by the word their data starts at, and the
+	// bounds of each of its segment's fields, low then high
+	unsigned short	*Word;
+	long		Num_words;
+	long		Allocated_words;
+	UCHAR		*Bound;
+	long		Bound_length;
+	long		Allocated_bound;
+
+	FOCSTAMPTABLE	Stamps;
+
+	// While building
+	FOCZONE_RECORD	*Records;
+	long		Num_records;
+	long		Allocated_records;
+	FOCZONE_PAGE	*Current;	// for Bounds()
+};
+
+// Reads one segment in page order, through the map:
+//
+//	FOCZONESCAN scan(foc, map, FOCSEG_ORDERS_ORDERS);
+//	scan.where(last_month);
+//	while ((data = scan.next())) {
+//		...
+//	}
+//
+// The WHERE expression may only test fields of the scanned segment,
+// since page order says nothing about a record's parents. next()
+// returns the record's data area, in the segment's page buffer. The
+// scan dies if a page it reads has changed since the map was built.
+class FOCZONESCAN {
+
+public:
+	FOCZONESCAN(FOCFILE* foc, FOCZONEMAP& map, int seg);
+
+	// The filter. The FOCEXPR must outlive the scan.
+	void	where(FOCEXPR& expr);
+
+	// Stop after n selected records, before reading another page. A
+	// negative n takes the limit off; rewind() starts the count over.
+	void	limit(long n);
+
+	UCHAR*	next(void);
+	void	rewind(void);
+
+	long	pages_read(void) { return Pages_read; };
+	long	pages_skipped(void) { return Pages_skipped; };
+	long	records_read(void) { return Records_read; };
+	long	records_selected(void) { return Records_selected; };
+
+private:
+	int	Next_page(void);
+
+private:
+	FOCFILE		*Foc;
+	FOCZONEMAP	*Map;
+	int		Seg;
+	FOCEXPR		*Where;
+	long		Limit;		// or -1
+
+	int		First, End;	// the segment's pages in the map
+	int		Current;	// page in the map, or -1
+	int		Record;		// next record on that page
+	UCHAR		*Page_data;
+
+	long		Pages_read;
+	long		Pages_skipped;
+	long		Records_read;
+	long		Records_selected;
+};
+
+#endif /* FOCZONE_H */
+
+/* magic settings for vi editors
+vi:set ts=8:
+vi:set sw=8:
+*/
@@ -0,0 +1,1218 @@
+/*
+    mkfoc
+    -----
+    Writes a synthetic PC/FOCUS 6.01-layout FOCUS file from a
+    Master File Description, for benchmarks and scale tests.
+
+    *********************************************************
+    This library is in no way related to or supported by IBI.
+    IBI's FOCUS is a proprietary database whose format may
+    change at any time. If you have any problems, suggestions,
+    or comments about the FocFile C++ library, contact
+    the author, not Information Builders!
+    *********************************************************
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+/*
+   mkfoc [-n root_instances] [-f SEGNAME=fanout] [-c FIELD=cardinality]
+         [-m FIELD=step] [-s seed] [-t transaction] master.mas file.foc
+
+   The master file is read the same way mas2h reads it, so the header
+   that mas2h makes from the generated file matches it. Segments need
+   a PARENT= attribute unless they are the root. Fields marked
+   FIELDTYPE=I or INDEX=I get a B-tree index.
+
+   -n	Number of root segment instances (default 100)
+   -f	Instances of SEGNAME under each parent instance (default 3,
+	unique segments always get 1)
+   -c	Number of distinct values in FIELD (default 1000 for alpha
+	fields, 100000 for integers, 3650 days for smartdates).
+	Alpha values are up to four letters of the field name and a
+	number; a field too short for the number of values, or of keys
+	in a chain, is an error.
+   -m	Make FIELD increase monotonically with the instance number,
+	changing value every `step' instances. Useful for date fields
+	that follow the load order.
+   -s	Seed for the value generator (default 1)
+   -t	Transaction number stamped on every page (default 1)
+
+   The layout is the one described in doc/Focus.txt: page 1 holds the
+   FDT, each segment has its own chain of data pages, and the indices
+   are B-trees as FOCINDEX_BTREE reads them. FOCUS 6 page numbers are
+   16-bit shorts, and FocFile reads them signed, so a file can't grow
+   past 32767 pages (128 MB).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <float.h>
+#include <stdint.h>
+
+#define die(format, args...) { \
+	fprintf(stderr, "mkfoc: " format, ## args); \
+	exit(-1); \
+	}
+
+typedef unsigned char UCHAR;
+
+// These mirror the constants in focfile.cpp
+#define PAGESIZE	4096
+#define CTRLOFF		4000 - 28	/* 0xf84 */
+#define FDTOFF		4000 - 30	/* 0xf86 */
+#define LAST_WORD	((CTRLOFF) / 4)	/* last word usable for data */
+#define NODEOFF		0x14		/* first record in an index node */
+#define MAX_PAGES	32767
+
+#define PTR_CHILD	3
+#define PTR_NEXT	4
+#define PTR_PARENT	5
+
+#define MAX_SEGS	64
+#define MAX_FIELDS	256
+#define MAX_CHILDREN	32
+
+struct GEN_FIELD {
+	char	name[13];
+	char	type;		// A, I, D, F, S
+	int	length;		// bytes in the record
+	int	offset;		// byte offset in the data area
+	int	seg;
+	long	cardinality;
+	long	step;		// monotonic if > 0
+	int	indexed;
+	int	key;		// 1 ascending, -1 descending
+};
+
+struct GEN_SEG {
+	char	name[9];
+	char	segtype[8];
+	char	parent_name[9];
+	int	parent;
+	int	fanout;
+	int	children[MAX_CHILDREN];
+	int	number_of_children;
+	int	number_of_pointers;
+	int	data_length;		// bytes
+	int	segment_length;		// words, pointers included
+	int	first_field;
+	int	number_of_fields;
+
+	// page writer
+	UCHAR	*page;
+	int	current_page;
+	int	next_word;
+	int	first_page;
+	int	last_page;
+	int	number_of_pages;
+	long	instances;
+};
+
+struct GEN_LOC {
+	int	page;
+	int	word;
+};
+
+// One index entry: the key, followed by the page and word.
+struct GEN_INDEX {
+	int	field;
+	int	key_size;
+	int	entry_size;
+	long	number_of_entries;
+	long	allocated;
+	UCHAR	*entries;
+	int	first_page;
+	int	last_page;
+	int	number_of_pages;
+};
+
+static GEN_SEG		Seg[MAX_SEGS + 1];
+static GEN_FIELD	Field[MAX_FIELDS];
+static GEN_INDEX	Index[MAX_FIELDS];
+static int		Num_segments = 0;
+static int		Num_fields = 0;
+static int		Num_indices = 0;
+
+static FILE		*Out;
+static int		Next_free_page = 2;	// page 1 is the FDT
+static long		Transaction = 1;
+static uint64_t		Rand_state = 1;
+
+static void	Parse_master(char *name);
+static void	Parse_record(char *record);
+static int	Find_segment(char *name);
+static int	Find_field(char *name);
+static void	Layout(void);
+static GEN_LOC	Generate_chain(int seg, GEN_LOC parent, int count);
+static GEN_LOC	Alloc_slot(int seg);
+static void	Write_pointer(int seg, GEN_LOC where, int word, GEN_LOC to,
+			int type);
+static void	Fill_data(int seg, UCHAR *data, int k, int count);
+static void	Flush_page(int seg, int next_page);
+static void	Write_control(UCHAR *page, int page_number, int next_page,
+			int segment, int free_word, GEN_LOC first);
+static void	Write_fdt(GEN_LOC root_first);
+static void	Build_index(GEN_INDEX *idx);
+static void	Add_index_entry(int field, UCHAR *key, GEN_LOC loc);
+static int	decimal_digits(long n);
+static void	put_short(UCHAR *b, int value);
+static void	put_pointer(UCHAR *b, GEN_LOC loc, int type);
+static uint64_t	next_random(void);
+static void	usage(void);
+
+int main(int argc, char **argv) {
+
+	long	root_instances = 100;
+	int	i;
+	char	*master;
+	char	*output;
+
+	// Options are collected first, since they refer to segments and
+	// fields that we only know about after reading the master.
+	char	*fanouts[MAX_SEGS];
+	char	*cards[MAX_FIELDS];
+	char	*steps[MAX_FIELDS];
+	int	num_fanouts = 0, num_cards = 0, num_steps = 0;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+
+		if (i + 1 >= argc) {
+			usage();
+		}
+
+		switch (argv[i][1]) {
+			case 'n':
+				root_instances = atol(argv[++i]);
+				break;
+			case 'f':
+				if (num_fanouts == MAX_SEGS) usage();
+				fanouts[num_fanouts++] = argv[++i];
+				break;
+			case 'c':
+				if (num_cards == MAX_FIELDS) usage();
+				cards[num_cards++] = argv[++i];
+				break;
+			case 'm':
+				if (num_steps == MAX_FIELDS) usage();
+				steps[num_steps++] = argv[++i];
+				break;
+			case 's':
+				Rand_state = strtoul(argv[++i], NULL, 10);
+				break;
+			case 't':
+				Transaction = atol(argv[++i]);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (argc - i != 2) {
+		usage();
+	}
+	master = argv[i];
+	output = argv[i + 1];
+
+	Parse_master(master);
+	Layout();
+
+	for (i = 0; i < num_fanouts; i++) {
+		char *eq = strchr(fanouts[i], '=');
+		if (!eq) usage();
+		*eq = 0;
+		Seg[Find_segment(fanouts[i])].fanout = atoi(eq + 1);
+	}
+	for (i = 0; i < num_cards; i++) {
+		char *eq = strchr(cards[i], '=');
+		if (!eq) usage();
+		*eq = 0;
+		Field[Find_field(cards[i])].cardinality = atol(eq + 1);
+		Field[Find_field(cards[i])].key = 0;
+	}
+	for (i = 0; i < num_steps; i++) {
+		char *eq = strchr(steps[i], '=');
+		if (!eq) usage();
+		*eq = 0;
+		Field[Find_field(steps[i])].step = atol(eq + 1);
+		Field[Find_field(steps[i])].key = 0;
+	}
+
+	// Alpha values are numbered, and the number has to fit
+	for (i = 0; i < Num_fields; i++) {
+		GEN_FIELD *f = &Field[i];
+		if (f->type == 'A' && !f->key &&
+				f->cardinality > 1 &&
+				decimal_digits(f->cardinality - 1) > f->length) {
+			die("field %s is A%d, too short for %ld distinct "
+				"values\n", f->name, f->length,
+				f->cardinality);
+		}
+	}
+
+	if (!(Out = fopen(output, "w+b"))) {
+		die("can't create %s\n", output);
+	}
+
+	// The root chain, and through it, everything else
+	GEN_LOC	none = { 0, 0 };
+	GEN_LOC	root_first = Generate_chain(1, none, root_instances);
+
+	for (i = 1; i <= Num_segments; i++) {
+		Flush_page(i, 0);
+	}
+
+	for (i = 0; i < Num_indices; i++) {
+		Build_index(&Index[i]);
+	}
+
+	Write_fdt(root_first);
+
+	for (i = 1; i <= Num_segments; i++) {
+		printf("SEG %d %s %ld instances %d pages\n", i, Seg[i].name,
+			Seg[i].instances, Seg[i].number_of_pages);
+	}
+	for (i = 0; i < Num_indices; i++) {
+		printf("IDX %d %s %ld keys %d pages\n", i + 1,
+			Field[Index[i].field].name,
+			Index[i].number_of_entries, Index[i].number_of_pages);
+	}
+
+	fclose(Out);
+	return 0;
+}
+
+static void usage(void) {
+	die("usage: mkfoc [-n root_instances] [-f SEGNAME=fanout] "
+		"[-c FIELD=cardinality]\n"
+		"\t[-m FIELD=step] [-s seed] [-t transaction] "
+		"master.mas file.foc\n");
+}
+
+// Read the master file one $-terminated record at a time, like mas2h.
+static void Parse_master(char *name) {
+
+	FILE	*fh;
+	char	record[4096];
+	int	length = 0;
+	int	c;
+	int	comment = 0;
+
+	if (!(fh = fopen(name, "r"))) {
+		die("can't open %s\n", name);
+	}
+
+	while ((c = getc(fh)) != EOF) {
+		if (comment) {
+			if (c == '\n') comment = 0;
+			continue;
+		}
+		if (c == '$') {
+			record[length] = 0;
+			Parse_record(record);
+			length = 0;
+			comment = 1;
+			continue;
+		}
+		if (length < (int) sizeof(record) - 1) {
+			record[length++] = (c == '\n' || c == '\r') ? ',' : c;
+		}
+	}
+	record[length] = 0;
+	Parse_record(record);
+
+	fclose(fh);
+
+	if (Num_segments == 0) {
+		die("no segments in %s\n", name);
+	}
+}
+
+// Split one record into its comma-separated attributes.
+static void Parse_record(char *record) {
+
+	char	*attr[64];
+	int	num_attr = 0;
+	char	*cursor = record;
+	int	i;
+
+	while (num_attr < 64) {
+		while (isspace(*cursor)) cursor++;
+		attr[num_attr++] = cursor;
+		char *comma = strchr(cursor, ',');
+		if (!comma) break;
+		*comma = 0;
+		cursor = comma + 1;
+	}
+	for (i = 0; i < num_attr; i++) {
+		char *end = attr[i] + strlen(attr[i]);
+		while (end > attr[i] && isspace(end[-1])) *--end = 0;
+	}
+
+	char	*value;
+	int	field_start = -1;
+
+	for (i = 0; i < num_attr; i++) {
+
+		if (!(value = strchr(attr[i], '='))) {
+			continue;
+		}
+		*value++ = 0;
+		while (isspace(*value)) value++;
+		char *end = attr[i] + strlen(attr[i]);
+		while (end > attr[i] && isspace(end[-1])) *--end = 0;
+
+		if (!strcmp(attr[i], "SEGNAME") || !strcmp(attr[i], "SEGMENT")) {
+			if (Num_segments == MAX_SEGS) {
+				die("too many segments\n");
+			}
+			GEN_SEG	*s = &Seg[++Num_segments];
+			memset(s, 0, sizeof(GEN_SEG));
+			strncpy(s->name, value, 8);
+			strcpy(s->segtype, "S1");
+			s->fanout = 3;
+			s->first_field = Num_fields;
+		}
+		else if (!strcmp(attr[i], "SEGTYPE") && Num_segments) {
+			strncpy(Seg[Num_segments].segtype, value, 7);
+		}
+		else if (!strcmp(attr[i], "PARENT") && Num_segments) {
+			strncpy(Seg[Num_segments].parent_name, value, 8);
+		}
+		else if (!strcmp(attr[i], "FIELDNAME") ||
+			 !strcmp(attr[i], "FIELD")) {
+			if (Num_segments == 0) {
+				die("field %s before any segment\n", value);
+			}
+			if (Num_fields == MAX_FIELDS) {
+				die("too many fields\n");
+			}
+			GEN_FIELD *f = &Field[Num_fields++];
+			memset(f, 0, sizeof(GEN_FIELD));
+			strncpy(f->name, value, 12);
+			f->seg = Num_segments;
+			Seg[Num_segments].number_of_fields++;
+			field_start = i;
+		}
+		else if ((!strcmp(attr[i], "FIELDTYPE") ||
+			  !strcmp(attr[i], "INDEX")) && field_start >= 0) {
+			if (value[0] == 'I') {
+				Field[Num_fields - 1].indexed = 1;
+			}
+		}
+		else if (!strcmp(attr[i], "USAGE") || !strcmp(attr[i], "FORMAT")) {
+			if (field_start >= 0) {
+				attr[field_start + 2] = value;
+			}
+		}
+	}
+
+	if (field_start < 0) {
+		return;
+	}
+
+	// FIELDNAME=name, alias, format
+	if (field_start + 2 >= num_attr) {
+		die("field %s has no format\n", Field[Num_fields - 1].name);
+	}
+
+	GEN_FIELD	*f = &Field[Num_fields - 1];
+	char		*format = attr[field_start + 2];
+	int		width = atoi(format + 1);
+
+	if (strchr(format, 'Y')) {
+		f->type = 'S';
+		f->length = 4;
+		f->cardinality = 3650;
+	}
+	else {
+		switch (format[0]) {
+			case 'A':
+				f->type = 'A';
+				f->length = width;
+				f->cardinality = 1000;
+				break;
+			case 'I':
+				f->type = 'I';
+				f->length = 4;
+				f->cardinality = 100000;
+				break;
+			case 'D':
+			case 'P':
+				f->type = 'D';
+				f->length = 8;
+				f->cardinality = 100000;
+				break;
+			case 'F':
+				f->type = 'F';
+				f->length = 4;
+				f->cardinality = 100000;
+				break;
+			default:
+				die("field %s has unknown format %s\n",
+					f->name, format);
+		}
+	}
+
+	if (f->length <= 0) {
+		die("field %s has bad length\n", f->name);
+	}
+}
+
+static int Find_segment(char *name) {
+
+	for (int i = 1; i <= Num_segments; i++) {
+		if (!strcmp(Seg[i].name, name)) {
+			return i;
+		}
+	}
+	die("unknown segment %s\n", name);
+	return 0;
+}
+
+static int Find_field(char *name) {
+
+	for (int i = 0; i < Num_fields; i++) {
+		if (!strcmp(Field[i].name, name)) {
+			return i;
+		}
+	}
+	die("unknown field %s\n", name);
+	return 0;
+}
+
+// Work out parents, children, pointers, field offsets and indices.
+static void Layout(void) {
+
+	int	i, j;
+
+	for (i = 1; i <= Num_segments; i++) {
+
+		GEN_SEG	*s = &Seg[i];
+
+		if (i == 1) {
+			if (s->parent_name[0]) {
+				die("root segment %s has a parent\n", s->name);
+			}
+			s->parent = 0;
+		}
+		else {
+			if (!s->parent_name[0]) {
+				die("segment %s has no PARENT=\n", s->name);
+			}
+			s->parent = Find_segment(s->parent_name);
+			if (s->parent >= i) {
+				die("segment %s comes before its parent\n",
+					s->name);
+			}
+			GEN_SEG	*p = &Seg[s->parent];
+			if (p->number_of_children == MAX_CHILDREN) {
+				die("segment %s has too many children\n",
+					p->name);
+			}
+			p->children[p->number_of_children++] = i;
+		}
+
+		if (s->segtype[0] == 'U' || !strcmp(s->segtype, "KU") ||
+				!strcmp(s->segtype, "KLU")) {
+			s->fanout = 1;
+		}
+	}
+
+	for (i = 1; i <= Num_segments; i++) {
+
+		GEN_SEG	*s = &Seg[i];
+		int	offset = 0;
+
+		for (j = s->first_field;
+				j < s->first_field + s->number_of_fields; j++) {
+			Field[j].offset = offset;
+			offset += Field[j].length;
+			if (Field[j].indexed) {
+				GEN_INDEX *idx = &Index[Num_indices++];
+				memset(idx, 0, sizeof(GEN_INDEX));
+				idx->field = j;
+				idx->key_size = Field[j].length;
+				idx->entry_size = idx->key_size + 4;
+			}
+		}
+
+		s->data_length = offset;
+
+		// Sn and SHn segments keep their instances sorted on the
+		// first field, which is unique within the chain.
+		if (s->segtype[0] == 'S' && s->number_of_fields > 0 &&
+				(s->segtype[1] == 'H' || atoi(s->segtype + 1) > 0)) {
+			Field[s->first_field].key =
+				s->segtype[1] == 'H' ? -1 : 1;
+		}
+		s->number_of_pointers = s->number_of_children + 1 +
+			(s->parent > 0 ? 1 : 0);
+		s->segment_length = s->number_of_pointers +
+			(s->data_length + 3) / 4;
+
+		if (s->segment_length > LAST_WORD) {
+			die("segment %s doesn't fit on a page\n", s->name);
+		}
+
+		s->page = (UCHAR*) calloc(1, PAGESIZE);
+	}
+}
+
+// Write `count' instances of seg as one chain, depth-first. Returns the
+// location of the first instance (page 0 if the chain is empty).
+static GEN_LOC Generate_chain(int seg, GEN_LOC parent, int count) {
+
+	GEN_SEG	*s = &Seg[seg];
+	GEN_LOC	first = { 0, 0 };
+	GEN_LOC	prev = { 0, 0 };
+	GEN_LOC	none = { 0, 0 };
+
+	for (int k = 0; k < count; k++) {
+
+		GEN_LOC	loc = Alloc_slot(seg);
+		UCHAR	*instance = s->page + (loc.word - 1) * 4;
+
+		if (prev.page) {
+			Write_pointer(seg, prev, s->number_of_children,
+				loc, PTR_NEXT);
+		}
+		else {
+			first = loc;
+		}
+
+		if (s->parent > 0) {
+			put_pointer(instance + (s->number_of_children + 1) * 4,
+				parent, PTR_PARENT);
+		}
+
+		Fill_data(seg, instance + s->number_of_pointers * 4, k, count);
+		for (int j = s->first_field;
+				j < s->first_field + s->number_of_fields; j++) {
+			if (Field[j].indexed) {
+				Add_index_entry(j, instance +
+					s->number_of_pointers * 4 +
+					Field[j].offset, loc);
+			}
+		}
+		s->instances++;
+
+		for (int c = 0; c < s->number_of_children; c++) {
+			int	child = s->children[c];
+			GEN_LOC	child_first = Generate_chain(child, loc,
+						Seg[child].fanout);
+			if (child_first.page) {
+				Write_pointer(seg, loc, c, child_first,
+					PTR_CHILD);
+			}
+			else {
+				Write_pointer(seg, loc, c, none, 0);
+			}
+		}
+
+		prev = loc;
+	}
+
+	return first;
+}
+
+// Find room for one more instance on the segment's current page,
+// starting a new page if necessary.
+static GEN_LOC Alloc_slot(int seg) {
+
+	GEN_SEG	*s = &Seg[seg];
+	GEN_LOC	loc;
+
+	if (s->current_page == 0 ||
+			s->next_word + s->segment_length - 1 > LAST_WORD) {
+
+		if (Next_free_page > MAX_PAGES) {
+			die("file would have more than %d pages\n", MAX_PAGES);
+		}
+
+		int	new_page = Next_free_page++;
+
+		if (s->current_page) {
+			Flush_page(seg, new_page);
+		}
+		else {
+			s->first_page = new_page;
+		}
+
+		memset(s->page, 0, PAGESIZE);
+		s->current_page = new_page;
+		s->next_word = 1;
+		s->last_page = new_page;
+		s->number_of_pages++;
+	}
+
+	loc.page = s->current_page;
+	loc.word = s->next_word;
+	s->next_word += s->segment_length;
+
+	return loc;
+}
+
+// Store a pointer in an instance that may already be on disk.
+static void Write_pointer(int seg, GEN_LOC where, int word, GEN_LOC to,
+			int type) {
+
+	GEN_SEG	*s = &Seg[seg];
+	UCHAR	b[4];
+
+	put_pointer(b, to, type);
+
+	if (where.page == s->current_page) {
+		memcpy(s->page + (where.word - 1 + word) * 4, b, 4);
+		return;
+	}
+
+	if (fseek(Out, (long)(where.page - 1) * PAGESIZE +
+			(where.word - 1 + word) * 4, SEEK_SET) < 0 ||
+			fwrite(b, 1, 4, Out) != 4) {
+		die("can't patch page %d\n", where.page);
+	}
+}
+
+static void Fill_data(int seg, UCHAR *data, int k, int count) {
+
+	GEN_SEG	*s = &Seg[seg];
+
+	for (int j = s->first_field;
+			j < s->first_field + s->number_of_fields; j++) {
+
+		GEN_FIELD	*f = &Field[j];
+		UCHAR		*b = data + f->offset;
+		long		n;
+
+		if (f->key) {
+			n = f->key > 0 ? k : count - 1 - k;
+		}
+		else if (f->step > 0) {
+			n = s->instances / f->step;
+			if (f->cardinality > 0) n %= f->cardinality;
+		}
+		else {
+			n = next_random() % (f->cardinality > 0 ?
+						f->cardinality : 1);
+		}
+
+		switch (f->type) {
+			case 'A': {
+				// As much of the name as leaves room for the
+				// widest number. Keys are zero-padded, so they
+				// sort as text.
+				long	widest = f->key ? count - 1 :
+						f->cardinality - 1;
+				if (widest < 0) widest = 0;
+				int	prefix = f->length - decimal_digits(widest);
+				char	value[64];
+				int	len;
+				if (prefix < 0) {
+					die("field %s is A%d, too short for %d "
+						"keys\n", f->name, f->length,
+						count);
+				}
+				if (prefix > 4) prefix = 4;
+				if (f->key) {
+					int digits = f->length - prefix;
+					if (digits > 9) digits = 9;
+					len = snprintf(value, sizeof(value),
+						"%.*s%0*ld", prefix, f->name,
+						digits, n);
+				}
+				else {
+					len = snprintf(value, sizeof(value),
+						"%.*s%ld", prefix, f->name, n);
+				}
+				memset(b, ' ', f->length);
+				memcpy(b, value, len < f->length ?
+						len : f->length);
+				break;
+			}
+			case 'I': {
+				int32_t	i = (int32_t) n;
+				memcpy(b, &i, 4);
+				break;
+			}
+			case 'S': {
+				// Days since 1900-Dec-31, from 1991-Jan-01
+				int32_t	i = (int32_t)(32873 + n);
+				memcpy(b, &i, 4);
+				break;
+			}
+			case 'D': {
+				double	d = n / 100.0;
+				memcpy(b, &d, 8);
+				break;
+			}
+			case 'F': {
+				float	fl = n / 100.0;
+				memcpy(b, &fl, 4);
+				break;
+			}
+		}
+	}
+}
+
+// Write the segment's current page, linked to next_page.
+static void Flush_page(int seg, int next_page) {
+
+	GEN_SEG	*s = &Seg[seg];
+	GEN_LOC	first = { s->current_page, 1 };
+
+	if (s->current_page == 0) {
+		return;
+	}
+
+	Write_control(s->page, s->current_page, next_page, seg,
+		s->next_word, first);
+
+	if (fseek(Out, (long)(s->current_page - 1) * PAGESIZE, SEEK_SET) < 0
+			|| fwrite(s->page, 1, PAGESIZE, Out) != PAGESIZE) {
+		die("can't write page %d\n", s->current_page);
+	}
+}
+
+static void Write_control(UCHAR *page, int page_number, int next_page,
+			int segment, int free_word, GEN_LOC first) {
+
+	UCHAR	*ctrl = page + CTRLOFF;
+	int32_t	transaction = (int32_t) Transaction;
+
+	put_pointer(ctrl, first, PTR_NEXT);
+	put_short(ctrl + 4, next_page);
+	put_short(ctrl + 6, segment);
+	put_short(ctrl + 8, LAST_WORD);
+	put_short(ctrl + 10, page_number);
+	put_short(ctrl + 12, 0);		// nothing deleted
+	put_short(ctrl + 14, free_word);
+	ctrl[16] = 0;				// not encrypted
+	memset(ctrl + 17, 0, 7);		// date and time
+	memcpy(ctrl + 24, &transaction, 4);
+}
+
+// Page 1: the File Directory Table, and the pointer to the first
+// root instance.
+static void Write_fdt(GEN_LOC root_first) {
+
+	UCHAR	*page = (UCHAR*) calloc(1, PAGESIZE);
+	UCHAR	*fdt = page + FDTOFF;
+	UCHAR	*entry;
+	GEN_LOC	none = { 0, 0 };
+	int	i;
+
+	int	entries = Num_segments + Num_indices;
+
+	if ((entries + 1) * 20 > FDTOFF) {
+		die("too many FDT entries\n");
+	}
+
+	put_short(fdt, entries);
+
+	for (i = 1; i <= Num_segments; i++) {
+		entry = fdt - i * 20;
+		put_short(entry + 0, Seg[i].first_page);
+		put_short(entry + 2, Seg[i].last_page);
+		memset(entry + 4, ' ', 8);
+		memcpy(entry + 4, Seg[i].name, strlen(Seg[i].name));
+		put_short(entry + 12, Seg[i].segment_length);
+		put_short(entry + 14, Seg[i].parent);
+		put_short(entry + 16, Seg[i].number_of_pages);
+		put_short(entry + 18, Seg[i].number_of_pointers);
+	}
+
+	for (i = 0; i < Num_indices; i++) {
+		entry = fdt - (Num_segments + i + 1) * 20;
+		put_short(entry + 0, Index[i].first_page);
+		put_short(entry + 2, Index[i].last_page);
+		memset(entry + 4, ' ', 12);
+		memcpy(entry + 4, Field[Index[i].field].name,
+			strlen(Field[Index[i].field].name));
+		put_short(entry + 16, Index[i].number_of_pages);
+		put_short(entry + 18, 0);	// INDEXTYPE_BTREE
+	}
+
+	// The extra entry holding the number of segments
+	put_short(fdt - (entries + 1) * 20, Num_segments);
+
+	Write_control(page, 1, 0, 0, 1, none);
+
+	if (fseek(Out, 0, SEEK_SET) < 0 ||
+			fwrite(page, 1, PAGESIZE, Out) != PAGESIZE) {
+		die("can't write FDT\n");
+	}
+
+	// The root segment's first page points to the top of the file.
+	UCHAR	b[4];
+	put_pointer(b, root_first, PTR_NEXT);
+	if (fseek(Out, (long)(Seg[1].first_page - 1) * PAGESIZE + CTRLOFF,
+			SEEK_SET) < 0 || fwrite(b, 1, 4, Out) != 4) {
+		die("can't write root pointer\n");
+	}
+
+	free(page);
+}
+
+static void Add_index_entry(int field, UCHAR *key, GEN_LOC loc) {
+
+	GEN_INDEX	*idx = NULL;
+
+	for (int i = 0; i < Num_indices; i++) {
+		if (Index[i].field == field) {
+			idx = &Index[i];
+		}
+	}
+
+	if (idx->number_of_entries == idx->allocated) {
+		idx->allocated = idx->allocated ? idx->allocated * 2 : 1024;
+		idx->entries = (UCHAR*) realloc(idx->entries,
+					idx->allocated * idx->entry_size);
+		if (!idx->entries) {
+			die("out of memory for index %s\n", Field[field].name);
+		}
+	}
+
+	UCHAR	*e = idx->entries + idx->number_of_entries * idx->entry_size;
+	memcpy(e, key, idx->key_size);
+	put_short(e + idx->key_size, loc.page);
+	put_short(e + idx->key_size + 2, loc.word);
+	idx->number_of_entries++;
+}
+
+// qsort() has no user argument, so the index being sorted lives here.
+static GEN_INDEX	*Sorting;
+
+static int key_compare(const void *a, const void *b) {
+
+	char	type = Field[Sorting->field].type;
+	int	c = 0;
+
+	if (type == 'I' || type == 'S') {
+		int32_t x, y;
+		memcpy(&x, a, 4);
+		memcpy(&y, b, 4);
+		c = (x > y) - (x < y);
+	}
+	else if (type == 'D') {
+		double x, y;
+		memcpy(&x, a, 8);
+		memcpy(&y, b, 8);
+		c = (x > y) - (x < y);
+	}
+	else if (type == 'F') {
+		float x, y;
+		memcpy(&x, a, 4);
+		memcpy(&y, b, 4);
+		c = (x > y) - (x < y);
+	}
+	else {
+		c = memcmp(a, b, Sorting->key_size);
+	}
+
+	if (c == 0) {
+		// Keep equal keys in file order
+		int pa = (unsigned short)(((UCHAR*)a)[Sorting->key_size] |
+			(((UCHAR*)a)[Sorting->key_size + 1] << 8));
+		int pb = (unsigned short)(((UCHAR*)b)[Sorting->key_size] |
+			(((UCHAR*)b)[Sorting->key_size + 1] << 8));
+		int wa = ((UCHAR*)a)[Sorting->key_size + 2] |
+			(((UCHAR*)a)[Sorting->key_size + 3] << 8);
+		int wb = ((UCHAR*)b)[Sorting->key_size + 2] |
+			(((UCHAR*)b)[Sorting->key_size + 3] << 8);
+		c = pa != pb ? pa - pb : wa - wb;
+	}
+
+	return c;
+}
+
+// A node of the B-tree under construction. Records are
+// key | data page | data word [| child page | unused].
+struct GEN_NODE {
+	int	is_leaf;
+	int	number_of_records;
+	UCHAR	*records;
+	int	*child;		// node number of each record's child
+	int	page;
+	int	parent;
+	int	right_sibling;
+};
+
+static GEN_NODE	*Nodes;
+static int	Num_nodes;
+
+static int New_node(int is_leaf, int records, int record_size) {
+
+	Nodes = (GEN_NODE*) realloc(Nodes, sizeof(GEN_NODE) * (Num_nodes + 1));
+	GEN_NODE *n = &Nodes[Num_nodes];
+	n->is_leaf = is_leaf;
+	n->number_of_records = 0;
+	n->records = (UCHAR*) calloc(records, record_size);
+	n->child = (int*) calloc(records, sizeof(int));
+	n->page = 0;
+	n->parent = -1;
+	n->right_sibling = -1;
+	return Num_nodes++;
+}
+
+// Splits `count' items into nodes of at most `capacity' items, with one
+// item promoted between each pair of neighbouring nodes.
+static int Number_of_nodes(long count, int capacity) {
+	return (count + 1 + capacity) / (capacity + 1);
+}
+
+/* FOCUS B-trees keep data pointers in the non-leaf records too, so this
+   is the classic Bayer-McCreight tree, not a B+tree. Every non-leaf node
+   starts with a record whose key is lower than any real key; its child
+   holds everything less than the node's second key. */
+static void Build_index(GEN_INDEX *idx) {
+
+	GEN_FIELD	*f = &Field[idx->field];
+	int		leaf_size = idx->key_size + 4;
+	int		node_size = idx->key_size + 8;
+	int		leaf_capacity = (CTRLOFF - NODEOFF) / leaf_size;
+	int		node_capacity = (CTRLOFF - NODEOFF) / node_size;
+	long		i;
+	int		j;
+
+	Sorting = idx;
+	qsort(idx->entries, idx->number_of_entries, idx->entry_size,
+		key_compare);
+
+	Nodes = NULL;
+	Num_nodes = 0;
+
+	UCHAR	*lowest = (UCHAR*) calloc(1, idx->key_size);
+	if (f->type == 'I' || f->type == 'S') {
+		int32_t	low = INT32_MIN;
+		memcpy(lowest, &low, 4);
+	}
+	else if (f->type == 'D') {
+		double	low = -DBL_MAX;
+		memcpy(lowest, &low, 8);
+	}
+	else if (f->type == 'F') {
+		float	low = -FLT_MAX;
+		memcpy(lowest, &low, 4);
+	}
+
+	// The leaves, and the items they promote.
+	long	count = idx->number_of_entries;
+	int	leaves = count ? Number_of_nodes(count, leaf_capacity) : 1;
+	UCHAR	*items = (UCHAR*) malloc((leaves + 1) * node_size);
+	int	*item_child = (int*) malloc((leaves + 1) * sizeof(int));
+	int	num_items = 0;
+	int	first_child = -1;
+	int	previous = -1;
+	long	taken = 0;
+
+	for (j = 0; j < leaves; j++) {
+		long	share = (count - (leaves - 1)) / leaves +
+				(j < (count - (leaves - 1)) % leaves ? 1 : 0);
+		int	node = New_node(1, leaf_capacity, leaf_size);
+
+		for (i = 0; i < share; i++) {
+			memcpy(Nodes[node].records + i * leaf_size,
+				idx->entries + (taken++) * idx->entry_size,
+				leaf_size);
+		}
+		Nodes[node].number_of_records = share;
+
+		if (previous >= 0) {
+			Nodes[previous].right_sibling = node;
+		}
+		previous = node;
+
+		if (j == 0) {
+			first_child = node;
+		}
+		else {
+			item_child[num_items - 1] = node;
+		}
+
+		if (j < leaves - 1) {
+			memcpy(items + num_items * node_size,
+				idx->entries + (taken++) * idx->entry_size,
+				leaf_size);
+			num_items++;
+		}
+	}
+
+	// Non-leaf levels, until one node holds them all.
+	int	root = first_child;
+
+	while (num_items > 0) {
+
+		int	nodes = Number_of_nodes(num_items, node_capacity - 1);
+		UCHAR	*up = (UCHAR*) malloc((nodes + 1) * node_size);
+		int	*up_child = (int*) malloc((nodes + 1) * sizeof(int));
+		int	num_up = 0;
+		int	up_first = -1;
+		int	left = first_child;
+		int	next_item = 0;
+
+		previous = -1;
+
+		for (j = 0; j < nodes; j++) {
+			int	share = (num_items - (nodes - 1)) / nodes +
+				(j < (num_items - (nodes - 1)) % nodes ? 1 : 0);
+			int	node = New_node(0, node_capacity, node_size);
+			GEN_NODE *n = &Nodes[node];
+
+			memcpy(n->records, lowest, idx->key_size);
+			n->child[0] = left;
+			Nodes[left].parent = node;
+
+			for (int r = 1; r <= share; r++) {
+				memcpy(n->records + r * node_size,
+					items + next_item * node_size,
+					leaf_size);
+				n->child[r] = item_child[next_item];
+				Nodes[n->child[r]].parent = node;
+				next_item++;
+			}
+			n->number_of_records = share + 1;
+
+			if (previous >= 0) {
+				Nodes[previous].right_sibling = node;
+			}
+			previous = node;
+
+			if (j == 0) {
+				up_first = node;
+			}
+			else {
+				up_child[num_up - 1] = node;
+			}
+
+			if (j < nodes - 1) {
+				memcpy(up + num_up * node_size,
+					items + next_item * node_size,
+					leaf_size);
+				left = item_child[next_item];
+				next_item++;
+				num_up++;
+			}
+		}
+
+		free(items);
+		free(item_child);
+		items = up;
+		item_child = up_child;
+		num_items = num_up;
+		first_child = up_first;
+		root = up_first;
+	}
+	free(items);
+	free(item_child);
+	free(lowest);
+
+	// The root comes first, since the FDT's first page is the root.
+	int	base = Next_free_page;
+	int	number = 0;
+
+	if (base + Num_nodes - 1 > MAX_PAGES) {
+		die("file would have more than %d pages\n", MAX_PAGES);
+	}
+	Nodes[root].page = base + number++;
+	for (j = Num_nodes - 1; j >= 0; j--) {
+		if (j != root) {
+			Nodes[j].page = base + number++;
+		}
+	}
+	Next_free_page += Num_nodes;
+
+	UCHAR	*page = (UCHAR*) malloc(PAGESIZE);
+	GEN_LOC	none = { 0, 0 };
+
+	for (j = 0; j < Num_nodes; j++) {
+
+		GEN_NODE	*n = &Nodes[j];
+		int		size = n->is_leaf ? leaf_size : node_size;
+
+		memset(page, 0, PAGESIZE);
+		page[0] = n->is_leaf;
+		put_short(page + 4, n->parent >= 0 ? Nodes[n->parent].page : 0);
+		put_short(page + 6, n->right_sibling >= 0 ?
+					Nodes[n->right_sibling].page : 0);
+		put_short(page + 8, idx->key_size);
+		put_short(page + 10, size);
+		put_short(page + 16, n->number_of_records * size);
+
+		for (int r = 0; r < n->number_of_records; r++) {
+			UCHAR *rec = page + NODEOFF + r * size;
+			memcpy(rec, n->records + r * size, leaf_size);
+			if (!n->is_leaf) {
+				put_short(rec + idx->key_size + 4,
+					Nodes[n->child[r]].page);
+			}
+		}
+
+		Write_control(page, n->page, 0, 0, 0, none);
+
+		if (fseek(Out, (long)(n->page - 1) * PAGESIZE, SEEK_SET) < 0
+			|| fwrite(page, 1, PAGESIZE, Out) != PAGESIZE) {
+			die("can't write index page %d\n", n->page);
+		}
+
+		free(n->records);
+		free(n->child);
+	}
+
+	idx->first_page = Nodes[root].page;
+	idx->last_page = base + Num_nodes - 1;
+	idx->number_of_pages = Num_nodes;
+
+	free(page);
+	free(Nodes);
+	free(idx->entries);
+	idx->entries = NULL;
+}
+
+// How many digits %ld prints for n >= 0
+static int decimal_digits(long n) {
+	int digits = 1;
+	for (; n >= 10; n /= 10) digits++;
+	return digits;
+}
+
+// Little-endian, the way PC/FOCUS stores them
+static void put_short(UCHAR *b, int value) {
+	b[0] = value & 0xff;
+	b[1] = (value >> 8) & 0xff;
+}
+
+// pppppppp pppppppp ttttttww wwwwwwww
+static void put_pointer(UCHAR *b, GEN_LOC loc, int type) {
+	put_short(b, loc.page);
+	put_short(b + 2, (type << 10) | (loc.word & 0x3ff));
+}
+
+// A 64-bit LCG, so the same seed makes the same file everywhere.
+static uint64_t next_random(void) {
+	Rand_state = Rand_state * 6364136223846793005ULL +
+			1442695040888963407ULL;
+	return Rand_state >> 33;
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
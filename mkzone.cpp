@@ -0,0 +1,154 @@
+/*
+    mkzone
+    ------
+    Builds or checks the zone map of a FOCUS file: the records and the
+    lowest and highest values of some fields on each data page, for
+    FOCZONESCAN to skip pages with.
+
+    *********************************************************
+    This library is in no way related to or supported by IBI.
+    IBI's FOCUS is a proprietary database whose format may
+    change at any time. If you have any problems, suggestions,
+    or comments about the FocFile C++ library, contact
+    the author, not Information Builders!
+    *********************************************************
+
+    Copyright (C) 2026  the FocFile contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+/*
+   mkzone [-m mfd] -f field [-f field ...] file.foc zonefile
+   mkzone -c file.foc zonefile
+
+   -f	A field to keep the bounds of, written as its FOCFLD macro
+	expands: seg,offset,type,length (3,0,S,4 for ORDER_DATE in
+	orders.h). Every segment with a field is mapped.
+   -m	The FOCFILE_ string from the mas2h header, if the file's
+	segment types matter (they don't for walking every record)
+   -c	Check an existing zone map instead: read every page it covers
+	and count those that have changed since it was built.
+
+   One line per mapped segment, or for -c:
+
+	segment=3 pages=4262 records=500000
+	fdt_changed=0 pages=4641 stale=0
+
+   mkzone -c exits with 1 if anything is stale.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "foczone.h"
+
+#define die(format, args...) { \
+	fprintf(stderr, "mkzone: " format, ## args); \
+	exit(-1); \
+	}
+
+static void usage(void);
+
+int main(int argc, char **argv) {
+
+	FOCZONEMAP	map;
+	FOCFILE		*foc;
+	FILE		*foc_fh, *zone_fh;
+	char		*mfd = NULL;
+	int		check = 0, fields = 0;
+	int		seg, offset, length, c;
+	char		type;
+
+	while ((c = getopt(argc, argv, "m:f:c")) != EOF) {
+		switch (c) {
+			case 'm':
+				mfd = optarg;
+				break;
+			case 'f':
+				if (sscanf(optarg, "%d,%d,%c,%d", &seg, &offset,
+						&type, &length) != 4) {
+					die("bad field %s\n", optarg);
+				}
+				map.field(seg, offset, type, length);
+				fields++;
+				break;
+			case 'c':
+				check = 1;
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (optind != argc - 2 || (!check && fields == 0)) {
+		usage();
+	}
+
+	if (!(foc_fh = fopen(argv[optind], "rb"))) {
+		die("Can't open %s\n", argv[optind]);
+	}
+	foc = mfd ? new FOCFILE(mfd, foc_fh) : new FOCFILE(foc_fh);
+
+	if (check) {
+		if (!(zone_fh = fopen(argv[optind + 1], "rb"))) {
+			die("Can't open %s\n", argv[optind + 1]);
+		}
+		int fdt_changed = !map.read(zone_fh, foc);
+		fclose(zone_fh);
+
+		int pages = 0;
+		for (seg = 1; seg <= foc->number_seg(); seg++) {
+			pages += map.pages(seg);
+		}
+		int stale = map.stale(foc);
+
+		printf("fdt_changed=%d pages=%d stale=%d\n", fdt_changed,
+			pages, stale);
+		return fdt_changed || stale;
+	}
+
+	map.build(foc);
+	for (seg = 1; seg <= foc->number_seg(); seg++) {
+		if (map.pages(seg) > 0) {
+			printf("segment=%d pages=%d records=%ld\n", seg,
+				map.pages(seg), map.records(seg));
+		}
+	}
+
+	if (!(zone_fh = fopen(argv[optind + 1], "wb"))) {
+		die("Can't open %s\n", argv[optind + 1]);
+	}
+	map.write(zone_fh);
+	fclose(zone_fh);
+
+	delete foc;
+	fclose(foc_fh);
+	return 0;
+}
+
+static void usage(void) {
+
+	die("usage: mkzone [-m mfd] -f seg,offset,type,length ... "
+		"file.foc zonefile\n"
+		"       mkzone -c file.foc zonefile\n");
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/
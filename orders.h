@@ -0,0 +1,33 @@
+
+#define FOCSEG_ORDERS_REGION		1
+#define FOCFLD_ORDERS_REGION		1,0,'A',8
+#define FOCFMT_ORDERS_REGION		"%8s"
+#define FOCIDX_ORDERS_REGION		1,'A',1
+#define FOCFLD_ORDERS_MANAGER		1,8,'A',20
+#define FOCFMT_ORDERS_MANAGER		"%20s"
+
+#define FOCSEG_ORDERS_CUST		2
+#define FOCFLD_ORDERS_CUST_ID		2,0,'I',4
+#define FOCFMT_ORDERS_CUST_ID		"%8ld"
+#define FOCIDX_ORDERS_CUST_ID		2,'I',2
+#define FOCFLD_ORDERS_CUST_NAME		2,4,'A',24
+#define FOCFMT_ORDERS_CUST_NAME		"%24s"
+#define FOCIDX_ORDERS_CUST_NAME		3,'A',2
+#define FOCFLD_ORDERS_STATUS		2,28,'A',2
+#define FOCFMT_ORDERS_STATUS		"%2s"
+
+#define FOCSEG_ORDERS_ORDERS		3
+#define FOCFLD_ORDERS_ORDER_DATE		3,0,'S',4
+#define FOCFMT_ORDERS_ORDER_DATE		"%5ld"
+#define FOCIDX_ORDERS_ORDER_DATE		4,'S',3
+#define FOCFLD_ORDERS_AMOUNT		3,4,'D',8
+#define FOCFMT_ORDERS_AMOUNT		"%12.2lf"
+#define FOCFLD_ORDERS_QTY		3,12,'I',4
+#define FOCFMT_ORDERS_QTY		"%5ld"
+#define FOCIDX_ORDERS_QTY		5,'I',3
+#define FOCFLD_ORDERS_PRICE		3,16,'F',4
+#define FOCFMT_ORDERS_PRICE		"%8.2f"
+#define FOCFLD_ORDERS_CHANNEL		3,20,'A',6
+#define FOCFMT_ORDERS_CHANNEL		"%6s"
+
+#define FOCFILE_ORDERS		"s1 tS1 s2 tS1 s3 tS0 "
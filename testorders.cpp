@@ -0,0 +1,1402 @@
+// testorders.cpp
+// --------------
+// Checks the index walks, the scans, and the classes built on them,
+// against a nested next() walk of data/orders.foc. Every index of the
+// file is walked forwards and backwards and looked up key by key;
+// FOCKEYS, FOCSIDX, FOCBITMAPINDEX, FOCINTERSECT and FOCTOPN, FOCEXPR,
+// FOCSCAN, FOCZONESCAN, FOCSAMPLESCAN, reccount_estimate(), the
+// sketches, FOCAGG and FOCROLLUP are held to what the walk found.
+// Prints each failure, and exits with 1 if there were any. "make test"
+// runs it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "focfile.h"
+#include "fockeys.h"
+#include "focsidx.h"
+#include "focbitmap.h"
+#include "focintersect.h"
+#include "foctop.h"
+#include "focscan.h"
+#include "focagg.h"
+#include "foczone.h"
+#include "focsample.h"
+#include "focsketch.h"
+#include "orders.h"
+
+#define die(format, args...) \
+	fprintf(stderr, "testorders: " format, ## args); \
+	exit(-1);
+
+#define check(test, format, args...) \
+	if (Checks++, !(test)) { \
+		Failures++; \
+		printf("testorders: FAIL: " format, ## args); \
+	}
+
+#define NUM_SEGS	3
+#define DATA_MAX	32	// longest data area of the three
+
+// A record, as the nested walk found it. n is its place in the walk,
+// and parent its parent's.
+struct REC {
+	int	page;
+	int	word;
+	long	n;
+	long	parent;
+	UCHAR	data[DATA_MAX];
+};
+
+// A field of one of the three segments
+struct FIELD {
+	int	seg;
+	int	offset;
+	char	type;
+	int	length;
+};
+
+static REC	*Rec[NUM_SEGS + 1];
+static long	Num_recs[NUM_SEGS + 1];
+static long	*By_position[NUM_SEGS + 1];	// Rec indexes, by page, word
+
+// The bytes of each segment's data area, to the end of its last field
+static int	Data_length[NUM_SEGS + 1] = { 0, 28, 30, 26 };
+
+// Values the filters test for, from the file
+static char	Status[3];
+static char	Channel[2][8];
+
+static long	Checks = 0;
+static long	Failures = 0;
+
+static FIELD	Sort_field;			// for key_order()
+static int	Highest;			// and best_order()
+static long	*Scan_rank;
+
+static void walk_file(FOCFILE* foc);
+static REC* find_rec(int seg, FOCPTR& where);
+static long* sorted_by_key(FIELD& f);
+static long key_count(FIELD& f, long* sorted, long at);
+static void check_index(FOCFILE* foc, int idx, char type, int seg,
+		FIELD f, const char* name);
+static void check_postings(FOCFILE* foc, int idx, char type, int seg,
+		FIELD& f, long* sorted, const char* name);
+static void check_prefixes(FOCFILE* foc, int idx, char type, int seg,
+		FIELD& f, long* sorted, const char* name);
+static void check_keys(FOCFILE* foc, int idx, char type, int seg,
+		FIELD& f, long* sorted, const char* name);
+static void check_sidx(FOCFILE* foc, FIELD f, int kind, const char* name);
+static void check_bitmaps(FOCFILE* foc);
+static void check_intersect(FOCFILE* foc);
+static void check_topn(FOCFILE* foc, FIELD f, int n, int order,
+		const char* name, int idx=0, char type=0, int seg=0);
+static void check_expr_scan(FOCFILE* foc);
+static void check_zonescan(FOCFILE* foc);
+static void check_estimate(FOCFILE* foc);
+static void check_samplescan(FOCFILE* foc);
+static void check_sketches(void);
+static void check_agg(FOCFILE* foc);
+static void check_rollup(FOCFILE* foc);
+static UCHAR* parent_data(int seg, long i);
+static void build_expr(FOCEXPR& where);
+static int passes_expr(long i);
+static void alpha_value(char* s, UCHAR* field, int length);
+static uint64_t record_hash(UCHAR* data, int seg);
+static int key_order(const void *a, const void *b);
+static int position_order(const void *a, const void *b);
+static int best_order(const void *a, const void *b);
+static int walk_order(const void *a, const void *b);
+static int hash_order(const void *a, const void *b);
+static int int32_order(const void *a, const void *b);
+static int double_order(const void *a, const void *b);
+
+int main(void) {
+
+	FOCFILE*	foc;
+	FILE*		fh;
+
+	if (!(fh = fopen("orders.foc", "rb"))) {
+		die("Can't open orders.foc\n");
+	}
+	foc = new FOCFILE(FOCFILE_ORDERS, fh);
+
+	walk_file(foc);
+	printf("testorders: %ld regions, %ld customers, %ld orders\n",
+		Num_recs[1], Num_recs[2], Num_recs[3]);
+
+	// FIELD and index macros name the same fields
+	FIELD region	= { FOCFLD_ORDERS_REGION };
+	FIELD cust_id	= { FOCFLD_ORDERS_CUST_ID };
+	FIELD cust_name	= { FOCFLD_ORDERS_CUST_NAME };
+	FIELD date	= { FOCFLD_ORDERS_ORDER_DATE };
+	FIELD qty	= { FOCFLD_ORDERS_QTY };
+	FIELD amount	= { FOCFLD_ORDERS_AMOUNT };
+	FIELD channel	= { FOCFLD_ORDERS_CHANNEL };
+
+	check_index(foc, FOCIDX_ORDERS_REGION, region, "REGION");
+	check_index(foc, FOCIDX_ORDERS_CUST_ID, cust_id, "CUST_ID");
+	check_index(foc, FOCIDX_ORDERS_CUST_NAME, cust_name, "CUST_NAME");
+	check_index(foc, FOCIDX_ORDERS_ORDER_DATE, date, "ORDER_DATE");
+	check_index(foc, FOCIDX_ORDERS_QTY, qty, "QTY");
+
+	check_sidx(foc, amount, FOCSIDX_SORTED, "sorted AMOUNT");
+	check_sidx(foc, channel, FOCSIDX_HASHED, "hashed CHANNEL");
+	check_sidx(foc, cust_name, FOCSIDX_SORTED, "sorted CUST_NAME");
+
+	check_bitmaps(foc);
+	check_intersect(foc);
+
+	check_topn(foc, qty, 10, FOCTOP_HIGHEST, "QTY highest, scan");
+	check_topn(foc, qty, 250, FOCTOP_LOWEST, "QTY lowest, scan");
+	check_topn(foc, amount, 50, FOCTOP_HIGHEST, "AMOUNT highest, scan");
+	check_topn(foc, qty, 10, FOCTOP_HIGHEST, "QTY highest, index",
+		FOCIDX_ORDERS_QTY);
+	check_topn(foc, qty, 250, FOCTOP_LOWEST, "QTY lowest, index",
+		FOCIDX_ORDERS_QTY);
+
+	// A customer's STATUS, and the first two CHANNELs
+	memcpy(Status, Rec[2][0].data + 28, 2);
+	alpha_value(Channel[0], Rec[3][0].data + 20, 6);
+	for (long i = 1; i < Num_recs[3]; i++) {
+		alpha_value(Channel[1], Rec[3][i].data + 20, 6);
+		if (strcmp(Channel[0], Channel[1]) != 0) {
+			break;
+		}
+	}
+
+	check_expr_scan(foc);
+	check_zonescan(foc);
+	check_estimate(foc);
+	check_samplescan(foc);
+	check_sketches();
+	check_agg(foc);
+	check_rollup(foc);
+
+	delete foc;
+	fclose(fh);
+
+	printf("testorders: %ld checks, %ld failed\n", Checks, Failures);
+	return Failures ? 1 : 0;
+}
+
+// The nested next() walk, which the rest is held to
+void walk_file(FOCFILE* foc) {
+
+	long	allocated[NUM_SEGS + 1];
+	int	seg;
+
+	for (seg = 1; seg <= NUM_SEGS; seg++) {
+		Num_recs[seg]	= 0;
+		allocated[seg]	= 1024;
+		Rec[seg] = (REC*) xmalloc("records", sizeof(REC) * 1024);
+	}
+
+	foc->reposition(FOCSEG_ORDERS_REGION);
+	for (seg = 1; seg > 0; ) {
+		if (!foc->next(seg)) {
+			seg--;
+			continue;
+		}
+
+		if (Num_recs[seg] == allocated[seg]) {
+			allocated[seg] *= 2;
+			Rec[seg] = (REC*) xrealloc("records", Rec[seg],
+					sizeof(REC) * allocated[seg]);
+		}
+
+		REC	*r = &Rec[seg][Num_recs[seg]];
+		FOCPTR	where;
+
+		foc->position(seg, where);
+		r->page	= where.page;
+		r->word	= where.word;
+		r->n	= Num_recs[seg]++;
+		r->parent = seg > 1 ? Num_recs[seg - 1] - 1 : -1;
+		memcpy(r->data, foc->record_data(seg), DATA_MAX);
+
+		if (seg < NUM_SEGS) {
+			seg++;
+		}
+	}
+
+	for (seg = 1; seg <= NUM_SEGS; seg++) {
+		By_position[seg] = (long*) xmalloc("positions",
+				sizeof(long) * Num_recs[seg]);
+		for (long i = 0; i < Num_recs[seg]; i++) {
+			By_position[seg][i] = i;
+		}
+		Sort_field.seg = seg;
+		qsort(By_position[seg], Num_recs[seg], sizeof(long),
+			position_order);
+	}
+}
+
+// The record at a position, or NULL
+REC* find_rec(int seg, FOCPTR& where) {
+
+	long	low = 0, high = Num_recs[seg];
+
+	while (low < high) {
+		long middle = (low + high) / 2;
+		REC *r = &Rec[seg][By_position[seg][middle]];
+		if (r->page < where.page ||
+				(r->page == where.page && r->word < where.word)) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	if (low == Num_recs[seg]) {
+		return NULL;
+	}
+	REC *r = &Rec[seg][By_position[seg][low]];
+	return r->page == where.page && r->word == where.word ? r : NULL;
+}
+
+// The segment's records by the field, then in walk order
+long* sorted_by_key(FIELD& f) {
+
+	long *sorted = (long*) xmalloc("sorted", sizeof(long) * Num_recs[f.seg]);
+
+	for (long i = 0; i < Num_recs[f.seg]; i++) {
+		sorted[i] = i;
+	}
+	Sort_field = f;
+	qsort(sorted, Num_recs[f.seg], sizeof(long), key_order);
+
+	return sorted;
+}
+
+// How many records from sorted[at] on have its key
+long key_count(FIELD& f, long* sorted, long at) {
+
+	UCHAR	*key = Rec[f.seg][sorted[at]].data + f.offset;
+	long	count = 0;
+
+	while (at + count < Num_recs[f.seg] &&
+			field_compare(f.type, f.length, key,
+			Rec[f.seg][sorted[at + count]].data + f.offset) == 0) {
+		count++;
+	}
+
+	return count;
+}
+
+// index_ends() and index_step() forwards give every record once, in key
+// order; backwards, the same in reverse
+void check_index(FOCFILE* foc, int idx, char type, int seg, FIELD f,
+		const char* name) {
+
+	long	n = Num_recs[seg];
+	long	*sorted = sorted_by_key(f);
+	long	*forward = (long*) xmalloc("forward", sizeof(long) * (n + 1));
+	long	*seen = (long*) xmalloc("seen", sizeof(long) * n);
+	long	count, i;
+	UCHAR	key[DATA_MAX];
+	FOCPTR	where;
+	REC	*r;
+
+	check(foc->index_key_size(idx, type, seg) == f.length,
+		"%s: key size %d, not %d\n", name,
+		foc->index_key_size(idx, type, seg), f.length);
+
+	memset(seen, 0, sizeof(long) * n);
+	foc->index_ends(idx, type, seg, 0);
+	for (count = 0; foc->index_step(idx, key, where); count++) {
+		if (!(r = find_rec(seg, where))) {
+			check(0, "%s: forward step %ld to page %d word %d, "
+				"where no record is\n", name, count,
+				where.page, where.word);
+			break;
+		}
+		check(memcmp(key, r->data + f.offset, f.length) == 0,
+			"%s: forward step %ld key isn't the record's\n",
+			name, count);
+		if (count > 0) {
+			check(field_compare(type, f.length,
+				Rec[seg][forward[count - 1]].data + f.offset,
+				key) <= 0,
+				"%s: forward step %ld out of order\n",
+				name, count);
+		}
+		if (count < n) {
+			forward[count] = r->n;
+			seen[r->n]++;
+		}
+	}
+	check(count == n, "%s: forward walk %ld records, not %ld\n",
+		name, count, n);
+	for (i = 0; i < n; i++) {
+		if (seen[i] != 1) {
+			check(0, "%s: forward walk met record %ld %ld times\n",
+				name, i, seen[i]);
+			break;
+		}
+	}
+
+	foc->index_ends(idx, type, seg, 1);
+	for (i = 0; foc->index_step(idx, key, where); i++) {
+		r = find_rec(seg, where);
+		if (i >= count || !r || r->n != forward[count - 1 - i]) {
+			check(0, "%s: backward step %ld isn't forward step "
+				"%ld\n", name, i, count - 1 - i);
+			break;
+		}
+	}
+	check(i == count, "%s: backward walk %ld records, not %ld\n",
+		name, i, count);
+
+	check_keys(foc, idx, type, seg, f, sorted, name);
+	check_postings(foc, idx, type, seg, f, sorted, name);
+	if (type == FIELDTYPE_ALPHA) {
+		check_prefixes(foc, idx, type, seg, f, sorted, name);
+	}
+
+	free(sorted);
+	free(forward);
+	free(seen);
+}
+
+// FOCKEYS gives each distinct key once, in order, with its count
+void check_keys(FOCFILE* foc, int idx, char type, int seg, FIELD& f,
+		long* sorted, const char* name) {
+
+	FOCKEYS	keys(foc, idx, type, seg);
+	long	distinct = 0, records = 0, at, i;
+
+	for (at = 0; at < Num_recs[seg]; at += key_count(f, sorted, at)) {
+		distinct++;
+	}
+
+	check(keys.distinct(&records) == distinct && records == Num_recs[seg],
+		"%s: FOCKEYS %ld keys of %ld records, not %ld of %ld\n", name,
+		keys.distinct(), records, distinct, Num_recs[seg]);
+
+	keys.rewind();
+	for (at = 0, i = 0; keys.next(); at += keys.records(), i++) {
+		if (at >= Num_recs[seg] || memcmp(keys.key(),
+				Rec[seg][sorted[at]].data + f.offset,
+				f.length) != 0 ||
+				keys.records() != key_count(f, sorted, at)) {
+			check(0, "%s: FOCKEYS key %ld isn't the walk's\n",
+				name, i);
+			return;
+		}
+	}
+	check(at == Num_recs[seg], "%s: FOCKEYS stopped at record %ld\n",
+		name, at);
+}
+
+// match_postings() moves to each record with the key, once
+void check_postings(FOCFILE* foc, int idx, char type, int seg, FIELD& f,
+		long* sorted, const char* name) {
+
+	UCHAR	key[DATA_MAX + 1];
+	FOCPTR	where;
+	long	at, count, moves, bad = 0;
+	REC	*r;
+
+	for (at = 0; at < Num_recs[seg] && bad < 5; at += count) {
+		count = key_count(f, sorted, at);
+		memset(key, 0, sizeof(key));
+		memcpy(key, Rec[seg][sorted[at]].data + f.offset, f.length);
+
+		for (moves = 0; ; moves++) {
+			int	found;
+
+			if (type == FIELDTYPE_ALPHA) {
+				found = foc->match_postings(idx, type, seg,
+						(char*) key);
+			}
+			else if (type == FIELDTYPE_SMDATE) {
+				SMDATE date(mkint32(key));
+				found = foc->match_postings(idx, type, seg,
+						date);
+			}
+			else {
+				int32_t i = mkint32(key);
+				found = foc->match_postings(idx, type, seg, i);
+			}
+			if (!found) {
+				break;
+			}
+
+			foc->position(seg, where);
+			r = find_rec(seg, where);
+			if (!r || memcmp(r->data + f.offset, key,
+						f.length) != 0) {
+				bad++;
+				check(0, "%s: match_postings for the key of "
+					"record %ld moved to another\n",
+					name, sorted[at]);
+				break;
+			}
+			if (moves > count) {
+				break;
+			}
+		}
+		if (moves != count) {
+			bad++;
+			check(0, "%s: match_postings for the key of record %ld "
+				"moved %ld times, not %ld\n", name, sorted[at],
+				moves, count);
+		}
+	}
+	check(bad == 0, "%s: match_postings failed for %ld keys\n", name, bad);
+}
+
+// match_prefix() moves to each record whose key starts with the prefix:
+// the first letter of each key, and its first four
+void check_prefixes(FOCFILE* foc, int idx, char type, int seg, FIELD& f,
+		long* sorted, const char* name) {
+
+	char	prefix[8], last[8] = "";
+	FOCPTR	where;
+	long	at, expect, moves, i;
+	int	length;
+	REC	*r;
+
+	for (length = 1; length <= 4; length += 3) {
+		for (at = 0; at < Num_recs[seg]; at++) {
+			memcpy(prefix, Rec[seg][sorted[at]].data + f.offset,
+				length);
+			prefix[length] = '\0';
+			if (at > 0 && strcmp(prefix, last) == 0) {
+				continue;
+			}
+			strcpy(last, prefix);
+
+			for (expect = 0, i = at; i < Num_recs[seg] &&
+					memcmp(Rec[seg][sorted[i]].data +
+					f.offset, prefix, length) == 0; i++) {
+				expect++;
+			}
+
+			for (moves = 0; moves <= expect && foc->match_prefix(
+					idx, type, seg, prefix); moves++) {
+				foc->position(seg, where);
+				r = find_rec(seg, where);
+				if (!r || memcmp(r->data + f.offset, prefix,
+							length) != 0) {
+					check(0, "%s: match_prefix \"%s\" moved "
+						"to a record without it\n",
+						name, prefix);
+					return;
+				}
+			}
+			check(moves == expect, "%s: match_prefix \"%s\" moved "
+				"%ld times, not %ld\n", name, prefix, moves,
+				expect);
+		}
+	}
+}
+
+// A FOCSIDX's postings for each key are the records with it, in walk
+// order, before and after a write() and read()
+void check_sidx(FOCFILE* foc, FIELD f, int kind, const char* name) {
+
+	FOCSIDX	built, loaded, *sidx;
+	UCHAR	key[DATA_MAX + 1];
+	FOCPTR	where;
+	long	*sorted = sorted_by_key(f);
+	long	at, count, moves, bad = 0;
+	FILE	*fh;
+	int	pass;
+
+	built.build(foc, f.seg, f.offset, f.type, f.length, kind);
+	check(built.postings() == Num_recs[f.seg],
+		"SIDX %s: %ld postings, not %ld\n", name, built.postings(),
+		Num_recs[f.seg]);
+
+	if (!(fh = tmpfile())) {
+		die("Can't make a temporary file\n");
+	}
+	built.write(fh);
+	rewind(fh);
+	check(loaded.read(fh, foc) == 1, "SIDX %s: read() says the file "
+		"has changed\n", name);
+	check(loaded.stale(foc) == 0, "SIDX %s: stale() counts %d pages\n",
+		name, loaded.stale(foc));
+	fclose(fh);
+
+	for (pass = 0; pass < 2; pass++) {
+		sidx = pass ? &loaded : &built;
+
+		for (at = 0; at < Num_recs[f.seg] && bad < 5; at += count) {
+			count = key_count(f, sorted, at);
+			memset(key, 0, sizeof(key));
+			memcpy(key, Rec[f.seg][sorted[at]].data + f.offset,
+				f.length);
+
+			int	found;
+			double	d;
+
+			memcpy(&d, key, sizeof(double));
+			found = f.type == FIELDTYPE_DOUBLE ?
+				sidx->find(d) : sidx->find((char*) key);
+			if (found != count) {
+				bad++;
+				check(0, "SIDX %s: find() %d for the key of "
+					"record %ld, not %ld\n", name, found,
+					sorted[at], count);
+			}
+
+			for (moves = 0; moves < count; moves++) {
+				found = f.type == FIELDTYPE_DOUBLE ?
+					sidx->match(foc, d) :
+					sidx->match(foc, (char*) key);
+				foc->position(f.seg, where);
+				if (!found || find_rec(f.seg, where) !=
+					&Rec[f.seg][sorted[at + moves]]) {
+					break;
+				}
+			}
+			if (moves != count || (f.type == FIELDTYPE_DOUBLE ?
+					sidx->match(foc, d) :
+					sidx->match(foc, (char*) key))) {
+				bad++;
+				check(0, "SIDX %s: match() for the key of "
+					"record %ld isn't the walk's\n", name,
+					sorted[at]);
+			}
+		}
+	}
+	check(bad == 0, "SIDX %s: failed for %ld keys\n", name, bad);
+
+	free(sorted);
+}
+
+// Each value's bitmap holds the records with it, by walk order, and
+// combining them is combining the records
+void check_bitmaps(FOCFILE* foc) {
+
+	FIELD		channel	= { FOCFLD_ORDERS_CHANNEL };
+	FIELD		status	= { FOCFLD_ORDERS_STATUS };
+	FOCBITMAPINDEX	by_channel, by_qty;
+	FOCPTR		where;
+	long		n = Num_recs[3], i, m, expect, brute;
+	int		v;
+
+	by_channel.build(foc, FOCFLD_ORDERS_CHANNEL);
+	by_qty.build(foc, FOCFLD_ORDERS_QTY);
+	check(by_channel.records() == n, "BITMAP: %ld records, not %ld\n",
+		by_channel.records(), n);
+
+	for (v = 0; v < by_channel.values(); v++) {
+		UCHAR			*value = by_channel.value(v);
+		const FOCBITMAP&	b = by_channel.value_bitmap(v);
+
+		for (expect = 0, i = 0; i < n; i++) {
+			int has = memcmp(Rec[3][i].data + channel.offset,
+					value, channel.length) == 0;
+			expect += has;
+			if (has != b.test(i)) {
+				check(0, "BITMAP: record %ld %s value %d\n",
+					i, has ? "lacks" : "has", v);
+				break;
+			}
+		}
+		check(b.count() == expect, "BITMAP: value %d has %ld records, "
+			"not %ld\n", v, b.count(), expect);
+
+		char key[16];
+		memset(key, 0, sizeof(key));
+		memcpy(key, value, channel.length);
+		check(by_channel.bitmap(key).count() == expect,
+			"BITMAP: bitmap() of value %d has %ld records\n", v,
+			by_channel.bitmap(key).count());
+	}
+	check(by_channel.bitmap((char*) "NOSUCH").count() == 0,
+		"BITMAP: a missing value has records\n");
+
+	// move() to every 97th record
+	for (m = 0; m < n; m += 97) {
+		by_channel.move(foc, m);
+		foc->position(3, where);
+		check(find_rec(3, where) == &Rec[3][m], "BITMAP: move() to "
+			"record %ld went to page %d word %d\n", m,
+			where.page, where.word);
+	}
+
+	// The first channel AND, OR, AND NOT some quantities
+	for (int32_t q = 1; q <= 2000; q += 333) {
+		FOCBITMAP	both = by_channel.value_bitmap(0);
+		FOCBITMAP	either = by_channel.value_bitmap(0);
+		FOCBITMAP	only = by_channel.value_bitmap(0);
+		long		n_both = 0, n_either = 0, n_only = 0;
+		UCHAR		*value = by_channel.value(0);
+
+		both.intersect(by_qty.bitmap(q));
+		either.unite(by_qty.bitmap(q));
+		only.subtract(by_qty.bitmap(q));
+
+		for (i = 0; i < n; i++) {
+			int c = memcmp(Rec[3][i].data + channel.offset, value,
+					channel.length) == 0;
+			int k = mkint32(Rec[3][i].data + 12) == q;
+			n_both += c && k;
+			n_either += c || k;
+			n_only += c && !k;
+		}
+		check(both.count() == n_both && either.count() == n_either &&
+			only.count() == n_only, "BITMAP: combining with QTY "
+			"%d gives %ld %ld %ld, not %ld %ld %ld\n", q,
+			both.count(), either.count(), only.count(), n_both,
+			n_either, n_only);
+	}
+
+	// A segment with a parent's records: STATUS of CUST
+	FOCBITMAPINDEX	by_status;
+	by_status.build(foc, FOCFLD_ORDERS_STATUS);
+	for (brute = 0, v = 0; v < by_status.values(); v++) {
+		const FOCBITMAP& b = by_status.value_bitmap(v);
+		for (m = b.next(0); m >= 0; m = b.next(m + 1)) {
+			brute += memcmp(Rec[2][m].data + status.offset,
+				by_status.value(v), status.length) == 0;
+		}
+	}
+	check(brute == Num_recs[2], "BITMAP: STATUS bitmaps hold %ld of "
+		"%ld customers\n", brute, Num_recs[2]);
+}
+
+// The records with every key are those the walk found with them
+void check_intersect(FOCFILE* foc) {
+
+	FOCPTR	where;
+	long	m, i, expect, got;
+
+	for (m = 0; m < Num_recs[3]; m += 1999) {
+		FOCINTERSECT	both(foc, FOCSEG_ORDERS_ORDERS);
+		REC		*r = &Rec[3][m];
+		SMDATE		date(mkint32(r->data + 0));
+		int32_t		qty = mkint32(r->data + 12);
+
+		both.key(FOCIDX_ORDERS_ORDER_DATE, date);
+		both.key(FOCIDX_ORDERS_QTY, qty);
+
+		for (expect = 0, i = 0; i < Num_recs[3]; i++) {
+			expect += memcmp(Rec[3][i].data, r->data, 4) == 0 &&
+				mkint32(Rec[3][i].data + 12) == qty;
+		}
+		check(both.count() == expect, "INTERSECT: record %ld's date "
+			"and quantity count %ld, not %ld\n", m, both.count(),
+			expect);
+
+		for (got = 0; both.next(); got++) {
+			foc->position(3, where);
+			REC *s = find_rec(3, where);
+			if (!s || memcmp(s->data, r->data, 4) != 0 ||
+					mkint32(s->data + 12) != qty) {
+				check(0, "INTERSECT: record %ld's keys moved "
+					"to another record\n", m);
+				break;
+			}
+		}
+		check(got == expect, "INTERSECT: record %ld's keys moved %ld "
+			"times, not %ld\n", m, got, expect);
+	}
+
+	// Two keys of a parent segment
+	for (m = 0; m < Num_recs[2]; m += 101) {
+		FOCINTERSECT	both(foc, FOCSEG_ORDERS_CUST);
+		REC		*r = &Rec[2][m];
+		int32_t		id = mkint32(r->data + 0);
+		char		name[32];
+
+		memset(name, 0, sizeof(name));
+		memcpy(name, r->data + 4, 24);
+		both.key(FOCIDX_ORDERS_CUST_ID, id);
+		both.key(FOCIDX_ORDERS_CUST_NAME, name);
+
+		for (expect = 0, i = 0; i < Num_recs[2]; i++) {
+			expect += memcmp(Rec[2][i].data, r->data, 28) == 0;
+		}
+		check(both.count() == expect, "INTERSECT: customer %ld counts "
+			"%ld, not %ld\n", m, both.count(), expect);
+	}
+}
+
+// The best n, best first, ties in the order a FOCSCAN meets them. An
+// index keeps equal keys in an order of its own, so only the values are
+// held to that there.
+void check_topn(FOCFILE* foc, FIELD f, int n, int order,
+		const char* name, int idx, char type, int seg) {
+
+	FOCTOPN	top(foc, f.seg, n, f.seg, f.offset, f.type, f.length, order);
+	FOCSCAN	scan(foc, f.seg);
+	long	*best = (long*) xmalloc("best", sizeof(long) * Num_recs[f.seg]);
+	long	got, i;
+	FOCPTR	where;
+	REC	*r;
+
+	Scan_rank = (long*) xmalloc("scan", sizeof(long) * Num_recs[f.seg]);
+	for (i = 0; scan.next(); i++) {
+		scan.position(where);
+		if (!(r = find_rec(f.seg, where))) {
+			die("TOPN %s: the scan met no record at page %d word "
+				"%d\n", name, where.page, where.word);
+		}
+		Scan_rank[r->n] = i;
+	}
+	check(i == Num_recs[f.seg], "TOPN %s: the scan met %ld records, not "
+		"%ld\n", name, i, Num_recs[f.seg]);
+
+	for (i = 0; i < Num_recs[f.seg]; i++) {
+		best[i] = i;
+	}
+	Sort_field	= f;
+	Highest		= order == FOCTOP_HIGHEST;
+	qsort(best, Num_recs[f.seg], sizeof(long), best_order);
+
+	if (idx) {
+		top.index(idx, type, seg);
+	}
+
+	for (got = 0; top.next(); got++) {
+		foc->position(f.seg, where);
+		r = find_rec(f.seg, where);
+		if (got >= Num_recs[f.seg] || !r ||
+				field_compare(f.type, f.length,
+				r->data + f.offset,
+				Rec[f.seg][best[got]].data + f.offset) != 0 ||
+				(!idx && r != &Rec[f.seg][best[got]])) {
+			check(0, "TOPN %s: record %ld isn't the sort's\n",
+				name, got);
+			break;
+		}
+	}
+	check(got == (n < Num_recs[f.seg] ? n : Num_recs[f.seg]),
+		"TOPN %s: %ld records, not %d\n", name, got, n);
+
+	free(best);
+	free(Scan_rank);
+	Scan_rank = NULL;
+}
+
+// The data area of a record's parent
+UCHAR* parent_data(int seg, long i) {
+
+	return Rec[seg - 1][Rec[seg][i].parent].data;
+}
+
+// The expression this file's scans are checked with:
+//	(STATUS EQ status OR CHANNEL IN (first, second)) AND NOT QTY LT 500
+// where STATUS is the parent's
+void build_expr(FOCEXPR& where) {
+
+	const char *channels[2] = { Channel[0], Channel[1] };
+
+	where.compare(FOCFLD_ORDERS_STATUS, FOCEXPR_EQ, Status);
+	where.in_list(FOCFLD_ORDERS_CHANNEL, 2, channels);
+	where.op_or();
+	where.compare(FOCFLD_ORDERS_QTY, FOCEXPR_LT, 500L);
+	where.op_not();
+	where.op_and();
+}
+
+int passes_expr(long i) {
+
+	UCHAR	*data = Rec[3][i].data;
+	char	channel[8];
+
+	alpha_value(channel, data + 20, 6);
+	return (memcmp(parent_data(3, i) + 28, Status, 2) == 0 ||
+			strcmp(channel, Channel[0]) == 0 ||
+			strcmp(channel, Channel[1]) == 0) &&
+		!(mkint32(data + 12) < 500);
+}
+
+// FOCEXPR::eval() on a second nested walk, and FOCSCAN with the same
+// expression, select the records the plain tests do
+void check_expr_scan(FOCFILE* foc) {
+
+	FOCEXPR	where;
+	FOCPTR	p;
+	long	expect = 0, got, i;
+	int	seg;
+	REC	*r;
+
+	for (i = 0; i < Num_recs[3]; i++) {
+		expect += passes_expr(i);
+	}
+	check(expect > 0 && expect < Num_recs[3], "EXPR: %ld of %ld orders "
+		"pass, so the test says nothing\n", expect, Num_recs[3]);
+
+	build_expr(where);
+	foc->reposition(FOCSEG_ORDERS_REGION);
+	for (seg = 1, i = got = 0; seg > 0; ) {
+		if (!foc->next(seg)) {
+			seg--;
+			continue;
+		}
+		if (seg < NUM_SEGS) {
+			seg++;
+			continue;
+		}
+		if (where.eval(foc) != passes_expr(i)) {
+			check(0, "EXPR: eval() of order %ld is %d\n", i,
+				!passes_expr(i));
+			break;
+		}
+		got += passes_expr(i);
+		i++;
+	}
+	check(got == expect, "EXPR: eval() passed %ld orders, not %ld\n",
+		got, expect);
+
+	// The same test on the data areas, for a one-segment expression
+	FOCEXPR	one;
+	one.range(FOCFLD_ORDERS_QTY, 100L, 900L);
+	one.compare(FOCFLD_ORDERS_AMOUNT, FOCEXPR_GT, 500.0);
+	one.op_or();
+	one.compile(foc);
+	for (i = got = 0; i < Num_recs[3]; i++) {
+		UCHAR	*data = Rec[3][i].data;
+		double	amount;
+		int32_t	qty = mkint32(data + 12);
+
+		memcpy(&amount, data + 4, sizeof(double));
+		got += one.eval_record(data) !=
+			((qty >= 100 && qty <= 900) || amount > 500.0);
+	}
+	check(got == 0, "EXPR: eval_record() wrong for %ld orders\n", got);
+
+	// FOCSCAN, with a column of the parent's and one of its own
+	FOCSCAN	scan(foc, FOCSEG_ORDERS_ORDERS);
+	char	status[3];
+	int32_t	qty;
+	long	bad = 0;
+
+	scan.where(where);
+	scan.column(status, FOCFLD_ORDERS_STATUS);
+	scan.column(qty, FOCFLD_ORDERS_QTY);
+	for (got = 0; scan.next(); got++) {
+		scan.position(p);
+		r = find_rec(3, p);
+		if (!r || !passes_expr(r->n) || qty != mkint32(r->data + 12) ||
+				strncmp(status, (char*) parent_data(3, r->n) +
+				28, 2) != 0) {
+			bad++;
+		}
+	}
+	check(got == expect && bad == 0, "SCAN: %ld orders, %ld of them "
+		"wrong, not %ld\n", got, bad, expect);
+	check(scan.records_read() == Num_recs[3], "SCAN: read %ld orders, "
+		"not %ld\n", scan.records_read(), Num_recs[3]);
+
+	FOCSCAN	limited(foc, FOCSEG_ORDERS_ORDERS);
+	limited.where(where);
+	limited.limit(25);
+	for (got = 0; limited.next(); got++)
+		;
+	check(got == 25, "SCAN: limit(25) gave %ld orders\n", got);
+}
+
+// A FOCZONESCAN selects the records the plain tests do, whatever pages
+// it skips
+void check_zonescan(FOCFILE* foc) {
+
+	FOCZONEMAP	map;
+	FOCEXPR		where;
+	SMDATE		from(mkint32(Rec[3][Num_recs[3] / 2].data));
+	UCHAR		*data;
+	uint64_t	expect_sum = 0, sum = 0;
+	long		expect = 0, got;
+	long		i;
+
+	map.field(FOCFLD_ORDERS_ORDER_DATE);
+	map.field(FOCFLD_ORDERS_QTY);
+	map.build(foc);
+	check(map.records(3) == Num_recs[3], "ZONE: map has %ld orders, not "
+		"%ld\n", map.records(3), Num_recs[3]);
+
+	where.compare(FOCFLD_ORDERS_ORDER_DATE, FOCEXPR_GE, from);
+	where.range(FOCFLD_ORDERS_QTY, 100L, 1500L);
+	where.op_and();
+
+	for (i = 0; i < Num_recs[3]; i++) {
+		int32_t qty = mkint32(Rec[3][i].data + 12);
+		if (mkint32(Rec[3][i].data) >= from.julian() &&
+				qty >= 100 && qty <= 1500) {
+			expect++;
+			expect_sum += record_hash(Rec[3][i].data, 3);
+		}
+	}
+
+	FOCZONESCAN scan(foc, map, FOCSEG_ORDERS_ORDERS);
+	scan.where(where);
+	for (got = 0; (data = scan.next()); got++) {
+		sum += record_hash(data, 3);
+	}
+	check(got == expect && sum == expect_sum, "ZONE: %ld orders, not "
+		"%ld, or not the same ones\n", got, expect);
+	check(scan.pages_skipped() > 0, "ZONE: no pages skipped\n");
+}
+
+// Each estimate is within its error of the count
+void check_estimate(FOCFILE* foc) {
+
+	int	samples[] = { 0, 1, 4, 16, 100000 };
+	long	error, estimate;
+
+	for (unsigned i = 0; i < sizeof(samples) / sizeof(int); i++) {
+		estimate = foc->reccount_estimate(FOCSEG_ORDERS_ORDERS, error,
+				samples[i]);
+		check(error >= 0 && labs(estimate - Num_recs[3]) <= error,
+			"ESTIMATE: sample %d gives %ld give or take %ld, for "
+			"%ld\n", samples[i], estimate, error, Num_recs[3]);
+	}
+
+	estimate = foc->reccount_estimate(FOCSEG_ORDERS_REGION, error, 100000);
+	check(estimate == Num_recs[1] && error == 0, "ESTIMATE: %ld regions "
+		"give or take %ld, not %ld\n", estimate, error, Num_recs[1]);
+}
+
+// A whole sample is the whole segment; part of one is records of the
+// segment, the same each time, and filters as they do
+void check_samplescan(FOCFILE* foc) {
+
+	uint64_t	*hashes = (uint64_t*) xmalloc("hashes",
+				sizeof(uint64_t) * Num_recs[3]);
+	uint64_t	h, sum = 0, expect_sum = 0;
+	UCHAR		*data;
+	long		got, again, passed, bad, i;
+
+	for (i = 0; i < Num_recs[3]; i++) {
+		hashes[i] = record_hash(Rec[3][i].data, 3);
+		expect_sum += hashes[i];
+	}
+	qsort(hashes, Num_recs[3], sizeof(uint64_t), hash_order);
+
+	FOCSAMPLESCAN all(foc, FOCSEG_ORDERS_ORDERS, 1.0);
+	for (got = 0; (data = all.next()); got++) {
+		sum += record_hash(data, 3);
+	}
+	check(got == Num_recs[3] && sum == expect_sum && all.scale() == 1.0,
+		"SAMPLE: the whole segment gave %ld orders, not %ld, scale "
+		"%g\n", got, Num_recs[3], all.scale());
+
+	FOCSAMPLESCAN part(foc, FOCSEG_ORDERS_ORDERS, 0.25, 7);
+	FOCEXPR where;
+	where.compare(FOCFLD_ORDERS_QTY, FOCEXPR_GE, 1000L);
+
+	for (got = passed = bad = 0; (data = part.next()); got++) {
+		h = record_hash(data, 3);
+		bad += !bsearch(&h, hashes, Num_recs[3], sizeof(uint64_t),
+				hash_order);
+		passed += mkint32(data + 12) >= 1000;
+	}
+	check(got > 0 && got < Num_recs[3] && bad == 0, "SAMPLE: a quarter "
+		"gave %ld orders, %ld not the segment's\n", got, bad);
+	check(part.scale() == (double) all.pages_sampled() /
+		part.pages_sampled(), "SAMPLE: scale %g for %ld of %ld pages\n",
+		part.scale(), part.pages_sampled(), all.pages_sampled());
+
+	part.rewind();
+	part.where(where);
+	for (again = 0; part.next(); again++)
+		;
+	check(again == passed, "SAMPLE: the filter passed %ld orders of the "
+		"same pages, not %ld\n", again, passed);
+
+	free(hashes);
+}
+
+// The sketches come near the exact answers, and merging the halves of
+// the segment, or reading one back, changes nothing
+void check_sketches(void) {
+
+	FIELD		date = { FOCFLD_ORDERS_ORDER_DATE };
+	FIELD		amount = { FOCFLD_ORDERS_AMOUNT };
+	FOCHLL		days(FOCFLD_ORDERS_ORDER_DATE);
+	FOCHLL		first(FOCFLD_ORDERS_ORDER_DATE);
+	FOCHLL		second(FOCFLD_ORDERS_ORDER_DATE);
+	FOCHLL		loaded(FOCFLD_ORDERS_ORDER_DATE);
+	FOCQUANTILES	amounts(FOCFLD_ORDERS_AMOUNT);
+	FOCQUANTILES	low(FOCFLD_ORDERS_AMOUNT);
+	FOCQUANTILES	high(FOCFLD_ORDERS_AMOUNT);
+	long		n = Num_recs[3], distinct = 0, at, i;
+	long		*sorted;
+	double		q, value, x, rank;
+	FILE		*fh;
+
+	for (i = 0; i < n; i++) {
+		days.add(Rec[3][i].data);
+		amounts.add(Rec[3][i].data);
+		if (i < n / 2) {
+			first.add(Rec[3][i].data);
+			low.add(Rec[3][i].data);
+		}
+		else {
+			second.add(Rec[3][i].data);
+			high.add(Rec[3][i].data);
+		}
+	}
+
+	sorted = sorted_by_key(date);
+	for (at = 0; at < n; at += key_count(date, sorted, at)) {
+		distinct++;
+	}
+	free(sorted);
+
+	check(days.estimate() > distinct * 0.95 &&
+		days.estimate() < distinct * 1.05, "HLL: %.0lf days, not "
+		"about %ld\n", days.estimate(), distinct);
+
+	first.merge(second);
+	check(first.estimate() == days.estimate(), "HLL: the halves merged "
+		"give %.0lf, not %.0lf\n", first.estimate(), days.estimate());
+
+	if (!(fh = tmpfile())) {
+		die("Can't make a temporary file\n");
+	}
+	days.write(fh);
+	rewind(fh);
+	loaded.read(fh);
+	fclose(fh);
+	check(loaded.estimate() == days.estimate(), "HLL: read back, %.0lf "
+		"days, not %.0lf\n", loaded.estimate(), days.estimate());
+
+	sorted = sorted_by_key(amount);
+	memcpy(&value, Rec[3][sorted[0]].data + 4, sizeof(double));
+	memcpy(&x, Rec[3][sorted[n - 1]].data + 4, sizeof(double));
+	check(amounts.count() == n && amounts.min() == value &&
+		amounts.max() == x, "QUANTILES: %ld values from %.2lf to "
+		"%.2lf, not %ld from %.2lf to %.2lf\n", amounts.count(),
+		amounts.min(), amounts.max(), n, value, x);
+
+	low.merge(high);
+	check(low.count() == n && low.min() == value && low.max() == x,
+		"QUANTILES: the halves merged hold %ld values\n", low.count());
+
+	for (q = 0.1; q < 0.95; q += 0.2) {
+		value = amounts.quantile(q);
+		for (at = 0; at < n; at++) {
+			memcpy(&x, Rec[3][sorted[at]].data + 4, sizeof(double));
+			if (x >= value) {
+				break;
+			}
+		}
+		rank = (double) at / n;
+		check(rank > q - 0.03 && rank < q + 0.03, "QUANTILES: "
+			"quantile(%.1lf) is %.2lf, with %.3lf below it\n", q,
+			value, rank);
+	}
+	free(sorted);
+}
+
+// GROUP BY a parent's field, and by the keys down to the parent, give
+// the groups a plain walk does
+void check_agg(FOCFILE* foc) {
+
+	long	count[256], n_dates[256], dates_at[256], i, g, k;
+	long	groups = 0, seen_groups = 0, bad = 0;
+	double	sum[256], amount_sum[256];
+	int32_t	low[256], high[256];
+	char	status[256][3];
+	int32_t	*dates;
+	double	*amounts;
+
+	// Brute force, by STATUS of the customer
+	for (i = 0; i < Num_recs[3]; i++) {
+		UCHAR	*data = Rec[3][i].data;
+		int32_t	qty = mkint32(data + 12);
+		double	amount;
+
+		memcpy(&amount, data + 4, sizeof(double));
+		for (g = 0; g < groups; g++) {
+			if (memcmp(status[g], parent_data(3, i) + 28, 2) == 0) {
+				break;
+			}
+		}
+		if (g == groups) {
+			if (groups == 256) {
+				die("More than 256 STATUS values\n");
+			}
+			memcpy(status[g], parent_data(3, i) + 28, 2);
+			status[g][2] = '\0';
+			count[g] = 0;
+			sum[g] = amount_sum[g] = 0;
+			low[g] = high[g] = qty;
+			groups++;
+		}
+		count[g]++;
+		sum[g] += qty;
+		amount_sum[g] += amount;
+		if (qty < low[g]) low[g] = qty;
+		if (qty > high[g]) high[g] = qty;
+	}
+
+	// Each group's dates and amounts, together
+	dates = (int32_t*) xmalloc("dates", sizeof(int32_t) * Num_recs[3]);
+	amounts = (double*) xmalloc("amounts", sizeof(double) * Num_recs[3]);
+	for (g = 0, k = 0; g < groups; g++) {
+		dates_at[g] = k;
+		for (i = 0; i < Num_recs[3]; i++) {
+			if (memcmp(status[g], parent_data(3, i) + 28, 2) == 0) {
+				dates[k] = mkint32(Rec[3][i].data);
+				memcpy(&amounts[k], Rec[3][i].data + 4,
+					sizeof(double));
+				k++;
+			}
+		}
+		qsort(dates + dates_at[g], count[g], sizeof(int32_t),
+			int32_order);
+		qsort(amounts + dates_at[g], count[g], sizeof(double),
+			double_order);
+		for (n_dates[g] = 0, i = 0; i < count[g]; i++) {
+			n_dates[g] += i == 0 || dates[dates_at[g] + i] !=
+				dates[dates_at[g] + i - 1];
+		}
+	}
+	check(groups > 1, "AGG: only %ld STATUS value\n", groups);
+
+	FOCAGG	agg(foc, FOCSEG_ORDERS_ORDERS);
+	char	by[3];
+	agg.group_by(FOCFLD_ORDERS_STATUS);
+	int	m_count = agg.count();
+	int	m_sum = agg.sum(FOCFLD_ORDERS_QTY);
+	int	m_min = agg.min(FOCFLD_ORDERS_QTY);
+	int	m_max = agg.max(FOCFLD_ORDERS_QTY);
+	int	m_avg = agg.avg(FOCFLD_ORDERS_AMOUNT);
+	int	m_distinct = agg.distinct(FOCFLD_ORDERS_ORDER_DATE);
+	int	m_median = agg.percentile(FOCFLD_ORDERS_AMOUNT, 50);
+
+	by[2] = '\0';
+	while (agg.next()) {
+		agg.hold(by, FOCFLD_ORDERS_STATUS);
+		for (g = 0; g < groups && strcmp(by, status[g]) != 0; g++)
+			;
+		if (g == groups) {
+			check(0, "AGG: a group for STATUS \"%s\"\n", by);
+			continue;
+		}
+		seen_groups++;
+
+		double	avg = amount_sum[g] / count[g];
+		double	d = agg.value(m_distinct);
+		double	median = agg.value(m_median);
+
+		for (k = 0; k < count[g] &&
+				amounts[dates_at[g] + k] < median; k++)
+			;
+		check(agg.value(m_count) == count[g] &&
+			agg.value(m_sum) == sum[g] &&
+			agg.value(m_min) == low[g] &&
+			agg.value(m_max) == high[g] &&
+			agg.value(m_avg) > avg - 1e-6 * (avg < 0 ? -avg : avg) &&
+			agg.value(m_avg) < avg + 1e-6 * (avg < 0 ? -avg : avg),
+			"AGG: STATUS \"%s\" measures aren't the walk's\n", by);
+		check(d > n_dates[g] * 0.95 && d < n_dates[g] * 1.05,
+			"AGG: STATUS \"%s\" has about %.0lf dates, not %ld\n",
+			by, d, n_dates[g]);
+		check(k > count[g] * 0.47 && k < count[g] * 0.53, "AGG: "
+			"STATUS \"%s\" median has %ld of %ld below it\n", by,
+			k, count[g]);
+	}
+	check(seen_groups == groups && agg.number_of_groups() == groups,
+		"AGG: %ld STATUS groups, not %ld\n", agg.number_of_groups(),
+		groups);
+	free(dates);
+	free(amounts);
+
+	// By the keys down to the customer, which streams, with a filter
+	FOCAGG		keys(foc, FOCSEG_ORDERS_ORDERS);
+	FOCEXPR		where;
+	char		region[9];
+	int32_t		id;
+	char		*met = (char*) xmalloc("met", Num_recs[2]);
+
+	build_expr(where);
+	keys.where(where);
+	keys.group_by(FOCFLD_ORDERS_REGION);
+	keys.group_by(FOCFLD_ORDERS_CUST_ID);
+	m_count = keys.count();
+	check(keys.is_streaming(), "AGG: BY REGION BY CUST_ID doesn't "
+		"stream\n");
+
+	memset(met, 0, Num_recs[2]);
+	region[8] = '\0';
+	for (g = 0; keys.next(); g++) {
+		keys.hold(region, FOCFLD_ORDERS_REGION);
+		keys.hold(id, FOCFLD_ORDERS_CUST_ID);
+		for (k = 0; k < Num_recs[2]; k++) {
+			if (mkint32(Rec[2][k].data) == id &&
+				memcmp(parent_data(2, k), region, 8) == 0) {
+				break;
+			}
+		}
+		if (k == Num_recs[2] || met[k]) {
+			bad++;
+			continue;
+		}
+		met[k] = 1;
+		for (count[0] = 0, i = 0; i < Num_recs[3]; i++) {
+			count[0] += Rec[3][i].parent == k && passes_expr(i);
+		}
+		bad += keys.value(m_count) != count[0];
+	}
+	for (count[0] = 0, k = 0; k < Num_recs[2]; k++) {
+		for (i = 0; i < Num_recs[3]; i++) {
+			if (Rec[3][i].parent == k && passes_expr(i)) {
+				count[0]++;
+				break;
+			}
+		}
+	}
+	check(bad == 0 && g == count[0], "AGG: %ld customer groups, %ld "
+		"wrong, not %ld\n", g, bad, count[0]);
+	free(met);
+}
+
+// Every instance above the orders, its parent, children, orders and
+// total QTY
+void check_rollup(FOCFILE* foc) {
+
+	FOCROLLUP	roll(foc, FOCSEG_ORDERS_ORDERS);
+	FOCPTR		where;
+	long		children, orders, bad = 0, i, j;
+	double		qty, all = 0;
+	int		seg, m;
+
+	m = roll.measure(FOCFLD_ORDERS_QTY);
+	roll.run();
+
+	for (i = 0; i < Num_recs[3]; i++) {
+		all += mkint32(Rec[3][i].data + 12);
+	}
+	check(roll.subtotal() == Num_recs[3] && roll.total(m) == all,
+		"ROLLUP: %ld orders of %.0lf, not %ld of %.0lf\n",
+		roll.subtotal(), roll.total(m), Num_recs[3], all);
+
+	for (seg = 1; seg < NUM_SEGS; seg++) {
+		check(roll.instances(seg) == Num_recs[seg], "ROLLUP: %ld "
+			"instances of segment %d, not %ld\n",
+			roll.instances(seg), seg, Num_recs[seg]);
+		if (roll.instances(seg) != Num_recs[seg]) {
+			continue;
+		}
+
+		for (i = 0; i < Num_recs[seg]; i++) {
+			children = orders = 0;
+			qty = 0;
+			for (j = 0; j < Num_recs[seg + 1]; j++) {
+				children += Rec[seg + 1][j].parent == i;
+			}
+			for (j = 0; j < Num_recs[3]; j++) {
+				long p = Rec[3][j].parent;
+				if (seg == 1) {
+					p = Rec[2][p].parent;
+				}
+				if (p == i) {
+					orders++;
+					qty += mkint32(Rec[3][j].data + 12);
+				}
+			}
+
+			roll.position(seg, i, where);
+			bad += roll.children(seg, i) != children ||
+				roll.subtotal(seg, i) != orders ||
+				roll.total(m, seg, i) != qty ||
+				find_rec(seg, where) != &Rec[seg][i] ||
+				(seg > 1 && roll.parent(seg, i) !=
+					Rec[seg][i].parent);
+		}
+	}
+	check(bad == 0, "ROLLUP: %ld instances aren't the walk's\n", bad);
+}
+
+// An alpha field, without its trailing blanks
+void alpha_value(char* s, UCHAR* field, int length) {
+
+	memcpy(s, field, length);
+	while (length > 0 && s[length - 1] == ' ') {
+		length--;
+	}
+	s[length] = '\0';
+}
+
+// FNV-1a of a data area, so records can be told apart by content
+uint64_t record_hash(UCHAR* data, int seg) {
+
+	uint64_t	h = 14695981039346656037ULL;
+
+	for (int i = 0; i < Data_length[seg]; i++) {
+		h = (h ^ data[i]) * 1099511628211ULL;
+	}
+
+	return h;
+}
+
+// For qsort(): records of Sort_field.seg by the field, then walk order
+int key_order(const void *a, const void *b) {
+
+	REC	*x = &Rec[Sort_field.seg][*(const long*) a];
+	REC	*y = &Rec[Sort_field.seg][*(const long*) b];
+	int	c = field_compare(Sort_field.type, Sort_field.length,
+			x->data + Sort_field.offset,
+			y->data + Sort_field.offset);
+
+	return c ? c : walk_order(a, b);
+}
+
+int position_order(const void *a, const void *b) {
+
+	REC	*x = &Rec[Sort_field.seg][*(const long*) a];
+	REC	*y = &Rec[Sort_field.seg][*(const long*) b];
+
+	if (x->page != y->page) {
+		return x->page - y->page;
+	}
+	return x->word - y->word;
+}
+
+// For qsort(): the best of Sort_field first, then the scan's order
+int best_order(const void *a, const void *b) {
+
+	long	x = *(const long*) a, y = *(const long*) b;
+	int	c = field_compare(Sort_field.type, Sort_field.length,
+			Rec[Sort_field.seg][x].data + Sort_field.offset,
+			Rec[Sort_field.seg][y].data + Sort_field.offset);
+
+	if (c) {
+		return Highest ? -c : c;
+	}
+	return (Scan_rank[x] > Scan_rank[y]) - (Scan_rank[x] < Scan_rank[y]);
+}
+
+int walk_order(const void *a, const void *b) {
+
+	long	x = *(const long*) a, y = *(const long*) b;
+
+	return (x > y) - (x < y);
+}
+
+int hash_order(const void *a, const void *b) {
+
+	uint64_t	x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+
+	return (x > y) - (x < y);
+}
+
+int int32_order(const void *a, const void *b) {
+
+	int32_t		x = *(const int32_t*) a, y = *(const int32_t*) b;
+
+	return (x > y) - (x < y);
+}
+
+int double_order(const void *a, const void *b) {
+
+	double		x = *(const double*) a, y = *(const double*) b;
+
+	return (x > y) - (x < y);
+}
+
+/* vi magic
+vi:set ts=8:
+vi:set sw=8:
+*/